@@ -0,0 +1,47 @@
+#include "bench_util.h"
+#include "lightbar_daemon.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Tick lateness of the daemon under load: many sessions at 60 Hz, started
+ * at staggered times so their ticks spread over the frame, with frames
+ * rendered but discarded.
+ *
+ *   bench_daemon [sessions [workers [seconds]]]
+ */
+
+static void sleep_ns(uint64_t ns) {
+    struct timespec ts = { (time_t)(ns / 1000000000u), (long)(ns % 1000000000u) };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+int main(int argc, char **argv) {
+    int sessions = argc > 1 ? atoi(argv[1]) : 500;
+    int workers = argc > 2 ? atoi(argv[2]) : 4;
+    int seconds = argc > 3 ? atoi(argv[3]) : 5;
+    static char reply[65536];
+    char line[128];
+
+    LightbarDaemon *server = lightbar_daemon_create(workers);
+    if (!server || sessions < 1 || seconds < 1) {
+        fprintf(stderr, "usage: %s [sessions [workers [seconds]]]\n", argv[0]);
+        return 1;
+    }
+    for (int i = 0; i < sessions; i++) {
+        snprintf(line, sizeof(line), "add s%d leds=%d speed=%d glow=3 rate=60 smooth=%d",
+                 i, 60 + i % 240, 5 + i % 40, i % 2);
+        lightbar_daemon_command(server, line, reply, sizeof(reply));
+    }
+    for (int i = 0; i < sessions; i++) {
+        snprintf(line, sizeof(line), "start s%d", i);
+        lightbar_daemon_command(server, line, reply, sizeof(reply));
+        sleep_ns(16666667u / (uint64_t)sessions);
+    }
+    sleep_ns((uint64_t)seconds * 1000000000u);
+    lightbar_daemon_command(server, "stats", reply, sizeof(reply));
+    printf("%d sessions at 60 Hz, %d workers, %d s\n%s", sessions, workers, seconds, reply);
+    lightbar_daemon_destroy(server);
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "bench_util.h"
+#include "lightbar.h"
+#include "lightbar_fx.h"
+#include <stdio.h>
+
+/* Cost of one update + render call, float core against the fixed-point
+ * one, on a strip sized like the demo. */
+
+#define NUM_LEDS 24
+#define CALLS 2000000
+
+typedef struct {
+    double ns;
+    double cycles;
+    double instructions;
+} Cost;
+
+static volatile uint8_t sink;
+
+static Cost run_float(int fd) {
+    LightbarConfig config = {
+        .num_leds = NUM_LEDS, .speed = 15.0f, .end_pause_ms = 200,
+        .glow_radius = 3, .color = { 255, 40, 0 }, .smooth = 1
+    };
+    LightbarState state;
+    Led leds[NUM_LEDS];
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+
+    uint64_t ns = bench_ns();
+    uint64_t cycles = bench_cycles();
+    bench_instructions_start(fd);
+    for (int i = 0; i < CALLS; i++) {
+        lightbar_update(&state, &config, 16.0f);
+        lightbar_render(&state, &config, leds);
+        sink = leds[i % NUM_LEDS].r;
+    }
+    uint64_t instructions = bench_instructions_stop(fd);
+    Cost cost = {
+        (double)(bench_ns() - ns) / CALLS,
+        (double)(bench_cycles() - cycles) / CALLS,
+        (double)instructions / CALLS
+    };
+    return cost;
+}
+
+static Cost run_fx(int fd) {
+    LightbarFxConfig config = {
+        .num_leds = NUM_LEDS, .end_pause_ms = 200,
+        .glow_radius = 3, .color = { 255, 40, 0 }, .smooth = 1
+    };
+    LightbarFxState state;
+    Led leds[NUM_LEDS];
+    lightbar_fx_set_speed(&config, LIGHTBAR_FX_SPEED(15.0));
+    lightbar_fx_init(&state, &config);
+    lightbar_fx_start(&state);
+
+    uint64_t ns = bench_ns();
+    uint64_t cycles = bench_cycles();
+    bench_instructions_start(fd);
+    for (int i = 0; i < CALLS; i++) {
+        lightbar_fx_update(&state, &config, 16000);
+        lightbar_fx_render(&state, &config, leds);
+        sink = leds[i % NUM_LEDS].r;
+    }
+    uint64_t instructions = bench_instructions_stop(fd);
+    Cost cost = {
+        (double)(bench_ns() - ns) / CALLS,
+        (double)(bench_cycles() - cycles) / CALLS,
+        (double)instructions / CALLS
+    };
+    return cost;
+}
+
+static void report(const char *name, Cost cost) {
+    printf("%-6s %8.1f ns %8.1f cycles ", name, cost.ns, cost.cycles);
+    if (cost.instructions > 0) {
+        printf("%8.1f instructions\n", cost.instructions);
+    } else {
+        printf("%8s instructions\n", "n/a");
+    }
+}
+
+int main(void) {
+    int fd = bench_instructions_open();
+    printf("update + render, %d LEDs, per call\n", NUM_LEDS);
+    report("float", run_float(fd));
+    report("fx", run_fx(fd));
+    if (fd < 0) {
+        printf("(instruction counts need perf_event_open; see /proc/sys/kernel/perf_event_paranoid)\n");
+    } else {
+        close(fd);
+    }
+    return 0;
+}
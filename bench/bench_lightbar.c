@@ -0,0 +1,498 @@
+#include "bench_util.h"
+#include "lightbar.h"
+#include "lightbar_fleet.h"
+#include "lightbar_fx.h"
+#include "lightbar_wire.h"
+#include "lightbar_layout.h"
+#include "lightbar_power.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Micro-benchmarks for the update and render hot paths. Each case is timed
+ * in batches of BATCH calls; the per-call times of SAMPLES batches give the
+ * median and p99. Instructions per call come from a separate untimed pass
+ * when perf events are available.
+ *
+ *   bench_lightbar [out.json]             run every case, write JSON
+ *   bench_lightbar --compare old new      per-case change between two runs
+ *   bench_lightbar --plan run             each *_plan case against the same
+ *                                         case re-deriving from the config
+ */
+
+#define BATCH 32
+#define SAMPLES 1000
+#define MAX_LEDS 10000
+#define DT_COUNT 1024
+#define STATE_COUNT 64
+#define LAYOUT_CHANNELS 4
+
+typedef struct Bench Bench;
+
+struct Bench {
+    char name[96];
+    LightbarConfig config;
+    LightbarPlan plan;
+    LightbarState state;
+    LightbarDelta delta;
+    LightbarFxConfig fx_config;
+    LightbarFxState fx_state;
+    LightbarWire wire;
+    LightbarWire layout_wires[LAYOUT_CHANNELS];
+    LightbarPower power;
+    LightbarFleet fleet;
+    /* Batches to time, if fewer than SAMPLES */
+    int samples;
+    /* Wind the bar down again each time it comes to rest */
+    int stopping;
+    const float *dts;
+    unsigned dt_index;
+    /* Consecutive animation states the render cases cycle through */
+    LightbarState states[STATE_COUNT];
+    unsigned state_index;
+    void (*run)(Bench *bench, int calls);
+};
+
+typedef struct {
+    double median_ns;
+    double p99_ns;
+    double instructions;
+} BenchResult;
+
+static Led leds[MAX_LEDS];
+static uint8_t wire_data[MAX_LEDS * 3];
+static uint8_t layout_data[LAYOUT_CHANNELS][MAX_LEDS * 3];
+/* The strip split across LAYOUT_CHANNELS outputs, every other one reversed */
+static LightbarLayout layout;
+static float dt_frame[DT_COUNT];
+static float dt_jitter[DT_COUNT];
+static float dt_stall[DT_COUNT];
+static double samples[SAMPLES];
+
+static void make_dts(void) {
+    srand(1);
+    for (int i = 0; i < DT_COUNT; i++) {
+        dt_frame[i] = 16.667f;
+        dt_jitter[i] = (float)(1 + rand() % 33);
+        /* Mostly 60 Hz frames, with a multi-second stall now and then */
+        dt_stall[i] = (i % 128 == 127) ? (float)(2000 + rand() % 8000) : 16.667f;
+    }
+}
+
+static inline float next_dt(Bench *b) {
+    return b->dts[b->dt_index++ % DT_COUNT];
+}
+
+static inline void keep_stopping(Bench *b) {
+    if (b->stopping && b->state.phase == LIGHTBAR_STOPPED) {
+        lightbar_start(&b->state);
+        lightbar_stop(&b->state, &b->config);
+    }
+}
+
+static void run_update(Bench *b, int calls) {
+    for (int i = 0; i < calls; i++) {
+        keep_stopping(b);
+        lightbar_update(&b->state, &b->config, next_dt(b));
+    }
+}
+
+static void run_update_plan(Bench *b, int calls) {
+    for (int i = 0; i < calls; i++) {
+        keep_stopping(b);
+        lightbar_update_plan(&b->state, &b->plan, next_dt(b));
+    }
+}
+
+static void run_advance(Bench *b, int calls) {
+    for (int i = 0; i < calls; i++) {
+        keep_stopping(b);
+        lightbar_advance(&b->state, &b->config, next_dt(b));
+    }
+}
+
+static void run_fx_update(Bench *b, int calls) {
+    for (int i = 0; i < calls; i++) {
+        if (b->stopping && b->fx_state.phase == LIGHTBAR_STOPPED) {
+            lightbar_fx_start(&b->fx_state);
+            lightbar_fx_stop(&b->fx_state, &b->fx_config);
+        }
+        lightbar_fx_update(&b->fx_state, &b->fx_config, (uint32_t)(next_dt(b) * 1000.0f));
+    }
+}
+
+static void run_fleet_update(Bench *b, int calls) {
+    for (int i = 0; i < calls; i++) {
+        lightbar_fleet_update(&b->fleet, next_dt(b));
+    }
+}
+
+static inline const LightbarState *next_state(Bench *b) {
+    return &b->states[b->state_index++ % STATE_COUNT];
+}
+
+static void run_render(Bench *b, int calls) {
+    for (int i = 0; i < calls; i++) {
+        lightbar_render(next_state(b), &b->config, leds);
+    }
+}
+
+static void run_render_plan(Bench *b, int calls) {
+    for (int i = 0; i < calls; i++) {
+        lightbar_render_plan(next_state(b), &b->plan, leds);
+    }
+}
+
+static void run_render_delta(Bench *b, int calls) {
+    int from, to;
+    for (int i = 0; i < calls; i++) {
+        lightbar_render_delta(&b->delta, next_state(b), &b->config, leds, &from, &to);
+    }
+}
+
+static void run_render_delta_plan(Bench *b, int calls) {
+    int from, to;
+    for (int i = 0; i < calls; i++) {
+        lightbar_render_delta_plan(&b->delta, next_state(b), &b->plan, leds, &from, &to);
+    }
+}
+
+static void run_render_delta_power(Bench *b, int calls) {
+    int from, to;
+    for (int i = 0; i < calls; i++) {
+        lightbar_power_render_delta(&b->power, &b->delta, next_state(b), &b->plan, leds,
+                                    &from, &to);
+    }
+}
+
+/* The same estimate by summing the whole frame after each delta render */
+static void run_render_delta_sum(Bench *b, int calls) {
+    int from, to;
+    for (int i = 0; i < calls; i++) {
+        lightbar_render_delta(&b->delta, next_state(b), &b->config, leds, &from, &to);
+        b->power.ma = lightbar_power_frame_ma(&b->power.model, leds, b->config.num_leds);
+    }
+}
+
+static void run_wire(Bench *b, int calls) {
+    for (int i = 0; i < calls; i++) {
+        lightbar_wire_render(&b->wire, next_state(b), &b->config);
+    }
+}
+
+static void run_wire_layout(Bench *b, int calls) {
+    for (int i = 0; i < calls; i++) {
+        lightbar_wire_render_layout(b->layout_wires, &layout, next_state(b), &b->config);
+    }
+}
+
+static void setup_layout(Bench *b) {
+    uint16_t num_leds = b->config.num_leds;
+    uint32_t leds[LAYOUT_CHANNELS];
+    int from = 0;
+    for (int c = 0; c < LAYOUT_CHANNELS; c++) {
+        int to = num_leds * (c + 1) / LAYOUT_CHANNELS;
+        leds[c] = (uint32_t)(to - from);
+        from = to;
+    }
+    lightbar_layout_free(&layout);
+    if (lightbar_layout_init(&layout, num_leds, LAYOUT_CHANNELS, leds) != 0) exit(1);
+    from = 0;
+    for (int c = 0; c < LAYOUT_CHANNELS; c++) {
+        if (lightbar_layout_segment(&layout, from, (int)leds[c], c, 0, c & 1) != 0) exit(1);
+        lightbar_wire_init(&b->layout_wires[c], LIGHTBAR_WIRE_GRB, (uint16_t)leds[c], 0,
+                           layout_data[c]);
+        from += (int)leds[c];
+    }
+    if (lightbar_layout_compile(&layout) != 0) exit(1);
+}
+
+static void setup_states(Bench *b) {
+    LightbarState state;
+    lightbar_init(&state, &b->config);
+    lightbar_start(&state);
+    for (int i = 0; i < STATE_COUNT; i++) {
+        lightbar_update(&state, &b->config, 16.667f);
+        b->states[i] = state;
+    }
+    lightbar_plan_sync(&b->plan, &b->config);
+    lightbar_delta_reset(&b->delta);
+    /* WS2812B on a supply that cannot light the widest glows at full */
+    LightbarPowerModel model = { 20, 20, 20, 1, (uint32_t)b->config.num_leds + 200 };
+    lightbar_power_init(&b->power, &model);
+    lightbar_wire_init(&b->wire, LIGHTBAR_WIRE_GRB, b->config.num_leds, 0, wire_data);
+    setup_layout(b);
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static BenchResult measure(Bench *b, int perf_fd) {
+    BenchResult result;
+    int count = b->samples ? b->samples : SAMPLES;
+    b->run(b, BATCH * 8);
+    for (int s = 0; s < count; s++) {
+        uint64_t start = bench_ns();
+        b->run(b, BATCH);
+        samples[s] = (double)(bench_ns() - start) / BATCH;
+    }
+    qsort(samples, (size_t)count, sizeof(samples[0]), compare_double);
+    result.median_ns = samples[count / 2];
+    result.p99_ns = samples[count * 99 / 100];
+
+    result.instructions = 0.0;
+    if (perf_fd >= 0) {
+        bench_instructions_start(perf_fd);
+        b->run(b, BATCH * count);
+        result.instructions = (double)bench_instructions_stop(perf_fd) / (BATCH * count);
+    }
+    return result;
+}
+
+static FILE *json;
+static int json_first = 1;
+
+static void report(Bench *b, int perf_fd) {
+    BenchResult r = measure(b, perf_fd);
+    printf("%-52s %10.1f %10.1f", b->name, r.median_ns, r.p99_ns);
+    if (r.instructions > 0.0) {
+        printf(" %10.1f\n", r.instructions);
+    } else {
+        printf(" %10s\n", "n/a");
+    }
+    if (json) {
+        fprintf(json, "%s    {\"name\": \"%s\", \"median_ns\": %.2f, \"p99_ns\": %.2f, ",
+                json_first ? "" : ",\n", b->name, r.median_ns, r.p99_ns);
+        if (r.instructions > 0.0) {
+            fprintf(json, "\"instructions\": %.1f}", r.instructions);
+        } else {
+            fprintf(json, "\"instructions\": null}");
+        }
+        json_first = 0;
+    }
+}
+
+static void init_bench(Bench *b, uint16_t num_leds, float speed, uint16_t glow_radius) {
+    memset(b, 0, sizeof(*b));
+    b->config.num_leds = num_leds;
+    b->config.speed = speed;
+    b->config.end_pause_ms = 200;
+    b->config.glow_radius = glow_radius;
+    b->config.color.r = 255;
+    b->config.color.g = 80;
+    b->config.color.b = 20;
+    lightbar_plan_init(&b->plan, &b->config);
+    lightbar_init(&b->state, &b->config);
+    lightbar_start(&b->state);
+}
+
+static void bench_updates(int perf_fd) {
+    static const float speeds[] = { 5.0f, 15.0f, 60.0f, 500.0f };
+    static const struct { const char *name; const float *dts; } patterns[] = {
+        { "frame", dt_frame }, { "jitter", dt_jitter }, { "stall", dt_stall }
+    };
+    static const struct { const char *name; void (*run)(Bench *, int); } fns[] = {
+        { "update", run_update }, { "update_plan", run_update_plan },
+        { "advance", run_advance }, { "fx_update", run_fx_update }
+    };
+    Bench b;
+
+    for (size_t f = 0; f < sizeof(fns) / sizeof(fns[0]); f++) {
+        for (size_t s = 0; s < sizeof(speeds) / sizeof(speeds[0]); s++) {
+            for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); p++) {
+                for (int stopping = 0; stopping <= 1; stopping++) {
+                    init_bench(&b, 144, speeds[s], 2);
+                    lightbar_fx_set_speed(&b.fx_config, LIGHTBAR_FX_SPEED(speeds[s]));
+                    b.fx_config.num_leds = b.config.num_leds;
+                    b.fx_config.end_pause_ms = b.config.end_pause_ms;
+                    lightbar_fx_init(&b.fx_state, &b.fx_config);
+                    lightbar_fx_start(&b.fx_state);
+                    b.stopping = stopping;
+                    b.dts = patterns[p].dts;
+                    b.run = fns[f].run;
+                    snprintf(b.name, sizeof(b.name), "%s/speed=%g/dt=%s%s", fns[f].name,
+                             (double)speeds[s], patterns[p].name,
+                             stopping ? "/stopping" : "");
+                    report(&b, perf_fd);
+                }
+            }
+        }
+    }
+}
+
+static void bench_renders(int perf_fd) {
+    static const uint16_t sizes[] = { 24, 144, 1000, 10000 };
+    static const uint16_t radii[] = { 0, 2, 8, 32 };
+    static const struct { const char *name; void (*run)(Bench *, int); } fns[] = {
+        { "render", run_render }, { "render_plan", run_render_plan },
+        { "render_delta", run_render_delta }, { "render_delta_plan", run_render_delta_plan },
+        { "render_delta_power", run_render_delta_power },
+        { "render_delta_sum", run_render_delta_sum }, { "wire_grb", run_wire },
+        { "wire_grb_layout4", run_wire_layout }
+    };
+    Bench b;
+
+    for (size_t f = 0; f < sizeof(fns) / sizeof(fns[0]); f++) {
+        for (size_t n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+            for (size_t r = 0; r < sizeof(radii) / sizeof(radii[0]); r++) {
+                for (int smooth = 0; smooth <= 1; smooth++) {
+                    init_bench(&b, sizes[n], 45.0f, radii[r]);
+                    b.config.smooth = (uint8_t)smooth;
+                    setup_states(&b);
+                    b.run = fns[f].run;
+                    snprintf(b.name, sizeof(b.name), "%s/leds=%u/radius=%u%s", fns[f].name,
+                             (unsigned)sizes[n], (unsigned)radii[r], smooth ? "/smooth" : "");
+                    report(&b, perf_fd);
+                }
+            }
+        }
+    }
+}
+
+/* Whole-fleet updates of mixed strips and speeds; with one_fast, a single
+ * instance takes hundreds of steps a frame while the rest take one or none. */
+static void bench_fleets(int perf_fd) {
+    static const uint32_t counts[] = { 1000, 10000, 100000 };
+    static const struct { const char *name; const float *dts; } patterns[] = {
+        { "frame", dt_frame }, { "jitter", dt_jitter }, { "stall", dt_stall }
+    };
+    Bench b;
+
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); p++) {
+            for (int one_fast = 0; one_fast <= 1; one_fast++) {
+                init_bench(&b, 144, 45.0f, 2);
+                if (lightbar_fleet_init(&b.fleet, counts[c]) != 0) exit(1);
+                srand(2);
+                for (uint32_t i = 0; i < counts[c]; i++) {
+                    LightbarConfig config = b.config;
+                    config.num_leds = (uint16_t)(24 + rand() % 121);
+                    config.speed = (one_fast && i == 0) ? 20000.0f : (float)(5 + rand() % 60);
+                    lightbar_fleet_add(&b.fleet, &config);
+                    lightbar_fleet_start(&b.fleet, i);
+                }
+                b.samples = (int)(SAMPLES * 10000 / counts[c]);
+                if (b.samples > SAMPLES) b.samples = SAMPLES;
+                b.dts = patterns[p].dts;
+                b.run = run_fleet_update;
+                snprintf(b.name, sizeof(b.name), "fleet_update/count=%u/dt=%s%s",
+                         (unsigned)counts[c], patterns[p].name, one_fast ? "/one_fast" : "");
+                report(&b, perf_fd);
+                lightbar_fleet_free(&b.fleet);
+            }
+        }
+    }
+}
+
+typedef struct {
+    char name[96];
+    double median_ns;
+    double p99_ns;
+} Entry;
+
+static int load(const char *path, Entry *entries, int max) {
+    FILE *f = fopen(path, "r");
+    char line[512];
+    int count = 0;
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    while (count < max && fgets(line, sizeof(line), f)) {
+        Entry *e = &entries[count];
+        if (sscanf(line, " {\"name\": \"%95[^\"]\", \"median_ns\": %lf, \"p99_ns\": %lf",
+                   e->name, &e->median_ns, &e->p99_ns) == 3) {
+            count++;
+        }
+    }
+    fclose(f);
+    return count;
+}
+
+static int compare(const char *old_path, const char *new_path) {
+    static Entry old_entries[1024], new_entries[1024];
+    int n_old = load(old_path, old_entries, 1024);
+    int n_new = load(new_path, new_entries, 1024);
+    if (n_old < 0 || n_new < 0) return 1;
+
+    printf("%-52s %10s %10s %8s\n", "case", "old ns", "new ns", "change");
+    for (int i = 0; i < n_new; i++) {
+        for (int j = 0; j < n_old; j++) {
+            if (strcmp(new_entries[i].name, old_entries[j].name) != 0) continue;
+            double before = old_entries[j].median_ns;
+            double after = new_entries[i].median_ns;
+            printf("%-52s %10.1f %10.1f %+7.1f%%\n", new_entries[i].name, before, after,
+                   before > 0.0 ? (after - before) * 100.0 / before : 0.0);
+            break;
+        }
+    }
+    return 0;
+}
+
+/* Pairs each "fn_plan/..." case of one run with "fn/..." */
+static int compare_plan(const char *path) {
+    static Entry entries[1024];
+    int count = load(path, entries, 1024);
+    if (count < 0) return 1;
+
+    printf("%-52s %10s %10s %8s\n", "case", "config ns", "plan ns", "change");
+    for (int i = 0; i < count; i++) {
+        char name[96];
+        char *plan = strstr(entries[i].name, "_plan/");
+        if (!plan) continue;
+        snprintf(name, sizeof(name), "%.*s%s", (int)(plan - entries[i].name), entries[i].name,
+                 plan + 5);
+        for (int j = 0; j < count; j++) {
+            if (strcmp(name, entries[j].name) != 0) continue;
+            double before = entries[j].median_ns;
+            double after = entries[i].median_ns;
+            printf("%-52s %10.1f %10.1f %+7.1f%%\n", entries[i].name, before, after,
+                   before > 0.0 ? (after - before) * 100.0 / before : 0.0);
+            break;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 4 && strcmp(argv[1], "--compare") == 0) {
+        return compare(argv[2], argv[3]);
+    }
+    if (argc == 3 && strcmp(argv[1], "--plan") == 0) {
+        return compare_plan(argv[2]);
+    }
+
+    const char *json_path = (argc > 1) ? argv[1] : NULL;
+    if (json_path) {
+        json = fopen(json_path, "w");
+        if (!json) {
+            perror(json_path);
+            return 1;
+        }
+    }
+
+    int perf_fd = bench_instructions_open();
+    make_dts();
+
+    if (json) {
+        fprintf(json, "{\n  \"batch\": %d,\n  \"samples\": %d,\n  \"results\": [\n",
+                BATCH, SAMPLES);
+    }
+    printf("%-52s %10s %10s %10s\n", "case", "median ns", "p99 ns", "instr");
+    bench_updates(perf_fd);
+    bench_renders(perf_fd);
+    bench_fleets(perf_fd);
+    if (json) {
+        fprintf(json, "\n  ]\n}\n");
+        fclose(json);
+        printf("wrote %s\n", json_path);
+    }
+    if (perf_fd < 0) {
+        printf("(instruction counts need perf_event_open; see /proc/sys/kernel/perf_event_paranoid)\n");
+    } else {
+        close(perf_fd);
+    }
+    return 0;
+}
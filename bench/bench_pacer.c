@@ -0,0 +1,49 @@
+#include "bench_util.h"
+#include "lightbar_pacer.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* One strip driven by the frame pacer: wakeup lateness, update and render
+ * cost, and the drift corrections, printed at the end. SIGUSR1 prints them
+ * mid-run.
+ *
+ *   bench_pacer [rate_hz [seconds]]
+ */
+
+static volatile sig_atomic_t dump_requested;
+
+static void on_usr1(int sig) {
+    (void)sig;
+    dump_requested = 1;
+}
+
+int main(int argc, char **argv) {
+    int rate = argc > 1 ? atoi(argv[1]) : 1000;
+    int seconds = argc > 2 ? atoi(argv[2]) : 5;
+    static LightbarPacer pacer;
+    static Led leds[300];
+    LightbarConfig config = { .num_leds = 300, .speed = 45.0f, .end_pause_ms = 120,
+                              .glow_radius = 4, .color = { 255, 80, 0 }, .smooth = 1 };
+    LightbarState state;
+
+    if (seconds < 1 || rate < 0 || lightbar_pacer_init(&pacer, (uint32_t)rate) != 0) {
+        fprintf(stderr, "usage: %s [rate_hz (%d-%d) [seconds]]\n", argv[0],
+                LIGHTBAR_PACER_MIN_HZ, LIGHTBAR_PACER_MAX_HZ);
+        return 1;
+    }
+    signal(SIGUSR1, on_usr1);
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+
+    uint64_t frames = (uint64_t)rate * (uint64_t)seconds;
+    while (pacer.frame < frames) {
+        lightbar_pacer_frame(&pacer, &state, &config, leds);
+        if (dump_requested) {
+            dump_requested = 0;
+            lightbar_pacer_dump(&pacer, stdout);
+        }
+    }
+    lightbar_pacer_dump(&pacer, stdout);
+    return 0;
+}
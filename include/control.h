@@ -0,0 +1,59 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stdint.h>
+#include "lightbar.h"
+
+/* Line protocol of the daemon's control socket. One command per line:
+ *
+ *   add <name> [key=value ...]   create a session (stopped)
+ *   set <name> key=value ...     change a running session's settings
+ *   start <name> | stop <name>   begin, or wind down, the oscillation
+ *   remove <name>
+ *   stats [<name>]               tick lateness, per session or overall
+ *   list
+ *
+ * Keys: leds, speed, pause (ms), glow, color (rrggbb), smooth (0/1),
+ * rate (ticks per second) and sink (output path, or "null"). */
+
+#define CONTROL_NAME_MAX 32
+#define CONTROL_SINK_MAX 108
+
+typedef enum {
+    CONTROL_ADD,
+    CONTROL_SET,
+    CONTROL_START,
+    CONTROL_STOP,
+    CONTROL_REMOVE,
+    CONTROL_STATS,
+    CONTROL_LIST
+} ControlOp;
+
+/* Which settings a command carries */
+enum {
+    CONTROL_HAS_LEDS = 1 << 0,
+    CONTROL_HAS_SPEED = 1 << 1,
+    CONTROL_HAS_PAUSE = 1 << 2,
+    CONTROL_HAS_GLOW = 1 << 3,
+    CONTROL_HAS_COLOR = 1 << 4,
+    CONTROL_HAS_SMOOTH = 1 << 5,
+    CONTROL_HAS_RATE = 1 << 6,
+    CONTROL_HAS_SINK = 1 << 7
+};
+
+typedef struct {
+    ControlOp op;
+    char name[CONTROL_NAME_MAX];
+    unsigned fields;
+    LightbarConfig config;
+    uint32_t rate_hz;
+    char sink[CONTROL_SINK_MAX];
+} ControlCommand;
+
+/* Parses one line. Returns 0 on success, -1 on a malformed command. */
+int control_parse(const char *line, ControlCommand *cmd);
+
+/* Copies the settings cmd carries into config and rate_hz. */
+void control_apply(const ControlCommand *cmd, LightbarConfig *config, uint32_t *rate_hz);
+
+#endif
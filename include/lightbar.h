@@ -3,18 +3,116 @@
 
 #include <stdint.h>
 
+#ifndef LIGHTBAR_MAX_GLOW_RADIUS
+#define LIGHTBAR_MAX_GLOW_RADIUS 255
+#endif
+
 typedef struct {
     uint8_t r, g, b;
 } Led;
 
+/* Output correction folded into one 256-entry table: gamma (optional) and
+ * global brightness. Rendering looks every channel up as it computes the
+ * LED, so correction costs no extra pass and no floating point; the table
+ * is only rebuilt when brightness changes. */
+typedef struct {
+    uint8_t brightness;
+    uint8_t gamma;
+    uint8_t table[256];
+} LightbarLut;
+
+/* Motion profiles shape how the dot travels along each leg between the
+ * ends. Timing is untouched: a leg still takes (num_leds - 1) steps of
+ * 1000 / speed ms, so edges, pauses, events and the STOPPING wind-down
+ * happen exactly as with linear motion. Only where the dot is drawn
+ * changes, by mapping progress through the leg onto a curve baked into a
+ * table once per change, so a frame costs one lookup and one lerp. Sine
+ * and ease-in-out slow into both ends; both cross the middle at mid-leg,
+ * so a wind-down still comes to rest without a jump on odd-length strips. */
+#define LIGHTBAR_PROFILE_SIZE 256
+
+typedef enum {
+    LIGHTBAR_PROFILE_LINEAR,
+    LIGHTBAR_PROFILE_SINE,
+    LIGHTBAR_PROFILE_EASE_IN_OUT,
+    LIGHTBAR_PROFILE_CUSTOM
+} LightbarProfileType;
+
+typedef struct {
+    LightbarProfileType type;
+    /* Fraction of the leg covered (0 to 1) at progress i / SIZE */
+    float table[LIGHTBAR_PROFILE_SIZE + 1];
+} LightbarProfile;
+
 typedef struct {
-    uint8_t num_leds;
+    uint16_t num_leds;
     float speed;
     uint16_t end_pause_ms;
-    uint8_t glow_radius;
+    uint16_t glow_radius;
     Led color;
+    /* Spread the dot across the current and next LED by step progress */
+    uint8_t smooth;
+    /* Output correction, or NULL for linear output */
+    const LightbarLut *lut;
+    /* Motion profile, or NULL for constant speed */
+    const LightbarProfile *profile;
 } LightbarConfig;
 
+/* Precomputed glow falloff: the lit window of 2 * radius + 1 LEDs centred
+ * on the dot, built once per color/radius change. */
+typedef struct {
+    Led color;
+    int radius;
+    const LightbarLut *lut;
+    uint8_t brightness;
+    Led window[2 * LIGHTBAR_MAX_GLOW_RADIUS + 1];
+} LightbarGlow;
+
+/* A config compiled for the frame loop: what lightbar_update() and the
+ * renderers would otherwise derive on every call (time per step, middle
+ * LED) and the glow at each distance from the dot, before and after
+ * output correction, so a lit LED costs table lookups instead of divisions.
+ * It captures the LUT as it was when built. */
+typedef struct {
+    LightbarConfig config;
+    /* 1000 / speed, or 0 when the dot cannot move */
+    float ms_per_step;
+    int middle;
+    uint8_t brightness;
+    uint8_t gamma;
+    /* The output correction, identity for linear output */
+    uint8_t table[256];
+    /* Only built when glow_radius <= LIGHTBAR_MAX_GLOW_RADIUS */
+    Led glow[LIGHTBAR_MAX_GLOW_RADIUS + 1];
+    Led lit[LIGHTBAR_MAX_GLOW_RADIUS + 1];
+} LightbarPlan;
+
+/* The lit part of one frame: LEDs [from, to) show a dot at position blended
+ * weight/256 of the way toward ahead; every other LED is dark. */
+typedef struct {
+    Led color;
+    int radius;
+    int position;
+    int ahead;
+    int weight;
+    int from;
+    int to;
+    const LightbarLut *lut;
+} LightbarSpan;
+
+/* What lightbar_render_delta() last drew into a buffer. */
+typedef struct {
+    int valid;
+    int num_leds;
+    int position;
+    int ahead;
+    int weight;
+    int radius;
+    Led color;
+    const LightbarLut *lut;
+    uint8_t brightness;
+} LightbarDelta;
+
 typedef enum {
     LIGHTBAR_STOPPED,
     LIGHTBAR_MOVING,
@@ -31,10 +129,137 @@ typedef struct {
     uint8_t edges_remaining;
 } LightbarState;
 
+typedef enum {
+    /* The dot arrived on an end LED; direction is the way it was heading */
+    LIGHTBAR_EVENT_EDGE_REACHED,
+    /* An end pause ran out; direction is the way the dot now leaves */
+    LIGHTBAR_EVENT_PAUSE_END,
+    /* The dot arrived on the middle LED */
+    LIGHTBAR_EVENT_MIDDLE_CROSSED,
+    /* A wind-down came to rest */
+    LIGHTBAR_EVENT_STOPPED
+} LightbarEventType;
+
+typedef struct {
+    LightbarEventType type;
+    int position;
+    int direction;
+    /* Time from the start of the interval passed to lightbar_advance_events() */
+    float offset_ms;
+} LightbarEvent;
+
+/* Caller-provided storage for lightbar_advance_events(). */
+typedef struct {
+    LightbarEvent *events;
+    int capacity;
+    int count;
+    int overflow;
+} LightbarEventBuffer;
+
+/* gamma != 0 applies a 2.2 gamma curve before scaling by brightness/255. */
+void lightbar_lut_init(LightbarLut *lut, uint8_t brightness, uint8_t gamma);
+/* Rebuilds the table if brightness changed. Returns 1 if rebuilt. */
+int lightbar_lut_set_brightness(LightbarLut *lut, uint8_t brightness);
+
+/* Bakes one of the built-in curves (not LIGHTBAR_PROFILE_CUSTOM). */
+void lightbar_profile_init(LightbarProfile *profile, LightbarProfileType type);
+/* Bakes a custom curve through count (at least 2) evenly spaced points
+ * from the start of a leg (0) to its end (1), clamped to [0, 1]. Returns 0,
+ * or -1 if count is too small. */
+int lightbar_profile_init_custom(LightbarProfile *profile, const float *points, int count);
+/* Fraction of the leg covered at progress u (0 to 1). */
+float lightbar_profile_at(const LightbarProfile *profile, float u);
+
 void lightbar_init(LightbarState *state, const LightbarConfig *config);
 void lightbar_start(LightbarState *state);
 void lightbar_stop(LightbarState *state, const LightbarConfig *config);
+
+/* Moves the dot on by dt_ms in closed form: jumps from event to event
+ * (edge, pause expiry, middle) instead of looping once per LED step, so the
+ * cost is bounded no matter how large dt_ms is. Time left in dt_ms when a
+ * pause starts or ends is dropped; the next frame starts the new phase. */
 void lightbar_update(LightbarState *state, const LightbarConfig *config, float dt_ms);
+/* lightbar_update() with the plan's precomputed constants. */
+void lightbar_update_plan(LightbarState *state, const LightbarPlan *plan, float dt_ms);
+
+/* lightbar_update(), except that time left over when a pause starts or
+ * ends inside dt_ms is carried into the next phase rather than dropped,
+ * giving the same state as a sequence of lightbar_update() calls whose
+ * frames end exactly on each boundary. */
+void lightbar_advance(LightbarState *state, const LightbarConfig *config, float dt_ms);
+
+/* lightbar_advance() plus what happened during dt_ms, in order, each with
+ * its exact offset from the start of the interval. Events are found by the
+ * same event-to-event jumps that advance the state, so there is no per-step
+ * or per-frame cost. The buffer's previous contents are replaced; if more
+ * events happen than fit, the rest are left out and overflow is set (the
+ * state is exact either way). */
+void lightbar_advance_events(LightbarState *state, const LightbarConfig *config, float dt_ms,
+                             LightbarEventBuffer *events);
+
+/* Milliseconds until the next event lightbar_advance() jumps to (reaching
+ * an edge, the end of a pause, or the final stop), or a negative value if
+ * none is coming. Advancing by exactly this much reaches the event. */
+float lightbar_time_to_event(const LightbarState *state, const LightbarConfig *config);
+
+/* Where the dot is drawn, in LEDs from the start of the strip, including
+ * progress toward the next LED and the motion profile. */
+float lightbar_dot_position(const LightbarState *state, const LightbarConfig *config);
+
+/* With config->smooth set, a moving dot is drawn as a blend of the two LEDs
+ * either side of lightbar_dot_position(), so motion stays smooth at high
+ * speeds and on long strips; without it the dot sits on the nearer LED.
+ * Only the lit window costs per-LED work; the rest of the strip is
+ * bulk-cleared. */
 void lightbar_render(const LightbarState *state, const LightbarConfig *config, Led *leds);
 
+/* The drawing primitive behind lightbar_render(), for callers that keep
+ * their own state: a dot at position blended weight/256 of the way toward
+ * ahead (weight 0 draws a whole-LED dot). */
+void lightbar_render_dot(uint16_t num_leds, uint16_t glow_radius, Led color,
+                        const LightbarLut *lut, int position, int ahead, int weight,
+                        Led *leds);
+
+/* Per-LED access to the frame lightbar_render() would draw, for encoders
+ * that write LEDs straight into another representation. */
+void lightbar_span(const LightbarState *state, const LightbarConfig *config, LightbarSpan *span);
+Led lightbar_span_led(const LightbarSpan *span, int i);
+
+void lightbar_glow_init(LightbarGlow *glow, const LightbarConfig *config);
+/* Rebuilds the kernel if color, glow_radius or the output correction
+ * changed. Returns 1 if rebuilt. */
+int lightbar_glow_sync(LightbarGlow *glow, const LightbarConfig *config);
+
+/* Same output as lightbar_render(), but with no per-LED arithmetic: the dark
+ * area is bulk-cleared and only the lit window is copied from the kernel.
+ * Falls back to lightbar_render() when glow_radius exceeds
+ * LIGHTBAR_MAX_GLOW_RADIUS or a smooth dot sits between two LEDs. */
+void lightbar_render_glow(const LightbarState *state, const LightbarConfig *config,
+                          const LightbarGlow *glow, Led *leds);
+
+void lightbar_plan_init(LightbarPlan *plan, const LightbarConfig *config);
+/* Rebuilds the plan if any config field, or the LUT's brightness or gamma,
+ * differs from what it was built from. Returns 1 if rebuilt. */
+int lightbar_plan_sync(LightbarPlan *plan, const LightbarConfig *config);
+
+/* Same output as lightbar_render() for the config the plan was built from.
+ * Falls back to lightbar_render() when glow_radius exceeds
+ * LIGHTBAR_MAX_GLOW_RADIUS. */
+void lightbar_render_plan(const LightbarState *state, const LightbarPlan *plan, Led *leds);
+
+void lightbar_delta_reset(LightbarDelta *delta);
+
+/* Brings a buffer last drawn by this function (with the same delta) up to
+ * date by rewriting only the previous and the new lit window. Reports the
+ * span covering both as [*dirty_from, *dirty_to) and returns 1, or returns
+ * 0 with an empty span when the frame is unchanged. The first call, or a
+ * change in num_leds, renders and reports the whole strip. */
+int lightbar_render_delta(LightbarDelta *delta, const LightbarState *state,
+                          const LightbarConfig *config, Led *leds,
+                          int *dirty_from, int *dirty_to);
+/* lightbar_render_delta() drawing through the plan. */
+int lightbar_render_delta_plan(LightbarDelta *delta, const LightbarState *state,
+                               const LightbarPlan *plan, Led *leds,
+                               int *dirty_from, int *dirty_to);
+
 #endif
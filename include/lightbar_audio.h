@@ -0,0 +1,97 @@
+#ifndef LIGHTBAR_AUDIO_H
+#define LIGHTBAR_AUDIO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "lightbar.h"
+
+/* Bilateral audio locked to the dot: a sine tone panned (constant power)
+ * by the dot's position, plus an optional click on the side the dot has
+ * just reached at each edge. The generator is the clock. Rendering n frames
+ * advances the LightbarState by exactly n sample periods through
+ * lightbar_advance(), split at every edge, pause end and stop, so each
+ * event lands on the first sample at or after it and the pan between
+ * events follows the dot's continuous position. Drive the light from the
+ * same state (or from the frames the output has played) and the two never
+ * drift apart.
+ *
+ * The tone fades in and out over LIGHTBAR_AUDIO_FADE_MS as the bar starts
+ * and comes to rest. */
+
+#ifndef LIGHTBAR_AUDIO_BLOCK
+#define LIGHTBAR_AUDIO_BLOCK 256
+#endif
+
+#define LIGHTBAR_AUDIO_FADE_MS 5.0f
+
+typedef struct {
+    uint32_t sample_rate;
+    float tone_hz;
+    /* Peak amplitude, 0 to 1 */
+    float volume;
+    /* Length of the edge click, 0 for none */
+    float click_ms;
+} LightbarAudioConfig;
+
+typedef struct {
+    LightbarAudioConfig config;
+    uint64_t frames;
+    /* Tone phase in cycles, [0, 1) */
+    double phase;
+    float level;
+    /* Samples of the current click left to play, and on which side */
+    uint32_t click_left;
+    uint32_t click_len;
+    int click_side;
+    float left[LIGHTBAR_AUDIO_BLOCK];
+    float right[LIGHTBAR_AUDIO_BLOCK];
+} LightbarAudio;
+
+/* Single-producer, single-consumer ring of interleaved stereo frames.
+ * Neither side ever blocks or takes a lock, so the consumer can live in a
+ * real-time audio callback. capacity must be a power of two. */
+typedef struct {
+    float *data;
+    uint32_t capacity;
+    uint64_t write;
+    uint64_t read;
+} LightbarAudioRing;
+
+/* PCM WAV writer, 16-bit integer or 32-bit float stereo. */
+typedef struct {
+    FILE *file;
+    uint32_t sample_rate;
+    int float_samples;
+    uint64_t frames;
+} LightbarWav;
+
+void lightbar_audio_init(LightbarAudio *audio, const LightbarAudioConfig *config);
+
+/* Renders frames of interleaved stereo, advancing state to match. */
+void lightbar_audio_render_f32(LightbarAudio *audio, LightbarState *state,
+                               const LightbarConfig *config, float *out, uint32_t frames);
+void lightbar_audio_render_s16(LightbarAudio *audio, LightbarState *state,
+                               const LightbarConfig *config, int16_t *out, uint32_t frames);
+
+/* Pan the dot's current position maps to, -1 (left) to 1 (right). */
+float lightbar_audio_pan(const LightbarState *state, const LightbarConfig *config);
+
+/* Returns 0, or -1 if capacity is not a power of two. storage holds
+ * 2 * capacity floats. */
+int lightbar_audio_ring_init(LightbarAudioRing *ring, float *storage, uint32_t capacity);
+uint32_t lightbar_audio_ring_readable(const LightbarAudioRing *ring);
+uint32_t lightbar_audio_ring_writable(const LightbarAudioRing *ring);
+/* Each returns the number of frames actually copied. */
+uint32_t lightbar_audio_ring_write(LightbarAudioRing *ring, const float *frames, uint32_t count);
+uint32_t lightbar_audio_ring_read(LightbarAudioRing *ring, float *frames, uint32_t count);
+/* Producer side: renders straight into the free space, up to max frames. */
+uint32_t lightbar_audio_fill(LightbarAudio *audio, LightbarState *state,
+                             const LightbarConfig *config, LightbarAudioRing *ring, uint32_t max);
+
+/* Returns 0, or -1 on an I/O error. */
+int lightbar_wav_open(LightbarWav *wav, const char *path, uint32_t sample_rate, int float_samples);
+int lightbar_wav_write(LightbarWav *wav, const float *frames, uint32_t count);
+/* Fills in the header's sizes and closes the file. */
+int lightbar_wav_close(LightbarWav *wav);
+
+#endif
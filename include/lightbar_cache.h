@@ -0,0 +1,80 @@
+#ifndef LIGHTBAR_CACHE_H
+#define LIGHTBAR_CACHE_H
+
+#include <stdint.h>
+#include "lightbar.h"
+
+#ifndef LIGHTBAR_CACHE_MAX_BYTES
+#define LIGHTBAR_CACHE_MAX_BYTES (1024u * 1024u)
+#endif
+
+/* For a fixed config an oscillating bar is strictly periodic: pause at the
+ * left edge, travel right, pause at the right edge, travel left. The cache
+ * compiles one period into a keyframe per step or pause, so steady-state
+ * playback is an index computation. Time flows as in lightbar_update(): a
+ * frame that reaches the start or end of a pause stops there and the rest
+ * of it is dropped.
+ *
+ * Without smoothing every frame is dark apart from the glow around the dot,
+ * so the cache prerenders that glow once and keeps, per position, which
+ * part of it lands on the strip (clipped at the ends).
+ *
+ * Smooth rendering and motion profiles depend on progress within a step,
+ * so such configs are never cached; neither are strips whose tables would
+ * not fit in LIGHTBAR_CACHE_MAX_BYTES. */
+typedef struct {
+    int16_t position;
+    int8_t direction;
+    uint8_t phase;
+} LightbarCacheKey;
+
+/* LEDs [from, to) of the frame are window[offset..] */
+typedef struct {
+    uint16_t from;
+    uint16_t to;
+    uint32_t offset;
+} LightbarCacheSpan;
+
+typedef struct {
+    /* Config the tables were built for; built == 0 forces a rebuild */
+    int built;
+    int ready;
+    LightbarConfig config;
+    uint8_t brightness;
+
+    double ms_per_step;
+    double period_ms;
+    uint32_t num_keys;
+    LightbarCacheKey *keys;
+    uint32_t window_len;
+    Led *window;
+    LightbarCacheSpan *spans;
+} LightbarCache;
+
+void lightbar_cache_init(LightbarCache *cache);
+void lightbar_cache_free(LightbarCache *cache);
+
+/* Forces a rebuild on the next sync, e.g. after a config setter. */
+void lightbar_cache_invalidate(LightbarCache *cache);
+
+/* Rebuilds the tables if config differs from the one they were built for.
+ * Returns 1 if the cache can play this config back, 0 if callers must run
+ * live (not cacheable, or allocation failed). */
+int lightbar_cache_sync(LightbarCache *cache, const LightbarConfig *config);
+
+/* Moves state on by dt_ms. While the bar oscillates (MOVING or PAUSED_END)
+ * and the cache holds config, this is a keyframe lookup; otherwise, as
+ * during the STOPPING wind-down, it runs lightbar_update(). */
+void lightbar_cache_update(LightbarCache *cache, LightbarState *state,
+                           const LightbarConfig *config, float dt_ms);
+
+/* The lit part of the frame lightbar_render() would draw for state: the
+ * returned entries are LEDs [*from, *to), every other LED is dark. NULL if
+ * the cache is not ready (render live instead). */
+const Led *lightbar_cache_window(const LightbarCache *cache, const LightbarState *state,
+                                 int *from, int *to);
+
+/* Draws that frame into leds. Returns 0, or -1 if the cache is not ready. */
+int lightbar_cache_render(const LightbarCache *cache, const LightbarState *state, Led *leds);
+
+#endif
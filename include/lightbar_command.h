@@ -0,0 +1,93 @@
+#ifndef LIGHTBAR_COMMAND_H
+#define LIGHTBAR_COMMAND_H
+
+#include <stdint.h>
+#include "lightbar.h"
+
+/* Start, stop and config commands from any number of control threads,
+ * applied by the thread that ticks the bar at the start of a frame.
+ *
+ * The queue is a bounded array of slots, each with a sequence number
+ * saying whether it is free for the producer at a given position or holds
+ * a command for the consumer there. Producers claim positions with a CAS
+ * on the tail and never wait: a push into a full queue fails at once and
+ * is counted as dropped. The consumer needs no atomic read-modify-write at
+ * all.
+ *
+ * lightbar_command_apply() drains a bounded batch per frame. Config
+ * commands go into a pending copy where the last value of each field
+ * wins, so a slider's burst of speed events costs one config change;
+ * pending changes are applied before each start or stop, which therefore
+ * sees the config exactly as sent before it, and repeats of a start or
+ * stop collapse into one. Values that only ever need their latest state
+ * can also go through lightbar_handoff.h; the queue keeps them in order
+ * with starts and stops. */
+
+typedef enum {
+    LIGHTBAR_CMD_START,
+    LIGHTBAR_CMD_STOP,
+    LIGHTBAR_CMD_SPEED,
+    LIGHTBAR_CMD_END_PAUSE,
+    LIGHTBAR_CMD_GLOW,
+    LIGHTBAR_CMD_COLOR,
+    LIGHTBAR_CMD_SMOOTH,
+    LIGHTBAR_CMD_PROFILE
+} LightbarCommandType;
+
+typedef struct {
+    LightbarCommandType type;
+    union {
+        float speed;
+        uint16_t end_pause_ms;
+        uint16_t glow_radius;
+        Led color;
+        uint8_t smooth;
+        const LightbarProfile *profile;
+    } value;
+} LightbarCommand;
+
+typedef struct {
+    uint32_t seq;
+    LightbarCommand command;
+} LightbarCommandSlot;
+
+typedef struct {
+    LightbarCommandSlot *slots;
+    uint32_t capacity;
+    /* Next position to push, claimed by CAS */
+    uint32_t tail;
+    /* Next position to pop; consumer only */
+    uint32_t head;
+    /* Pushes refused because the queue was full */
+    uint64_t dropped;
+    /* Consumer only: commands drained, and those that changed nothing */
+    uint64_t drained;
+    uint64_t coalesced;
+} LightbarCommandQueue;
+
+/* What a batch changed, as returned by lightbar_command_apply() */
+#define LIGHTBAR_COMMAND_STATE 1
+#define LIGHTBAR_COMMAND_CONFIG 2
+
+/* Called after each start or stop is applied. */
+typedef void (*LightbarCommandHook)(const LightbarCommand *command, const LightbarState *state,
+                                    const LightbarConfig *config, void *ctx);
+
+/* capacity must be a power of two. Returns 0, or -1 if it is not. */
+int lightbar_command_queue_init(LightbarCommandQueue *queue, LightbarCommandSlot *slots,
+                                uint32_t capacity);
+
+/* Safe from any number of threads. Returns 0, or -1 if the queue is full. */
+int lightbar_command_push(LightbarCommandQueue *queue, const LightbarCommand *command);
+
+/* Consumer only. Returns 1 and the oldest command, or 0 if none is ready. */
+int lightbar_command_pop(LightbarCommandQueue *queue, LightbarCommand *command);
+
+/* Consumer only: drains up to max commands into state and config, in
+ * order but coalesced as above, calling hook (if not NULL) for each start
+ * and stop. Returns the LIGHTBAR_COMMAND_* flags for what changed. */
+int lightbar_command_apply(LightbarCommandQueue *queue, LightbarState *state,
+                           LightbarConfig *config, uint32_t max,
+                           LightbarCommandHook hook, void *ctx);
+
+#endif
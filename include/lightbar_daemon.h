@@ -0,0 +1,47 @@
+#ifndef LIGHTBAR_DAEMON_H
+#define LIGHTBAR_DAEMON_H
+
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Runs many lightbar sessions at once, each with its own config, tick rate
+ * and output sink. Sessions are spread round-robin over a small pool of
+ * worker threads. Each worker keeps its sessions' next ticks in a timer
+ * wheel of LIGHTBAR_DAEMON_TICK_NS slots and sleeps in epoll on a single
+ * timerfd armed for the wheel's nearest expiry, so there is no thread or
+ * sleep per session.
+ *
+ * A tick advances the session by the time since its previous tick, renders
+ * it, and writes the frame to the sink as num_leds RGB triplets. Ticks are
+ * due on a fixed grid of 1/rate seconds; a tick that misses its slot
+ * entirely is dropped and its time folded into the next one. A sink that
+ * cannot take a frame without blocking drops it. Sessions are managed with
+ * the control.h line protocol. */
+
+#ifndef LIGHTBAR_DAEMON_TICK_NS
+#define LIGHTBAR_DAEMON_TICK_NS 100000u
+#endif
+
+typedef struct LightbarDaemon LightbarDaemon;
+
+/* NULL if the workers could not be started. */
+LightbarDaemon *lightbar_daemon_create(int workers);
+void lightbar_daemon_destroy(LightbarDaemon *daemon);
+
+/* Publishes per-session counters in a POSIX shared memory block called name
+ * (see lightbar_stats.h) with room for slots sessions; sessions beyond that
+ * are not published. The block is unlinked when the daemon is destroyed.
+ * Returns 0, or -1 if it could not be created. */
+int lightbar_daemon_publish_stats(LightbarDaemon *daemon, const char *name, uint32_t slots);
+
+/* Runs one control line and writes the reply into reply: zero or more
+ * result lines followed by "ok" or "err <reason>", each ending in a
+ * newline. Returns 0 on success, -1 on error. */
+int lightbar_daemon_command(LightbarDaemon *daemon, const char *line, char *reply, size_t size);
+
+/* Serves the control protocol on a Unix stream socket at path until *quit
+ * becomes nonzero. Returns 0, or -1 if the socket could not be set up. */
+int lightbar_daemon_serve(LightbarDaemon *daemon, const char *path, volatile sig_atomic_t *quit);
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef LIGHTBAR_FLEET_H
+#define LIGHTBAR_FLEET_H
+
+#include <stdint.h>
+#include "lightbar.h"
+
+/* Many lightbars stored as one array per field, so lightbar_fleet_update()
+ * runs as straight-line, branch-free loops the compiler can vectorize.
+ * Every instance behaves exactly like its own LightbarState/LightbarConfig
+ * pair driven through lightbar_update(). */
+typedef struct {
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t total_leds;
+
+    /* Config, plus values derived from it when it is set */
+    int32_t *num_leds;
+    float *speed;
+    int32_t *end_pause_ms;
+    uint16_t *glow_radius;
+    Led *color;
+    uint8_t *smooth;
+    const LightbarLut **lut;
+    const LightbarProfile **profile;
+    float *ms_per_step;
+    float *pause_ms;
+    int32_t *last;
+    int32_t *middle;
+    uint32_t *led_offset;
+
+    /* State */
+    int32_t *position;
+    int32_t *direction;
+    int32_t *phase;
+    float *pause_timer_ms;
+    float *move_accum_ms;
+    int32_t *edges_remaining;
+
+    /* Scratch: what each instance has left to do in the current update */
+    int32_t *busy;
+} LightbarFleet;
+
+/* Returns 0 on success, -1 if allocation fails. */
+int lightbar_fleet_init(LightbarFleet *fleet, uint32_t capacity);
+void lightbar_fleet_free(LightbarFleet *fleet);
+
+/* Adds an instance initialised as by lightbar_init(). Its LEDs occupy
+ * num_leds entries starting at led_offset[index] of the buffer passed to
+ * lightbar_fleet_render(). Returns the index, or -1 when the fleet is full. */
+int lightbar_fleet_add(LightbarFleet *fleet, const LightbarConfig *config);
+
+void lightbar_fleet_set_config(LightbarFleet *fleet, uint32_t index, const LightbarConfig *config);
+void lightbar_fleet_get_config(const LightbarFleet *fleet, uint32_t index, LightbarConfig *config);
+void lightbar_fleet_get_state(const LightbarFleet *fleet, uint32_t index, LightbarState *state);
+void lightbar_fleet_set_state(LightbarFleet *fleet, uint32_t index, const LightbarState *state);
+
+void lightbar_fleet_start(LightbarFleet *fleet, uint32_t index);
+void lightbar_fleet_stop(LightbarFleet *fleet, uint32_t index);
+void lightbar_fleet_update(LightbarFleet *fleet, float dt_ms);
+
+/* Renders every instance into leds, which must hold total_leds entries. */
+void lightbar_fleet_render(const LightbarFleet *fleet, Led *leds);
+
+#endif
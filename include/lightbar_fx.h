@@ -0,0 +1,48 @@
+#ifndef LIGHTBAR_FX_H
+#define LIGHTBAR_FX_H
+
+#include <stdint.h>
+#include "lightbar.h"
+
+/* Integer-only twin of the lightbar core for parts without an FPU. Time is
+ * kept in whole microseconds and speed in Q16.16 LEDs per second. Speed is
+ * turned into microseconds per step when it is set, so an update only
+ * divides when a frame covers more than one step. Firmware picks this variant at build
+ * time by compiling src/lightbar_fx.c and calling lightbar_fx_* in place of
+ * lightbar_*; it walks through the same sequence of steps as the float
+ * version. */
+
+/* Q16.16 speed from a constant LEDs-per-second value */
+#define LIGHTBAR_FX_SPEED(leds_per_s) ((uint32_t)((leds_per_s) * 65536.0 + 0.5))
+
+typedef struct {
+    uint16_t num_leds;
+    uint32_t speed_q16;
+    uint16_t end_pause_ms;
+    uint16_t glow_radius;
+    Led color;
+    uint8_t smooth;
+    const LightbarLut *lut;
+    /* Derived by lightbar_fx_set_speed() */
+    uint32_t us_per_step;
+    uint32_t weight_scale;
+} LightbarFxConfig;
+
+typedef struct {
+    int position;
+    int direction;
+    LightbarPhase phase;
+    int32_t pause_timer_us;
+    uint32_t move_accum_us;
+    uint8_t edges_remaining;
+} LightbarFxState;
+
+void lightbar_fx_set_speed(LightbarFxConfig *config, uint32_t speed_q16);
+
+void lightbar_fx_init(LightbarFxState *state, const LightbarFxConfig *config);
+void lightbar_fx_start(LightbarFxState *state);
+void lightbar_fx_stop(LightbarFxState *state, const LightbarFxConfig *config);
+void lightbar_fx_update(LightbarFxState *state, const LightbarFxConfig *config, uint32_t dt_us);
+void lightbar_fx_render(const LightbarFxState *state, const LightbarFxConfig *config, Led *leds);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef LIGHTBAR_HANDOFF_H
+#define LIGHTBAR_HANDOFF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "lightbar.h"
+
+/* Passes configs from control threads to the thread that ticks the bar,
+ * without locks. It is a seqlock: a publisher makes the sequence odd,
+ * writes the config, and makes it even again; the tick thread copies the
+ * config and keeps the copy only if the sequence was the same even value
+ * before and after. Every word is moved with an atomic access, so the
+ * copy is race-free as well as consistent.
+ *
+ * Publishers never wait for the tick thread, only briefly for each other.
+ * The tick thread polls once per frame: when nothing was published since
+ * its last copy that is a single atomic load, and a copy torn by a publish
+ * in progress is retried a few times and otherwise left for the next
+ * frame, so it never spins behind a writer either.
+ *
+ * The lut and profile pointers are passed as they are; the tables they
+ * point at must outlive every config that refers to them. */
+
+#ifndef LIGHTBAR_HANDOFF_RETRIES
+#define LIGHTBAR_HANDOFF_RETRIES 4
+#endif
+
+#define LIGHTBAR_HANDOFF_WORDS ((sizeof(LightbarConfig) + sizeof(size_t) - 1) / sizeof(size_t))
+
+typedef struct {
+    /* Odd while a publish is in progress; advances by 2 per publish */
+    uint32_t seq;
+    union {
+        LightbarConfig config;
+        size_t words[LIGHTBAR_HANDOFF_WORDS];
+    } data;
+} LightbarHandoff;
+
+/* Not thread-safe: call before any thread uses the handoff. */
+void lightbar_handoff_init(LightbarHandoff *handoff, const LightbarConfig *config);
+
+/* Makes config the current one. Safe from any number of threads. */
+void lightbar_handoff_publish(LightbarHandoff *handoff, const LightbarConfig *config);
+
+/* Copies the current config into *config if it is newer than *seen, the
+ * version of the last one copied, and updates *seen. Returns 1 if it
+ * copied, 0 if config is unchanged. Start with *seen = 0 to take the
+ * initial config. Only one thread may poll with a given seen. */
+int lightbar_handoff_poll(const LightbarHandoff *handoff, LightbarConfig *config, uint32_t *seen);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef LIGHTBAR_HIST_H
+#define LIGHTBAR_HIST_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Log-linear histogram in the HdrHistogram style: each power of two is
+ * split into 2^LIGHTBAR_HIST_SUB_BITS equal buckets, so any value from 0
+ * to 2^64 - 1 is recorded with about 6% relative precision in constant
+ * time and fixed memory. Meant to stay on for a whole session. */
+#define LIGHTBAR_HIST_SUB_BITS 4
+#define LIGHTBAR_HIST_SUB (1u << LIGHTBAR_HIST_SUB_BITS)
+#define LIGHTBAR_HIST_BUCKETS ((64 - LIGHTBAR_HIST_SUB_BITS + 1) * LIGHTBAR_HIST_SUB)
+
+typedef struct {
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    double sum;
+    uint64_t buckets[LIGHTBAR_HIST_BUCKETS];
+} LightbarHist;
+
+void lightbar_hist_init(LightbarHist *hist);
+void lightbar_hist_record(LightbarHist *hist, uint64_t value);
+
+/* Smallest recorded bucket's upper bound covering fraction q (0 to 1) of
+ * the values, clamped to [min, max]; 0 when empty. */
+uint64_t lightbar_hist_quantile(const LightbarHist *hist, double q);
+
+/* One line: count, mean, p50, p90, p99, p99.9 and max, in units of scale
+ * (e.g. 1000 to print nanoseconds as microseconds). */
+void lightbar_hist_print(const LightbarHist *hist, const char *name, double scale, FILE *out);
+
+#endif
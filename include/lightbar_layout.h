@@ -0,0 +1,87 @@
+#ifndef LIGHTBAR_LAYOUT_H
+#define LIGHTBAR_LAYOUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "lightbar.h"
+
+/* Where each logical LED of a bar physically is, for rigs built from
+ * several strip segments, serpentine panels and output channels. Segments
+ * and panels are added to a builder and compiled once into a flat map
+ * from logical index to the physical (channel, index) pairs it lights:
+ * one pair per LED on a strip, a whole column on a panel.
+ *
+ * Logical LEDs mapped to nothing are gaps in the bar (it passes them in
+ * the dark); physical LEDs nothing maps to stay dark. If two logical LEDs
+ * share a physical one, the later wins.
+ *
+ * Rendering through the map touches only the lit window and the window
+ * lit last frame, writing straight into the per-channel outputs, so a
+ * frame costs the same however many channels and segments the rig has. */
+
+typedef struct {
+    uint32_t index;
+    uint16_t channel;
+} LightbarPixel;
+
+typedef struct {
+    uint16_t logical;
+    LightbarPixel pixel;
+} LightbarLayoutEntry;
+
+typedef struct {
+    uint16_t num_leds;
+    int num_channels;
+    uint32_t *channel_leds;
+
+    /* Builder: every mapping added so far */
+    LightbarLayoutEntry *entries;
+    size_t count;
+    size_t capacity;
+
+    /* Compiled: logical LED i lights pixels[first[i]] to pixels[first[i + 1]] */
+    int compiled;
+    uint32_t *first;
+    LightbarPixel *pixels;
+} LightbarLayout;
+
+/* Per-channel Led buffers and the logical window last drawn into them. */
+typedef struct {
+    Led **channels;
+    int valid;
+    int from;
+    int to;
+} LightbarLayoutOutput;
+
+/* channel_leds[c] is the number of physical LEDs on channel c. Returns 0,
+ * or -1 if allocation fails. */
+int lightbar_layout_init(LightbarLayout *layout, uint16_t num_leds, int num_channels,
+                         const uint32_t *channel_leds);
+void lightbar_layout_free(LightbarLayout *layout);
+
+/* Maps logical LEDs [logical, logical + count) onto physical LEDs from
+ * physical on channel, running backwards from physical + count - 1 if
+ * reverse is set. Returns 0, or -1 if either range is out of bounds. */
+int lightbar_layout_segment(LightbarLayout *layout, int logical, int count, int channel,
+                            uint32_t physical, int reverse);
+
+/* A width x height panel wired in rows from physical on channel, the
+ * first row left to right and each following row back the other way.
+ * Logical LED logical + x lights column x. Returns 0, or -1 if out of
+ * bounds. */
+int lightbar_layout_serpentine(LightbarLayout *layout, int logical, int width, int height,
+                               int channel, uint32_t physical);
+
+/* Builds the map from everything added. Returns 0, or -1 if allocation
+ * fails. */
+int lightbar_layout_compile(LightbarLayout *layout);
+
+void lightbar_layout_output_init(LightbarLayoutOutput *out, Led **channels);
+
+/* Draws the frame lightbar_render() would, through the compiled map. The
+ * first call clears every channel; later calls only rewrite the previous
+ * and the new lit window. config->num_leds must match the layout. */
+void lightbar_layout_render(LightbarLayoutOutput *out, const LightbarLayout *layout,
+                            const LightbarState *state, const LightbarConfig *config);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef LIGHTBAR_PACER_H
+#define LIGHTBAR_PACER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "lightbar.h"
+#include "lightbar_hist.h"
+
+/* Native frame loop at a fixed rate on CLOCK_MONOTONIC. Frame k is due at
+ * epoch + k / rate seconds, computed from the epoch in integer nanoseconds,
+ * and the loop sleeps to that absolute deadline, so neither the schedule
+ * nor the time fed to the bar drifts however long the session runs. A
+ * frame that wakes after later deadlines have passed skips them and
+ * advances the bar over the gap in one step.
+ *
+ * The bar itself accumulates float time in move_accum_ms and
+ * pause_timer_ms. While it oscillates steadily, once a second its place in
+ * the oscillation period is checked against the exact value from the
+ * session clock and snapped back; the size of each correction goes into
+ * the drift histogram.
+ *
+ * Wakeup lateness, update cost, render cost and drift are recorded in
+ * nanoseconds and can be dumped at any time. */
+
+#define LIGHTBAR_PACER_MIN_HZ 60
+#define LIGHTBAR_PACER_MAX_HZ 2000
+
+typedef struct {
+    uint32_t rate_hz;
+    uint64_t epoch_ns;
+    /* Index of the deadline last run, and deadlines skipped */
+    uint64_t frame;
+    uint64_t missed;
+    uint32_t since_check;
+
+    /* The period position the bar had at anchor_ns, for the config it
+     * had then */
+    int anchored;
+    uint64_t anchor_ns;
+    double anchor_ms;
+    LightbarConfig anchor_config;
+
+    LightbarHist late;
+    LightbarHist update;
+    LightbarHist render;
+    LightbarHist drift;
+} LightbarPacer;
+
+/* Starts the epoch now. Returns 0, or -1 if rate_hz is out of range. */
+int lightbar_pacer_init(LightbarPacer *pacer, uint32_t rate_hz);
+
+/* When frame is due, in CLOCK_MONOTONIC nanoseconds. */
+uint64_t lightbar_pacer_deadline(const LightbarPacer *pacer, uint64_t frame);
+
+/* Sleeps until the next frame is due and returns how far the bar must
+ * advance to reach it, in milliseconds. */
+double lightbar_pacer_wait(LightbarPacer *pacer);
+
+/* Advances state by dt_ms to the current frame's deadline, correcting
+ * drift as described above. */
+void lightbar_pacer_update(LightbarPacer *pacer, LightbarState *state,
+                           const LightbarConfig *config, double dt_ms);
+
+/* One whole frame: wait, update and render into leds, timing each. */
+void lightbar_pacer_frame(LightbarPacer *pacer, LightbarState *state,
+                          const LightbarConfig *config, Led *leds);
+
+/* Frame counts and every histogram, in microseconds. */
+void lightbar_pacer_dump(const LightbarPacer *pacer, FILE *out);
+
+#endif
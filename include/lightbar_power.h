@@ -0,0 +1,62 @@
+#ifndef LIGHTBAR_POWER_H
+#define LIGHTBAR_POWER_H
+
+#include <stdint.h>
+#include "lightbar.h"
+
+/* Supply current estimation and brightness limiting for the delta render
+ * path.
+ *
+ * The estimate is kept as per-channel sums of the drawn frame. A delta
+ * frame only rewrites its dirty span, which covers the previous lit window,
+ * and every LED outside the lit window is dark, so the new sums are the
+ * sums over the dirty span: the cost follows the LEDs that changed, never
+ * the strip length.
+ *
+ * With a budget the limiter draws through its own copy of the config's
+ * output correction, at the highest brightness (up to the configured one)
+ * whose estimate fits. Output scales with the LUT brightness, so one
+ * proportional step nearly always lands it; the frame is redrawn at the
+ * lower brightness before it is returned, so no frame over budget ever
+ * leaves the function. Brightness comes back up the same way as the draw
+ * falls. */
+
+typedef struct {
+    /* mA one LED draws per channel at full output; about 20 for WS2812B */
+    uint16_t ma_r, ma_g, ma_b;
+    /* mA one LED draws when dark; about 1 for WS2812B */
+    uint16_t idle_ma;
+    /* Supply budget for the whole strip in mA, 0 for no limit */
+    uint32_t budget_ma;
+} LightbarPowerModel;
+
+typedef struct {
+    LightbarPowerModel model;
+    /* The config's correction at the brightness actually drawn, and the
+     * caller's plan rebuilt to draw through it */
+    LightbarLut lut;
+    LightbarPlan plan;
+    /* Channel sums of the frame last drawn */
+    uint32_t sum_r, sum_g, sum_b;
+    uint16_t num_leds;
+    /* Estimated draw of that frame */
+    uint32_t ma;
+    /* Frames drawn below the configured brightness */
+    uint64_t limited;
+} LightbarPower;
+
+void lightbar_power_init(LightbarPower *power, const LightbarPowerModel *model);
+
+/* Estimated draw of count LEDs, summed over every one of them. */
+uint32_t lightbar_power_frame_ma(const LightbarPowerModel *model, const Led *leds, int count);
+
+/* lightbar_render_delta_plan() that keeps power->ma up to date and, with a
+ * budget, limits brightness to it. leds must only ever be drawn through
+ * this function with this power and delta. Returns and reports the dirty
+ * span like lightbar_render_delta(), including LEDs redrawn by the
+ * limiter. */
+int lightbar_power_render_delta(LightbarPower *power, LightbarDelta *delta,
+                                const LightbarState *state, const LightbarPlan *plan,
+                                Led *leds, int *dirty_from, int *dirty_to);
+
+#endif
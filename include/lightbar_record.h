@@ -0,0 +1,153 @@
+#ifndef LIGHTBAR_RECORD_H
+#define LIGHTBAR_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "lightbar.h"
+#include "lightbar_cache.h"
+
+/* Session recording for reproducing what a bar did. The recorder is told
+ * about every init, start, stop and update as it happens and appends them
+ * to a file of one-byte opcodes with LEB128 varint operands:
+ *
+ *   - config changes are found by comparing against the last config
+ *     written, so every setter is covered without hooking each one, and
+ *     only the fields that changed are stored;
+ *   - each dt is stored as its float bits XORed with the previous dt's,
+ *     and a run of identical dts collapses into one repeat count;
+ *   - every checkpoint_ms of session time a checkpoint stores the whole
+ *     config and state, and resets the XOR chain, so decoding can start at
+ *     any checkpoint.
+ *
+ * Closing appends an index of the checkpoints. A file cut short by a crash
+ * has no index, and lightbar_replay_open() rebuilds it by scanning the
+ * records, which costs no core work.
+ *
+ * The replayer maps the file, seeks to any session time from the nearest
+ * checkpoint before it, and re-runs every recorded dt through whichever of
+ * lightbar_update() and lightbar_cache_update() the bar was using at the
+ * time. Each checkpoint passed on the way is compared with the replayed
+ * state, so a replay both reproduces a session and shows where the
+ * original run departed from the core. */
+
+#define LIGHTBAR_RECORD_MAGIC "LBREC02\n"
+#define LIGHTBAR_RECORD_MAGIC_SIZE 8
+
+typedef enum {
+    LIGHTBAR_REC_END,
+    LIGHTBAR_REC_INIT,
+    LIGHTBAR_REC_START,
+    LIGHTBAR_REC_STOP,
+    LIGHTBAR_REC_UPDATE,
+    LIGHTBAR_REC_REPEAT,
+    LIGHTBAR_REC_CHECKPOINT,
+    LIGHTBAR_REC_NUM_LEDS,
+    LIGHTBAR_REC_SPEED,
+    LIGHTBAR_REC_END_PAUSE,
+    LIGHTBAR_REC_GLOW,
+    LIGHTBAR_REC_COLOR,
+    LIGHTBAR_REC_SMOOTH,
+    LIGHTBAR_REC_LUT,
+    LIGHTBAR_REC_PROFILE,
+    LIGHTBAR_REC_CACHED
+} LightbarRecordOp;
+
+typedef struct {
+    double time_ms;
+    uint64_t offset;
+} LightbarCheckpoint;
+
+typedef struct {
+    FILE *file;
+    int error;
+    uint64_t offset;
+    double checkpoint_ms;
+
+    double time_ms;
+    double last_checkpoint_ms;
+    uint64_t frames;
+    uint32_t dt_bits;
+    uint32_t repeats;
+
+    /* What the file says the config is, lut as brightness and gamma and
+     * profile as a copy */
+    LightbarConfig config;
+    int has_lut;
+    uint8_t brightness;
+    uint8_t gamma;
+    int has_profile;
+    LightbarProfile profile;
+    /* Whether updates go through lightbar_cache_update() */
+    int cached;
+
+    LightbarCheckpoint *index;
+    size_t index_count;
+    size_t index_capacity;
+} LightbarRecorder;
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    /* Records run from the magic to end; pos is the next one */
+    size_t end;
+    size_t pos;
+    int error;
+
+    LightbarCheckpoint *index;
+    size_t index_count;
+
+    LightbarState state;
+    LightbarConfig config;
+    LightbarLut lut;
+    LightbarProfile profile;
+    int cached;
+    LightbarCache cache;
+    double time_ms;
+    uint64_t frames;
+    uint32_t dt_bits;
+    uint32_t repeat_left;
+    /* Whether state is known, from a checkpoint or an init */
+    int synced;
+
+    /* Checkpoints the replayed state disagreed with */
+    uint64_t mismatches;
+    double first_mismatch_ms;
+} LightbarReplay;
+
+/* Starts a recording of a bar as it is now, which may be mid-session.
+ * checkpoint_ms of session time passes between checkpoints. Returns 0, or
+ * -1 if the file cannot be created. */
+int lightbar_record_open(LightbarRecorder *rec, const char *path, double checkpoint_ms,
+                         const LightbarState *state, const LightbarConfig *config);
+
+/* Call after the matching core call, with the state it left. */
+void lightbar_record_init(LightbarRecorder *rec, const LightbarState *state,
+                          const LightbarConfig *config);
+void lightbar_record_start(LightbarRecorder *rec, const LightbarConfig *config);
+void lightbar_record_stop(LightbarRecorder *rec, const LightbarConfig *config);
+void lightbar_record_update(LightbarRecorder *rec, const LightbarState *state,
+                            const LightbarConfig *config, float dt_ms);
+/* Call when updates switch between lightbar_update() and
+ * lightbar_cache_update() (cached), before the next update. */
+void lightbar_record_cached(LightbarRecorder *rec, int cached);
+
+/* Writes the index and closes the file. Returns 0, or -1 if any write
+ * failed. */
+int lightbar_record_close(LightbarRecorder *rec);
+
+/* Returns 0, or -1 if the file cannot be mapped or is not a recording. */
+int lightbar_replay_open(LightbarReplay *replay, const char *path);
+void lightbar_replay_close(LightbarReplay *replay);
+
+/* Applies the next record. Returns its op, LIGHTBAR_REC_END at the end of
+ * the recording, or -1 if the record is corrupt. A repeat is applied one
+ * update at a time and returns LIGHTBAR_REC_UPDATE each time. */
+int lightbar_replay_next(LightbarReplay *replay);
+
+/* Positions the replay after the last update ending at or before time_ms,
+ * starting from the closest checkpoint. Returns 0, or -1 if the recording
+ * is corrupt. */
+int lightbar_replay_seek(LightbarReplay *replay, double time_ms);
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef LIGHTBAR_STATS_H
+#define LIGHTBAR_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Live counters in POSIX shared memory, for watching a running daemon from
+ * another process (tools/lightbar_stats) without a debugger or logging.
+ *
+ * The block is a LightbarStatsHeader followed by a fixed number of slots,
+ * one per session. Each slot has a single writer, the thread ticking its
+ * session, which updates it with relaxed atomic loads and stores: no locks,
+ * no read-modify-write, nothing a reader can stall. Readers map the block
+ * read-only. A sample is exact per field but not across fields, so a
+ * frame's counters may be half in it.
+ *
+ * The owner stores magic last, after everything else is in place. Readers
+ * check magic and version, and use slot_size to step over fields added by
+ * a newer writer. */
+
+#define LIGHTBAR_STATS_MAGIC 0x5354424cu
+#define LIGHTBAR_STATS_VERSION 1u
+#define LIGHTBAR_STATS_NAME_MAX 32
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_size;
+    uint32_t slots;
+    uint32_t pid;
+    uint32_t reserved;
+    /* CLOCK_REALTIME when the block was created */
+    uint64_t created_ns;
+} LightbarStatsHeader;
+
+typedef struct {
+    /* Bumped when a session takes or gives up the slot; odd while held */
+    uint32_t generation;
+    char name[LIGHTBAR_STATS_NAME_MAX];
+    uint64_t frames;
+    /* LED steps taken, and the most in any one frame */
+    uint64_t steps;
+    uint64_t max_steps;
+    uint64_t edges;
+    uint64_t pauses;
+    /* Wind-downs completed, and the time from lightbar_stop() to STOPPED */
+    uint64_t stops;
+    uint64_t stop_ns_sum;
+    uint64_t stop_ns_max;
+    /* Time spent in lightbar_render(); min is UINT64_MAX before a frame */
+    uint64_t render_ns_sum;
+    uint64_t render_ns_min;
+    uint64_t render_ns_max;
+} __attribute__((aligned(64))) LightbarStatsSlot;
+
+typedef struct {
+    LightbarStatsHeader *header;
+    LightbarStatsSlot *slots;
+    size_t size;
+    /* Set for the creator, which unlinks the name on close */
+    int owner;
+    char name[64];
+} LightbarStats;
+
+/* Creates the shared memory object name, e.g. "/lightbar", with room for
+ * count sessions, replacing a block whose creator has exited. Returns 0,
+ * or -1 with errno set (EEXIST if the creator is still running). */
+int lightbar_stats_create(LightbarStats *stats, const char *name, uint32_t count);
+/* Maps an existing block read-only. Returns 0, or -1 if it is missing or
+ * not a block this build understands. */
+int lightbar_stats_open(LightbarStats *stats, const char *name);
+void lightbar_stats_close(LightbarStats *stats);
+
+/* A free slot, zeroed and labelled name, or NULL if all are taken. Claim
+ * and release are for one thread (the daemon's control thread). */
+LightbarStatsSlot *lightbar_stats_claim(LightbarStats *stats, const char *name);
+void lightbar_stats_release(LightbarStatsSlot *slot);
+
+/* Accounts one frame: LED steps taken, edges reached, pauses entered and
+ * render time. Only the slot's writer may call it. */
+void lightbar_stats_frame(LightbarStatsSlot *slot, uint32_t steps, uint32_t edges,
+                          uint32_t pauses, uint64_t render_ns);
+/* Accounts a wind-down that came to rest latency_ns after lightbar_stop(). */
+void lightbar_stats_stopped(LightbarStatsSlot *slot, uint64_t latency_ns);
+
+/* Copies slot index into out. Returns 1 if a session holds it, else 0. */
+int lightbar_stats_sample(const LightbarStats *stats, uint32_t index, LightbarStatsSlot *out);
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef LIGHTBAR_TRACE_H
+#define LIGHTBAR_TRACE_H
+
+#include <stdint.h>
+
+/* Trace points for the update, render and frame loops, compiled in with
+ * -DLIGHTBAR_TRACE and to nothing otherwise.
+ *
+ * Each thread appends fixed 16-byte records to its own ring, allocated and
+ * registered on its first event. Appending is a timestamp read, a few
+ * stores and a release store of the head: no locks, no read-modify-write,
+ * no formatting. The timestamp is the TSC on x86, converted at dump time
+ * against CLOCK_MONOTONIC, and CLOCK_MONOTONIC elsewhere. A ring keeps
+ * the last LIGHTBAR_TRACE_CAPACITY records.
+ *
+ * lightbar_trace_dump() writes every ring to a file for tools/
+ * lightbar_trace_json, which turns it into Chrome/Perfetto trace JSON.
+ * Dump once the traced threads are idle or joined; a record being
+ * written during the dump may come out torn.
+ *
+ * File: LightbarTraceHeader, then per ring a LightbarTraceRingHeader and
+ * its records oldest first, all little-endian. */
+
+#ifndef LIGHTBAR_TRACE_CAPACITY
+#define LIGHTBAR_TRACE_CAPACITY (1u << 15)
+#endif
+
+#define LIGHTBAR_TRACE_MAGIC "LBTRACE1"
+
+typedef enum {
+    /* arg: steps taken, for the _END of update and advance. Args above
+     * 0xFFFF are recorded as 0xFFFF. */
+    LIGHTBAR_TRACE_UPDATE_BEGIN,
+    LIGHTBAR_TRACE_UPDATE_END,
+    LIGHTBAR_TRACE_ADVANCE_BEGIN,
+    LIGHTBAR_TRACE_ADVANCE_END,
+    /* arg: LEDs rewritten, for the _END of render and frame */
+    LIGHTBAR_TRACE_RENDER_BEGIN,
+    LIGHTBAR_TRACE_RENDER_END,
+    /* One bridge or daemon tick */
+    LIGHTBAR_TRACE_FRAME_BEGIN,
+    LIGHTBAR_TRACE_FRAME_END,
+    /* The phase changed to phase */
+    LIGHTBAR_TRACE_PHASE,
+    LIGHTBAR_TRACE_EVENT_COUNT
+} LightbarTraceEvent;
+
+typedef struct {
+    uint64_t ticks;
+    uint8_t event;
+    uint8_t phase;
+    uint16_t arg;
+    int32_t position;
+} LightbarTraceRecord;
+
+typedef struct {
+    char magic[8];
+    uint32_t record_size;
+    uint32_t rings;
+    double ns_per_tick;
+    uint64_t base_ticks;
+} LightbarTraceHeader;
+
+typedef struct {
+    uint32_t tid;
+    uint32_t reserved;
+    uint64_t count;
+} LightbarTraceRingHeader;
+
+typedef struct LightbarTraceRing LightbarTraceRing;
+
+struct LightbarTraceRing {
+    LightbarTraceRing *next;
+    uint32_t tid;
+    /* Records ever appended; the ring holds the last CAPACITY of them */
+    uint64_t head;
+    LightbarTraceRecord records[LIGHTBAR_TRACE_CAPACITY];
+};
+
+#ifdef LIGHTBAR_TRACE
+
+extern __thread LightbarTraceRing *lightbar_trace_ring;
+extern __thread uint32_t lightbar_trace_steps;
+
+/* This thread's ring, registering a new one on first use; NULL if out of
+ * memory, in which case the thread's events are dropped. */
+LightbarTraceRing *lightbar_trace_attach(void);
+/* CLOCK_MONOTONIC in ns */
+uint64_t lightbar_trace_clock(void);
+
+static inline uint64_t lightbar_trace_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return lightbar_trace_clock();
+#endif
+}
+
+static inline void lightbar_trace_emit(int event, int phase, uint32_t arg, int position) {
+    LightbarTraceRing *ring = lightbar_trace_ring;
+    if (!ring && !(ring = lightbar_trace_attach())) return;
+    uint64_t head = ring->head;
+    LightbarTraceRecord *r = &ring->records[head & (LIGHTBAR_TRACE_CAPACITY - 1)];
+    r->ticks = lightbar_trace_ticks();
+    r->event = (uint8_t)event;
+    r->phase = (uint8_t)phase;
+    r->arg = arg > 0xFFFF ? 0xFFFF : (uint16_t)arg;
+    r->position = position;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/* Writes every thread's ring. Returns 0, or -1 if the file cannot be
+ * written. */
+int lightbar_trace_dump(const char *path);
+
+#define LIGHTBAR_TRACE_EVENT(event, phase, arg, position) \
+    lightbar_trace_emit((event), (int)(phase), (uint32_t)(arg), (int)(position))
+#define LIGHTBAR_TRACE_STEPS_ADD(n) ((void)(lightbar_trace_steps += (n)))
+#define LIGHTBAR_TRACE_STEPS_RESET() ((void)(lightbar_trace_steps = 0))
+#define LIGHTBAR_TRACE_STEPS lightbar_trace_steps
+
+#else
+
+#define LIGHTBAR_TRACE_EVENT(event, phase, arg, position) ((void)0)
+#define LIGHTBAR_TRACE_STEPS_ADD(n) ((void)0)
+#define LIGHTBAR_TRACE_STEPS_RESET() ((void)0)
+
+#endif
+
+#endif
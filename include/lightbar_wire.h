@@ -0,0 +1,71 @@
+#ifndef LIGHTBAR_WIRE_H
+#define LIGHTBAR_WIRE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "lightbar.h"
+#include "lightbar_layout.h"
+
+/* Renders frames straight into the bytes an LED driver transmits, so there
+ * is no intermediate Led[] buffer and no second reordering/encoding pass.
+ * Each buffer remembers the lit window it last held: later frames only
+ * rewrite that window and the new one, since every dark LED already holds
+ * its encoded "off" pattern. */
+typedef enum {
+    LIGHTBAR_WIRE_GRB,          /* WS2812/SK6812: G, R, B - 3 bytes per LED */
+    LIGHTBAR_WIRE_GRBW,         /* SK6812 RGBW: G, R, B, W=0 - 4 bytes per LED */
+    LIGHTBAR_WIRE_WS2812_SPI3,  /* WS2812 over SPI at 2.4 MHz: 3 SPI bits per data bit */
+    LIGHTBAR_WIRE_WS2812_SPI4,  /* WS2812 over SPI at 3.2 MHz: 4 SPI bits per data bit */
+    LIGHTBAR_WIRE_APA102        /* start frame, 0xE0|brightness B G R per LED, end frame */
+} LightbarWireFormat;
+
+typedef struct {
+    LightbarWireFormat format;
+    uint16_t num_leds;
+    /* APA102 5-bit global brightness (0-31); ignored by other formats */
+    uint8_t brightness;
+    uint8_t *data;
+    /* Lit window last encoded into data; valid == 0 forces a full encode */
+    int valid;
+    int from;
+    int to;
+} LightbarWire;
+
+/* Two transmit buffers: one is encoded while the other goes out over DMA. */
+typedef struct {
+    LightbarWire buffers[2];
+    int front;
+} LightbarWirePair;
+
+/* Bytes per LED, and total transmit bytes including any frame overhead. */
+size_t lightbar_wire_stride(LightbarWireFormat format);
+size_t lightbar_wire_size(LightbarWireFormat format, uint16_t num_leds);
+
+/* data must hold lightbar_wire_size(format, num_leds) bytes. */
+void lightbar_wire_init(LightbarWire *wire, LightbarWireFormat format, uint16_t num_leds,
+                        uint8_t brightness, uint8_t *data);
+void lightbar_wire_set_brightness(LightbarWire *wire, uint8_t brightness);
+
+/* Encodes the frame lightbar_render() would draw. config->num_leds must
+ * match the num_leds the buffer was set up with. */
+void lightbar_wire_render(LightbarWire *wire, const LightbarState *state,
+                          const LightbarConfig *config);
+
+/* Encodes the frame through a compiled layout into one buffer per output
+ * channel, wires[c] holding layout->channel_leds[c] LEDs. Only the pixels
+ * of the previous and the new lit window are rewritten. */
+void lightbar_wire_render_layout(LightbarWire *wires, const LightbarLayout *layout,
+                                 const LightbarState *state, const LightbarConfig *config);
+
+void lightbar_wire_pair_init(LightbarWirePair *pair, LightbarWireFormat format,
+                             uint16_t num_leds, uint8_t brightness,
+                             uint8_t *data0, uint8_t *data1);
+void lightbar_wire_pair_set_brightness(LightbarWirePair *pair, uint8_t brightness);
+
+/* Encodes the next frame into the buffer not currently being sent, makes it
+ * the front buffer and returns it for transmission. The previous front
+ * buffer must be free again (its transfer finished) before the next call. */
+const uint8_t *lightbar_wire_pair_render(LightbarWirePair *pair, const LightbarState *state,
+                                         const LightbarConfig *config);
+
+#endif
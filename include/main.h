@@ -1,6 +1,19 @@
 #ifndef MAIN_H
 #define MAIN_H
 
-const char *hello_message(void);
+#define MAIN_DEFAULT_SOCKET "/tmp/lightbar.sock"
+#define MAIN_DEFAULT_WORKERS 4
+#define MAIN_MAX_WORKERS 64
+#define MAIN_STATS_SLOTS 256
+
+typedef struct {
+    const char *socket_path;
+    int workers;
+    /* Shared memory name for live stats, or NULL */
+    const char *stats_name;
+} Options;
+
+/* Reads `[-s socket] [-w workers] [-m stats_name]`. Returns 0, or -1 on a bad command line. */
+int parse_options(int argc, char **argv, Options *options);
 
 #endif
@@ -0,0 +1,46 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+
+/* Hierarchical timer wheel: four levels of 256 slots, each level 256 times
+ * coarser than the one below. Adding and removing a timer is O(1); timers
+ * on the upper levels cascade down as their slot comes up, keeping their
+ * exact expiry tick. Times are in caller-defined ticks. */
+#define TIMER_WHEEL_BITS 8
+#define TIMER_WHEEL_SLOTS (1u << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+
+/* Embed in the timed object; zero it before first use. */
+typedef struct TimerEntry {
+    struct TimerEntry *next;
+    struct TimerEntry *prev;
+    uint64_t expires;
+} TimerEntry;
+
+typedef struct {
+    uint64_t now;
+    uint32_t count;
+    /* Circular list heads */
+    TimerEntry slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+} TimerWheel;
+
+typedef void (*TimerFn)(TimerEntry *entry, void *ctx);
+
+void timer_wheel_init(TimerWheel *wheel, uint64_t now);
+
+/* Schedules entry to fire at tick expires; a tick not after wheel->now
+ * fires on the next advance. entry must not already be scheduled. */
+void timer_wheel_add(TimerWheel *wheel, TimerEntry *entry, uint64_t expires);
+void timer_wheel_remove(TimerWheel *wheel, TimerEntry *entry);
+int timer_wheel_pending(const TimerEntry *entry);
+
+/* Moves the wheel to tick now, calling fn for every timer that expires on
+ * the way, in expiry order. fn may add or remove timers. */
+void timer_wheel_advance(TimerWheel *wheel, uint64_t now, TimerFn fn, void *ctx);
+
+/* Ticks from wheel->now until the wheel next needs advancing: the nearest
+ * expiry, or the next cascade if that comes first. UINT64_MAX when empty. */
+uint64_t timer_wheel_next(const TimerWheel *wheel);
+
+#endif
@@ -0,0 +1,128 @@
+#include "control.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const struct {
+    const char *word;
+    ControlOp op;
+    int needs_name;
+} ops[] = {
+    { "add", CONTROL_ADD, 1 },
+    { "set", CONTROL_SET, 1 },
+    { "start", CONTROL_START, 1 },
+    { "stop", CONTROL_STOP, 1 },
+    { "remove", CONTROL_REMOVE, 1 },
+    { "stats", CONTROL_STATS, 0 },
+    { "list", CONTROL_LIST, 0 }
+};
+
+/* Copies the next space-separated word of *line into word. Returns its
+ * length, 0 at end of line, or -1 if it does not fit. */
+static int next_word(const char **line, char *word, size_t size) {
+    const char *p = *line;
+    while (*p == ' ' || *p == '\t') p++;
+    size_t n = 0;
+    while (p[n] && !isspace((unsigned char)p[n])) n++;
+    if (n >= size) return -1;
+    memcpy(word, p, n);
+    word[n] = '\0';
+    *line = p + n;
+    return (int)n;
+}
+
+static int parse_uint(const char *s, unsigned long max, unsigned long *out) {
+    char *end;
+    if (!isdigit((unsigned char)*s)) return -1;
+    unsigned long v = strtoul(s, &end, 10);
+    if (*end || v > max) return -1;
+    *out = v;
+    return 0;
+}
+
+static int parse_setting(ControlCommand *cmd, const char *key, const char *value) {
+    unsigned long v;
+    if (strcmp(key, "leds") == 0) {
+        if (parse_uint(value, 65535, &v) != 0 || v == 0) return -1;
+        cmd->config.num_leds = (uint16_t)v;
+        cmd->fields |= CONTROL_HAS_LEDS;
+    } else if (strcmp(key, "speed") == 0) {
+        char *end;
+        double speed = strtod(value, &end);
+        if (end == value || *end || !(speed >= 0.0) || speed > 100000.0) return -1;
+        cmd->config.speed = (float)speed;
+        cmd->fields |= CONTROL_HAS_SPEED;
+    } else if (strcmp(key, "pause") == 0) {
+        if (parse_uint(value, 65535, &v) != 0) return -1;
+        cmd->config.end_pause_ms = (uint16_t)v;
+        cmd->fields |= CONTROL_HAS_PAUSE;
+    } else if (strcmp(key, "glow") == 0) {
+        if (parse_uint(value, 65535, &v) != 0) return -1;
+        cmd->config.glow_radius = (uint16_t)v;
+        cmd->fields |= CONTROL_HAS_GLOW;
+    } else if (strcmp(key, "color") == 0) {
+        char *end;
+        if (strlen(value) != 6 || !isxdigit((unsigned char)*value)) return -1;
+        v = strtoul(value, &end, 16);
+        if (*end) return -1;
+        cmd->config.color.r = (uint8_t)(v >> 16);
+        cmd->config.color.g = (uint8_t)(v >> 8);
+        cmd->config.color.b = (uint8_t)v;
+        cmd->fields |= CONTROL_HAS_COLOR;
+    } else if (strcmp(key, "smooth") == 0) {
+        if (parse_uint(value, 1, &v) != 0) return -1;
+        cmd->config.smooth = (uint8_t)v;
+        cmd->fields |= CONTROL_HAS_SMOOTH;
+    } else if (strcmp(key, "rate") == 0) {
+        if (parse_uint(value, 10000, &v) != 0 || v == 0) return -1;
+        cmd->rate_hz = (uint32_t)v;
+        cmd->fields |= CONTROL_HAS_RATE;
+    } else if (strcmp(key, "sink") == 0) {
+        if (strlen(value) >= CONTROL_SINK_MAX) return -1;
+        strcpy(cmd->sink, value);
+        cmd->fields |= CONTROL_HAS_SINK;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int control_parse(const char *line, ControlCommand *cmd) {
+    char word[CONTROL_SINK_MAX + 16];
+    memset(cmd, 0, sizeof(*cmd));
+
+    if (next_word(&line, word, sizeof(word)) <= 0) return -1;
+    size_t i;
+    for (i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+        if (strcmp(word, ops[i].word) == 0) break;
+    }
+    if (i == sizeof(ops) / sizeof(ops[0])) return -1;
+    cmd->op = ops[i].op;
+
+    int n = next_word(&line, cmd->name, sizeof(cmd->name));
+    if (n < 0 || (ops[i].needs_name && n == 0)) return -1;
+    if (cmd->op == CONTROL_LIST && n > 0) return -1;
+
+    while ((n = next_word(&line, word, sizeof(word))) > 0) {
+        char *eq = strchr(word, '=');
+        if (!eq || eq == word) return -1;
+        *eq = '\0';
+        if (parse_setting(cmd, word, eq + 1) != 0) return -1;
+    }
+    if (n < 0) return -1;
+
+    /* Only add and set take settings; a strip's length is fixed once added */
+    if (cmd->fields && cmd->op != CONTROL_ADD && cmd->op != CONTROL_SET) return -1;
+    if (cmd->op == CONTROL_SET && (cmd->fields & CONTROL_HAS_LEDS)) return -1;
+    return 0;
+}
+
+void control_apply(const ControlCommand *cmd, LightbarConfig *config, uint32_t *rate_hz) {
+    if (cmd->fields & CONTROL_HAS_LEDS) config->num_leds = cmd->config.num_leds;
+    if (cmd->fields & CONTROL_HAS_SPEED) config->speed = cmd->config.speed;
+    if (cmd->fields & CONTROL_HAS_PAUSE) config->end_pause_ms = cmd->config.end_pause_ms;
+    if (cmd->fields & CONTROL_HAS_GLOW) config->glow_radius = cmd->config.glow_radius;
+    if (cmd->fields & CONTROL_HAS_COLOR) config->color = cmd->config.color;
+    if (cmd->fields & CONTROL_HAS_SMOOTH) config->smooth = cmd->config.smooth;
+    if (cmd->fields & CONTROL_HAS_RATE) *rate_hz = cmd->rate_hz;
+}
@@ -1,5 +1,61 @@
 #include "lightbar.h"
+#include "lightbar_trace.h"
+#include <math.h>
 #include <stdlib.h>
+#include <string.h>
+
+static void clamp_to_edge(LightbarState *state, int last) {
+    if (state->position <= 0) state->position = 0;
+    if (state->position >= last) state->position = last;
+}
+
+static void finalize_stop(LightbarState *state) {
+    state->phase = LIGHTBAR_STOPPED;
+    state->direction = 1;
+    state->pause_timer_ms = 0.0f;
+    state->move_accum_ms = 0.0f;
+}
+
+void lightbar_profile_init(LightbarProfile *profile, LightbarProfileType type) {
+    profile->type = type;
+    for (int i = 0; i <= LIGHTBAR_PROFILE_SIZE; i++) {
+        double u = (double)i / LIGHTBAR_PROFILE_SIZE;
+        double p;
+        switch (type) {
+        case LIGHTBAR_PROFILE_SINE:
+            p = 0.5 - 0.5 * cos(3.14159265358979323846 * u);
+            break;
+        case LIGHTBAR_PROFILE_EASE_IN_OUT:
+            p = u < 0.5 ? 4.0 * u * u * u : 1.0 - 4.0 * (1.0 - u) * (1.0 - u) * (1.0 - u);
+            break;
+        default:
+            p = u;
+            break;
+        }
+        profile->table[i] = (float)p;
+    }
+}
+
+int lightbar_profile_init_custom(LightbarProfile *profile, const float *points, int count) {
+    if (count < 2) return -1;
+    profile->type = LIGHTBAR_PROFILE_CUSTOM;
+    for (int i = 0; i <= LIGHTBAR_PROFILE_SIZE; i++) {
+        float x = (float)i * (float)(count - 1) / LIGHTBAR_PROFILE_SIZE;
+        int k = (int)x;
+        if (k >= count - 1) k = count - 2;
+        float p = points[k] + (points[k + 1] - points[k]) * (x - (float)k);
+        profile->table[i] = p < 0.0f ? 0.0f : (p > 1.0f ? 1.0f : p);
+    }
+    return 0;
+}
+
+float lightbar_profile_at(const LightbarProfile *profile, float u) {
+    if (u <= 0.0f) return profile->table[0];
+    if (u >= 1.0f) return profile->table[LIGHTBAR_PROFILE_SIZE];
+    float x = u * LIGHTBAR_PROFILE_SIZE;
+    int i = (int)x;
+    return profile->table[i] + (profile->table[i + 1] - profile->table[i]) * (x - (float)i);
+}
 
 void lightbar_init(LightbarState *state, const LightbarConfig *config) {
     state->position = config->num_leds / 2;
@@ -12,6 +68,7 @@ void lightbar_init(LightbarState *state, const LightbarConfig *config) {
 
 void lightbar_start(LightbarState *state) {
     state->phase = LIGHTBAR_MOVING;
+    LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_PHASE, state->phase, 0, state->position);
 }
 
 void lightbar_stop(LightbarState *state, const LightbarConfig *config) {
@@ -33,109 +90,638 @@ void lightbar_stop(LightbarState *state, const LightbarConfig *config) {
     }
 
     state->phase = LIGHTBAR_STOPPING;
+    LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_PHASE, state->phase, 0, state->position);
 }
 
-void lightbar_update(LightbarState *state, const LightbarConfig *config, float dt_ms) {
-    if (state->phase == LIGHTBAR_STOPPED) {
+/* Number of steps from the current position until the edge check fires. */
+static int steps_to_edge(const LightbarState *state, const LightbarConfig *config) {
+    int next = state->position + state->direction;
+    if (next <= 0 || next >= config->num_leds - 1) return 1;
+    return (state->direction == 1) ? config->num_leds - 1 - state->position
+                                   : state->position;
+}
+
+/* Strips this short only ever reach the middle during an end pause (or
+ * never), so a wind-down on them oscillates forever like MOVING does. */
+static int never_finalizes(const LightbarConfig *config) {
+    return config->num_leds <= 2 &&
+           (config->end_pause_ms > 0 || config->num_leds == 0);
+}
+
+static void emit(LightbarEventBuffer *events, LightbarEventType type, int position,
+                 int direction, double offset_ms) {
+    if (events->count == events->capacity) {
+        events->overflow = 1;
         return;
     }
+    LightbarEvent *e = &events->events[events->count++];
+    e->type = type;
+    e->position = position;
+    e->direction = direction;
+    e->offset_ms = (float)offset_ms;
+}
 
-    if (state->phase == LIGHTBAR_PAUSED_END) {
-        state->pause_timer_ms -= dt_ms;
-        if (state->pause_timer_ms <= 0.0f) {
+/* Moves the state on by dt_ms, jumping from event to event and reporting
+ * them into events when it is not NULL. With carry, time left over when a
+ * pause starts or ends runs on into the next phase (lightbar_advance());
+ * without it the rest of dt_ms is dropped there (lightbar_update()).
+ * ms_per_step is 0 when the dot cannot move. */
+static void advance_events(LightbarState *state, const LightbarConfig *config,
+                           float ms_per_step, int middle, float dt_ms,
+                           LightbarEventBuffer *events, int carry) {
+    int reduced = 0;
+    float t = dt_ms;
+
+    while (state->phase != LIGHTBAR_STOPPED) {
+        int stopping = (state->phase == LIGHTBAR_STOPPING);
+
+        if (state->phase == LIGHTBAR_PAUSED_END ||
+            (stopping && state->pause_timer_ms > 0.0f)) {
+            if (t < state->pause_timer_ms) {
+                state->pause_timer_ms -= t;
+                return;
+            }
+            t -= state->pause_timer_ms;
             state->direction = -state->direction;
-            state->phase = LIGHTBAR_MOVING;
+            if (!stopping) state->phase = LIGHTBAR_MOVING;
             state->pause_timer_ms = 0.0f;
             state->move_accum_ms = 0.0f;
+            if (events) {
+                emit(events, LIGHTBAR_EVENT_PAUSE_END, state->position, state->direction,
+                     (double)dt_ms - t);
+            }
+            if (!carry) return;
+            continue;
+        }
+
+        if (ms_per_step <= 0.0f) return;
+        float accum = state->move_accum_ms + t;
+
+        /* Jump straight to the next event: an edge, or the middle once a
+         * wind-down has no edges left to visit. */
+        int edge_steps = steps_to_edge(state, config);
+        int steps = edge_steps;
+        int to_middle = (middle - state->position) * state->direction;
+        if (stopping && state->edges_remaining == 0 &&
+            to_middle > 0 && to_middle < edge_steps) {
+            steps = to_middle;
         }
-        return;
-    }
 
-    if (state->phase == LIGHTBAR_STOPPING) {
-        /* Handle pending end pause (stays in STOPPING phase) */
-        if (state->pause_timer_ms > 0.0f) {
-            state->pause_timer_ms -= dt_ms;
-            if (state->pause_timer_ms <= 0.0f) {
-                state->direction = -state->direction;
-                state->pause_timer_ms = 0.0f;
-                state->move_accum_ms = 0.0f;
+        if ((double)accum < (double)steps * ms_per_step) {
+            int n = (int)((double)accum / ms_per_step);
+            if (n >= steps) n = steps - 1;
+            if (events && to_middle > 0 && to_middle <= n) {
+                emit(events, LIGHTBAR_EVENT_MIDDLE_CROSSED, middle, state->direction,
+                     (double)dt_ms - t + (double)to_middle * ms_per_step - state->move_accum_ms);
             }
+            state->position += n * state->direction;
+            LIGHTBAR_TRACE_STEPS_ADD(n);
+            state->move_accum_ms = (float)((double)accum - (double)n * ms_per_step);
             return;
         }
 
-        if (config->speed <= 0.0f) return;
-        float ms_per_step = 1000.0f / config->speed;
-        state->move_accum_ms += dt_ms;
-        while (state->move_accum_ms >= ms_per_step) {
-            state->move_accum_ms -= ms_per_step;
-            state->position += state->direction;
-
-            /* Edge check */
-            if (state->position <= 0 || state->position >= config->num_leds - 1) {
-                if (state->position <= 0) state->position = 0;
-                if (state->position >= config->num_leds - 1)
-                    state->position = config->num_leds - 1;
-                if (state->edges_remaining > 0) state->edges_remaining--;
-                if (config->end_pause_ms > 0) {
-                    state->pause_timer_ms = (float)config->end_pause_ms;
-                    state->move_accum_ms = 0.0f;
-                    return;
-                }
-                state->direction = -state->direction;
+        double start_ms = (double)dt_ms - t - state->move_accum_ms;
+        t = (float)((double)accum - (double)steps * ms_per_step);
+        state->position += steps * state->direction;
+        LIGHTBAR_TRACE_STEPS_ADD(steps);
+        state->move_accum_ms = 0.0f;
+        if (events && to_middle > 0 && to_middle <= steps) {
+            emit(events, LIGHTBAR_EVENT_MIDDLE_CROSSED, middle, state->direction,
+                 start_ms + (double)to_middle * ms_per_step);
+        }
+
+        if (steps < edge_steps) {
+            if (events) {
+                emit(events, LIGHTBAR_EVENT_STOPPED, state->position, state->direction,
+                     (double)dt_ms - t);
             }
+            finalize_stop(state);
+            return;
+        }
 
-            /* Middle check */
-            if (state->position == config->num_leds / 2 &&
+        clamp_to_edge(state, config->num_leds - 1);
+        if (events) {
+            emit(events, LIGHTBAR_EVENT_EDGE_REACHED, state->position, state->direction,
+                 (double)dt_ms - t);
+        }
+        if (stopping && state->edges_remaining > 0) state->edges_remaining--;
+        if (config->end_pause_ms > 0) {
+            if (!stopping) state->phase = LIGHTBAR_PAUSED_END;
+            state->pause_timer_ms = (float)config->end_pause_ms;
+            if (!carry) return;
+        } else {
+            state->direction = -state->direction;
+            if (stopping && state->position == middle &&
                 state->edges_remaining == 0) {
-                state->phase = LIGHTBAR_STOPPED;
-                state->direction = 1;
-                state->pause_timer_ms = 0.0f;
-                state->move_accum_ms = 0.0f;
+                if (events) {
+                    emit(events, LIGHTBAR_EVENT_STOPPED, state->position, -state->direction,
+                         (double)dt_ms - t);
+                }
+                finalize_stop(state);
                 return;
             }
         }
+
+        /* From an edge the motion repeats every two legs and two pauses,
+         * so whole periods of a long stall can be skipped outright (once
+         * there is no more room to report their events). */
+        if (!reduced && (!events || events->overflow) &&
+            (!stopping || (state->edges_remaining == 0 && never_finalizes(config)))) {
+            int leg = (config->num_leds > 2) ? config->num_leds - 1 : 1;
+            float period_ms = 2.0f * ((float)leg * ms_per_step + (float)config->end_pause_ms);
+            if (t >= period_ms) t = fmodf(t, period_ms);
+            reduced = 1;
+        }
+    }
+}
+
+static void traced_update(LightbarState *state, const LightbarConfig *config,
+                          float ms_per_step, int middle, float dt_ms) {
+#ifdef LIGHTBAR_TRACE
+    LightbarPhase phase = state->phase;
+    LIGHTBAR_TRACE_STEPS_RESET();
+    LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_UPDATE_BEGIN, phase, 0, state->position);
+    advance_events(state, config, ms_per_step, middle, dt_ms, NULL, 0);
+    LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_UPDATE_END, state->phase, LIGHTBAR_TRACE_STEPS,
+                         state->position);
+    if (state->phase != phase) {
+        LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_PHASE, state->phase, 0, state->position);
+    }
+#else
+    advance_events(state, config, ms_per_step, middle, dt_ms, NULL, 0);
+#endif
+}
+
+static float step_ms(const LightbarConfig *config) {
+    return config->speed > 0.0f ? 1000.0f / config->speed : 0.0f;
+}
+
+void lightbar_update(LightbarState *state, const LightbarConfig *config, float dt_ms) {
+    traced_update(state, config, step_ms(config), config->num_leds / 2, dt_ms);
+}
+
+void lightbar_update_plan(LightbarState *state, const LightbarPlan *plan, float dt_ms) {
+    traced_update(state, &plan->config, plan->ms_per_step, plan->middle, dt_ms);
+}
+
+static void advance(LightbarState *state, const LightbarConfig *config, float dt_ms,
+                    LightbarEventBuffer *events) {
+#ifdef LIGHTBAR_TRACE
+    LightbarPhase phase = state->phase;
+    LIGHTBAR_TRACE_STEPS_RESET();
+    LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_ADVANCE_BEGIN, phase, 0, state->position);
+    advance_events(state, config, step_ms(config), config->num_leds / 2, dt_ms, events, 1);
+    LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_ADVANCE_END, state->phase, LIGHTBAR_TRACE_STEPS,
+                         state->position);
+    if (state->phase != phase) {
+        LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_PHASE, state->phase, 0, state->position);
+    }
+#else
+    advance_events(state, config, step_ms(config), config->num_leds / 2, dt_ms, events, 1);
+#endif
+}
+
+void lightbar_advance(LightbarState *state, const LightbarConfig *config, float dt_ms) {
+    advance(state, config, dt_ms, NULL);
+}
+
+void lightbar_advance_events(LightbarState *state, const LightbarConfig *config, float dt_ms,
+                             LightbarEventBuffer *events) {
+    events->count = 0;
+    events->overflow = 0;
+    advance(state, config, dt_ms, events);
+}
+
+float lightbar_time_to_event(const LightbarState *state, const LightbarConfig *config) {
+    if (state->phase == LIGHTBAR_STOPPED) return -1.0f;
+    int stopping = (state->phase == LIGHTBAR_STOPPING);
+    if (state->phase == LIGHTBAR_PAUSED_END || (stopping && state->pause_timer_ms > 0.0f)) {
+        return state->pause_timer_ms;
+    }
+    if (config->speed <= 0.0f) return -1.0f;
+
+    float ms_per_step = 1000.0f / config->speed;
+    int edge_steps = steps_to_edge(state, config);
+    int steps = edge_steps;
+    int to_middle = (config->num_leds / 2 - state->position) * state->direction;
+    if (stopping && state->edges_remaining == 0 && to_middle > 0 && to_middle < edge_steps) {
+        steps = to_middle;
+    }
+    double boundary = (double)steps * ms_per_step;
+    double t = boundary - (double)state->move_accum_ms;
+    if (t <= 0.0) return 0.0f;
+    /* advance_events() adds dt to the accumulator in float and compares the
+     * sum with the boundary in double, so the nearest float to t can land a
+     * hair short; round up until it reaches */
+    float ms = (float)t;
+    while ((double)(state->move_accum_ms + ms) < boundary) ms = nextafterf(ms, INFINITY);
+    return ms;
+}
+
+static void clear_leds(Led *leds, int count) {
+    if (count > 0) memset(leds, 0, (size_t)count * sizeof(Led));
+}
+
+/* round(255 * (v / 255)^2.2) */
+static const uint8_t gamma22[256] = {
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,
+      1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+      3,   3,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,   6,
+      6,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  11,  11,  11,  12,
+     12,  13,  13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,
+     20,  20,  21,  22,  22,  23,  23,  24,  25,  25,  26,  26,  27,  28,  28,  29,
+     30,  30,  31,  32,  33,  33,  34,  35,  35,  36,  37,  38,  39,  39,  40,  41,
+     42,  43,  43,  44,  45,  46,  47,  48,  49,  49,  50,  51,  52,  53,  54,  55,
+     56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,
+     73,  74,  75,  76,  77,  78,  79,  81,  82,  83,  84,  85,  87,  88,  89,  90,
+     91,  93,  94,  95,  97,  98,  99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+    113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+    137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+    163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+    192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+    223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255
+};
+
+void lightbar_lut_init(LightbarLut *lut, uint8_t brightness, uint8_t gamma) {
+    lut->brightness = brightness;
+    lut->gamma = gamma;
+    for (int v = 0; v < 256; v++) {
+        int level = gamma ? gamma22[v] : v;
+        lut->table[v] = (uint8_t)((level * brightness + 127) / 255);
+    }
+}
+
+int lightbar_lut_set_brightness(LightbarLut *lut, uint8_t brightness) {
+    if (lut->brightness == brightness) return 0;
+    lightbar_lut_init(lut, brightness, lut->gamma);
+    return 1;
+}
+
+static inline Led correct(const LightbarLut *lut, Led led) {
+    if (lut) {
+        led.r = lut->table[led.r];
+        led.g = lut->table[led.g];
+        led.b = lut->table[led.b];
+    }
+    return led;
+}
+
+static Led glow_at(Led color, int radius, int distance) {
+    Led led = color;
+    if (distance > 0) {
+        int divisor = radius + 1;
+        int factor = divisor - distance;
+        led.r = (uint8_t)(color.r * factor / divisor);
+        led.g = (uint8_t)(color.g * factor / divisor);
+        led.b = (uint8_t)(color.b * factor / divisor);
+    }
+    return led;
+}
+
+/* Blend weight (0-255) given to the LED one step ahead of position: how far
+ * move_accum_ms has progressed toward the next step. Zero unless smooth
+ * rendering is on and the dot is travelling. */
+static int smooth_weight(const LightbarState *state, const LightbarConfig *config) {
+    if (!config->smooth || config->speed <= 0.0f) return 0;
+    if (state->phase != LIGHTBAR_MOVING && state->phase != LIGHTBAR_STOPPING) return 0;
+    if (state->pause_timer_ms > 0.0f) return 0;
+    int weight = (int)(state->move_accum_ms * config->speed * 0.256f);
+    if (weight < 0) weight = 0;
+    if (weight > 255) weight = 255;
+    return weight;
+}
+
+static int travelling(const LightbarState *state, const LightbarConfig *config) {
+    return (state->phase == LIGHTBAR_MOVING ||
+            (state->phase == LIGHTBAR_STOPPING && state->pause_timer_ms <= 0.0f)) &&
+           config->speed > 0.0f;
+}
+
+static int profiled(const LightbarConfig *config) {
+    return config->profile && config->profile->type != LIGHTBAR_PROFILE_LINEAR &&
+           config->num_leds >= 2;
+}
+
+float lightbar_dot_position(const LightbarState *state, const LightbarConfig *config) {
+    if (!travelling(state, config)) return (float)state->position;
+    float steps = state->move_accum_ms * config->speed / 1000.0f;
+    if (!profiled(config)) return (float)state->position + (float)state->direction * steps;
+
+    /* Progress through the leg from the end the dot last left */
+    int last = config->num_leds - 1;
+    int done = state->direction == 1 ? state->position : last - state->position;
+    float covered = lightbar_profile_at(config->profile, ((float)done + steps) / (float)last) *
+                    (float)last;
+    return state->direction == 1 ? covered : (float)last - covered;
+}
+
+/* The dot lightbar_render() draws: position blended weight/256 of the way
+ * toward ahead. */
+static void dot_at(const LightbarState *state, const LightbarConfig *config,
+                   int *position, int *ahead, int *weight) {
+    if (!profiled(config) || !travelling(state, config)) {
+        *position = state->position;
+        *weight = smooth_weight(state, config);
+        *ahead = *weight ? state->position + state->direction : state->position;
+        return;
+    }
+    float x = lightbar_dot_position(state, config);
+    int base = (int)x;
+    float frac = x - (float)base;
+    if (!config->smooth) {
+        *position = base + (frac >= 0.5f);
+        *ahead = *position;
+        *weight = 0;
         return;
     }
+    *position = base;
+    *weight = (int)(frac * 256.0f);
+    if (*weight > 255) *weight = 255;
+    *ahead = *weight ? base + 1 : base;
+}
 
-    if (state->phase == LIGHTBAR_MOVING) {
-        if (config->speed <= 0.0f) return;
-        float ms_per_step = 1000.0f / config->speed;
-        state->move_accum_ms += dt_ms;
-        while (state->move_accum_ms >= ms_per_step) {
-            state->move_accum_ms -= ms_per_step;
-            state->position += state->direction;
-
-            /* End check */
-            if (state->position <= 0 || state->position >= config->num_leds - 1) {
-                if (state->position <= 0) state->position = 0;
-                if (state->position >= config->num_leds - 1) state->position = config->num_leds - 1;
-                if (config->end_pause_ms > 0) {
-                    state->phase = LIGHTBAR_PAUSED_END;
-                    state->pause_timer_ms = (float)config->end_pause_ms;
-                    state->move_accum_ms = 0.0f;
-                    return;
-                }
-                state->direction = -state->direction;
-            }
+/* LEDs [*from, *to) that a dot spanning position..ahead can light, clipped
+ * to the strip. */
+static void window_bounds(int position, int ahead, int radius, int num_leds,
+                          int *from, int *to) {
+    *from = ((ahead < position) ? ahead : position) - radius;
+    *to = ((ahead > position) ? ahead : position) + radius + 1;
+    if (*from < 0) *from = 0;
+    if (*from > num_leds) *from = num_leds;
+    if (*to > num_leds) *to = num_leds;
+    if (*to < *from) *to = *from;
+}
+
+static void draw_window(Led color, int radius, const LightbarLut *lut, int position,
+                        int ahead, int weight, int from, int to, Led *leds) {
+    if (weight == 0) {
+        for (int i = from; i < to; i++) {
+            leds[i] = correct(lut, glow_at(color, radius, abs(i - position)));
         }
+        return;
+    }
+    const Led off = { 0, 0, 0 };
+    for (int i = from; i < to; i++) {
+        int d0 = abs(i - position);
+        int d1 = abs(i - ahead);
+        Led a = (d0 <= radius) ? glow_at(color, radius, d0) : off;
+        Led b = (d1 <= radius) ? glow_at(color, radius, d1) : off;
+        Led led;
+        led.r = (uint8_t)((a.r * (256 - weight) + b.r * weight) >> 8);
+        led.g = (uint8_t)((a.g * (256 - weight) + b.g * weight) >> 8);
+        led.b = (uint8_t)((a.b * (256 - weight) + b.b * weight) >> 8);
+        leds[i] = correct(lut, led);
     }
 }
 
+void lightbar_render_dot(uint16_t num_leds, uint16_t glow_radius, Led color,
+                        const LightbarLut *lut, int position, int ahead, int weight,
+                        Led *leds) {
+    int from, to;
+    if (weight == 0) ahead = position;
+    window_bounds(position, ahead, glow_radius, num_leds, &from, &to);
+    clear_leds(leds, from);
+    draw_window(color, glow_radius, lut, position, ahead, weight, from, to, leds);
+    clear_leds(leds + to, num_leds - to);
+}
+
 void lightbar_render(const LightbarState *state, const LightbarConfig *config, Led *leds) {
-    for (int i = 0; i < config->num_leds; i++) {
-        int distance = abs(i - state->position);
-        if (distance == 0) {
-            leds[i] = config->color;
-        } else if (config->glow_radius > 0 && distance <= config->glow_radius) {
-            int divisor = config->glow_radius + 1;
-            int factor = divisor - distance;
-            leds[i].r = (uint8_t)(config->color.r * factor / divisor);
-            leds[i].g = (uint8_t)(config->color.g * factor / divisor);
-            leds[i].b = (uint8_t)(config->color.b * factor / divisor);
+    int position, ahead, weight;
+    LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_RENDER_BEGIN, state->phase, 0, state->position);
+    dot_at(state, config, &position, &ahead, &weight);
+    lightbar_render_dot(config->num_leds, config->glow_radius, config->color, config->lut,
+                        position, ahead, weight, leds);
+    LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_RENDER_END, state->phase, config->num_leds,
+                         state->position);
+}
+
+void lightbar_span(const LightbarState *state, const LightbarConfig *config, LightbarSpan *span) {
+    span->color = config->color;
+    span->radius = config->glow_radius;
+    dot_at(state, config, &span->position, &span->ahead, &span->weight);
+    span->lut = config->lut;
+    window_bounds(span->position, span->ahead, span->radius, config->num_leds,
+                  &span->from, &span->to);
+}
+
+Led lightbar_span_led(const LightbarSpan *span, int i) {
+    const Led off = { 0, 0, 0 };
+    int d0 = abs(i - span->position);
+    Led a = (d0 <= span->radius) ? glow_at(span->color, span->radius, d0) : off;
+    if (span->weight == 0) return correct(span->lut, a);
+    int d1 = abs(i - span->ahead);
+    Led b = (d1 <= span->radius) ? glow_at(span->color, span->radius, d1) : off;
+    Led led;
+    led.r = (uint8_t)((a.r * (256 - span->weight) + b.r * span->weight) >> 8);
+    led.g = (uint8_t)((a.g * (256 - span->weight) + b.g * span->weight) >> 8);
+    led.b = (uint8_t)((a.b * (256 - span->weight) + b.b * span->weight) >> 8);
+    return correct(span->lut, led);
+}
+
+void lightbar_glow_init(LightbarGlow *glow, const LightbarConfig *config) {
+    glow->color = config->color;
+    glow->radius = config->glow_radius;
+    glow->lut = config->lut;
+    glow->brightness = config->lut ? config->lut->brightness : 0;
+    if (glow->radius > LIGHTBAR_MAX_GLOW_RADIUS) return;
+    for (int d = 0; d <= glow->radius; d++) {
+        Led led = correct(config->lut, glow_at(config->color, glow->radius, d));
+        glow->window[glow->radius - d] = led;
+        glow->window[glow->radius + d] = led;
+    }
+}
+
+int lightbar_glow_sync(LightbarGlow *glow, const LightbarConfig *config) {
+    if (glow->radius == config->glow_radius &&
+        glow->color.r == config->color.r &&
+        glow->color.g == config->color.g &&
+        glow->color.b == config->color.b &&
+        glow->lut == config->lut &&
+        (!config->lut || glow->brightness == config->lut->brightness)) {
+        return 0;
+    }
+    lightbar_glow_init(glow, config);
+    return 1;
+}
+
+void lightbar_render_glow(const LightbarState *state, const LightbarConfig *config,
+                          const LightbarGlow *glow, Led *leds) {
+    int position, ahead, weight;
+    dot_at(state, config, &position, &ahead, &weight);
+    if (glow->radius > LIGHTBAR_MAX_GLOW_RADIUS || weight > 0) {
+        lightbar_render(state, config, leds);
+        return;
+    }
+    int start = position - glow->radius;
+    int from, to;
+    window_bounds(position, position, glow->radius, config->num_leds, &from, &to);
+
+    clear_leds(leds, from);
+    if (to > from) {
+        memcpy(leds + from, glow->window + (from - start), (size_t)(to - from) * sizeof(Led));
+    }
+    clear_leds(leds + to, config->num_leds - to);
+}
+
+void lightbar_plan_init(LightbarPlan *plan, const LightbarConfig *config) {
+    const LightbarLut *lut = config->lut;
+    plan->config = *config;
+    plan->ms_per_step = config->speed > 0.0f ? 1000.0f / config->speed : 0.0f;
+    plan->middle = config->num_leds / 2;
+    plan->brightness = lut ? lut->brightness : 0;
+    plan->gamma = lut ? lut->gamma : 0;
+    for (int i = 0; i < 256; i++) {
+        plan->table[i] = lut ? lut->table[i] : (uint8_t)i;
+    }
+    if (config->glow_radius > LIGHTBAR_MAX_GLOW_RADIUS) return;
+    for (int d = 0; d <= config->glow_radius; d++) {
+        plan->glow[d] = glow_at(config->color, config->glow_radius, d);
+        plan->lit[d] = correct(lut, plan->glow[d]);
+    }
+}
+
+int lightbar_plan_sync(LightbarPlan *plan, const LightbarConfig *config) {
+    const LightbarConfig *built = &plan->config;
+    if (built->num_leds == config->num_leds &&
+        built->speed == config->speed &&
+        built->end_pause_ms == config->end_pause_ms &&
+        built->glow_radius == config->glow_radius &&
+        built->color.r == config->color.r &&
+        built->color.g == config->color.g &&
+        built->color.b == config->color.b &&
+        built->smooth == config->smooth &&
+        built->lut == config->lut &&
+        built->profile == config->profile &&
+        (!config->lut || (plan->brightness == config->lut->brightness &&
+                          plan->gamma == config->lut->gamma))) {
+        return 0;
+    }
+    lightbar_plan_init(plan, config);
+    return 1;
+}
+
+/* draw_window() with the falloff and correction looked up in the plan. */
+static void draw_planned(const LightbarPlan *plan, int position, int ahead, int weight,
+                         int from, int to, Led *leds) {
+    int radius = plan->config.glow_radius;
+    if (weight == 0) {
+        for (int i = from; i < to; i++) {
+            leds[i] = plan->lit[abs(i - position)];
+        }
+        return;
+    }
+    const Led off = { 0, 0, 0 };
+    for (int i = from; i < to; i++) {
+        int d0 = abs(i - position);
+        int d1 = abs(i - ahead);
+        Led a = (d0 <= radius) ? plan->glow[d0] : off;
+        Led b = (d1 <= radius) ? plan->glow[d1] : off;
+        leds[i].r = plan->table[(a.r * (256 - weight) + b.r * weight) >> 8];
+        leds[i].g = plan->table[(a.g * (256 - weight) + b.g * weight) >> 8];
+        leds[i].b = plan->table[(a.b * (256 - weight) + b.b * weight) >> 8];
+    }
+}
+
+void lightbar_render_plan(const LightbarState *state, const LightbarPlan *plan, Led *leds) {
+    const LightbarConfig *config = &plan->config;
+    if (config->glow_radius > LIGHTBAR_MAX_GLOW_RADIUS) {
+        lightbar_render(state, config, leds);
+        return;
+    }
+    int position, ahead, weight, from, to;
+    LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_RENDER_BEGIN, state->phase, 0, state->position);
+    dot_at(state, config, &position, &ahead, &weight);
+    window_bounds(position, ahead, config->glow_radius, config->num_leds, &from, &to);
+    clear_leds(leds, from);
+    draw_planned(plan, position, ahead, weight, from, to, leds);
+    clear_leds(leds + to, config->num_leds - to);
+    LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_RENDER_END, state->phase, config->num_leds,
+                         state->position);
+}
+
+void lightbar_delta_reset(LightbarDelta *delta) {
+    delta->valid = 0;
+}
+
+/* Draws through plan's tables when it has them, else straight from config. */
+static int render_delta(LightbarDelta *delta, const LightbarState *state,
+                        const LightbarConfig *config, const LightbarPlan *plan, Led *leds,
+                        int *dirty_from, int *dirty_to) {
+    int radius = config->glow_radius;
+    int brightness = plan ? plan->brightness : (config->lut ? config->lut->brightness : 0);
+    int position, ahead, weight;
+    dot_at(state, config, &position, &ahead, &weight);
+
+    if (!delta->valid || delta->num_leds != config->num_leds) {
+        if (plan) {
+            lightbar_render_plan(state, plan, leds);
         } else {
-            leds[i].r = 0;
-            leds[i].g = 0;
-            leds[i].b = 0;
+            lightbar_render(state, config, leds);
+        }
+        *dirty_from = 0;
+        *dirty_to = config->num_leds;
+    } else if (delta->position == position && delta->ahead == ahead &&
+               delta->weight == weight && delta->radius == radius &&
+               delta->color.r == config->color.r &&
+               delta->color.g == config->color.g &&
+               delta->color.b == config->color.b &&
+               delta->lut == config->lut &&
+               (!config->lut || delta->brightness == brightness)) {
+        *dirty_from = 0;
+        *dirty_to = 0;
+        return 0;
+    } else {
+        int old_from, old_to, from, to;
+        window_bounds(delta->position, delta->ahead, delta->radius, config->num_leds,
+                      &old_from, &old_to);
+        window_bounds(position, ahead, radius, config->num_leds, &from, &to);
+        clear_leds(leds + old_from, old_to - old_from);
+        if (plan && radius <= LIGHTBAR_MAX_GLOW_RADIUS) {
+            draw_planned(plan, position, ahead, weight, from, to, leds);
+        } else {
+            draw_window(config->color, radius, config->lut, position, ahead, weight,
+                        from, to, leds);
+        }
+        if (old_to == old_from) {
+            *dirty_from = from;
+            *dirty_to = to;
+        } else if (to == from) {
+            *dirty_from = old_from;
+            *dirty_to = old_to;
+        } else {
+            *dirty_from = (old_from < from) ? old_from : from;
+            *dirty_to = (old_to > to) ? old_to : to;
         }
     }
+
+    delta->valid = 1;
+    delta->num_leds = config->num_leds;
+    delta->position = position;
+    delta->ahead = ahead;
+    delta->weight = weight;
+    delta->radius = radius;
+    delta->color = config->color;
+    delta->lut = config->lut;
+    delta->brightness = (uint8_t)brightness;
+    return *dirty_to > *dirty_from;
+}
+
+int lightbar_render_delta(LightbarDelta *delta, const LightbarState *state,
+                          const LightbarConfig *config, Led *leds,
+                          int *dirty_from, int *dirty_to) {
+    LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_RENDER_BEGIN, state->phase, 0, state->position);
+    int changed = render_delta(delta, state, config, NULL, leds, dirty_from, dirty_to);
+    LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_RENDER_END, state->phase, *dirty_to - *dirty_from,
+                         state->position);
+    return changed;
+}
+
+int lightbar_render_delta_plan(LightbarDelta *delta, const LightbarState *state,
+                               const LightbarPlan *plan, Led *leds,
+                               int *dirty_from, int *dirty_to) {
+    LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_RENDER_BEGIN, state->phase, 0, state->position);
+    int changed = render_delta(delta, state, &plan->config, plan, leds, dirty_from, dirty_to);
+    LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_RENDER_END, state->phase, *dirty_to - *dirty_from,
+                         state->position);
+    return changed;
 }
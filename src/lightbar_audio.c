@@ -0,0 +1,307 @@
+#include "lightbar_audio.h"
+#include <math.h>
+#include <string.h>
+
+#define TWO_PI 6.283185307179586f
+
+/* sin(2 pi c) for c in [0, 1). Folding into a quarter wave keeps a
+ * degree-9 polynomial within 4e-6, and the whole thing is branch-free so
+ * the sample loops vectorize. */
+static inline float sin_cycle(float c) {
+    float x = c - 0.5f;
+    float ax = x < 0.0f ? -x : x;
+    float d = ax - 0.25f;
+    float f = 0.25f - (d < 0.0f ? -d : d);
+    float t = TWO_PI * (x < 0.0f ? -f : f);
+    float t2 = t * t;
+    float s = t * (1.0f + t2 * (-1.0f / 6.0f + t2 * (1.0f / 120.0f +
+                   t2 * (-1.0f / 5040.0f + t2 * (1.0f / 362880.0f)))));
+    return -s;
+}
+
+static inline float clampf(float x, float lo, float hi) {
+    x = x < lo ? lo : x;
+    return x > hi ? hi : x;
+}
+
+void lightbar_audio_init(LightbarAudio *audio, const LightbarAudioConfig *config) {
+    memset(audio, 0, sizeof(*audio));
+    audio->config = *config;
+    audio->click_len = (uint32_t)(config->click_ms * (float)config->sample_rate / 1000.0f);
+}
+
+static int is_moving(const LightbarState *state) {
+    return state->phase == LIGHTBAR_MOVING ||
+           (state->phase == LIGHTBAR_STOPPING && state->pause_timer_ms <= 0.0f);
+}
+
+float lightbar_audio_pan(const LightbarState *state, const LightbarConfig *config) {
+    int last = config->num_leds - 1;
+    if (last <= 0) return 0.0f;
+    return clampf(2.0f * lightbar_dot_position(state, config) / (float)last - 1.0f, -1.0f, 1.0f);
+}
+
+/* Synthesises samples [from, from + n) of the scratch block with the pan
+ * moving linearly by slope per sample. */
+static void synth(LightbarAudio *audio, uint32_t from, uint32_t n, float pan, float slope,
+                  float target) {
+    const LightbarAudioConfig *c = &audio->config;
+    float inc = c->tone_hz / (float)c->sample_rate;
+    float phase = (float)audio->phase;
+    float volume = c->volume;
+    float level = audio->level;
+    float fade = 1.0f / (LIGHTBAR_AUDIO_FADE_MS * (float)c->sample_rate / 1000.0f);
+    float dl = target > level ? fade : (target < level ? -fade : 0.0f);
+    float click = (float)audio->click_left;
+    float inv_click = audio->click_len ? 1.0f / (float)audio->click_len : 0.0f;
+    float click_l = audio->click_side < 0 ? 1.0f : 0.0f;
+    float click_r = audio->click_side > 0 ? 1.0f : 0.0f;
+    float *left = audio->left + from;
+    float *right = audio->right + from;
+
+    for (uint32_t i = 0; i < n; i++) {
+        float fi = (float)i;
+        float cycle = phase + inc * fi;
+        cycle -= (float)(int)cycle;
+        float tone = volume * sin_cycle(cycle);
+        float held = tone * clampf(level + dl * fi, 0.0f, 1.0f);
+        float theta = (clampf(pan + slope * fi, -1.0f, 1.0f) + 1.0f) * 0.125f;
+        float accent = tone * clampf(click - fi, 0.0f, click) * inv_click;
+        left[i] = held * sin_cycle(theta + 0.25f) + accent * click_l;
+        right[i] = held * sin_cycle(theta) + accent * click_r;
+    }
+
+    audio->phase += (double)inc * n;
+    audio->phase -= floor(audio->phase);
+    audio->level = clampf(level + dl * (float)n, 0.0f, 1.0f);
+    audio->click_left = audio->click_left > n ? audio->click_left - n : 0;
+}
+
+/* Renders n <= LIGHTBAR_AUDIO_BLOCK frames into the scratch block, one
+ * segment per stretch between events. */
+static void render_block(LightbarAudio *audio, LightbarState *state,
+                         const LightbarConfig *config, uint32_t n) {
+    double sample_ms = 1000.0 / audio->config.sample_rate;
+    int last = config->num_leds - 1;
+    uint32_t done = 0;
+    while (done < n) {
+        uint32_t len = n - done;
+        int cut = 0;
+        float event = lightbar_time_to_event(state, config);
+        if (event >= 0.0f) {
+            /* The event falls within the segment's last sample */
+            double samples = ceil((double)event / sample_ms);
+            if (samples < 1.0) samples = 1.0;
+            if (samples <= (double)len) {
+                len = (uint32_t)samples;
+                cut = 1;
+            }
+        }
+
+        int moving = is_moving(state);
+        int curved = moving && config->profile && config->profile->type != LIGHTBAR_PROFILE_LINEAR;
+        float pan = lightbar_audio_pan(state, config);
+        float slope = 0.0f;
+        float target = state->phase == LIGHTBAR_STOPPED ? 0.0f : 1.0f;
+        if (moving && last > 0 && !curved) {
+            slope = (float)(2.0 * state->direction * config->speed * sample_ms / 1000.0 / last);
+        }
+        if (!curved) synth(audio, done, len, pan, slope, target);
+
+        LightbarEvent fired[4];
+        LightbarEventBuffer events = { fired, 4, 0, 0 };
+        lightbar_advance_events(state, config, (float)(len * sample_ms), &events);
+        if (cut && events.count == 0) {
+            /* ceil(event / sample_ms) can land on a whole count whose length,
+             * multiplied back out in double, is just under the event. Finish
+             * the step to it; reaching it takes exactly the time left. */
+            float rest = lightbar_time_to_event(state, config);
+            if (rest >= 0.0f) lightbar_advance_events(state, config, rest, &events);
+        }
+        if (curved) {
+            /* A profile bends the path; segments are at most one block, so
+             * a chord to where the dot ends up is close enough */
+            slope = (lightbar_audio_pan(state, config) - pan) / (float)len;
+            synth(audio, done, len, pan, slope, target);
+        }
+        for (int i = 0; i < events.count; i++) {
+            if (fired[i].type == LIGHTBAR_EVENT_EDGE_REACHED) {
+                audio->click_left = audio->click_len;
+                audio->click_side = fired[i].direction;
+            }
+        }
+        done += len;
+    }
+    audio->frames += n;
+}
+
+void lightbar_audio_render_f32(LightbarAudio *audio, LightbarState *state,
+                               const LightbarConfig *config, float *out, uint32_t frames) {
+    while (frames > 0) {
+        uint32_t n = frames < LIGHTBAR_AUDIO_BLOCK ? frames : LIGHTBAR_AUDIO_BLOCK;
+        render_block(audio, state, config, n);
+        for (uint32_t i = 0; i < n; i++) {
+            out[2 * i] = audio->left[i];
+            out[2 * i + 1] = audio->right[i];
+        }
+        out += 2 * n;
+        frames -= n;
+    }
+}
+
+static inline int16_t to_s16(float x) {
+    float v = clampf(x, -1.0f, 1.0f) * 32767.0f;
+    return (int16_t)(v + (v < 0.0f ? -0.5f : 0.5f));
+}
+
+void lightbar_audio_render_s16(LightbarAudio *audio, LightbarState *state,
+                               const LightbarConfig *config, int16_t *out, uint32_t frames) {
+    while (frames > 0) {
+        uint32_t n = frames < LIGHTBAR_AUDIO_BLOCK ? frames : LIGHTBAR_AUDIO_BLOCK;
+        render_block(audio, state, config, n);
+        for (uint32_t i = 0; i < n; i++) {
+            out[2 * i] = to_s16(audio->left[i]);
+            out[2 * i + 1] = to_s16(audio->right[i]);
+        }
+        out += 2 * n;
+        frames -= n;
+    }
+}
+
+int lightbar_audio_ring_init(LightbarAudioRing *ring, float *storage, uint32_t capacity) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) return -1;
+    ring->data = storage;
+    ring->capacity = capacity;
+    ring->write = 0;
+    ring->read = 0;
+    return 0;
+}
+
+uint32_t lightbar_audio_ring_readable(const LightbarAudioRing *ring) {
+    uint64_t read = __atomic_load_n(&ring->read, __ATOMIC_ACQUIRE);
+    return (uint32_t)(__atomic_load_n(&ring->write, __ATOMIC_ACQUIRE) - read);
+}
+
+uint32_t lightbar_audio_ring_writable(const LightbarAudioRing *ring) {
+    uint64_t write = __atomic_load_n(&ring->write, __ATOMIC_ACQUIRE);
+    return ring->capacity - (uint32_t)(write - __atomic_load_n(&ring->read, __ATOMIC_ACQUIRE));
+}
+
+/* Copies count frames between a linear buffer and the ring starting at
+ * index, wrapping once if needed. */
+static void ring_copy(const LightbarAudioRing *ring, uint64_t index, float *linear,
+                      uint32_t count, int to_ring) {
+    uint32_t at = (uint32_t)(index & (ring->capacity - 1));
+    uint32_t first = ring->capacity - at < count ? ring->capacity - at : count;
+    float *slot = ring->data + 2 * (size_t)at;
+    if (to_ring) {
+        memcpy(slot, linear, 2 * sizeof(float) * first);
+        memcpy(ring->data, linear + 2 * first, 2 * sizeof(float) * (count - first));
+    } else {
+        memcpy(linear, slot, 2 * sizeof(float) * first);
+        memcpy(linear + 2 * first, ring->data, 2 * sizeof(float) * (count - first));
+    }
+}
+
+uint32_t lightbar_audio_ring_write(LightbarAudioRing *ring, const float *frames, uint32_t count) {
+    uint32_t space = lightbar_audio_ring_writable(ring);
+    if (count > space) count = space;
+    uint64_t write = __atomic_load_n(&ring->write, __ATOMIC_RELAXED);
+    ring_copy(ring, write, (float *)frames, count, 1);
+    __atomic_store_n(&ring->write, write + count, __ATOMIC_RELEASE);
+    return count;
+}
+
+uint32_t lightbar_audio_ring_read(LightbarAudioRing *ring, float *frames, uint32_t count) {
+    uint32_t ready = lightbar_audio_ring_readable(ring);
+    if (count > ready) count = ready;
+    uint64_t read = __atomic_load_n(&ring->read, __ATOMIC_RELAXED);
+    ring_copy(ring, read, frames, count, 0);
+    __atomic_store_n(&ring->read, read + count, __ATOMIC_RELEASE);
+    return count;
+}
+
+uint32_t lightbar_audio_fill(LightbarAudio *audio, LightbarState *state,
+                             const LightbarConfig *config, LightbarAudioRing *ring, uint32_t max) {
+    uint32_t count = lightbar_audio_ring_writable(ring);
+    if (count > max) count = max;
+    uint64_t write = __atomic_load_n(&ring->write, __ATOMIC_RELAXED);
+    uint32_t at = (uint32_t)(write & (ring->capacity - 1));
+    uint32_t first = ring->capacity - at < count ? ring->capacity - at : count;
+    lightbar_audio_render_f32(audio, state, config, ring->data + 2 * (size_t)at, first);
+    lightbar_audio_render_f32(audio, state, config, ring->data, count - first);
+    __atomic_store_n(&ring->write, write + count, __ATOMIC_RELEASE);
+    return count;
+}
+
+static void put_le(uint8_t *p, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) p[i] = (uint8_t)(value >> (8 * i));
+}
+
+static void wav_header(uint8_t *h, uint32_t sample_rate, int float_samples, uint32_t data_bytes) {
+    uint32_t sample_bytes = float_samples ? 4 : 2;
+    memcpy(h, "RIFF", 4);
+    put_le(h + 4, 36 + data_bytes, 4);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put_le(h + 16, 16, 4);
+    put_le(h + 20, float_samples ? 3 : 1, 2);
+    put_le(h + 22, 2, 2);
+    put_le(h + 24, sample_rate, 4);
+    put_le(h + 28, sample_rate * 2 * sample_bytes, 4);
+    put_le(h + 32, 2 * sample_bytes, 2);
+    put_le(h + 34, 8 * sample_bytes, 2);
+    memcpy(h + 36, "data", 4);
+    put_le(h + 40, data_bytes, 4);
+}
+
+int lightbar_wav_open(LightbarWav *wav, const char *path, uint32_t sample_rate, int float_samples) {
+    uint8_t header[44];
+    wav->file = fopen(path, "wb");
+    wav->sample_rate = sample_rate;
+    wav->float_samples = float_samples;
+    wav->frames = 0;
+    if (!wav->file) return -1;
+    wav_header(header, sample_rate, float_samples, 0);
+    if (fwrite(header, sizeof(header), 1, wav->file) != 1) {
+        fclose(wav->file);
+        wav->file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int lightbar_wav_write(LightbarWav *wav, const float *frames, uint32_t count) {
+    uint8_t buf[LIGHTBAR_AUDIO_BLOCK * 2 * 4];
+    uint32_t sample_bytes = wav->float_samples ? 4 : 2;
+    while (count > 0) {
+        uint32_t n = count < LIGHTBAR_AUDIO_BLOCK ? count : LIGHTBAR_AUDIO_BLOCK;
+        for (uint32_t i = 0; i < 2 * n; i++) {
+            if (wav->float_samples) {
+                uint32_t bits;
+                memcpy(&bits, &frames[i], 4);
+                put_le(buf + 4 * i, bits, 4);
+            } else {
+                put_le(buf + 2 * i, (uint16_t)to_s16(frames[i]), 2);
+            }
+        }
+        if (fwrite(buf, 2 * sample_bytes, n, wav->file) != n) return -1;
+        wav->frames += n;
+        frames += 2 * n;
+        count -= n;
+    }
+    return 0;
+}
+
+int lightbar_wav_close(LightbarWav *wav) {
+    uint8_t header[44];
+    uint64_t bytes = wav->frames * 2 * (wav->float_samples ? 4 : 2);
+    if (bytes > UINT32_MAX - 36) bytes = UINT32_MAX - 36;
+    wav_header(header, wav->sample_rate, wav->float_samples, (uint32_t)bytes);
+    int status = 0;
+    if (fseek(wav->file, 0, SEEK_SET) != 0 || fwrite(header, sizeof(header), 1, wav->file) != 1) {
+        status = -1;
+    }
+    if (fclose(wav->file) != 0) status = -1;
+    wav->file = NULL;
+    return status;
+}
@@ -0,0 +1,239 @@
+#include "lightbar_cache.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+void lightbar_cache_init(LightbarCache *cache) {
+    memset(cache, 0, sizeof(*cache));
+}
+
+static void release(LightbarCache *cache) {
+    free(cache->keys);
+    free(cache->window);
+    free(cache->spans);
+    cache->keys = NULL;
+    cache->window = NULL;
+    cache->spans = NULL;
+    cache->num_keys = 0;
+    cache->window_len = 0;
+    cache->ready = 0;
+}
+
+void lightbar_cache_free(LightbarCache *cache) {
+    release(cache);
+    cache->built = 0;
+}
+
+void lightbar_cache_invalidate(LightbarCache *cache) {
+    cache->built = 0;
+}
+
+static int same_config(const LightbarCache *cache, const LightbarConfig *config) {
+    const LightbarConfig *c = &cache->config;
+    return c->num_leds == config->num_leds && c->speed == config->speed &&
+           c->end_pause_ms == config->end_pause_ms &&
+           c->glow_radius == config->glow_radius &&
+           c->color.r == config->color.r && c->color.g == config->color.g &&
+           c->color.b == config->color.b && c->smooth == config->smooth &&
+           c->lut == config->lut && c->profile == config->profile &&
+           (!config->lut || cache->brightness == config->lut->brightness);
+}
+
+/* Keyframes of one period, starting as the dot arrives at the left edge:
+ * [left pause], steps right, [right pause], steps left. */
+static void build_keys(LightbarCache *cache, int last, int paused) {
+    uint32_t k = 0;
+    if (paused) {
+        LightbarCacheKey key = { 0, -1, LIGHTBAR_PAUSED_END };
+        cache->keys[k++] = key;
+    }
+    for (int p = 0; p < last; p++) {
+        LightbarCacheKey key = { (int16_t)p, 1, LIGHTBAR_MOVING };
+        cache->keys[k++] = key;
+    }
+    if (paused) {
+        LightbarCacheKey key = { (int16_t)last, 1, LIGHTBAR_PAUSED_END };
+        cache->keys[k++] = key;
+    }
+    for (int p = last; p > 0; p--) {
+        LightbarCacheKey key = { (int16_t)p, -1, LIGHTBAR_MOVING };
+        cache->keys[k++] = key;
+    }
+    cache->num_keys = k;
+}
+
+/* Renders the glow once, as far as it can reach on this strip, and where
+ * it lands for every position. */
+static void build_window(LightbarCache *cache, const LightbarConfig *config, int reach) {
+    LightbarSpan span = { 0 };
+    span.color = config->color;
+    span.radius = config->glow_radius;
+    span.lut = config->lut;
+    span.position = reach;
+    span.ahead = reach;
+    for (int i = 0; i < (int)cache->window_len; i++) {
+        cache->window[i] = lightbar_span_led(&span, i);
+    }
+
+    int n = config->num_leds;
+    for (int p = 0; p < n; p++) {
+        int from = p - reach;
+        int to = p + reach + 1;
+        if (from < 0) from = 0;
+        if (to > n) to = n;
+        cache->spans[p].from = (uint16_t)from;
+        cache->spans[p].to = (uint16_t)to;
+        cache->spans[p].offset = (uint32_t)(from - (p - reach));
+    }
+}
+
+int lightbar_cache_sync(LightbarCache *cache, const LightbarConfig *config) {
+    if (cache->built && same_config(cache, config)) {
+        return cache->ready;
+    }
+
+    release(cache);
+    cache->built = 1;
+    cache->config = *config;
+    cache->brightness = config->lut ? config->lut->brightness : 0;
+
+    int n = config->num_leds;
+    int reach = config->glow_radius < n - 1 ? config->glow_radius : n - 1;
+    size_t window_len = 2 * (size_t)reach + 1;
+    if (config->smooth || config->speed <= 0.0f || n < 2 ||
+        (config->profile && config->profile->type != LIGHTBAR_PROFILE_LINEAR) ||
+        window_len * sizeof(Led) + (size_t)n * sizeof(LightbarCacheSpan) >
+            LIGHTBAR_CACHE_MAX_BYTES) {
+        return 0;
+    }
+
+    int last = n - 1;
+    int paused = config->end_pause_ms > 0;
+    cache->ms_per_step = 1000.0 / config->speed;
+    cache->period_ms = 2.0 * ((double)last * cache->ms_per_step + config->end_pause_ms);
+    cache->keys = malloc((size_t)(2 * last + 2) * sizeof(LightbarCacheKey));
+    cache->window = malloc(window_len * sizeof(Led));
+    cache->spans = malloc((size_t)n * sizeof(LightbarCacheSpan));
+    if (!cache->keys || !cache->window || !cache->spans) {
+        release(cache);
+        return 0;
+    }
+    cache->window_len = (uint32_t)window_len;
+    build_window(cache, config, reach);
+    build_keys(cache, last, paused);
+    cache->ready = 1;
+    return 1;
+}
+
+/* Where in the period state sits, or -1 if it is not on the cycle. */
+static double period_time(const LightbarCache *cache, const LightbarState *state,
+                          int last, double pause) {
+    double leg = last * cache->ms_per_step;
+    double t;
+    if (state->phase == LIGHTBAR_PAUSED_END) {
+        double waited = pause - state->pause_timer_ms;
+        if (waited < 0.0) waited = 0.0;
+        if (state->position == 0 && state->direction == -1) return waited;
+        if (state->position == last && state->direction == 1) return pause + leg + waited;
+        return -1.0;
+    }
+    if (state->phase != LIGHTBAR_MOVING) return -1.0;
+    if (state->direction == 1 && state->position >= 0 && state->position < last) {
+        t = pause + state->position * cache->ms_per_step;
+    } else if (state->direction == -1 && state->position > 0 && state->position <= last) {
+        t = 2.0 * pause + leg + (last - state->position) * cache->ms_per_step;
+    } else {
+        return -1.0;
+    }
+    return t + state->move_accum_ms;
+}
+
+void lightbar_cache_update(LightbarCache *cache, LightbarState *state,
+                           const LightbarConfig *config, float dt_ms) {
+    int last = config->num_leds - 1;
+    double pause = config->end_pause_ms;
+    double t = -1.0;
+    if (lightbar_cache_sync(cache, config)) {
+        t = period_time(cache, state, last, pause);
+    }
+    if (t < 0.0) {
+        lightbar_update(state, config, dt_ms);
+        return;
+    }
+
+    /* With end pauses a frame ends where a pause starts or ends, as in
+     * lightbar_update(); without them the bar just bounces and time wraps
+     * around the period. */
+    double leg = last * cache->ms_per_step;
+    int paused = pause > 0.0;
+    if (paused) {
+        double ends[4] = { pause, pause + leg, 2.0 * pause + leg, cache->period_ms };
+        int segment = 0;
+        while (segment < 3 && ends[segment] <= t) segment++;
+        t += dt_ms;
+        if (t >= ends[segment]) t = ends[segment];
+    } else {
+        t += dt_ms;
+    }
+    if (t >= cache->period_ms) t = fmod(t, cache->period_ms);
+
+    /* Segment of the period, then the keyframe within it */
+    uint32_t k;
+    double start, end;
+    if (paused && t < pause) {
+        k = 0;
+        start = 0.0;
+        end = pause;
+    } else if (t < pause + leg) {
+        int j = (int)((t - pause) / cache->ms_per_step);
+        if (j > last - 1) j = last - 1;
+        k = (uint32_t)(paused + j);
+        start = pause + j * cache->ms_per_step;
+        end = start + cache->ms_per_step;
+    } else if (paused && t < 2.0 * pause + leg) {
+        k = (uint32_t)(1 + last);
+        start = pause + leg;
+        end = start + pause;
+    } else {
+        int j = (int)((t - 2.0 * pause - leg) / cache->ms_per_step);
+        if (j > last - 1) j = last - 1;
+        if (j < 0) j = 0;
+        k = (uint32_t)(2 * paused + last + j);
+        start = 2.0 * pause + leg + j * cache->ms_per_step;
+        end = start + cache->ms_per_step;
+    }
+
+    const LightbarCacheKey *key = &cache->keys[k];
+    state->position = key->position;
+    state->direction = key->direction;
+    state->phase = (LightbarPhase)key->phase;
+    if (state->phase == LIGHTBAR_PAUSED_END) {
+        state->pause_timer_ms = (float)(end - t);
+        state->move_accum_ms = 0.0f;
+    } else {
+        double accum = t - start;
+        state->pause_timer_ms = 0.0f;
+        state->move_accum_ms = (float)(accum > 0.0 ? accum : 0.0);
+    }
+}
+
+const Led *lightbar_cache_window(const LightbarCache *cache, const LightbarState *state,
+                                 int *from, int *to) {
+    if (!cache->ready || state->position < 0 || state->position >= cache->config.num_leds) {
+        return NULL;
+    }
+    const LightbarCacheSpan *span = &cache->spans[state->position];
+    *from = span->from;
+    *to = span->to;
+    return cache->window + span->offset;
+}
+
+int lightbar_cache_render(const LightbarCache *cache, const LightbarState *state, Led *leds) {
+    int from, to;
+    const Led *window = lightbar_cache_window(cache, state, &from, &to);
+    if (!window) return -1;
+    memset(leds, 0, (size_t)from * sizeof(Led));
+    memcpy(leds + from, window, (size_t)(to - from) * sizeof(Led));
+    memset(leds + to, 0, (size_t)(cache->config.num_leds - to) * sizeof(Led));
+    return 0;
+}
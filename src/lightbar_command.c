@@ -0,0 +1,100 @@
+#include "lightbar_command.h"
+#include <string.h>
+
+int lightbar_command_queue_init(LightbarCommandQueue *queue, LightbarCommandSlot *slots,
+                                uint32_t capacity) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) return -1;
+    memset(queue, 0, sizeof(*queue));
+    queue->slots = slots;
+    queue->capacity = capacity;
+    /* Slot i is free for the producer at position i */
+    for (uint32_t i = 0; i < capacity; i++) slots[i].seq = i;
+    return 0;
+}
+
+int lightbar_command_push(LightbarCommandQueue *queue, const LightbarCommand *command) {
+    uint32_t pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    LightbarCommandSlot *slot;
+    for (;;) {
+        slot = &queue->slots[pos & (queue->capacity - 1)];
+        uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        int32_t diff = (int32_t)(seq - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&queue->tail, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            /* The consumer has not freed this slot a lap ago: full */
+            __atomic_add_fetch(&queue->dropped, 1, __ATOMIC_RELAXED);
+            return -1;
+        } else {
+            pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+        }
+    }
+    slot->command = *command;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int lightbar_command_pop(LightbarCommandQueue *queue, LightbarCommand *command) {
+    LightbarCommandSlot *slot = &queue->slots[queue->head & (queue->capacity - 1)];
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != queue->head + 1) return 0;
+    *command = slot->command;
+    /* Free the slot for the producer one lap on */
+    __atomic_store_n(&slot->seq, queue->head + queue->capacity, __ATOMIC_RELEASE);
+    queue->head++;
+    return 1;
+}
+
+static int flush(LightbarConfig *config, const LightbarConfig *pending) {
+    if (memcmp(config, pending, sizeof(*config)) == 0) return 0;
+    *config = *pending;
+    return LIGHTBAR_COMMAND_CONFIG;
+}
+
+int lightbar_command_apply(LightbarCommandQueue *queue, LightbarState *state,
+                           LightbarConfig *config, uint32_t max,
+                           LightbarCommandHook hook, void *ctx) {
+    LightbarConfig pending = *config;
+    LightbarCommand command;
+    unsigned fields = 0;
+    int last = -1;
+    int changed = 0;
+
+    for (uint32_t n = 0; n < max && lightbar_command_pop(queue, &command); n++) {
+        queue->drained++;
+        if (command.type == LIGHTBAR_CMD_START || command.type == LIGHTBAR_CMD_STOP) {
+            changed |= flush(config, &pending);
+            fields = 0;
+            /* Starting a moving bar or stopping a stopping one does nothing */
+            if ((int)command.type == last) {
+                queue->coalesced++;
+                continue;
+            }
+            last = (int)command.type;
+            if (command.type == LIGHTBAR_CMD_START) {
+                lightbar_start(state);
+            } else {
+                lightbar_stop(state, config);
+            }
+            changed |= LIGHTBAR_COMMAND_STATE;
+            if (hook) hook(&command, state, config, ctx);
+            continue;
+        }
+
+        unsigned field = 1u << command.type;
+        if (fields & field) queue->coalesced++;
+        fields |= field;
+        switch (command.type) {
+        case LIGHTBAR_CMD_SPEED: pending.speed = command.value.speed; break;
+        case LIGHTBAR_CMD_END_PAUSE: pending.end_pause_ms = command.value.end_pause_ms; break;
+        case LIGHTBAR_CMD_GLOW: pending.glow_radius = command.value.glow_radius; break;
+        case LIGHTBAR_CMD_COLOR: pending.color = command.value.color; break;
+        case LIGHTBAR_CMD_SMOOTH: pending.smooth = command.value.smooth; break;
+        case LIGHTBAR_CMD_PROFILE: pending.profile = command.value.profile; break;
+        default: break;
+        }
+    }
+    return changed | flush(config, &pending);
+}
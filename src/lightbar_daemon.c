@@ -0,0 +1,710 @@
+#define _GNU_SOURCE
+#include "lightbar_daemon.h"
+#include "control.h"
+#include "lightbar.h"
+#include "lightbar_stats.h"
+#include "lightbar_trace.h"
+#include "timer_wheel.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Tick lateness histogram: 10 us buckets up to 10 ms, then one overflow */
+#define LATE_BUCKET_NS 10000u
+#define LATE_BUCKETS 1000
+
+#define MAX_CLIENTS 16
+#define LINE_MAX_BYTES 512
+#define REPLY_BYTES 65536
+
+/* Room for the events of one tick; more only on a stalled worker */
+#define TICK_EVENTS 16
+
+typedef struct {
+    pthread_t thread;
+    /* Guards the wheel, the stats and every session on this worker */
+    pthread_mutex_t lock;
+    int epoll_fd;
+    int timer_fd;
+    int wake_fd;
+    int quit;
+    uint64_t base_ns;
+    uint32_t sessions;
+    uint64_t ticks;
+    uint64_t late_max_ns;
+    uint64_t late[LATE_BUCKETS + 1];
+    TimerWheel wheel;
+} Worker;
+
+typedef struct Session Session;
+
+struct Session {
+    /* First, so a fired TimerEntry is its Session */
+    TimerEntry timer;
+    Session *next;
+    Worker *worker;
+    char name[CONTROL_NAME_MAX];
+    LightbarConfig config;
+    LightbarState state;
+    uint32_t rate_hz;
+    uint64_t period_ns;
+    uint64_t last_ns;
+    uint64_t due_ns;
+    int sink_fd;
+    char sink[CONTROL_SINK_MAX];
+    uint64_t ticks;
+    uint64_t missed;
+    uint64_t dropped;
+    uint64_t late_sum_ns;
+    uint64_t late_max_ns;
+    /* Shared-memory slot, or NULL if stats are not published */
+    LightbarStatsSlot *stats;
+    /* When lightbar_stop() began the current wind-down, or 0 */
+    uint64_t stop_ns;
+    Led *leds;
+};
+
+struct LightbarDaemon {
+    Worker *workers;
+    int num_workers;
+    int next_worker;
+    /* Only the control thread walks or changes the list */
+    Session *sessions;
+    LightbarStats stats;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* First wheel tick at or after t, so a tick never fires early */
+static uint64_t wheel_tick(const Worker *w, uint64_t t) {
+    return (t - w->base_ns + LIGHTBAR_DAEMON_TICK_NS - 1) / LIGHTBAR_DAEMON_TICK_NS;
+}
+
+static void arm(Worker *w) {
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    uint64_t next = timer_wheel_next(&w->wheel);
+    if (next != UINT64_MAX) {
+        uint64_t at = w->base_ns + (w->wheel.now + next) * LIGHTBAR_DAEMON_TICK_NS;
+        its.it_value.tv_sec = (time_t)(at / 1000000000u);
+        its.it_value.tv_nsec = (long)(at % 1000000000u);
+    }
+    timerfd_settime(w->timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static void record_late(Worker *w, Session *s, uint64_t late) {
+    uint64_t bucket = late / LATE_BUCKET_NS;
+    w->late[bucket < LATE_BUCKETS ? bucket : LATE_BUCKETS]++;
+    if (late > w->late_max_ns) w->late_max_ns = late;
+    w->ticks++;
+    s->late_sum_ns += late;
+    if (late > s->late_max_ns) s->late_max_ns = late;
+    s->ticks++;
+}
+
+/* Where state sits on the bounce lightbar_advance() follows, counted from
+ * the moment the dot last arrived at the left edge: *x LED steps along the
+ * way there and back, *t milliseconds. Returns 0 if state is not on it. */
+static int cycle_position(const LightbarState *state, const LightbarConfig *config,
+                          int *x, double *t) {
+    int last = config->num_leds - 1;
+    double step = 1000.0 / config->speed;
+    double pause = config->end_pause_ms;
+    double leg = last * step;
+    int p = state->position;
+    if (last < 1 || config->speed <= 0.0f) return 0;
+
+    if (state->phase == LIGHTBAR_PAUSED_END ||
+        (state->phase == LIGHTBAR_STOPPING && state->pause_timer_ms > 0.0f)) {
+        double waited = pause - state->pause_timer_ms;
+        if (waited < 0.0) waited = 0.0;
+        if (p == 0 && state->direction == -1) {
+            *x = 0;
+            *t = waited;
+        } else if (p == last && state->direction == 1) {
+            *x = last;
+            *t = pause + leg + waited;
+        } else {
+            return 0;
+        }
+        return 1;
+    }
+    if (state->phase != LIGHTBAR_MOVING && state->phase != LIGHTBAR_STOPPING) return 0;
+    if (state->direction == 1 && p >= 0 && p < last) {
+        *x = p;
+        *t = pause + p * step + state->move_accum_ms;
+    } else if (state->direction == -1 && p > 0 && p <= last) {
+        *x = 2 * last - p;
+        *t = 2.0 * pause + leg + (last - p) * step + state->move_accum_ms;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+/* Advances and renders s like tick_session() does, accounting the frame in
+ * its stats slot. While the dot stays on its bounce, the steps and edges
+ * follow from where it sits on the cycle before and after plus the whole
+ * cycles dt_ms spans, however many events that was. A frame that ends in a
+ * stop is a short wind-down whose few events always fit, so there the
+ * steps are the distances between them. */
+static void advance_counted(Session *s, float dt_ms) {
+    LightbarEvent storage[TICK_EVENTS];
+    LightbarEventBuffer events = { storage, TICK_EVENTS, 0, 0 };
+    uint32_t steps = 0, edges = 0;
+    int from = s->state.position;
+    int x0, x1;
+    double t0, t1;
+    int on_cycle = cycle_position(&s->state, &s->config, &x0, &t0);
+    double stop_ms = dt_ms;
+
+    lightbar_advance_events(&s->state, &s->config, dt_ms, &events);
+    for (int i = 0; i < events.count; i++) {
+        const LightbarEvent *e = &storage[i];
+        steps += (uint32_t)abs(e->position - from);
+        from = e->position;
+        if (e->type == LIGHTBAR_EVENT_EDGE_REACHED) edges++;
+        if (e->type == LIGHTBAR_EVENT_STOPPED) stop_ms = e->offset_ms;
+    }
+    steps += (uint32_t)abs(s->state.position - from);
+
+    if (on_cycle && cycle_position(&s->state, &s->config, &x1, &t1)) {
+        int last = s->config.num_leds - 1;
+        double period = 2.0 * (last * 1000.0 / s->config.speed + s->config.end_pause_ms);
+        int64_t cycles = (int64_t)((t0 + dt_ms - t1) / period + 0.5);
+        int64_t travel = cycles * 2 * last + x1 - x0;
+        steps = (uint32_t)travel;
+        edges = (uint32_t)((x0 + travel) / last - x0 / last);
+    }
+    if (s->state.phase == LIGHTBAR_STOPPED && s->stop_ns) {
+        uint64_t at = s->last_ns + (uint64_t)(stop_ms * 1e6);
+        lightbar_stats_stopped(s->stats, at > s->stop_ns ? at - s->stop_ns : 0);
+        s->stop_ns = 0;
+    }
+
+    uint64_t start = now_ns();
+    lightbar_render(&s->state, &s->config, s->leds);
+    lightbar_stats_frame(s->stats, steps, edges, s->config.end_pause_ms ? edges : 0,
+                         now_ns() - start);
+}
+
+static void tick_session(TimerEntry *entry, void *ctx) {
+    Worker *w = ctx;
+    Session *s = (Session *)entry;
+    uint64_t now = now_ns();
+    record_late(w, s, now > s->due_ns ? now - s->due_ns : 0);
+    LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_FRAME_BEGIN, s->state.phase, 0, s->state.position);
+
+    float dt_ms = (float)((double)(s->due_ns - s->last_ns) / 1e6);
+    if (s->stats) {
+        advance_counted(s, dt_ms);
+    } else {
+        lightbar_advance(&s->state, &s->config, dt_ms);
+        lightbar_render(&s->state, &s->config, s->leds);
+    }
+    s->last_ns = s->due_ns;
+    if (s->sink_fd >= 0) {
+        size_t size = (size_t)s->config.num_leds * sizeof(Led);
+        if (write(s->sink_fd, s->leds, size) != (ssize_t)size) s->dropped++;
+    }
+    LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_FRAME_END, s->state.phase, s->config.num_leds,
+                         s->state.position);
+    if (s->state.phase == LIGHTBAR_STOPPED) return;
+
+    s->due_ns += s->period_ns;
+    if (s->due_ns <= now) {
+        uint64_t missed = (now - s->due_ns) / s->period_ns + 1;
+        s->due_ns += missed * s->period_ns;
+        s->missed += missed;
+    }
+    timer_wheel_add(&w->wheel, &s->timer, wheel_tick(w, s->due_ns));
+}
+
+/* Fires everything due by now; called with the lock held. */
+static void catch_up(Worker *w) {
+    uint64_t tick = (now_ns() - w->base_ns) / LIGHTBAR_DAEMON_TICK_NS;
+    timer_wheel_advance(&w->wheel, tick, tick_session, w);
+}
+
+static void drain(int fd) {
+    uint64_t value;
+    while (read(fd, &value, sizeof(value)) > 0) {
+    }
+}
+
+static void *worker_main(void *arg) {
+    Worker *w = arg;
+    struct epoll_event events[2];
+    for (;;) {
+        int n = epoll_wait(w->epoll_fd, events, 2, -1);
+        if (n < 0 && errno != EINTR) break;
+        for (int i = 0; i < n; i++) drain(events[i].data.fd);
+        pthread_mutex_lock(&w->lock);
+        if (w->quit) {
+            pthread_mutex_unlock(&w->lock);
+            break;
+        }
+        catch_up(w);
+        arm(w);
+        pthread_mutex_unlock(&w->lock);
+    }
+    return NULL;
+}
+
+static int worker_start(Worker *w, uint64_t base_ns) {
+    struct epoll_event ev;
+    memset(w, 0, sizeof(*w));
+    w->base_ns = base_ns;
+    timer_wheel_init(&w->wheel, 0);
+    w->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    w->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    w->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (w->epoll_fd < 0 || w->timer_fd < 0 || w->wake_fd < 0) goto fail;
+    ev.events = EPOLLIN;
+    ev.data.fd = w->timer_fd;
+    if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, w->timer_fd, &ev) != 0) goto fail;
+    ev.data.fd = w->wake_fd;
+    if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, w->wake_fd, &ev) != 0) goto fail;
+    pthread_mutex_init(&w->lock, NULL);
+    if (pthread_create(&w->thread, NULL, worker_main, w) != 0) {
+        pthread_mutex_destroy(&w->lock);
+        goto fail;
+    }
+    return 0;
+
+fail:
+    if (w->epoll_fd >= 0) close(w->epoll_fd);
+    if (w->timer_fd >= 0) close(w->timer_fd);
+    if (w->wake_fd >= 0) close(w->wake_fd);
+    return -1;
+}
+
+static void worker_stop(Worker *w) {
+    uint64_t one = 1;
+    pthread_mutex_lock(&w->lock);
+    w->quit = 1;
+    pthread_mutex_unlock(&w->lock);
+    while (write(w->wake_fd, &one, sizeof(one)) < 0 && errno == EINTR) {
+    }
+    pthread_join(w->thread, NULL);
+    pthread_mutex_destroy(&w->lock);
+    close(w->epoll_fd);
+    close(w->timer_fd);
+    close(w->wake_fd);
+}
+
+LightbarDaemon *lightbar_daemon_create(int workers) {
+    if (workers < 1) return NULL;
+    LightbarDaemon *daemon = calloc(1, sizeof(*daemon));
+    if (!daemon) return NULL;
+    daemon->workers = calloc((size_t)workers, sizeof(Worker));
+    if (!daemon->workers) {
+        free(daemon);
+        return NULL;
+    }
+    uint64_t base_ns = now_ns();
+    for (int i = 0; i < workers; i++) {
+        if (worker_start(&daemon->workers[i], base_ns) != 0) {
+            lightbar_daemon_destroy(daemon);
+            return NULL;
+        }
+        daemon->num_workers++;
+    }
+    return daemon;
+}
+
+static void session_free(Session *s) {
+    if (s->sink_fd >= 0) close(s->sink_fd);
+    free(s->leds);
+    free(s);
+}
+
+void lightbar_daemon_destroy(LightbarDaemon *daemon) {
+    if (!daemon) return;
+    for (int i = 0; i < daemon->num_workers; i++) {
+        worker_stop(&daemon->workers[i]);
+    }
+    while (daemon->sessions) {
+        Session *s = daemon->sessions;
+        daemon->sessions = s->next;
+        session_free(s);
+    }
+    lightbar_stats_close(&daemon->stats);
+    free(daemon->workers);
+    free(daemon);
+}
+
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+} Reply;
+
+static void reply_add(Reply *r, const char *fmt, ...) {
+    va_list args;
+    if (r->len >= r->size) return;
+    va_start(args, fmt);
+    int n = vsnprintf(r->buf + r->len, r->size - r->len, fmt, args);
+    va_end(args);
+    if (n > 0) r->len += (size_t)n < r->size - r->len ? (size_t)n : r->size - r->len - 1;
+}
+
+static int reply_err(Reply *r, const char *reason) {
+    reply_add(r, "err %s\n", reason);
+    return -1;
+}
+
+static Session *find(LightbarDaemon *daemon, const char *name) {
+    for (Session *s = daemon->sessions; s; s = s->next) {
+        if (strcmp(s->name, name) == 0) return s;
+    }
+    return NULL;
+}
+
+static int open_sink(const char *path) {
+    if (strcmp(path, "null") == 0) return -1;
+    return open(path, O_WRONLY | O_NONBLOCK | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+}
+
+static void set_rate(Session *s, uint32_t rate_hz) {
+    s->rate_hz = rate_hz;
+    s->period_ns = 1000000000u / rate_hz;
+}
+
+static int add_session(LightbarDaemon *daemon, const ControlCommand *cmd, Reply *r) {
+    static const LightbarConfig defaults = {
+        .num_leds = 60, .speed = 10.0f, .end_pause_ms = 200,
+        .glow_radius = 2, .color = { 255, 0, 0 }
+    };
+    if (find(daemon, cmd->name)) return reply_err(r, "exists");
+
+    Session *s = calloc(1, sizeof(*s));
+    if (!s) return reply_err(r, "no memory");
+    s->config = defaults;
+    uint32_t rate_hz = 60;
+    control_apply(cmd, &s->config, &rate_hz);
+    set_rate(s, rate_hz);
+    strcpy(s->name, cmd->name);
+    strcpy(s->sink, (cmd->fields & CONTROL_HAS_SINK) ? cmd->sink : "null");
+    s->leds = malloc((size_t)s->config.num_leds * sizeof(Led));
+    s->sink_fd = open_sink(s->sink);
+    if (!s->leds || (s->sink_fd < 0 && strcmp(s->sink, "null") != 0)) {
+        int failed_open = s->leds != NULL;
+        session_free(s);
+        return reply_err(r, failed_open ? "cannot open sink" : "no memory");
+    }
+    lightbar_init(&s->state, &s->config);
+
+    if (daemon->stats.header) s->stats = lightbar_stats_claim(&daemon->stats, s->name);
+
+    s->worker = &daemon->workers[daemon->next_worker];
+    daemon->next_worker = (daemon->next_worker + 1) % daemon->num_workers;
+    pthread_mutex_lock(&s->worker->lock);
+    s->worker->sessions++;
+    pthread_mutex_unlock(&s->worker->lock);
+    s->next = daemon->sessions;
+    daemon->sessions = s;
+    return 0;
+}
+
+static void remove_session(LightbarDaemon *daemon, Session *s) {
+    Worker *w = s->worker;
+    pthread_mutex_lock(&w->lock);
+    timer_wheel_remove(&w->wheel, &s->timer);
+    w->sessions--;
+    pthread_mutex_unlock(&w->lock);
+    if (s->stats) lightbar_stats_release(s->stats);
+    for (Session **p = &daemon->sessions; *p; p = &(*p)->next) {
+        if (*p == s) {
+            *p = s->next;
+            break;
+        }
+    }
+    session_free(s);
+}
+
+static int set_session(Session *s, const ControlCommand *cmd, Reply *r) {
+    int fd = -1;
+    if (cmd->fields & CONTROL_HAS_SINK) {
+        fd = open_sink(cmd->sink);
+        if (fd < 0 && strcmp(cmd->sink, "null") != 0) return reply_err(r, "cannot open sink");
+    }
+    pthread_mutex_lock(&s->worker->lock);
+    if (cmd->fields & CONTROL_HAS_SINK) {
+        if (s->sink_fd >= 0) close(s->sink_fd);
+        s->sink_fd = fd;
+        strcpy(s->sink, cmd->sink);
+    }
+    uint32_t rate_hz = s->rate_hz;
+    control_apply(cmd, &s->config, &rate_hz);
+    set_rate(s, rate_hz);
+    pthread_mutex_unlock(&s->worker->lock);
+    return 0;
+}
+
+static void start_session(Session *s) {
+    Worker *w = s->worker;
+    pthread_mutex_lock(&w->lock);
+    lightbar_start(&s->state);
+    s->stop_ns = 0;
+    if (!timer_wheel_pending(&s->timer)) {
+        /* Bring a wheel that has idled up to date before filing into it */
+        catch_up(w);
+        s->last_ns = now_ns();
+        s->due_ns = s->last_ns + s->period_ns;
+        timer_wheel_add(&w->wheel, &s->timer, wheel_tick(w, s->due_ns));
+        arm(w);
+    }
+    pthread_mutex_unlock(&w->lock);
+}
+
+static void late_percentiles(uint64_t *late, uint64_t total, double *p50_us, double *p99_us) {
+    uint64_t seen = 0;
+    *p50_us = *p99_us = 0.0;
+    int have50 = 0;
+    for (int b = 0; b <= LATE_BUCKETS && total > 0; b++) {
+        seen += late[b];
+        /* Report the upper edge of the bucket */
+        double us = (double)(b + 1) * LATE_BUCKET_NS / 1000.0;
+        if (!have50 && seen * 2 >= total) {
+            *p50_us = us;
+            have50 = 1;
+        }
+        if (seen * 100 >= total * 99) {
+            *p99_us = us;
+            break;
+        }
+    }
+}
+
+static void stats_all(LightbarDaemon *daemon, Reply *r) {
+    static uint64_t late[LATE_BUCKETS + 1];
+    uint64_t ticks = 0, max_ns = 0;
+    uint32_t sessions = 0;
+    memset(late, 0, sizeof(late));
+    for (int i = 0; i < daemon->num_workers; i++) {
+        Worker *w = &daemon->workers[i];
+        pthread_mutex_lock(&w->lock);
+        for (int b = 0; b <= LATE_BUCKETS; b++) late[b] += w->late[b];
+        ticks += w->ticks;
+        sessions += w->sessions;
+        if (w->late_max_ns > max_ns) max_ns = w->late_max_ns;
+        pthread_mutex_unlock(&w->lock);
+    }
+    double p50, p99;
+    late_percentiles(late, ticks, &p50, &p99);
+    reply_add(r, "sessions=%u workers=%d ticks=%llu late_p50_us<=%.0f late_p99_us<=%.0f "
+              "late_max_us=%.1f\n", sessions, daemon->num_workers, (unsigned long long)ticks,
+              p50, p99, (double)max_ns / 1000.0);
+}
+
+static void stats_session(Session *s, Reply *r) {
+    pthread_mutex_lock(&s->worker->lock);
+    double avg_us = s->ticks ? (double)s->late_sum_ns / (double)s->ticks / 1000.0 : 0.0;
+    reply_add(r, "%s ticks=%llu missed=%llu dropped=%llu late_avg_us=%.1f late_max_us=%.1f\n",
+              s->name, (unsigned long long)s->ticks, (unsigned long long)s->missed,
+              (unsigned long long)s->dropped, avg_us, (double)s->late_max_ns / 1000.0);
+    pthread_mutex_unlock(&s->worker->lock);
+}
+
+static const char *phase_name(LightbarPhase phase) {
+    switch (phase) {
+    case LIGHTBAR_MOVING: return "moving";
+    case LIGHTBAR_PAUSED_END: return "paused";
+    case LIGHTBAR_STOPPING: return "stopping";
+    default: return "stopped";
+    }
+}
+
+int lightbar_daemon_publish_stats(LightbarDaemon *daemon, const char *name, uint32_t slots) {
+    if (daemon->stats.header || lightbar_stats_create(&daemon->stats, name, slots) != 0) {
+        return -1;
+    }
+    for (Session *s = daemon->sessions; s; s = s->next) {
+        LightbarStatsSlot *slot = lightbar_stats_claim(&daemon->stats, s->name);
+        pthread_mutex_lock(&s->worker->lock);
+        s->stats = slot;
+        pthread_mutex_unlock(&s->worker->lock);
+    }
+    return 0;
+}
+
+int lightbar_daemon_command(LightbarDaemon *daemon, const char *line, char *reply, size_t size) {
+    Reply r = { reply, size, 0 };
+    ControlCommand cmd;
+    if (size > 0) reply[0] = '\0';
+    if (control_parse(line, &cmd) != 0) return reply_err(&r, "syntax");
+
+    Session *s = NULL;
+    if (cmd.op != CONTROL_ADD && cmd.name[0]) {
+        s = find(daemon, cmd.name);
+        if (!s) return reply_err(&r, "no such session");
+    }
+
+    switch (cmd.op) {
+    case CONTROL_ADD:
+        if (add_session(daemon, &cmd, &r) != 0) return -1;
+        break;
+    case CONTROL_SET:
+        if (set_session(s, &cmd, &r) != 0) return -1;
+        break;
+    case CONTROL_START:
+        start_session(s);
+        break;
+    case CONTROL_STOP:
+        pthread_mutex_lock(&s->worker->lock);
+        if (s->state.phase == LIGHTBAR_MOVING || s->state.phase == LIGHTBAR_PAUSED_END) {
+            s->stop_ns = now_ns();
+        }
+        lightbar_stop(&s->state, &s->config);
+        pthread_mutex_unlock(&s->worker->lock);
+        break;
+    case CONTROL_REMOVE:
+        remove_session(daemon, s);
+        break;
+    case CONTROL_STATS:
+        if (s) {
+            stats_session(s, &r);
+        } else {
+            stats_all(daemon, &r);
+        }
+        break;
+    case CONTROL_LIST:
+        for (s = daemon->sessions; s; s = s->next) {
+            pthread_mutex_lock(&s->worker->lock);
+            reply_add(&r, "%s %s leds=%u rate=%u sink=%s\n", s->name, phase_name(s->state.phase),
+                      (unsigned)s->config.num_leds, s->rate_hz, s->sink);
+            pthread_mutex_unlock(&s->worker->lock);
+        }
+        break;
+    }
+    reply_add(&r, "ok\n");
+    return 0;
+}
+
+typedef struct {
+    int fd;
+    size_t len;
+    char buf[LINE_MAX_BYTES];
+} Client;
+
+static void send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+/* Runs every complete line in the client's buffer. Returns -1 to drop the
+ * client. */
+static int serve_client(LightbarDaemon *daemon, Client *c, char *reply) {
+    ssize_t n = read(c->fd, c->buf + c->len, sizeof(c->buf) - 1 - c->len);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN)) return 0;
+    if (n <= 0) return -1;
+    c->len += (size_t)n;
+    c->buf[c->len] = '\0';
+
+    char *line = c->buf;
+    char *end;
+    while ((end = strchr(line, '\n')) != NULL) {
+        *end = '\0';
+        lightbar_daemon_command(daemon, line, reply, REPLY_BYTES);
+        send_all(c->fd, reply, strlen(reply));
+        line = end + 1;
+    }
+    c->len -= (size_t)(line - c->buf);
+    memmove(c->buf, line, c->len);
+    if (c->len == sizeof(c->buf) - 1) {
+        send_all(c->fd, "err line too long\n", 18);
+        return -1;
+    }
+    return 0;
+}
+
+int lightbar_daemon_serve(LightbarDaemon *daemon, const char *path, volatile sig_atomic_t *quit) {
+    static Client clients[MAX_CLIENTS];
+    struct sockaddr_un addr;
+    struct epoll_event ev;
+    struct epoll_event events[MAX_CLIENTS + 1];
+
+    if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) return -1;
+    unlink(path);
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_fd < 0 || bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(listen_fd, MAX_CLIENTS) != 0 ||
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev) != 0) {
+        if (epoll_fd >= 0) close(epoll_fd);
+        close(listen_fd);
+        return -1;
+    }
+
+    char *reply = malloc(REPLY_BYTES);
+    if (!reply) {
+        close(epoll_fd);
+        close(listen_fd);
+        return -1;
+    }
+    for (int i = 0; i < MAX_CLIENTS; i++) clients[i].fd = -1;
+
+    while (!*quit) {
+        /* Wake now and then to notice quit even without a signal */
+        int n = epoll_wait(epoll_fd, events, MAX_CLIENTS + 1, 250);
+        for (int i = 0; i < n; i++) {
+            Client *c = events[i].data.ptr;
+            if (!c) {
+                int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+                if (fd < 0) continue;
+                int slot = 0;
+                while (slot < MAX_CLIENTS && clients[slot].fd >= 0) slot++;
+                if (slot == MAX_CLIENTS) {
+                    send_all(fd, "err busy\n", 9);
+                    close(fd);
+                    continue;
+                }
+                clients[slot].fd = fd;
+                clients[slot].len = 0;
+                ev.events = EPOLLIN;
+                ev.data.ptr = &clients[slot];
+                epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+            } else if (serve_client(daemon, c, reply) != 0) {
+                close(c->fd);
+                c->fd = -1;
+            }
+        }
+    }
+
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0) close(clients[i].fd);
+    }
+    free(reply);
+    close(epoll_fd);
+    close(listen_fd);
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,277 @@
+#include "lightbar_fleet.h"
+#include <stdlib.h>
+
+int lightbar_fleet_init(LightbarFleet *fleet, uint32_t capacity) {
+    fleet->count = 0;
+    fleet->capacity = capacity;
+    fleet->total_leds = 0;
+
+    fleet->num_leds = calloc(capacity, sizeof(int32_t));
+    fleet->speed = calloc(capacity, sizeof(float));
+    fleet->end_pause_ms = calloc(capacity, sizeof(int32_t));
+    fleet->glow_radius = calloc(capacity, sizeof(uint16_t));
+    fleet->color = calloc(capacity, sizeof(Led));
+    fleet->smooth = calloc(capacity, sizeof(uint8_t));
+    fleet->lut = calloc(capacity, sizeof(*fleet->lut));
+    fleet->profile = calloc(capacity, sizeof(*fleet->profile));
+    fleet->ms_per_step = calloc(capacity, sizeof(float));
+    fleet->pause_ms = calloc(capacity, sizeof(float));
+    fleet->last = calloc(capacity, sizeof(int32_t));
+    fleet->middle = calloc(capacity, sizeof(int32_t));
+    fleet->led_offset = calloc(capacity, sizeof(uint32_t));
+    fleet->position = calloc(capacity, sizeof(int32_t));
+    fleet->direction = calloc(capacity, sizeof(int32_t));
+    fleet->phase = calloc(capacity, sizeof(int32_t));
+    fleet->pause_timer_ms = calloc(capacity, sizeof(float));
+    fleet->move_accum_ms = calloc(capacity, sizeof(float));
+    fleet->edges_remaining = calloc(capacity, sizeof(int32_t));
+    fleet->busy = calloc(capacity, sizeof(int32_t));
+
+    if (capacity > 0 &&
+        (!fleet->num_leds || !fleet->speed || !fleet->end_pause_ms ||
+         !fleet->glow_radius || !fleet->color || !fleet->smooth || !fleet->lut ||
+         !fleet->profile || !fleet->ms_per_step || !fleet->pause_ms ||
+         !fleet->last || !fleet->middle || !fleet->led_offset ||
+         !fleet->position || !fleet->direction || !fleet->phase ||
+         !fleet->pause_timer_ms || !fleet->move_accum_ms ||
+         !fleet->edges_remaining || !fleet->busy)) {
+        lightbar_fleet_free(fleet);
+        return -1;
+    }
+    return 0;
+}
+
+void lightbar_fleet_free(LightbarFleet *fleet) {
+    free(fleet->num_leds);
+    free(fleet->speed);
+    free(fleet->end_pause_ms);
+    free(fleet->glow_radius);
+    free(fleet->color);
+    free(fleet->smooth);
+    free((void *)fleet->lut);
+    free((void *)fleet->profile);
+    free(fleet->ms_per_step);
+    free(fleet->pause_ms);
+    free(fleet->last);
+    free(fleet->middle);
+    free(fleet->led_offset);
+    free(fleet->position);
+    free(fleet->direction);
+    free(fleet->phase);
+    free(fleet->pause_timer_ms);
+    free(fleet->move_accum_ms);
+    free(fleet->edges_remaining);
+    free(fleet->busy);
+    fleet->count = 0;
+    fleet->capacity = 0;
+    fleet->total_leds = 0;
+}
+
+int lightbar_fleet_add(LightbarFleet *fleet, const LightbarConfig *config) {
+    if (fleet->count >= fleet->capacity) {
+        return -1;
+    }
+    uint32_t i = fleet->count++;
+    fleet->num_leds[i] = config->num_leds;
+    fleet->led_offset[i] = fleet->total_leds;
+    fleet->total_leds += config->num_leds;
+    lightbar_fleet_set_config(fleet, i, config);
+
+    LightbarState state;
+    lightbar_init(&state, config);
+    lightbar_fleet_set_state(fleet, i, &state);
+    return (int)i;
+}
+
+/* num_leds is fixed once an instance is added, since it sets the layout
+ * of the render buffer. */
+void lightbar_fleet_set_config(LightbarFleet *fleet, uint32_t i, const LightbarConfig *config) {
+    fleet->speed[i] = config->speed;
+    fleet->end_pause_ms[i] = config->end_pause_ms;
+    fleet->glow_radius[i] = config->glow_radius;
+    fleet->color[i] = config->color;
+    fleet->smooth[i] = config->smooth;
+    fleet->lut[i] = config->lut;
+    fleet->profile[i] = config->profile;
+    fleet->ms_per_step[i] = (config->speed > 0.0f) ? 1000.0f / config->speed : 0.0f;
+    fleet->pause_ms[i] = (float)config->end_pause_ms;
+    fleet->last[i] = fleet->num_leds[i] - 1;
+    fleet->middle[i] = fleet->num_leds[i] / 2;
+}
+
+void lightbar_fleet_get_config(const LightbarFleet *fleet, uint32_t i, LightbarConfig *config) {
+    config->num_leds = (uint16_t)fleet->num_leds[i];
+    config->speed = fleet->speed[i];
+    config->end_pause_ms = (uint16_t)fleet->end_pause_ms[i];
+    config->glow_radius = fleet->glow_radius[i];
+    config->color = fleet->color[i];
+    config->smooth = fleet->smooth[i];
+    config->lut = fleet->lut[i];
+    config->profile = fleet->profile[i];
+}
+
+void lightbar_fleet_get_state(const LightbarFleet *fleet, uint32_t i, LightbarState *state) {
+    state->position = fleet->position[i];
+    state->direction = fleet->direction[i];
+    state->phase = (LightbarPhase)fleet->phase[i];
+    state->pause_timer_ms = fleet->pause_timer_ms[i];
+    state->move_accum_ms = fleet->move_accum_ms[i];
+    state->edges_remaining = (uint8_t)fleet->edges_remaining[i];
+}
+
+void lightbar_fleet_set_state(LightbarFleet *fleet, uint32_t i, const LightbarState *state) {
+    fleet->position[i] = state->position;
+    fleet->direction[i] = state->direction;
+    fleet->phase[i] = state->phase;
+    fleet->pause_timer_ms[i] = state->pause_timer_ms;
+    fleet->move_accum_ms[i] = state->move_accum_ms;
+    fleet->edges_remaining[i] = state->edges_remaining;
+}
+
+void lightbar_fleet_start(LightbarFleet *fleet, uint32_t i) {
+    fleet->phase[i] = LIGHTBAR_MOVING;
+}
+
+void lightbar_fleet_stop(LightbarFleet *fleet, uint32_t i) {
+    LightbarConfig config;
+    LightbarState state;
+    lightbar_fleet_get_config(fleet, i, &config);
+    lightbar_fleet_get_state(fleet, i, &state);
+    lightbar_stop(&state, &config);
+    lightbar_fleet_set_state(fleet, i, &state);
+}
+
+/* The update kernels below keep every instance on the same path: each
+ * condition becomes an all-ones/all-zeros mask, every load, float operation
+ * and store is unconditional, and results are chosen with pick(). That
+ * lets GCC if-convert and vectorize the loops (given -fno-trapping-math,
+ * which does not change any result). */
+static inline int32_t pick(int32_t mask, int32_t a, int32_t b) {
+    return (a & mask) | (b & ~mask);
+}
+
+/* What fleet_begin() leaves for each instance in busy */
+#define FLEET_IDLE 0
+#define FLEET_STEP 1
+/* Two or more steps due: left untouched for lightbar_update() */
+#define FLEET_LONG 2
+
+/* Pause countdown and accumulation: the part of lightbar_update() that runs
+ * once per call. */
+static void fleet_begin(uint32_t n, float dt_ms, const float *restrict speed,
+                        const float *restrict ms_per_step, int32_t *restrict direction,
+                        int32_t *restrict phase, float *restrict pause,
+                        float *restrict accum, int32_t *restrict busy) {
+    for (uint32_t i = 0; i < n; i++) {
+        int32_t ph = phase[i];
+        int32_t dir = direction[i];
+        float p = pause[i];
+        float acc = accum[i];
+
+        int32_t paused_end = -(ph == LIGHTBAR_PAUSED_END);
+        int32_t stopping = -(ph == LIGHTBAR_STOPPING);
+        int32_t stop_pause = stopping & -(p > 0.0f);
+        int32_t in_pause = paused_end | stop_pause;
+        int32_t moving = (-(ph == LIGHTBAR_MOVING) | (stopping & ~stop_pause)) &
+                         -(speed[i] > 0.0f);
+
+        float left = p - dt_ms;
+        float added = acc + (moving ? dt_ms : 0.0f);
+        int32_t lengthy = moving & -(added >= 2.0f * ms_per_step[i]);
+        int32_t expire = in_pause & -(left <= 0.0f);
+        dir = (dir ^ expire) - expire;
+        ph = pick(expire & paused_end, LIGHTBAR_MOVING, ph);
+        p = in_pause ? left : p;
+        p = expire ? 0.0f : p;
+        acc = expire ? 0.0f : (lengthy ? acc : added);
+
+        pause[i] = p;
+        direction[i] = dir;
+        phase[i] = ph;
+        accum[i] = acc;
+        busy[i] = pick(lengthy, FLEET_LONG, moving & FLEET_STEP);
+    }
+}
+
+/* The single step of every instance with one due. Its time left over is
+ * under a step, so after an edge bounce there is nothing more to do. */
+static void fleet_step(uint32_t n, const float *restrict ms_per_step,
+                           const int32_t *restrict last, const int32_t *restrict middle,
+                           const float *restrict end_pause, int32_t *restrict position,
+                           int32_t *restrict direction, int32_t *restrict phase,
+                           float *restrict pause, float *restrict accum,
+                           int32_t *restrict edges, int32_t *restrict busy) {
+    for (uint32_t i = 0; i < n; i++) {
+        int32_t ph = phase[i];
+        int32_t pos = position[i];
+        int32_t dir = direction[i];
+        int32_t e = edges[i];
+        int32_t hi = last[i];
+        float p = pause[i];
+        float acc = accum[i];
+        float step = ms_per_step[i];
+        float pause_ms = end_pause[i];
+
+        int32_t go = -(busy[i] == FLEET_STEP) & -(acc >= step);
+        int32_t stopping = -(ph == LIGHTBAR_STOPPING);
+        int32_t next = pos + dir;
+        int32_t low = -(next <= 0);
+        int32_t high = -(next >= hi);
+        int32_t edge = go & (low | high);
+        next = pick(edge & low, 0, next);
+        next = pick(edge & high, hi, next);
+
+        e -= edge & stopping & -(e > 0) & 1;
+        int32_t pause_hit = edge & -(pause_ms > 0.0f);
+        int32_t fin = go & ~pause_hit & stopping & -(next == middle[i]) & -(e == 0);
+        int32_t flip = edge & ~pause_hit;
+        dir = (dir ^ flip) - flip;
+        dir = pick(fin, 1, dir);
+        ph = pick(pause_hit & ~stopping, LIGHTBAR_PAUSED_END, ph);
+        ph = pick(fin, LIGHTBAR_STOPPED, ph);
+        pos = pick(go, next, pos);
+
+        float remaining = acc - (go ? step : 0.0f);
+        remaining = (pause_hit | fin) ? 0.0f : remaining;
+        p = pause_hit ? pause_ms : p;
+        p = fin ? 0.0f : p;
+
+        phase[i] = ph;
+        pause[i] = p;
+        accum[i] = remaining;
+        direction[i] = dir;
+        position[i] = pos;
+        edges[i] = e;
+    }
+}
+
+/* Instances with a step due take it in the vector loop; the few a long
+ * frame or a high speed gives more than one go through lightbar_update()
+ * one by one, so no instance makes the rest of the fleet loop again. */
+void lightbar_fleet_update(LightbarFleet *fleet, float dt_ms) {
+    fleet_begin(fleet->count, dt_ms, fleet->speed, fleet->ms_per_step, fleet->direction,
+                fleet->phase, fleet->pause_timer_ms, fleet->move_accum_ms, fleet->busy);
+    fleet_step(fleet->count, fleet->ms_per_step, fleet->last, fleet->middle,
+               fleet->pause_ms, fleet->position, fleet->direction, fleet->phase,
+               fleet->pause_timer_ms, fleet->move_accum_ms, fleet->edges_remaining,
+               fleet->busy);
+    for (uint32_t i = 0; i < fleet->count; i++) {
+        if (fleet->busy[i] != FLEET_LONG) continue;
+        LightbarConfig config;
+        LightbarState state;
+        lightbar_fleet_get_config(fleet, i, &config);
+        lightbar_fleet_get_state(fleet, i, &state);
+        lightbar_update(&state, &config, dt_ms);
+        lightbar_fleet_set_state(fleet, i, &state);
+    }
+}
+
+void lightbar_fleet_render(const LightbarFleet *fleet, Led *leds) {
+    for (uint32_t i = 0; i < fleet->count; i++) {
+        LightbarConfig config;
+        LightbarState state;
+        lightbar_fleet_get_config(fleet, i, &config);
+        lightbar_fleet_get_state(fleet, i, &state);
+        lightbar_render(&state, &config, leds + fleet->led_offset[i]);
+    }
+}
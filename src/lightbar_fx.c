@@ -0,0 +1,156 @@
+#include "lightbar_fx.h"
+
+/* weight = move_accum_us * weight_scale >> WEIGHT_SHIFT. move_accum_us stays
+ * below us_per_step, so the product stays below 2^31 + us_per_step. */
+#define WEIGHT_SHIFT 23
+
+void lightbar_fx_set_speed(LightbarFxConfig *config, uint32_t speed_q16) {
+    config->speed_q16 = speed_q16;
+    if (speed_q16 == 0) {
+        config->us_per_step = 0;
+        config->weight_scale = 0;
+        return;
+    }
+    uint64_t us = (1000000ULL << 16) / speed_q16;
+    if (us > INT32_MAX) us = INT32_MAX;
+    config->us_per_step = us > 0 ? (uint32_t)us : 1;
+    config->weight_scale = ((256UL << WEIGHT_SHIFT) + config->us_per_step - 1) / config->us_per_step;
+}
+
+void lightbar_fx_init(LightbarFxState *state, const LightbarFxConfig *config) {
+    state->position = config->num_leds / 2;
+    state->direction = 1;
+    state->phase = LIGHTBAR_STOPPED;
+    state->pause_timer_us = 0;
+    state->move_accum_us = 0;
+    state->edges_remaining = 0;
+}
+
+void lightbar_fx_start(LightbarFxState *state) {
+    state->phase = LIGHTBAR_MOVING;
+}
+
+void lightbar_fx_stop(LightbarFxState *state, const LightbarFxConfig *config) {
+    if (state->phase == LIGHTBAR_STOPPED || state->phase == LIGHTBAR_STOPPING) {
+        return;
+    }
+
+    int middle = config->num_leds / 2;
+
+    if (state->phase == LIGHTBAR_PAUSED_END) {
+        state->edges_remaining = (state->direction == 1) ? 1 : 0;
+    } else if (state->direction == 1) {
+        state->edges_remaining = (state->position >= middle) ? 2 : 0;
+    } else {
+        state->edges_remaining = 1;
+    }
+
+    state->phase = LIGHTBAR_STOPPING;
+}
+
+/* Number of steps from the current position until the edge check fires. */
+static int steps_to_edge(const LightbarFxState *state, const LightbarFxConfig *config) {
+    int next = state->position + state->direction;
+    if (next <= 0 || next >= config->num_leds - 1) return 1;
+    return (state->direction == 1) ? config->num_leds - 1 - state->position
+                                   : state->position;
+}
+
+static void finalize_stop(LightbarFxState *state) {
+    state->phase = LIGHTBAR_STOPPED;
+    state->direction = 1;
+    state->pause_timer_us = 0;
+    state->move_accum_us = 0;
+}
+
+/* Jumps from edge to edge like lightbar_update(), so a long stall costs a
+ * few iterations rather than one per step. Frames shorter than a step, the
+ * usual case, still divide nothing. */
+void lightbar_fx_update(LightbarFxState *state, const LightbarFxConfig *config, uint32_t dt_us) {
+    int middle = config->num_leds / 2;
+    int reduced = 0;
+    uint32_t t = dt_us;
+
+    while (state->phase != LIGHTBAR_STOPPED) {
+        int stopping = (state->phase == LIGHTBAR_STOPPING);
+
+        /* End pause, or a pending one during the wind-down (stays STOPPING) */
+        if (state->phase == LIGHTBAR_PAUSED_END || (stopping && state->pause_timer_us > 0)) {
+            if (t < (uint32_t)state->pause_timer_us) {
+                state->pause_timer_us -= (int32_t)t;
+                return;
+            }
+            state->direction = -state->direction;
+            if (!stopping) state->phase = LIGHTBAR_MOVING;
+            state->pause_timer_us = 0;
+            state->move_accum_us = 0;
+            return;
+        }
+
+        if (config->us_per_step == 0) return;
+        uint64_t accum = (uint64_t)state->move_accum_us + t;
+        if (accum < config->us_per_step) {
+            state->move_accum_us = (uint32_t)accum;
+            return;
+        }
+
+        int edge_steps = steps_to_edge(state, config);
+        int steps = edge_steps;
+        int to_middle = (middle - state->position) * state->direction;
+        if (stopping && state->edges_remaining == 0 &&
+            to_middle > 0 && to_middle < edge_steps) {
+            steps = to_middle;
+        }
+
+        uint64_t span = (uint64_t)steps * config->us_per_step;
+        if (accum < span) {
+            uint32_t n = (uint32_t)(accum / config->us_per_step);
+            state->position += (int)n * state->direction;
+            state->move_accum_us = (uint32_t)(accum - (uint64_t)n * config->us_per_step);
+            return;
+        }
+
+        t = (uint32_t)(accum - span);
+        state->position += steps * state->direction;
+        state->move_accum_us = 0;
+        if (steps < edge_steps) {
+            finalize_stop(state);
+            return;
+        }
+
+        int last = config->num_leds - 1;
+        if (state->position <= 0) state->position = 0;
+        if (state->position >= last) state->position = last;
+        if (stopping && state->edges_remaining > 0) state->edges_remaining--;
+        if (config->end_pause_ms > 0) {
+            if (!stopping) state->phase = LIGHTBAR_PAUSED_END;
+            state->pause_timer_us = (int32_t)config->end_pause_ms * 1000;
+            return;
+        }
+        state->direction = -state->direction;
+        if (stopping && state->position == middle && state->edges_remaining == 0) {
+            finalize_stop(state);
+            return;
+        }
+
+        /* Without end pauses the motion repeats every two legs, so whole
+         * periods of a long stall are skipped outright. */
+        if (!reduced && (!stopping || (state->edges_remaining == 0 && config->num_leds == 0))) {
+            int leg = (config->num_leds > 2) ? config->num_leds - 1 : 1;
+            uint64_t period = 2ULL * (uint64_t)leg * config->us_per_step;
+            if (t >= period) t = (uint32_t)(t % period);
+            reduced = 1;
+        }
+    }
+}
+
+void lightbar_fx_render(const LightbarFxState *state, const LightbarFxConfig *config, Led *leds) {
+    int weight = 0;
+    if (config->smooth && config->us_per_step > 0 && state->pause_timer_us <= 0 &&
+        (state->phase == LIGHTBAR_MOVING || state->phase == LIGHTBAR_STOPPING)) {
+        weight = (int)((state->move_accum_us * config->weight_scale) >> WEIGHT_SHIFT);
+        if (weight > 255) weight = 255;
+    }
+    lightbar_render_dot(config->num_leds, config->glow_radius, config->color, config->lut,
+                        state->position, state->position + state->direction, weight, leds);
+}
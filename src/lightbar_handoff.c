@@ -0,0 +1,60 @@
+#include "lightbar_handoff.h"
+#include <string.h>
+
+void lightbar_handoff_init(LightbarHandoff *handoff, const LightbarConfig *config) {
+    memset(&handoff->data, 0, sizeof(handoff->data));
+    handoff->data.config = *config;
+    /* Version 2, so a poller starting from 0 takes the initial config */
+    handoff->seq = 2;
+}
+
+void lightbar_handoff_publish(LightbarHandoff *handoff, const LightbarConfig *config) {
+    union {
+        LightbarConfig config;
+        size_t words[LIGHTBAR_HANDOFF_WORDS];
+    } next;
+    memset(&next, 0, sizeof(next));
+    next.config = *config;
+
+    /* Claim the handoff by making the sequence odd */
+    uint32_t seq = __atomic_load_n(&handoff->seq, __ATOMIC_RELAXED);
+    for (;;) {
+        if (seq & 1) {
+            seq = __atomic_load_n(&handoff->seq, __ATOMIC_RELAXED);
+            continue;
+        }
+        if (__atomic_compare_exchange_n(&handoff->seq, &seq, seq + 1, 1,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    /* Release stores keep each word after the odd sequence; no fences, so
+     * ThreadSanitizer sees every ordering the algorithm relies on */
+    for (size_t i = 0; i < LIGHTBAR_HANDOFF_WORDS; i++) {
+        __atomic_store_n(&handoff->data.words[i], next.words[i], __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&handoff->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+int lightbar_handoff_poll(const LightbarHandoff *handoff, LightbarConfig *config, uint32_t *seen) {
+    union {
+        LightbarConfig config;
+        size_t words[LIGHTBAR_HANDOFF_WORDS];
+    } copy;
+
+    for (int attempt = 0; attempt < LIGHTBAR_HANDOFF_RETRIES; attempt++) {
+        uint32_t before = __atomic_load_n(&handoff->seq, __ATOMIC_ACQUIRE);
+        if (before == *seen) return 0;
+        if (before & 1) continue;
+        /* Acquire loads keep each word before the second sequence load */
+        for (size_t i = 0; i < LIGHTBAR_HANDOFF_WORDS; i++) {
+            copy.words[i] = __atomic_load_n(&handoff->data.words[i], __ATOMIC_ACQUIRE);
+        }
+        if (__atomic_load_n(&handoff->seq, __ATOMIC_RELAXED) == before) {
+            *config = copy.config;
+            *seen = before;
+            return 1;
+        }
+    }
+    return 0;
+}
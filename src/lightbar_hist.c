@@ -0,0 +1,60 @@
+#include "lightbar_hist.h"
+#include <string.h>
+
+void lightbar_hist_init(LightbarHist *hist) {
+    memset(hist, 0, sizeof(*hist));
+    hist->min = UINT64_MAX;
+}
+
+static unsigned bucket_of(uint64_t value) {
+    if (value < LIGHTBAR_HIST_SUB) return (unsigned)value;
+    unsigned top = 63u - (unsigned)__builtin_clzll(value);
+    unsigned shift = top - LIGHTBAR_HIST_SUB_BITS;
+    unsigned sub = (unsigned)(value >> shift) & (LIGHTBAR_HIST_SUB - 1);
+    return (shift + 1) * LIGHTBAR_HIST_SUB + sub;
+}
+
+/* Largest value that lands in bucket b */
+static uint64_t bucket_top(unsigned b) {
+    if (b < LIGHTBAR_HIST_SUB) return b;
+    unsigned shift = b / LIGHTBAR_HIST_SUB - 1;
+    uint64_t sub = LIGHTBAR_HIST_SUB + b % LIGHTBAR_HIST_SUB;
+    return ((sub + 1) << shift) - 1;
+}
+
+void lightbar_hist_record(LightbarHist *hist, uint64_t value) {
+    hist->buckets[bucket_of(value)]++;
+    hist->count++;
+    hist->sum += (double)value;
+    if (value < hist->min) hist->min = value;
+    if (value > hist->max) hist->max = value;
+}
+
+uint64_t lightbar_hist_quantile(const LightbarHist *hist, double q) {
+    if (hist->count == 0) return 0;
+    double target = q * (double)hist->count;
+    uint64_t seen = 0;
+    for (unsigned b = 0; b < LIGHTBAR_HIST_BUCKETS; b++) {
+        seen += hist->buckets[b];
+        if (hist->buckets[b] && (double)seen >= target) {
+            uint64_t v = bucket_top(b);
+            if (v < hist->min) v = hist->min;
+            return v < hist->max ? v : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+void lightbar_hist_print(const LightbarHist *hist, const char *name, double scale, FILE *out) {
+    if (hist->count == 0) {
+        fprintf(out, "%-10s count=0\n", name);
+        return;
+    }
+    fprintf(out, "%-10s count=%llu mean=%.1f p50=%.1f p90=%.1f p99=%.1f p99.9=%.1f max=%.1f\n",
+            name, (unsigned long long)hist->count, hist->sum / (double)hist->count / scale,
+            (double)lightbar_hist_quantile(hist, 0.5) / scale,
+            (double)lightbar_hist_quantile(hist, 0.9) / scale,
+            (double)lightbar_hist_quantile(hist, 0.99) / scale,
+            (double)lightbar_hist_quantile(hist, 0.999) / scale,
+            (double)hist->max / scale);
+}
@@ -0,0 +1,135 @@
+#include "lightbar_layout.h"
+#include <stdlib.h>
+#include <string.h>
+
+int lightbar_layout_init(LightbarLayout *layout, uint16_t num_leds, int num_channels,
+                         const uint32_t *channel_leds) {
+    memset(layout, 0, sizeof(*layout));
+    layout->num_leds = num_leds;
+    layout->num_channels = num_channels;
+    layout->channel_leds = malloc((size_t)(num_channels > 0 ? num_channels : 1) * sizeof(uint32_t));
+    if (!layout->channel_leds) return -1;
+    for (int c = 0; c < num_channels; c++) layout->channel_leds[c] = channel_leds[c];
+    return 0;
+}
+
+void lightbar_layout_free(LightbarLayout *layout) {
+    free(layout->channel_leds);
+    free(layout->entries);
+    free(layout->first);
+    free(layout->pixels);
+    memset(layout, 0, sizeof(*layout));
+}
+
+static int add(LightbarLayout *layout, int logical, int channel, uint32_t index) {
+    if (layout->count == layout->capacity) {
+        size_t capacity = layout->capacity ? 2 * layout->capacity : 64;
+        LightbarLayoutEntry *entries = realloc(layout->entries, capacity * sizeof(*entries));
+        if (!entries) return -1;
+        layout->entries = entries;
+        layout->capacity = capacity;
+    }
+    LightbarLayoutEntry *e = &layout->entries[layout->count++];
+    e->logical = (uint16_t)logical;
+    e->pixel.channel = (uint16_t)channel;
+    e->pixel.index = index;
+    layout->compiled = 0;
+    return 0;
+}
+
+static int fits(const LightbarLayout *layout, int logical, int count, int channel,
+                uint32_t physical, uint64_t leds) {
+    return count > 0 && logical >= 0 && logical + count <= layout->num_leds &&
+           channel >= 0 && channel < layout->num_channels &&
+           physical + leds <= layout->channel_leds[channel];
+}
+
+int lightbar_layout_segment(LightbarLayout *layout, int logical, int count, int channel,
+                            uint32_t physical, int reverse) {
+    if (!fits(layout, logical, count, channel, physical, (uint64_t)count)) return -1;
+    for (int i = 0; i < count; i++) {
+        uint32_t index = reverse ? physical + (uint32_t)(count - 1 - i) : physical + (uint32_t)i;
+        if (add(layout, logical + i, channel, index) != 0) return -1;
+    }
+    return 0;
+}
+
+int lightbar_layout_serpentine(LightbarLayout *layout, int logical, int width, int height,
+                               int channel, uint32_t physical) {
+    if (height <= 0 ||
+        !fits(layout, logical, width, channel, physical, (uint64_t)width * (uint64_t)height)) {
+        return -1;
+    }
+    for (int x = 0; x < width; x++) {
+        for (int y = 0; y < height; y++) {
+            int column = (y & 1) ? width - 1 - x : x;
+            uint32_t index = physical + (uint32_t)y * (uint32_t)width + (uint32_t)column;
+            if (add(layout, logical + x, channel, index) != 0) return -1;
+        }
+    }
+    return 0;
+}
+
+int lightbar_layout_compile(LightbarLayout *layout) {
+    uint32_t *first = calloc((size_t)layout->num_leds + 1, sizeof(uint32_t));
+    LightbarPixel *pixels = malloc((layout->count ? layout->count : 1) * sizeof(LightbarPixel));
+    if (!first || !pixels) {
+        free(first);
+        free(pixels);
+        return -1;
+    }
+    /* Counting sort by logical index, keeping the order entries were added */
+    for (size_t i = 0; i < layout->count; i++) first[layout->entries[i].logical + 1]++;
+    for (int i = 0; i < layout->num_leds; i++) first[i + 1] += first[i];
+    for (size_t i = 0; i < layout->count; i++) {
+        const LightbarLayoutEntry *e = &layout->entries[i];
+        pixels[first[e->logical]++] = e->pixel;
+    }
+    for (int i = layout->num_leds; i > 0; i--) first[i] = first[i - 1];
+    first[0] = 0;
+
+    free(layout->first);
+    free(layout->pixels);
+    layout->first = first;
+    layout->pixels = pixels;
+    layout->compiled = 1;
+    return 0;
+}
+
+void lightbar_layout_output_init(LightbarLayoutOutput *out, Led **channels) {
+    out->channels = channels;
+    out->valid = 0;
+    out->from = 0;
+    out->to = 0;
+}
+
+static void scatter(const LightbarLayoutOutput *out, const LightbarLayout *layout, int i, Led led) {
+    for (uint32_t k = layout->first[i]; k < layout->first[i + 1]; k++) {
+        const LightbarPixel *p = &layout->pixels[k];
+        out->channels[p->channel][p->index] = led;
+    }
+}
+
+void lightbar_layout_render(LightbarLayoutOutput *out, const LightbarLayout *layout,
+                            const LightbarState *state, const LightbarConfig *config) {
+    const Led off = { 0, 0, 0 };
+    LightbarSpan span;
+    lightbar_span(state, config, &span);
+    if (span.to > layout->num_leds) span.to = layout->num_leds;
+    if (span.from > span.to) span.from = span.to;
+
+    if (!out->valid) {
+        for (int c = 0; c < layout->num_channels; c++) {
+            memset(out->channels[c], 0, layout->channel_leds[c] * sizeof(Led));
+        }
+    } else {
+        for (int i = out->from; i < out->to; i++) scatter(out, layout, i, off);
+    }
+    for (int i = span.from; i < span.to; i++) {
+        scatter(out, layout, i, lightbar_span_led(&span, i));
+    }
+
+    out->valid = 1;
+    out->from = span.from;
+    out->to = span.to;
+}
@@ -0,0 +1,176 @@
+#define _GNU_SOURCE
+#include "lightbar_pacer.h"
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#define NS_PER_S 1000000000ull
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NS_PER_S + (uint64_t)ts.tv_nsec;
+}
+
+int lightbar_pacer_init(LightbarPacer *pacer, uint32_t rate_hz) {
+    if (rate_hz < LIGHTBAR_PACER_MIN_HZ || rate_hz > LIGHTBAR_PACER_MAX_HZ) return -1;
+    memset(pacer, 0, sizeof(*pacer));
+    pacer->rate_hz = rate_hz;
+    pacer->epoch_ns = now_ns();
+    lightbar_hist_init(&pacer->late);
+    lightbar_hist_init(&pacer->update);
+    lightbar_hist_init(&pacer->render);
+    lightbar_hist_init(&pacer->drift);
+    return 0;
+}
+
+uint64_t lightbar_pacer_deadline(const LightbarPacer *pacer, uint64_t frame) {
+    uint64_t rate = pacer->rate_hz;
+    return pacer->epoch_ns + frame / rate * NS_PER_S + frame % rate * NS_PER_S / rate;
+}
+
+/* Index of the last deadline at or before t */
+static uint64_t frame_at(const LightbarPacer *pacer, uint64_t t) {
+    uint64_t elapsed = t - pacer->epoch_ns;
+    return elapsed / NS_PER_S * pacer->rate_hz + elapsed % NS_PER_S * pacer->rate_hz / NS_PER_S;
+}
+
+double lightbar_pacer_wait(LightbarPacer *pacer) {
+    uint64_t previous = lightbar_pacer_deadline(pacer, pacer->frame);
+    uint64_t frame = pacer->frame + 1;
+    uint64_t due = lightbar_pacer_deadline(pacer, frame);
+    uint64_t now = now_ns();
+
+    if (now < due) {
+        struct timespec ts;
+        ts.tv_sec = (time_t)(due / NS_PER_S);
+        ts.tv_nsec = (long)(due % NS_PER_S);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        }
+        now = now_ns();
+    } else {
+        uint64_t latest = frame_at(pacer, now);
+        if (latest > frame) {
+            pacer->missed += latest - frame;
+            frame = latest;
+            due = lightbar_pacer_deadline(pacer, frame);
+        }
+    }
+    lightbar_hist_record(&pacer->late, now - due);
+    pacer->frame = frame;
+    return (double)(due - previous) / 1e6;
+}
+
+static int oscillates(const LightbarState *state, const LightbarConfig *config) {
+    return (state->phase == LIGHTBAR_MOVING || state->phase == LIGHTBAR_PAUSED_END) &&
+           config->num_leds >= 2 && config->speed > 0.0f;
+}
+
+static int same_motion(const LightbarConfig *a, const LightbarConfig *b) {
+    return a->num_leds == b->num_leds && a->speed == b->speed &&
+           a->end_pause_ms == b->end_pause_ms;
+}
+
+/* In float, as lightbar_advance() steps */
+static double ms_per_step(const LightbarConfig *config) {
+    return (double)(1000.0f / config->speed);
+}
+
+static double period_ms(const LightbarConfig *config) {
+    return 2.0 * ((config->num_leds - 1) * ms_per_step(config) + config->end_pause_ms);
+}
+
+/* Time since the dot last arrived at the left edge, as in the frame
+ * cache; -1 if the state is not on the cycle. */
+static double period_time(const LightbarState *state, const LightbarConfig *config) {
+    int last = config->num_leds - 1;
+    double step = ms_per_step(config);
+    double pause = config->end_pause_ms;
+    double leg = last * step;
+    if (state->phase == LIGHTBAR_PAUSED_END) {
+        double waited = pause - state->pause_timer_ms;
+        if (waited < 0.0) waited = 0.0;
+        if (state->position == 0 && state->direction == -1) return waited;
+        if (state->position == last && state->direction == 1) return pause + leg + waited;
+        return -1.0;
+    }
+    if (state->direction == 1 && state->position >= 0 && state->position < last) {
+        return pause + state->position * step + state->move_accum_ms;
+    }
+    if (state->direction == -1 && state->position > 0 && state->position <= last) {
+        return 2.0 * pause + leg + (last - state->position) * step + state->move_accum_ms;
+    }
+    return -1.0;
+}
+
+/* The state period_time() maps to t */
+static void state_at(LightbarState *state, const LightbarConfig *config, double t) {
+    state->position = 0;
+    state->move_accum_ms = 0.0f;
+    if (config->end_pause_ms > 0) {
+        state->direction = -1;
+        state->phase = LIGHTBAR_PAUSED_END;
+        state->pause_timer_ms = (float)config->end_pause_ms;
+    } else {
+        state->direction = 1;
+        state->phase = LIGHTBAR_MOVING;
+        state->pause_timer_ms = 0.0f;
+    }
+    lightbar_advance(state, config, (float)t);
+}
+
+/* Snaps a steadily oscillating bar back to where the session clock says
+ * it is, or starts tracking it from here. */
+static void correct_drift(LightbarPacer *pacer, LightbarState *state,
+                          const LightbarConfig *config, uint64_t at_ns) {
+    double t = period_time(state, config);
+    if (!oscillates(state, config) || t < 0.0) {
+        pacer->anchored = 0;
+        return;
+    }
+    if (!pacer->anchored || !same_motion(&pacer->anchor_config, config)) {
+        pacer->anchored = 1;
+        pacer->anchor_ns = at_ns;
+        pacer->anchor_ms = t;
+        pacer->anchor_config = *config;
+        return;
+    }
+
+    double period = period_ms(config);
+    double exact = fmod(pacer->anchor_ms + (double)(at_ns - pacer->anchor_ns) / 1e6, period);
+    double drift = t - exact;
+    if (drift > period / 2.0) drift -= period;
+    if (drift < -period / 2.0) drift += period;
+    lightbar_hist_record(&pacer->drift, (uint64_t)(fabs(drift) * 1e6));
+    state_at(state, config, exact);
+}
+
+void lightbar_pacer_update(LightbarPacer *pacer, LightbarState *state,
+                           const LightbarConfig *config, double dt_ms) {
+    lightbar_advance(state, config, (float)dt_ms);
+    if (++pacer->since_check >= pacer->rate_hz || !pacer->anchored) {
+        pacer->since_check = 0;
+        correct_drift(pacer, state, config, lightbar_pacer_deadline(pacer, pacer->frame));
+    }
+}
+
+void lightbar_pacer_frame(LightbarPacer *pacer, LightbarState *state,
+                          const LightbarConfig *config, Led *leds) {
+    double dt_ms = lightbar_pacer_wait(pacer);
+    uint64_t start = now_ns();
+    lightbar_pacer_update(pacer, state, config, dt_ms);
+    uint64_t updated = now_ns();
+    lightbar_render(state, config, leds);
+    lightbar_hist_record(&pacer->update, updated - start);
+    lightbar_hist_record(&pacer->render, now_ns() - updated);
+}
+
+void lightbar_pacer_dump(const LightbarPacer *pacer, FILE *out) {
+    fprintf(out, "rate=%u Hz frames=%llu missed=%llu (times in us)\n", pacer->rate_hz,
+            (unsigned long long)pacer->frame, (unsigned long long)pacer->missed);
+    lightbar_hist_print(&pacer->late, "late", 1000.0, out);
+    lightbar_hist_print(&pacer->update, "update", 1000.0, out);
+    lightbar_hist_print(&pacer->render, "render", 1000.0, out);
+    lightbar_hist_print(&pacer->drift, "drift", 1000.0, out);
+}
@@ -0,0 +1,105 @@
+#include "lightbar_power.h"
+#include <string.h>
+
+void lightbar_power_init(LightbarPower *power, const LightbarPowerModel *model) {
+    memset(power, 0, sizeof(*power));
+    power->model = *model;
+    lightbar_lut_init(&power->lut, 255, 0);
+}
+
+static uint32_t estimate(const LightbarPowerModel *model, uint32_t r, uint32_t g, uint32_t b,
+                         int count) {
+    /* Rounded up, so a frame that fits the estimate fits the supply */
+    uint64_t lit = ((uint64_t)r * model->ma_r + (uint64_t)g * model->ma_g +
+                    (uint64_t)b * model->ma_b + 254) / 255;
+    return (uint32_t)(lit + (uint64_t)count * model->idle_ma);
+}
+
+uint32_t lightbar_power_frame_ma(const LightbarPowerModel *model, const Led *leds, int count) {
+    uint32_t r = 0, g = 0, b = 0;
+    for (int i = 0; i < count; i++) {
+        r += leds[i].r;
+        g += leds[i].g;
+        b += leds[i].b;
+    }
+    return estimate(model, r, g, b, count);
+}
+
+/* The span covers the previous lit window and everything else is dark, so
+ * the frame's sums are the span's. */
+static void account(LightbarPower *power, const Led *leds, int from, int to, uint16_t num_leds) {
+    uint32_t r = 0, g = 0, b = 0;
+    for (int i = from; i < to; i++) {
+        r += leds[i].r;
+        g += leds[i].g;
+        b += leds[i].b;
+    }
+    power->sum_r = r;
+    power->sum_g = g;
+    power->sum_b = b;
+    power->num_leds = num_leds;
+    power->ma = estimate(&power->model, r, g, b, num_leds);
+}
+
+/* Highest brightness up to cap whose draw, scaled from the frame last
+ * drawn, fits the budget. */
+static int fitting_brightness(const LightbarPower *power, int cap) {
+    uint32_t idle = (uint32_t)power->num_leds * power->model.idle_ma;
+    uint32_t budget = power->model.budget_ma;
+    int brightness = power->lut.brightness;
+    if (budget <= idle) return 0;
+    if (power->ma <= idle || brightness == 0) return cap;
+    uint64_t fit = (uint64_t)brightness * (budget - idle) / (power->ma - idle);
+    return fit < (uint64_t)cap ? (int)fit : cap;
+}
+
+int lightbar_power_render_delta(LightbarPower *power, LightbarDelta *delta,
+                                const LightbarState *state, const LightbarPlan *plan,
+                                Led *leds, int *dirty_from, int *dirty_to) {
+    const LightbarConfig *config = &plan->config;
+    int cap = config->lut ? plan->brightness : 255;
+    int gamma = plan->gamma;
+    LightbarConfig drawn = *config;
+    drawn.lut = &power->lut;
+
+    if (power->lut.gamma != gamma) {
+        /* The delta only notices brightness changes */
+        lightbar_lut_init(&power->lut, power->lut.brightness, (uint8_t)gamma);
+        lightbar_delta_reset(delta);
+    }
+    if (!power->model.budget_ma || power->lut.brightness > cap) {
+        lightbar_lut_set_brightness(&power->lut, (uint8_t)cap);
+    }
+    lightbar_plan_sync(&power->plan, &drawn);
+    int changed = lightbar_render_delta_plan(delta, state, &power->plan, leds, dirty_from,
+                                             dirty_to);
+    if (changed) account(power, leds, *dirty_from, *dirty_to, config->num_leds);
+
+    /* At most one step up, then down until the estimate fits */
+    int raised = 0, lowered = 0;
+    while (power->model.budget_ma) {
+        int brightness = power->lut.brightness;
+        int target = fitting_brightness(power, cap);
+        if (power->ma > power->model.budget_ma && target >= brightness) target = brightness - 1;
+        if (target == brightness || target < 0) break;
+        if (target > brightness && (raised || lowered)) break;
+        raised |= target > brightness;
+        lowered |= target < brightness;
+
+        int from, to;
+        lightbar_lut_set_brightness(&power->lut, (uint8_t)target);
+        lightbar_plan_sync(&power->plan, &drawn);
+        if (!lightbar_render_delta_plan(delta, state, &power->plan, leds, &from, &to)) continue;
+        account(power, leds, from, to, config->num_leds);
+        if (!changed) {
+            *dirty_from = from;
+            *dirty_to = to;
+            changed = 1;
+        } else {
+            if (from < *dirty_from) *dirty_from = from;
+            if (to > *dirty_to) *dirty_to = to;
+        }
+    }
+    if (power->lut.brightness < cap) power->limited++;
+    return changed;
+}
@@ -0,0 +1,722 @@
+#define _GNU_SOURCE
+#include "lightbar_record.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define INDEX_MAGIC "LBRIDX1\n"
+/* END offset and index magic */
+#define TRAILER_SIZE 16
+
+static uint32_t float_bits(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+static float bits_float(uint32_t bits) {
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static uint64_t double_bits(double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return bits;
+}
+
+static double bits_double(uint64_t bits) {
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+static uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/* ---- Writing ---- */
+
+static void put(LightbarRecorder *rec, const void *bytes, size_t n) {
+    if (rec->error) return;
+    if (fwrite(bytes, 1, n, rec->file) != n) {
+        rec->error = 1;
+        return;
+    }
+    rec->offset += n;
+}
+
+static void put_byte(LightbarRecorder *rec, uint8_t b) {
+    put(rec, &b, 1);
+}
+
+static void put_varint(LightbarRecorder *rec, uint64_t v) {
+    uint8_t bytes[10];
+    size_t n = 0;
+    while (v >= 0x80) {
+        bytes[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    bytes[n++] = (uint8_t)v;
+    put(rec, bytes, n);
+}
+
+static void put_fixed(LightbarRecorder *rec, uint64_t v, int size) {
+    uint8_t bytes[8];
+    for (int i = 0; i < size; i++) bytes[i] = (uint8_t)(v >> (8 * i));
+    put(rec, bytes, (size_t)size);
+}
+
+/* 0 for none, else the type plus one; a custom curve follows as its table */
+static void put_profile(LightbarRecorder *rec, const LightbarProfile *profile) {
+    put_byte(rec, profile ? (uint8_t)(profile->type + 1) : 0);
+    if (profile && profile->type == LIGHTBAR_PROFILE_CUSTOM) {
+        for (int i = 0; i <= LIGHTBAR_PROFILE_SIZE; i++) {
+            put_fixed(rec, float_bits(profile->table[i]), 4);
+        }
+    }
+}
+
+static void put_config(LightbarRecorder *rec, const LightbarConfig *config) {
+    put_varint(rec, config->num_leds);
+    put_fixed(rec, float_bits(config->speed), 4);
+    put_varint(rec, config->end_pause_ms);
+    put_varint(rec, config->glow_radius);
+    put(rec, &config->color, 3);
+    put_byte(rec, config->smooth);
+    put_byte(rec, config->lut != NULL);
+    if (config->lut) {
+        put_byte(rec, config->lut->brightness);
+        put_byte(rec, config->lut->gamma);
+    }
+    put_profile(rec, config->profile);
+}
+
+static void put_state(LightbarRecorder *rec, const LightbarState *state) {
+    put_varint(rec, zigzag(state->position));
+    put_varint(rec, zigzag(state->direction));
+    put_byte(rec, (uint8_t)state->phase);
+    put_fixed(rec, float_bits(state->pause_timer_ms), 4);
+    put_fixed(rec, float_bits(state->move_accum_ms), 4);
+    put_byte(rec, state->edges_remaining);
+}
+
+static void remember_config(LightbarRecorder *rec, const LightbarConfig *config) {
+    rec->config = *config;
+    rec->has_lut = config->lut != NULL;
+    if (config->lut) {
+        rec->brightness = config->lut->brightness;
+        rec->gamma = config->lut->gamma;
+    }
+    rec->has_profile = config->profile != NULL;
+    if (config->profile) rec->profile = *config->profile;
+}
+
+/* Built-in curves are fully described by their type */
+static int same_profile(const LightbarRecorder *rec, const LightbarProfile *profile) {
+    if (!profile || !rec->has_profile) return !profile && !rec->has_profile;
+    return profile->type == rec->profile.type &&
+           (profile->type != LIGHTBAR_PROFILE_CUSTOM ||
+            memcmp(profile->table, rec->profile.table, sizeof(profile->table)) == 0);
+}
+
+static void flush_repeats(LightbarRecorder *rec) {
+    if (rec->repeats == 0) return;
+    put_byte(rec, LIGHTBAR_REC_REPEAT);
+    put_varint(rec, rec->repeats);
+    rec->repeats = 0;
+}
+
+/* Writes only the fields that differ from the last config written */
+static void sync_config(LightbarRecorder *rec, const LightbarConfig *config) {
+    LightbarConfig *old = &rec->config;
+    int has_lut = config->lut != NULL;
+    int lut_changed = has_lut != rec->has_lut ||
+                      (has_lut && (config->lut->brightness != rec->brightness ||
+                                   config->lut->gamma != rec->gamma));
+    int profile_changed = !same_profile(rec, config->profile);
+    if (config->num_leds == old->num_leds && float_bits(config->speed) == float_bits(old->speed) &&
+        config->end_pause_ms == old->end_pause_ms && config->glow_radius == old->glow_radius &&
+        memcmp(&config->color, &old->color, 3) == 0 && config->smooth == old->smooth &&
+        !lut_changed && !profile_changed) {
+        return;
+    }
+    flush_repeats(rec);
+    if (config->num_leds != old->num_leds) {
+        put_byte(rec, LIGHTBAR_REC_NUM_LEDS);
+        put_varint(rec, config->num_leds);
+    }
+    if (float_bits(config->speed) != float_bits(old->speed)) {
+        put_byte(rec, LIGHTBAR_REC_SPEED);
+        put_fixed(rec, float_bits(config->speed), 4);
+    }
+    if (config->end_pause_ms != old->end_pause_ms) {
+        put_byte(rec, LIGHTBAR_REC_END_PAUSE);
+        put_varint(rec, config->end_pause_ms);
+    }
+    if (config->glow_radius != old->glow_radius) {
+        put_byte(rec, LIGHTBAR_REC_GLOW);
+        put_varint(rec, config->glow_radius);
+    }
+    if (memcmp(&config->color, &old->color, 3) != 0) {
+        put_byte(rec, LIGHTBAR_REC_COLOR);
+        put(rec, &config->color, 3);
+    }
+    if (config->smooth != old->smooth) {
+        put_byte(rec, LIGHTBAR_REC_SMOOTH);
+        put_byte(rec, config->smooth);
+    }
+    if (lut_changed) {
+        put_byte(rec, LIGHTBAR_REC_LUT);
+        put_byte(rec, (uint8_t)has_lut);
+        if (has_lut) {
+            put_byte(rec, config->lut->brightness);
+            put_byte(rec, config->lut->gamma);
+        }
+    }
+    if (profile_changed) {
+        put_byte(rec, LIGHTBAR_REC_PROFILE);
+        put_profile(rec, config->profile);
+    }
+    remember_config(rec, config);
+}
+
+static void checkpoint(LightbarRecorder *rec, const LightbarState *state,
+                       const LightbarConfig *config) {
+    flush_repeats(rec);
+    if (rec->index_count == rec->index_capacity) {
+        size_t capacity = rec->index_capacity ? 2 * rec->index_capacity : 64;
+        LightbarCheckpoint *index = realloc(rec->index, capacity * sizeof(*index));
+        if (!index) {
+            rec->error = 1;
+            return;
+        }
+        rec->index = index;
+        rec->index_capacity = capacity;
+    }
+    rec->index[rec->index_count].time_ms = rec->time_ms;
+    rec->index[rec->index_count].offset = rec->offset;
+    rec->index_count++;
+
+    put_byte(rec, LIGHTBAR_REC_CHECKPOINT);
+    put_fixed(rec, double_bits(rec->time_ms), 8);
+    put_varint(rec, rec->frames);
+    put_config(rec, config);
+    put_state(rec, state);
+    put_byte(rec, (uint8_t)rec->cached);
+    rec->dt_bits = 0;
+    rec->last_checkpoint_ms = rec->time_ms;
+    /* A crash loses at most one interval */
+    if (!rec->error && fflush(rec->file) != 0) rec->error = 1;
+}
+
+int lightbar_record_open(LightbarRecorder *rec, const char *path, double checkpoint_ms,
+                         const LightbarState *state, const LightbarConfig *config) {
+    memset(rec, 0, sizeof(*rec));
+    rec->file = fopen(path, "wb");
+    if (!rec->file) return -1;
+    rec->checkpoint_ms = checkpoint_ms;
+    put(rec, LIGHTBAR_RECORD_MAGIC, LIGHTBAR_RECORD_MAGIC_SIZE);
+    remember_config(rec, config);
+    checkpoint(rec, state, config);
+    return 0;
+}
+
+void lightbar_record_init(LightbarRecorder *rec, const LightbarState *state,
+                          const LightbarConfig *config) {
+    flush_repeats(rec);
+    put_byte(rec, LIGHTBAR_REC_INIT);
+    put_config(rec, config);
+    remember_config(rec, config);
+    checkpoint(rec, state, config);
+}
+
+void lightbar_record_start(LightbarRecorder *rec, const LightbarConfig *config) {
+    sync_config(rec, config);
+    flush_repeats(rec);
+    put_byte(rec, LIGHTBAR_REC_START);
+}
+
+void lightbar_record_stop(LightbarRecorder *rec, const LightbarConfig *config) {
+    sync_config(rec, config);
+    flush_repeats(rec);
+    put_byte(rec, LIGHTBAR_REC_STOP);
+}
+
+void lightbar_record_update(LightbarRecorder *rec, const LightbarState *state,
+                            const LightbarConfig *config, float dt_ms) {
+    uint32_t bits = float_bits(dt_ms);
+    sync_config(rec, config);
+    if (bits == rec->dt_bits) {
+        rec->repeats++;
+    } else {
+        flush_repeats(rec);
+        put_byte(rec, LIGHTBAR_REC_UPDATE);
+        put_varint(rec, bits ^ rec->dt_bits);
+        rec->dt_bits = bits;
+    }
+    rec->time_ms += dt_ms;
+    rec->frames++;
+    if (rec->time_ms - rec->last_checkpoint_ms >= rec->checkpoint_ms) {
+        checkpoint(rec, state, config);
+    }
+}
+
+void lightbar_record_cached(LightbarRecorder *rec, int cached) {
+    cached = cached != 0;
+    if (cached == rec->cached) return;
+    flush_repeats(rec);
+    put_byte(rec, LIGHTBAR_REC_CACHED);
+    put_byte(rec, (uint8_t)cached);
+    rec->cached = cached;
+}
+
+int lightbar_record_close(LightbarRecorder *rec) {
+    flush_repeats(rec);
+    uint64_t end = rec->offset;
+    put_byte(rec, LIGHTBAR_REC_END);
+    put_varint(rec, rec->index_count);
+    for (size_t i = 0; i < rec->index_count; i++) {
+        put_fixed(rec, double_bits(rec->index[i].time_ms), 8);
+        put_varint(rec, rec->index[i].offset);
+    }
+    put_fixed(rec, end, 8);
+    put(rec, INDEX_MAGIC, 8);
+    if (fclose(rec->file) != 0) rec->error = 1;
+    free(rec->index);
+    rec->file = NULL;
+    rec->index = NULL;
+    return rec->error ? -1 : 0;
+}
+
+/* ---- Reading ---- */
+
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+    int error;
+} Reader;
+
+static uint8_t get_byte(Reader *r) {
+    if (r->p >= r->end) {
+        r->error = 1;
+        return 0;
+    }
+    return *r->p++;
+}
+
+static uint64_t get_varint(Reader *r) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t b = get_byte(r);
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    r->error = 1;
+    return 0;
+}
+
+static uint64_t get_fixed(Reader *r, int size) {
+    uint64_t v = 0;
+    for (int i = 0; i < size; i++) v |= (uint64_t)get_byte(r) << (8 * i);
+    return v;
+}
+
+typedef struct {
+    int op;
+    uint64_t value;
+    LightbarConfig config;
+    int has_lut;
+    uint8_t brightness;
+    uint8_t gamma;
+    /* As written by put_profile() */
+    uint8_t profile_kind;
+    LightbarProfile profile;
+    double time_ms;
+    LightbarState state;
+    int cached;
+} Record;
+
+static void get_lut(Reader *r, Record *rec) {
+    rec->has_lut = get_byte(r) != 0;
+    if (rec->has_lut) {
+        rec->brightness = get_byte(r);
+        rec->gamma = get_byte(r);
+    }
+}
+
+static void get_profile(Reader *r, Record *rec) {
+    rec->profile_kind = get_byte(r);
+    if (rec->profile_kind > LIGHTBAR_PROFILE_CUSTOM + 1) r->error = 1;
+    if (rec->profile_kind == LIGHTBAR_PROFILE_CUSTOM + 1) {
+        for (int i = 0; i <= LIGHTBAR_PROFILE_SIZE; i++) {
+            rec->profile.table[i] = bits_float((uint32_t)get_fixed(r, 4));
+        }
+    }
+}
+
+static void get_config(Reader *r, Record *rec) {
+    LightbarConfig *c = &rec->config;
+    memset(c, 0, sizeof(*c));
+    c->num_leds = (uint16_t)get_varint(r);
+    c->speed = bits_float((uint32_t)get_fixed(r, 4));
+    c->end_pause_ms = (uint16_t)get_varint(r);
+    c->glow_radius = (uint16_t)get_varint(r);
+    c->color.r = get_byte(r);
+    c->color.g = get_byte(r);
+    c->color.b = get_byte(r);
+    c->smooth = get_byte(r);
+    get_lut(r, rec);
+    get_profile(r, rec);
+}
+
+static void get_state(Reader *r, LightbarState *s) {
+    s->position = (int)unzigzag(get_varint(r));
+    s->direction = (int)unzigzag(get_varint(r));
+    s->phase = (LightbarPhase)get_byte(r);
+    s->pause_timer_ms = bits_float((uint32_t)get_fixed(r, 4));
+    s->move_accum_ms = bits_float((uint32_t)get_fixed(r, 4));
+    s->edges_remaining = get_byte(r);
+}
+
+/* Decodes the record at pos. Returns the offset after it, or 0 if it is
+ * cut short or unknown. */
+static size_t decode(const LightbarReplay *replay, size_t pos, size_t end, Record *rec) {
+    Reader r = { replay->data + pos, replay->data + end, 0 };
+    rec->op = get_byte(&r);
+    switch (rec->op) {
+    case LIGHTBAR_REC_END:
+    case LIGHTBAR_REC_START:
+    case LIGHTBAR_REC_STOP:
+        break;
+    case LIGHTBAR_REC_INIT:
+        get_config(&r, rec);
+        break;
+    case LIGHTBAR_REC_UPDATE:
+    case LIGHTBAR_REC_REPEAT:
+    case LIGHTBAR_REC_NUM_LEDS:
+    case LIGHTBAR_REC_END_PAUSE:
+    case LIGHTBAR_REC_GLOW:
+        rec->value = get_varint(&r);
+        break;
+    case LIGHTBAR_REC_SPEED:
+        rec->value = get_fixed(&r, 4);
+        break;
+    case LIGHTBAR_REC_COLOR:
+        rec->value = get_fixed(&r, 3);
+        break;
+    case LIGHTBAR_REC_SMOOTH:
+    case LIGHTBAR_REC_CACHED:
+        rec->value = get_byte(&r);
+        break;
+    case LIGHTBAR_REC_LUT:
+        get_lut(&r, rec);
+        break;
+    case LIGHTBAR_REC_PROFILE:
+        get_profile(&r, rec);
+        break;
+    case LIGHTBAR_REC_CHECKPOINT:
+        rec->time_ms = bits_double(get_fixed(&r, 8));
+        rec->value = get_varint(&r);
+        get_config(&r, rec);
+        get_state(&r, &rec->state);
+        rec->cached = get_byte(&r) != 0;
+        break;
+    default:
+        return 0;
+    }
+    return r.error ? 0 : (size_t)(r.p - replay->data);
+}
+
+/* Both tables are rebuilt in place, so the cache cannot see them change */
+static void set_lut(LightbarReplay *replay, const Record *rec) {
+    lightbar_cache_invalidate(&replay->cache);
+    if (rec->has_lut) {
+        lightbar_lut_init(&replay->lut, rec->brightness, rec->gamma);
+        replay->config.lut = &replay->lut;
+    } else {
+        replay->config.lut = NULL;
+    }
+}
+
+static void set_profile(LightbarReplay *replay, const Record *rec) {
+    lightbar_cache_invalidate(&replay->cache);
+    if (rec->profile_kind == 0) {
+        replay->config.profile = NULL;
+        return;
+    }
+    LightbarProfileType type = (LightbarProfileType)(rec->profile_kind - 1);
+    if (type == LIGHTBAR_PROFILE_CUSTOM) {
+        replay->profile = rec->profile;
+        replay->profile.type = type;
+    } else {
+        lightbar_profile_init(&replay->profile, type);
+    }
+    replay->config.profile = &replay->profile;
+}
+
+static int same_state(const LightbarState *a, const LightbarState *b) {
+    return a->position == b->position && a->direction == b->direction && a->phase == b->phase &&
+           float_bits(a->pause_timer_ms) == float_bits(b->pause_timer_ms) &&
+           float_bits(a->move_accum_ms) == float_bits(b->move_accum_ms) &&
+           a->edges_remaining == b->edges_remaining;
+}
+
+static void restore(LightbarReplay *replay, const Record *rec) {
+    replay->config = rec->config;
+    set_lut(replay, rec);
+    set_profile(replay, rec);
+    replay->cached = rec->cached;
+    replay->state = rec->state;
+    replay->time_ms = rec->time_ms;
+    replay->frames = rec->value;
+    replay->dt_bits = 0;
+    replay->repeat_left = 0;
+    replay->synced = 1;
+}
+
+static void step(LightbarReplay *replay) {
+    float dt = bits_float(replay->dt_bits);
+    if (replay->cached) {
+        lightbar_cache_update(&replay->cache, &replay->state, &replay->config, dt);
+    } else {
+        lightbar_update(&replay->state, &replay->config, dt);
+    }
+    replay->time_ms += dt;
+    replay->frames++;
+}
+
+/* Reads the trailer's index, or rebuilds it from the checkpoints */
+static int load_index(LightbarReplay *replay) {
+    size_t size = replay->size;
+    if (size >= LIGHTBAR_RECORD_MAGIC_SIZE + 1 + TRAILER_SIZE &&
+        memcmp(replay->data + size - 8, INDEX_MAGIC, 8) == 0) {
+        Reader t = { replay->data + size - TRAILER_SIZE, replay->data + size, 0 };
+        uint64_t end = get_fixed(&t, 8);
+        if (end >= LIGHTBAR_RECORD_MAGIC_SIZE && end < size - TRAILER_SIZE &&
+            replay->data[end] == LIGHTBAR_REC_END) {
+            Reader r = { replay->data + end + 1, replay->data + size - TRAILER_SIZE, 0 };
+            uint64_t count = get_varint(&r);
+            if (!r.error && count <= size) {
+                replay->index = malloc((count ? count : 1) * sizeof(*replay->index));
+                if (!replay->index) return -1;
+                for (uint64_t i = 0; i < count; i++) {
+                    replay->index[i].time_ms = bits_double(get_fixed(&r, 8));
+                    replay->index[i].offset = get_varint(&r);
+                    if (replay->index[i].offset >= end) r.error = 1;
+                }
+                if (!r.error) {
+                    replay->index_count = (size_t)count;
+                    replay->end = (size_t)end;
+                    return 0;
+                }
+                free(replay->index);
+                replay->index = NULL;
+            }
+        }
+    }
+
+    size_t capacity = 0;
+    size_t pos = LIGHTBAR_RECORD_MAGIC_SIZE;
+    Record rec;
+    for (;;) {
+        size_t next = decode(replay, pos, size, &rec);
+        if (next == 0 || rec.op == LIGHTBAR_REC_END) break;
+        if (rec.op == LIGHTBAR_REC_CHECKPOINT) {
+            if (replay->index_count == capacity) {
+                capacity = capacity ? 2 * capacity : 64;
+                LightbarCheckpoint *index = realloc(replay->index, capacity * sizeof(*index));
+                if (!index) return -1;
+                replay->index = index;
+            }
+            replay->index[replay->index_count].time_ms = rec.time_ms;
+            replay->index[replay->index_count].offset = pos;
+            replay->index_count++;
+        }
+        pos = next;
+    }
+    replay->end = pos;
+    return 0;
+}
+
+int lightbar_replay_open(LightbarReplay *replay, const char *path) {
+    memset(replay, 0, sizeof(*replay));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < LIGHTBAR_RECORD_MAGIC_SIZE) {
+        close(fd);
+        return -1;
+    }
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return -1;
+    replay->data = data;
+    replay->size = (size_t)st.st_size;
+    if (memcmp(data, LIGHTBAR_RECORD_MAGIC, LIGHTBAR_RECORD_MAGIC_SIZE) != 0 ||
+        load_index(replay) != 0) {
+        lightbar_replay_close(replay);
+        return -1;
+    }
+    replay->pos = LIGHTBAR_RECORD_MAGIC_SIZE;
+    return 0;
+}
+
+void lightbar_replay_close(LightbarReplay *replay) {
+    if (replay->data) munmap((void *)replay->data, replay->size);
+    free(replay->index);
+    lightbar_cache_free(&replay->cache);
+    replay->data = NULL;
+    replay->index = NULL;
+}
+
+int lightbar_replay_next(LightbarReplay *replay) {
+    if (replay->repeat_left > 0) {
+        replay->repeat_left--;
+        step(replay);
+        return LIGHTBAR_REC_UPDATE;
+    }
+    if (replay->pos >= replay->end) return LIGHTBAR_REC_END;
+
+    Record rec;
+    size_t next = decode(replay, replay->pos, replay->end, &rec);
+    if (next == 0) {
+        replay->error = 1;
+        return -1;
+    }
+    replay->pos = next;
+    switch (rec.op) {
+    case LIGHTBAR_REC_INIT:
+        replay->config = rec.config;
+        set_lut(replay, &rec);
+        set_profile(replay, &rec);
+        lightbar_init(&replay->state, &replay->config);
+        replay->synced = 1;
+        break;
+    case LIGHTBAR_REC_START:
+        lightbar_start(&replay->state);
+        break;
+    case LIGHTBAR_REC_STOP:
+        lightbar_stop(&replay->state, &replay->config);
+        break;
+    case LIGHTBAR_REC_UPDATE:
+        replay->dt_bits ^= (uint32_t)rec.value;
+        step(replay);
+        break;
+    case LIGHTBAR_REC_REPEAT:
+        if (rec.value == 0 || rec.value > UINT32_MAX) {
+            replay->error = 1;
+            return -1;
+        }
+        replay->repeat_left = (uint32_t)rec.value - 1;
+        step(replay);
+        return LIGHTBAR_REC_UPDATE;
+    case LIGHTBAR_REC_CHECKPOINT:
+        if (replay->synced && !same_state(&replay->state, &rec.state)) {
+            if (replay->mismatches++ == 0) replay->first_mismatch_ms = rec.time_ms;
+        }
+        restore(replay, &rec);
+        break;
+    case LIGHTBAR_REC_NUM_LEDS:
+        replay->config.num_leds = (uint16_t)rec.value;
+        break;
+    case LIGHTBAR_REC_SPEED:
+        replay->config.speed = bits_float((uint32_t)rec.value);
+        break;
+    case LIGHTBAR_REC_END_PAUSE:
+        replay->config.end_pause_ms = (uint16_t)rec.value;
+        break;
+    case LIGHTBAR_REC_GLOW:
+        replay->config.glow_radius = (uint16_t)rec.value;
+        break;
+    case LIGHTBAR_REC_COLOR:
+        replay->config.color.r = (uint8_t)rec.value;
+        replay->config.color.g = (uint8_t)(rec.value >> 8);
+        replay->config.color.b = (uint8_t)(rec.value >> 16);
+        break;
+    case LIGHTBAR_REC_SMOOTH:
+        replay->config.smooth = (uint8_t)rec.value;
+        break;
+    case LIGHTBAR_REC_LUT:
+        set_lut(replay, &rec);
+        break;
+    case LIGHTBAR_REC_PROFILE:
+        set_profile(replay, &rec);
+        break;
+    case LIGHTBAR_REC_CACHED:
+        replay->cached = rec.value != 0;
+        break;
+    }
+    return rec.op;
+}
+
+/* The dt of the next record if it is an update, without applying it */
+static int next_dt(const LightbarReplay *replay, float *dt) {
+    if (replay->repeat_left > 0) {
+        *dt = bits_float(replay->dt_bits);
+        return 1;
+    }
+    Record rec;
+    if (replay->pos >= replay->end ||
+        decode(replay, replay->pos, replay->end, &rec) == 0) {
+        return 0;
+    }
+    if (rec.op == LIGHTBAR_REC_UPDATE) {
+        *dt = bits_float(replay->dt_bits ^ (uint32_t)rec.value);
+        return 1;
+    }
+    if (rec.op == LIGHTBAR_REC_REPEAT) {
+        *dt = bits_float(replay->dt_bits);
+        return 1;
+    }
+    return 0;
+}
+
+int lightbar_replay_seek(LightbarReplay *replay, double time_ms) {
+    /* Last checkpoint at or before time_ms */
+    size_t lo = 0, hi = replay->index_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (replay->index[mid].time_ms <= time_ms) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    memset(&replay->state, 0, sizeof(replay->state));
+    memset(&replay->config, 0, sizeof(replay->config));
+    replay->time_ms = 0.0;
+    replay->frames = 0;
+    replay->dt_bits = 0;
+    replay->repeat_left = 0;
+    replay->synced = 0;
+    replay->cached = 0;
+    replay->pos = LIGHTBAR_RECORD_MAGIC_SIZE;
+    if (lo > 0) {
+        Record rec;
+        size_t at = (size_t)replay->index[lo - 1].offset;
+        size_t next = decode(replay, at, replay->end, &rec);
+        if (next == 0 || rec.op != LIGHTBAR_REC_CHECKPOINT) {
+            replay->error = 1;
+            return -1;
+        }
+        restore(replay, &rec);
+        replay->pos = next;
+    }
+
+    for (;;) {
+        float dt;
+        if (next_dt(replay, &dt) && replay->time_ms + dt > time_ms) return 0;
+        int op = lightbar_replay_next(replay);
+        if (op < 0) return -1;
+        if (op == LIGHTBAR_REC_END) return 0;
+    }
+}
@@ -0,0 +1,184 @@
+#define _GNU_SOURCE
+#include "lightbar_stats.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define STORE(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+
+static LightbarStatsSlot *slot_at(const LightbarStats *stats, uint32_t index) {
+    return (LightbarStatsSlot *)((char *)stats->slots + (size_t)index * stats->header->slot_size);
+}
+
+static int name_fits(LightbarStats *stats, const char *name) {
+    if (strlen(name) >= sizeof(stats->name)) {
+        errno = ENAMETOOLONG;
+        return 0;
+    }
+    strcpy(stats->name, name);
+    return 1;
+}
+
+/* Whether name is a block whose creating process is still running */
+static int owner_alive(const char *name) {
+    struct stat st;
+    int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) return 0;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(LightbarStatsHeader)) {
+        map = mmap(NULL, sizeof(LightbarStatsHeader), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+    const LightbarStatsHeader *h = map;
+    pid_t pid = (pid_t)h->pid;
+    int alive = __atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) == LIGHTBAR_STATS_MAGIC &&
+                pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+    munmap(map, sizeof(LightbarStatsHeader));
+    return alive;
+}
+
+int lightbar_stats_create(LightbarStats *stats, const char *name, uint32_t count) {
+    memset(stats, 0, sizeof(*stats));
+    if (!name_fits(stats, name)) return -1;
+    stats->size = sizeof(LightbarStatsSlot) + (size_t)count * sizeof(LightbarStatsSlot);
+    /* A block left by a crashed daemon is replaced, not reused; one whose
+     * daemon is still running is left alone */
+    if (owner_alive(name)) {
+        errno = EEXIST;
+        return -1;
+    }
+    shm_unlink(name);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    void *map = MAP_FAILED;
+    if (ftruncate(fd, (off_t)stats->size) == 0) {
+        map = mmap(NULL, stats->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        shm_unlink(name);
+        return -1;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    /* The header gets a whole slot so the slots stay on their own lines */
+    stats->header = map;
+    stats->slots = (LightbarStatsSlot *)map + 1;
+    stats->owner = 1;
+    stats->header->version = LIGHTBAR_STATS_VERSION;
+    stats->header->slot_size = sizeof(LightbarStatsSlot);
+    stats->header->slots = count;
+    stats->header->pid = (uint32_t)getpid();
+    stats->header->created_ns = (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+    __atomic_store_n(&stats->header->magic, LIGHTBAR_STATS_MAGIC, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int lightbar_stats_open(LightbarStats *stats, const char *name) {
+    struct stat st;
+    memset(stats, 0, sizeof(*stats));
+    if (!name_fits(stats, name)) return -1;
+    int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(LightbarStatsSlot)) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    LightbarStatsHeader *h = map;
+    if (__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != LIGHTBAR_STATS_MAGIC ||
+        h->version != LIGHTBAR_STATS_VERSION || h->slot_size < sizeof(LightbarStatsSlot) ||
+        (size_t)h->slot_size * ((size_t)h->slots + 1) > (size_t)st.st_size) {
+        munmap(map, (size_t)st.st_size);
+        errno = EINVAL;
+        return -1;
+    }
+    stats->header = h;
+    stats->slots = (LightbarStatsSlot *)((char *)map + h->slot_size);
+    stats->size = (size_t)st.st_size;
+    return 0;
+}
+
+void lightbar_stats_close(LightbarStats *stats) {
+    if (!stats->header) return;
+    munmap(stats->header, stats->size);
+    if (stats->owner) shm_unlink(stats->name);
+    stats->header = NULL;
+}
+
+LightbarStatsSlot *lightbar_stats_claim(LightbarStats *stats, const char *name) {
+    for (uint32_t i = 0; i < stats->header->slots; i++) {
+        LightbarStatsSlot *slot = slot_at(stats, i);
+        uint32_t generation = slot->generation;
+        if (generation & 1) continue;
+        memset(slot, 0, sizeof(*slot));
+        strncpy(slot->name, name, sizeof(slot->name) - 1);
+        slot->render_ns_min = UINT64_MAX;
+        __atomic_store_n(&slot->generation, generation + 1, __ATOMIC_RELEASE);
+        return slot;
+    }
+    return NULL;
+}
+
+void lightbar_stats_release(LightbarStatsSlot *slot) {
+    __atomic_store_n(&slot->generation, slot->generation + 1, __ATOMIC_RELEASE);
+}
+
+void lightbar_stats_frame(LightbarStatsSlot *slot, uint32_t steps, uint32_t edges,
+                          uint32_t pauses, uint64_t render_ns) {
+    /* Single writer: plain increments, published field by field */
+    STORE(slot->frames, LOAD(slot->frames) + 1);
+    if (steps) {
+        STORE(slot->steps, LOAD(slot->steps) + steps);
+        if (steps > LOAD(slot->max_steps)) STORE(slot->max_steps, steps);
+    }
+    if (edges) STORE(slot->edges, LOAD(slot->edges) + edges);
+    if (pauses) STORE(slot->pauses, LOAD(slot->pauses) + pauses);
+    STORE(slot->render_ns_sum, LOAD(slot->render_ns_sum) + render_ns);
+    if (render_ns < LOAD(slot->render_ns_min)) STORE(slot->render_ns_min, render_ns);
+    if (render_ns > LOAD(slot->render_ns_max)) STORE(slot->render_ns_max, render_ns);
+}
+
+void lightbar_stats_stopped(LightbarStatsSlot *slot, uint64_t latency_ns) {
+    STORE(slot->stops, LOAD(slot->stops) + 1);
+    STORE(slot->stop_ns_sum, LOAD(slot->stop_ns_sum) + latency_ns);
+    if (latency_ns > LOAD(slot->stop_ns_max)) STORE(slot->stop_ns_max, latency_ns);
+}
+
+int lightbar_stats_sample(const LightbarStats *stats, uint32_t index, LightbarStatsSlot *out) {
+    LightbarStatsSlot *slot = slot_at(stats, index);
+    uint32_t generation;
+    /* A slot handed to another session mid-copy is copied again */
+    do {
+        generation = __atomic_load_n(&slot->generation, __ATOMIC_ACQUIRE);
+        if (!(generation & 1)) return 0;
+        out->generation = generation;
+        memcpy(out->name, slot->name, sizeof(out->name));
+        out->name[sizeof(out->name) - 1] = '\0';
+        out->frames = LOAD(slot->frames);
+        out->steps = LOAD(slot->steps);
+        out->max_steps = LOAD(slot->max_steps);
+        out->edges = LOAD(slot->edges);
+        out->pauses = LOAD(slot->pauses);
+        out->stops = LOAD(slot->stops);
+        out->stop_ns_sum = LOAD(slot->stop_ns_sum);
+        out->stop_ns_max = LOAD(slot->stop_ns_max);
+        out->render_ns_sum = LOAD(slot->render_ns_sum);
+        out->render_ns_min = LOAD(slot->render_ns_min);
+        out->render_ns_max = LOAD(slot->render_ns_max);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&slot->generation, __ATOMIC_ACQUIRE) != generation);
+    return 1;
+}
@@ -0,0 +1,77 @@
+#define _GNU_SOURCE
+#include "lightbar_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+__thread LightbarTraceRing *lightbar_trace_ring;
+__thread uint32_t lightbar_trace_steps;
+
+/* Every ring ever attached, newest first; rings are never freed */
+static LightbarTraceRing *rings;
+static uint32_t next_tid;
+/* Ticks and CLOCK_MONOTONIC at the first attach, for calibration */
+static int based;
+static uint64_t base_ticks;
+static uint64_t base_ns;
+
+uint64_t lightbar_trace_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+LightbarTraceRing *lightbar_trace_attach(void) {
+    LightbarTraceRing *ring = calloc(1, sizeof(*ring));
+    if (!ring) return NULL;
+    if (__atomic_exchange_n(&based, 1, __ATOMIC_ACQ_REL) == 0) {
+        base_ns = lightbar_trace_clock();
+        base_ticks = lightbar_trace_ticks();
+    }
+    ring->tid = __atomic_add_fetch(&next_tid, 1, __ATOMIC_RELAXED);
+    ring->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&rings, &ring->next, ring, 1,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    lightbar_trace_ring = ring;
+    return ring;
+}
+
+static int write_ring(FILE *f, const LightbarTraceRing *ring) {
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t count = head < LIGHTBAR_TRACE_CAPACITY ? head : LIGHTBAR_TRACE_CAPACITY;
+    LightbarTraceRingHeader rh = { ring->tid, 0, count };
+    size_t at = (size_t)((head - count) & (LIGHTBAR_TRACE_CAPACITY - 1));
+    size_t first = LIGHTBAR_TRACE_CAPACITY - at < count ? LIGHTBAR_TRACE_CAPACITY - at
+                                                        : (size_t)count;
+    if (fwrite(&rh, sizeof(rh), 1, f) != 1) return -1;
+    if (fwrite(ring->records + at, sizeof(LightbarTraceRecord), first, f) != first) return -1;
+    size_t rest = (size_t)count - first;
+    if (fwrite(ring->records, sizeof(LightbarTraceRecord), rest, f) != rest) return -1;
+    return 0;
+}
+
+int lightbar_trace_dump(const char *path) {
+    LightbarTraceHeader header;
+    LightbarTraceRing *first = __atomic_load_n(&rings, __ATOMIC_ACQUIRE);
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LIGHTBAR_TRACE_MAGIC, sizeof(header.magic));
+    header.record_size = sizeof(LightbarTraceRecord);
+    for (LightbarTraceRing *r = first; r; r = r->next) header.rings++;
+    header.base_ticks = base_ticks;
+    header.ns_per_tick = 1.0;
+    uint64_t ticks = lightbar_trace_ticks();
+    if (first && ticks > base_ticks) {
+        header.ns_per_tick = (double)(lightbar_trace_clock() - base_ns) / (double)(ticks - base_ticks);
+    }
+
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    int status = fwrite(&header, sizeof(header), 1, f) == 1 ? 0 : -1;
+    for (LightbarTraceRing *r = first; r && status == 0; r = r->next) {
+        status = write_ring(f, r);
+    }
+    if (fclose(f) != 0) status = -1;
+    return status;
+}
@@ -0,0 +1,230 @@
+#include "lightbar_wire.h"
+#include <string.h>
+
+#define APA102_START_BYTES 4
+
+/* WS2812 SPI encodings. With 3 bits per data bit a 1 is sent as 110 and a 0
+ * as 100, so one data nibble becomes 12 SPI bits: the fixed 0x924 pattern
+ * with the nibble's bits in the middle of each triplet. With 4 bits per
+ * data bit a 1 is 1110 and a 0 is 1000, so each pair of data bits becomes
+ * one SPI byte. */
+static const uint16_t spi3_nibble[16] = {
+    0x000, 0x002, 0x010, 0x012, 0x080, 0x082, 0x090, 0x092,
+    0x400, 0x402, 0x410, 0x412, 0x480, 0x482, 0x490, 0x492
+};
+
+static const uint8_t spi4_pair[4] = { 0x88, 0x8E, 0xE8, 0xEE };
+
+static size_t apa102_end_bytes(uint16_t num_leds) {
+    /* One extra clock edge per two LEDs to push the data all the way out */
+    size_t bytes = ((size_t)num_leds + 15) / 16;
+    return bytes < 4 ? 4 : bytes;
+}
+
+size_t lightbar_wire_stride(LightbarWireFormat format) {
+    switch (format) {
+    case LIGHTBAR_WIRE_GRB: return 3;
+    case LIGHTBAR_WIRE_GRBW: return 4;
+    case LIGHTBAR_WIRE_WS2812_SPI3: return 9;
+    case LIGHTBAR_WIRE_WS2812_SPI4: return 12;
+    case LIGHTBAR_WIRE_APA102: return 4;
+    }
+    return 0;
+}
+
+static size_t header_bytes(LightbarWireFormat format) {
+    return format == LIGHTBAR_WIRE_APA102 ? APA102_START_BYTES : 0;
+}
+
+size_t lightbar_wire_size(LightbarWireFormat format, uint16_t num_leds) {
+    size_t size = lightbar_wire_stride(format) * num_leds;
+    if (format == LIGHTBAR_WIRE_APA102) {
+        size += APA102_START_BYTES + apa102_end_bytes(num_leds);
+    }
+    return size;
+}
+
+static inline void put_spi3(uint8_t *p, uint8_t v) {
+    uint32_t bits = 0x924924u | ((uint32_t)spi3_nibble[v >> 4] << 12) | spi3_nibble[v & 15];
+    p[0] = (uint8_t)(bits >> 16);
+    p[1] = (uint8_t)(bits >> 8);
+    p[2] = (uint8_t)bits;
+}
+
+static inline void put_spi4(uint8_t *p, uint8_t v) {
+    p[0] = spi4_pair[v >> 6];
+    p[1] = spi4_pair[(v >> 4) & 3];
+    p[2] = spi4_pair[(v >> 2) & 3];
+    p[3] = spi4_pair[v & 3];
+}
+
+static inline void put_led(const LightbarWire *wire, uint8_t *p, Led led) {
+    switch (wire->format) {
+    case LIGHTBAR_WIRE_GRB:
+        p[0] = led.g;
+        p[1] = led.r;
+        p[2] = led.b;
+        break;
+    case LIGHTBAR_WIRE_GRBW:
+        p[0] = led.g;
+        p[1] = led.r;
+        p[2] = led.b;
+        p[3] = 0;
+        break;
+    case LIGHTBAR_WIRE_WS2812_SPI3:
+        put_spi3(p, led.g);
+        put_spi3(p + 3, led.r);
+        put_spi3(p + 6, led.b);
+        break;
+    case LIGHTBAR_WIRE_WS2812_SPI4:
+        put_spi4(p, led.g);
+        put_spi4(p + 4, led.r);
+        put_spi4(p + 8, led.b);
+        break;
+    case LIGHTBAR_WIRE_APA102:
+        p[0] = (uint8_t)(0xE0 | wire->brightness);
+        p[1] = led.b;
+        p[2] = led.g;
+        p[3] = led.r;
+        break;
+    }
+}
+
+/* Writes the encoded "off" pattern into LEDs [from, to). Formats whose off
+ * LED is a single repeated byte use memset; the others write one LED and
+ * double the filled run with memcpy. */
+static void put_dark(const LightbarWire *wire, int from, int to) {
+    if (to <= from) return;
+    size_t stride = lightbar_wire_stride(wire->format);
+    uint8_t *p = wire->data + header_bytes(wire->format) + (size_t)from * stride;
+    size_t bytes = (size_t)(to - from) * stride;
+
+    if (wire->format == LIGHTBAR_WIRE_GRB || wire->format == LIGHTBAR_WIRE_GRBW) {
+        memset(p, 0, bytes);
+        return;
+    }
+    if (wire->format == LIGHTBAR_WIRE_WS2812_SPI4) {
+        memset(p, 0x88, bytes);
+        return;
+    }
+    const Led off = { 0, 0, 0 };
+    put_led(wire, p, off);
+    size_t filled = stride;
+    while (filled < bytes) {
+        size_t n = (filled < bytes - filled) ? filled : bytes - filled;
+        memcpy(p + filled, p, n);
+        filled += n;
+    }
+}
+
+static void put_frame(const LightbarWire *wire) {
+    if (wire->format != LIGHTBAR_WIRE_APA102) return;
+    size_t end = APA102_START_BYTES + lightbar_wire_stride(wire->format) * wire->num_leds;
+    memset(wire->data, 0x00, APA102_START_BYTES);
+    memset(wire->data + end, 0xFF, apa102_end_bytes(wire->num_leds));
+}
+
+void lightbar_wire_init(LightbarWire *wire, LightbarWireFormat format, uint16_t num_leds,
+                        uint8_t brightness, uint8_t *data) {
+    wire->format = format;
+    wire->num_leds = num_leds;
+    wire->brightness = brightness & 0x1F;
+    wire->data = data;
+    wire->valid = 0;
+    wire->from = 0;
+    wire->to = 0;
+}
+
+void lightbar_wire_set_brightness(LightbarWire *wire, uint8_t brightness) {
+    brightness &= 0x1F;
+    if (wire->brightness == brightness) return;
+    wire->brightness = brightness;
+    /* Every APA102 LED frame carries the brightness, dark ones included */
+    if (wire->format == LIGHTBAR_WIRE_APA102) wire->valid = 0;
+}
+
+void lightbar_wire_render(LightbarWire *wire, const LightbarState *state,
+                          const LightbarConfig *config) {
+    LightbarSpan span;
+    lightbar_span(state, config, &span);
+
+    if (!wire->valid) {
+        put_frame(wire);
+        put_dark(wire, 0, span.from);
+        put_dark(wire, span.to, wire->num_leds);
+    } else {
+        put_dark(wire, wire->from, wire->to);
+    }
+
+    size_t stride = lightbar_wire_stride(wire->format);
+    uint8_t *p = wire->data + header_bytes(wire->format) + (size_t)span.from * stride;
+    for (int i = span.from; i < span.to; i++, p += stride) {
+        put_led(wire, p, lightbar_span_led(&span, i));
+    }
+
+    wire->valid = 1;
+    wire->from = span.from;
+    wire->to = span.to;
+}
+
+static void put_pixels(LightbarWire *wires, const LightbarLayout *layout, int i, Led led) {
+    for (uint32_t k = layout->first[i]; k < layout->first[i + 1]; k++) {
+        const LightbarPixel *pixel = &layout->pixels[k];
+        LightbarWire *wire = &wires[pixel->channel];
+        size_t stride = lightbar_wire_stride(wire->format);
+        put_led(wire, wire->data + header_bytes(wire->format) + pixel->index * stride, led);
+    }
+}
+
+void lightbar_wire_render_layout(LightbarWire *wires, const LightbarLayout *layout,
+                                 const LightbarState *state, const LightbarConfig *config) {
+    const Led off = { 0, 0, 0 };
+    LightbarSpan span;
+    lightbar_span(state, config, &span);
+    if (span.to > layout->num_leds) span.to = layout->num_leds;
+    if (span.from > span.to) span.from = span.to;
+
+    /* Every channel is rendered together, so all valid ones share a window */
+    int from = 0, to = 0;
+    for (int c = 0; c < layout->num_channels; c++) {
+        LightbarWire *wire = &wires[c];
+        if (wire->valid) {
+            from = wire->from;
+            to = wire->to;
+        } else {
+            put_frame(wire);
+            put_dark(wire, 0, wire->num_leds);
+        }
+    }
+    for (int i = from; i < to; i++) put_pixels(wires, layout, i, off);
+    for (int i = span.from; i < span.to; i++) {
+        put_pixels(wires, layout, i, lightbar_span_led(&span, i));
+    }
+
+    for (int c = 0; c < layout->num_channels; c++) {
+        wires[c].valid = 1;
+        wires[c].from = span.from;
+        wires[c].to = span.to;
+    }
+}
+
+void lightbar_wire_pair_init(LightbarWirePair *pair, LightbarWireFormat format,
+                             uint16_t num_leds, uint8_t brightness,
+                             uint8_t *data0, uint8_t *data1) {
+    lightbar_wire_init(&pair->buffers[0], format, num_leds, brightness, data0);
+    lightbar_wire_init(&pair->buffers[1], format, num_leds, brightness, data1);
+    pair->front = 1;
+}
+
+void lightbar_wire_pair_set_brightness(LightbarWirePair *pair, uint8_t brightness) {
+    lightbar_wire_set_brightness(&pair->buffers[0], brightness);
+    lightbar_wire_set_brightness(&pair->buffers[1], brightness);
+}
+
+const uint8_t *lightbar_wire_pair_render(LightbarWirePair *pair, const LightbarState *state,
+                                         const LightbarConfig *config) {
+    int back = pair->front ^ 1;
+    lightbar_wire_render(&pair->buffers[back], state, config);
+    pair->front = back;
+    return pair->buffers[back].data;
+}
@@ -1,11 +1,73 @@
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lightbar_daemon.h"
+#include "lightbar_trace.h"
 #include "main.h"
 
-const char *hello_message(void) {
-    return "Hello, World!";
+static volatile sig_atomic_t quit;
+
+static void on_signal(int sig) {
+    (void)sig;
+    quit = 1;
+}
+
+int parse_options(int argc, char **argv, Options *options) {
+    options->socket_path = MAIN_DEFAULT_SOCKET;
+    options->workers = MAIN_DEFAULT_WORKERS;
+    options->stats_name = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) return -1;
+        if (strcmp(argv[i], "-s") == 0) {
+            options->socket_path = argv[++i];
+        } else if (strcmp(argv[i], "-w") == 0) {
+            char *end;
+            long workers = strtol(argv[++i], &end, 10);
+            if (*end || workers < 1 || workers > MAIN_MAX_WORKERS) return -1;
+            options->workers = (int)workers;
+        } else if (strcmp(argv[i], "-m") == 0) {
+            options->stats_name = argv[++i];
+            if (options->stats_name[0] != '/') return -1;
+        } else {
+            return -1;
+        }
+    }
+    return options->socket_path[0] ? 0 : -1;
 }
 
-int main(void) {
-    printf("%s\n", hello_message());
-    return 0;
+int main(int argc, char **argv) {
+    Options options;
+    if (parse_options(argc, argv, &options) != 0) {
+        fprintf(stderr, "usage: %s [-s socket] [-w workers] [-m stats_name]\n", argv[0]);
+        return 2;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    LightbarDaemon *server = lightbar_daemon_create(options.workers);
+    if (!server) {
+        fprintf(stderr, "cannot start %d workers\n", options.workers);
+        return 1;
+    }
+    if (options.stats_name &&
+        lightbar_daemon_publish_stats(server, options.stats_name, MAIN_STATS_SLOTS) != 0) {
+        perror(options.stats_name);
+        lightbar_daemon_destroy(server);
+        return 1;
+    }
+    printf("lightbar daemon: %d workers, control socket %s\n", options.workers, options.socket_path);
+    fflush(stdout);
+    int status = lightbar_daemon_serve(server, options.socket_path, &quit);
+    if (status != 0) perror(options.socket_path);
+    lightbar_daemon_destroy(server);
+#ifdef LIGHTBAR_TRACE
+    /* The workers are joined, so every ring is quiet */
+    const char *trace = getenv("LIGHTBAR_TRACE_FILE");
+    if (!trace) trace = "lightbar.trace";
+    if (lightbar_trace_dump(trace) != 0) perror(trace);
+#endif
+    return status != 0;
 }
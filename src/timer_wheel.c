@@ -0,0 +1,123 @@
+#include "timer_wheel.h"
+#include <stddef.h>
+
+#define MASK (TIMER_WHEEL_SLOTS - 1)
+
+static void list_init(TimerEntry *head) {
+    head->next = head;
+    head->prev = head;
+}
+
+static void list_append(TimerEntry *head, TimerEntry *entry) {
+    entry->prev = head->prev;
+    entry->next = head;
+    head->prev->next = entry;
+    head->prev = entry;
+}
+
+static void list_unlink(TimerEntry *entry) {
+    entry->prev->next = entry->next;
+    entry->next->prev = entry->prev;
+    entry->next = NULL;
+    entry->prev = NULL;
+}
+
+void timer_wheel_init(TimerWheel *wheel, uint64_t now) {
+    wheel->now = now;
+    wheel->count = 0;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (unsigned slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+            list_init(&wheel->slots[level][slot]);
+        }
+    }
+}
+
+/* Files entry by its distance from now: level L holds timers due within
+ * 256^(L+1) ticks, in the slot for bits [8L, 8L+8) of the expiry. Nothing
+ * is filed before earliest, the first slot still to be processed. */
+static void place(TimerWheel *wheel, TimerEntry *entry, uint64_t earliest) {
+    uint64_t expires = entry->expires;
+    if (expires < earliest) expires = earliest;
+    uint64_t delta = expires - wheel->now;
+
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+           delta >= (1ull << (TIMER_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    uint64_t max = 1ull << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS);
+    if (delta >= max) expires = wheel->now + max - 1;
+    unsigned slot = (unsigned)(expires >> (TIMER_WHEEL_BITS * level)) & MASK;
+    list_append(&wheel->slots[level][slot], entry);
+}
+
+void timer_wheel_add(TimerWheel *wheel, TimerEntry *entry, uint64_t expires) {
+    entry->expires = expires;
+    place(wheel, entry, wheel->now + 1);
+    wheel->count++;
+}
+
+void timer_wheel_remove(TimerWheel *wheel, TimerEntry *entry) {
+    if (!entry->next) return;
+    list_unlink(entry);
+    wheel->count--;
+}
+
+int timer_wheel_pending(const TimerEntry *entry) {
+    return entry->next != NULL;
+}
+
+/* Re-files every timer of one upper-level slot relative to the new now,
+ * which has not been processed yet. */
+static void cascade(TimerWheel *wheel, int level) {
+    unsigned slot = (unsigned)(wheel->now >> (TIMER_WHEEL_BITS * level)) & MASK;
+    TimerEntry *head = &wheel->slots[level][slot];
+    TimerEntry pending;
+    list_init(&pending);
+    if (head->next != head) {
+        pending.next = head->next;
+        pending.prev = head->prev;
+        pending.next->prev = &pending;
+        pending.prev->next = &pending;
+        list_init(head);
+    }
+    while (pending.next != &pending) {
+        TimerEntry *entry = pending.next;
+        list_unlink(entry);
+        place(wheel, entry, wheel->now);
+    }
+}
+
+void timer_wheel_advance(TimerWheel *wheel, uint64_t now, TimerFn fn, void *ctx) {
+    while (wheel->now < now) {
+        if (wheel->count == 0) {
+            wheel->now = now;
+            return;
+        }
+        wheel->now++;
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if ((wheel->now & ((1ull << (TIMER_WHEEL_BITS * level)) - 1)) != 0) break;
+            cascade(wheel, level);
+        }
+        TimerEntry *head = &wheel->slots[0][wheel->now & MASK];
+        while (head->next != head) {
+            TimerEntry *entry = head->next;
+            list_unlink(entry);
+            wheel->count--;
+            fn(entry, ctx);
+        }
+    }
+}
+
+uint64_t timer_wheel_next(const TimerWheel *wheel) {
+    if (wheel->count == 0) return UINT64_MAX;
+    unsigned base = (unsigned)(wheel->now & MASK);
+    for (unsigned d = 1; d < TIMER_WHEEL_SLOTS; d++) {
+        unsigned slot = (base + d) & MASK;
+        const TimerEntry *head = &wheel->slots[0][slot];
+        if (head->next != head) return d;
+        /* Level 0 wraps here: upper levels may cascade timers into it */
+        if (slot == 0) return d;
+    }
+    return TIMER_WHEEL_SLOTS - base;
+}
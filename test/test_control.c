@@ -0,0 +1,106 @@
+#include "unity.h"
+#include "control.h"
+#include <string.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_parse_add_with_settings(void) {
+    ControlCommand cmd;
+    TEST_ASSERT_EQUAL_INT(0, control_parse("add room1 leds=144 speed=12.5 pause=200 glow=3 "
+                                           "color=ff8040 smooth=1 rate=120 sink=/tmp/room1\n",
+                                           &cmd));
+    TEST_ASSERT_EQUAL_INT(CONTROL_ADD, cmd.op);
+    TEST_ASSERT_EQUAL_STRING("room1", cmd.name);
+    TEST_ASSERT_EQUAL_UINT(0xff, cmd.fields);
+    TEST_ASSERT_EQUAL_UINT16(144, cmd.config.num_leds);
+    TEST_ASSERT_EQUAL_FLOAT(12.5f, cmd.config.speed);
+    TEST_ASSERT_EQUAL_UINT16(200, cmd.config.end_pause_ms);
+    TEST_ASSERT_EQUAL_UINT16(3, cmd.config.glow_radius);
+    TEST_ASSERT_EQUAL_UINT8(0xff, cmd.config.color.r);
+    TEST_ASSERT_EQUAL_UINT8(0x80, cmd.config.color.g);
+    TEST_ASSERT_EQUAL_UINT8(0x40, cmd.config.color.b);
+    TEST_ASSERT_EQUAL_UINT8(1, cmd.config.smooth);
+    TEST_ASSERT_EQUAL_UINT32(120, cmd.rate_hz);
+    TEST_ASSERT_EQUAL_STRING("/tmp/room1", cmd.sink);
+}
+
+void test_parse_commands_without_settings(void) {
+    ControlCommand cmd;
+    TEST_ASSERT_EQUAL_INT(0, control_parse("start room1", &cmd));
+    TEST_ASSERT_EQUAL_INT(CONTROL_START, cmd.op);
+    TEST_ASSERT_EQUAL_INT(0, control_parse("  stop\troom1  ", &cmd));
+    TEST_ASSERT_EQUAL_INT(CONTROL_STOP, cmd.op);
+    TEST_ASSERT_EQUAL_STRING("room1", cmd.name);
+    TEST_ASSERT_EQUAL_INT(0, control_parse("stats", &cmd));
+    TEST_ASSERT_EQUAL_INT(CONTROL_STATS, cmd.op);
+    TEST_ASSERT_EQUAL_STRING("", cmd.name);
+    TEST_ASSERT_EQUAL_INT(0, control_parse("list\n", &cmd));
+    TEST_ASSERT_EQUAL_INT(CONTROL_LIST, cmd.op);
+}
+
+void test_parse_rejects_malformed(void) {
+    ControlCommand cmd;
+    TEST_ASSERT_EQUAL_INT(-1, control_parse("", &cmd));
+    TEST_ASSERT_EQUAL_INT(-1, control_parse("launch room1", &cmd));
+    TEST_ASSERT_EQUAL_INT(-1, control_parse("start", &cmd));
+    TEST_ASSERT_EQUAL_INT(-1, control_parse("add room1 leds", &cmd));
+    TEST_ASSERT_EQUAL_INT(-1, control_parse("add room1 =5", &cmd));
+    TEST_ASSERT_EQUAL_INT(-1, control_parse("add room1 hue=5", &cmd));
+    TEST_ASSERT_EQUAL_INT(-1, control_parse("add room1 leds=0", &cmd));
+    TEST_ASSERT_EQUAL_INT(-1, control_parse("add room1 leds=-3", &cmd));
+    TEST_ASSERT_EQUAL_INT(-1, control_parse("add room1 leds=70000", &cmd));
+    TEST_ASSERT_EQUAL_INT(-1, control_parse("add room1 speed=fast", &cmd));
+    TEST_ASSERT_EQUAL_INT(-1, control_parse("add room1 color=fff", &cmd));
+    TEST_ASSERT_EQUAL_INT(-1, control_parse("add room1 color=-fffff", &cmd));
+    TEST_ASSERT_EQUAL_INT(-1, control_parse("add room1 smooth=2", &cmd));
+    TEST_ASSERT_EQUAL_INT(-1, control_parse("add room1 rate=0", &cmd));
+    TEST_ASSERT_EQUAL_INT(-1, control_parse("list room1", &cmd));
+}
+
+void test_parse_rejects_name_too_long(void) {
+    ControlCommand cmd;
+    char line[64] = "start ";
+    memset(line + 6, 'x', CONTROL_NAME_MAX);
+    line[6 + CONTROL_NAME_MAX] = '\0';
+    TEST_ASSERT_EQUAL_INT(-1, control_parse(line, &cmd));
+    line[6 + CONTROL_NAME_MAX - 1] = '\0';
+    TEST_ASSERT_EQUAL_INT(0, control_parse(line, &cmd));
+}
+
+void test_settings_only_on_add_and_set(void) {
+    ControlCommand cmd;
+    TEST_ASSERT_EQUAL_INT(-1, control_parse("start room1 speed=5", &cmd));
+    TEST_ASSERT_EQUAL_INT(0, control_parse("set room1 speed=5", &cmd));
+    /* The strip length is fixed once a session exists */
+    TEST_ASSERT_EQUAL_INT(-1, control_parse("set room1 leds=10", &cmd));
+}
+
+void test_apply_copies_only_present_fields(void) {
+    ControlCommand cmd;
+    LightbarConfig config = {
+        .num_leds = 24, .speed = 10.0f, .end_pause_ms = 100,
+        .glow_radius = 2, .color = { 1, 2, 3 }
+    };
+    uint32_t rate_hz = 60;
+    TEST_ASSERT_EQUAL_INT(0, control_parse("set room1 speed=30 color=000010", &cmd));
+    control_apply(&cmd, &config, &rate_hz);
+    TEST_ASSERT_EQUAL_UINT16(24, config.num_leds);
+    TEST_ASSERT_EQUAL_FLOAT(30.0f, config.speed);
+    TEST_ASSERT_EQUAL_UINT16(100, config.end_pause_ms);
+    TEST_ASSERT_EQUAL_UINT16(2, config.glow_radius);
+    TEST_ASSERT_EQUAL_UINT8(0, config.color.r);
+    TEST_ASSERT_EQUAL_UINT8(0x10, config.color.b);
+    TEST_ASSERT_EQUAL_UINT32(60, rate_hz);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_add_with_settings);
+    RUN_TEST(test_parse_commands_without_settings);
+    RUN_TEST(test_parse_rejects_malformed);
+    RUN_TEST(test_parse_rejects_name_too_long);
+    RUN_TEST(test_settings_only_on_add_and_set);
+    RUN_TEST(test_apply_copies_only_present_fields);
+    return UNITY_END();
+}
@@ -1,5 +1,33 @@
 #include "unity.h"
 #include "lightbar.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Update-path tests run once against each implementation. */
+static void update_with_plan(LightbarState *state, const LightbarConfig *config, float dt_ms) {
+    LightbarPlan plan;
+    lightbar_plan_init(&plan, config);
+    lightbar_update_plan(state, &plan, dt_ms);
+}
+
+static void (*update)(LightbarState *, const LightbarConfig *, float) = lightbar_update;
+
+/* Render tests likewise run against lightbar_render(), the glow kernel and
+ * the compiled plan. */
+static void render_with_glow(const LightbarState *state, const LightbarConfig *config, Led *leds) {
+    LightbarGlow glow;
+    lightbar_glow_init(&glow, config);
+    lightbar_render_glow(state, config, &glow, leds);
+}
+
+static void render_with_plan(const LightbarState *state, const LightbarConfig *config, Led *leds) {
+    LightbarPlan plan;
+    lightbar_plan_init(&plan, config);
+    lightbar_render_plan(state, &plan, leds);
+}
+
+static void (*render)(const LightbarState *, const LightbarConfig *, Led *) = lightbar_render;
 
 void setUp(void) {}
 void tearDown(void) {}
@@ -174,7 +202,7 @@ void test_update_stopped_does_nothing(void) {
     LightbarState state;
     lightbar_init(&state, &config);
     int old_pos = state.position;
-    lightbar_update(&state, &config, 1000.0f);
+    update(&state, &config, 1000.0f);
     TEST_ASSERT_EQUAL_INT(old_pos, state.position);
     TEST_ASSERT_EQUAL_INT(LIGHTBAR_STOPPED, state.phase);
 }
@@ -189,7 +217,7 @@ void test_update_advances_position(void) {
     lightbar_start(&state);
     int start_pos = state.position;
     /* 10 LEDs/s => 100ms per step. Feed exactly 100ms. */
-    lightbar_update(&state, &config, 100.0f);
+    update(&state, &config, 100.0f);
     TEST_ASSERT_EQUAL_INT(start_pos + 1, state.position);
 }
 
@@ -202,9 +230,9 @@ void test_update_accumulates_partial_steps(void) {
     lightbar_init(&state, &config);
     lightbar_start(&state);
     int start_pos = state.position;
-    lightbar_update(&state, &config, 50.0f);
+    update(&state, &config, 50.0f);
     TEST_ASSERT_EQUAL_INT(start_pos, state.position);
-    lightbar_update(&state, &config, 50.0f);
+    update(&state, &config, 50.0f);
     TEST_ASSERT_EQUAL_INT(start_pos + 1, state.position);
 }
 
@@ -218,7 +246,7 @@ void test_update_multiple_steps_in_one_frame(void) {
     lightbar_start(&state);
     int start_pos = state.position;
     /* 300ms = 3 steps at 10 LEDs/s */
-    lightbar_update(&state, &config, 300.0f);
+    update(&state, &config, 300.0f);
     TEST_ASSERT_EQUAL_INT(start_pos + 3, state.position);
 }
 
@@ -232,7 +260,7 @@ void test_update_triggers_end_pause_at_right(void) {
     lightbar_start(&state);
     state.position = 22;
     /* One step moves to 23 (last LED) */
-    lightbar_update(&state, &config, 100.0f);
+    update(&state, &config, 100.0f);
     TEST_ASSERT_EQUAL_INT(23, state.position);
     TEST_ASSERT_EQUAL_INT(LIGHTBAR_PAUSED_END, state.phase);
     TEST_ASSERT_FLOAT_WITHIN(0.01f, 200.0f, state.pause_timer_ms);
@@ -248,7 +276,7 @@ void test_update_triggers_end_pause_at_left(void) {
     lightbar_start(&state);
     state.position = 1;
     state.direction = -1;
-    lightbar_update(&state, &config, 100.0f);
+    update(&state, &config, 100.0f);
     TEST_ASSERT_EQUAL_INT(0, state.position);
     TEST_ASSERT_EQUAL_INT(LIGHTBAR_PAUSED_END, state.phase);
 }
@@ -266,7 +294,7 @@ void test_end_pause_expires_and_reverses(void) {
     state.phase = LIGHTBAR_PAUSED_END;
     state.pause_timer_ms = 200.0f;
     /* Feed 200ms to expire the pause */
-    lightbar_update(&state, &config, 200.0f);
+    update(&state, &config, 200.0f);
     TEST_ASSERT_EQUAL_INT(LIGHTBAR_MOVING, state.phase);
     TEST_ASSERT_EQUAL_INT(-1, state.direction);
 }
@@ -283,7 +311,7 @@ void test_end_pause_partial_timer(void) {
     state.phase = LIGHTBAR_PAUSED_END;
     state.pause_timer_ms = 200.0f;
     /* Feed 100ms — still paused */
-    lightbar_update(&state, &config, 100.0f);
+    update(&state, &config, 100.0f);
     TEST_ASSERT_EQUAL_INT(LIGHTBAR_PAUSED_END, state.phase);
     TEST_ASSERT_FLOAT_WITHIN(0.01f, 100.0f, state.pause_timer_ms);
 }
@@ -299,7 +327,7 @@ void test_zero_end_pause_skips_pause(void) {
     state.position = 22;
     state.direction = 1;
     /* Step to 23 (end), should reverse without pausing */
-    lightbar_update(&state, &config, 100.0f);
+    update(&state, &config, 100.0f);
     TEST_ASSERT_EQUAL_INT(23, state.position);
     TEST_ASSERT_EQUAL_INT(LIGHTBAR_MOVING, state.phase);
     TEST_ASSERT_EQUAL_INT(-1, state.direction);
@@ -314,7 +342,7 @@ void test_render_single_led_no_glow(void) {
     lightbar_init(&state, &config);
     state.position = 5;
     Led leds[10];
-    lightbar_render(&state, &config, leds);
+    render(&state, &config, leds);
     TEST_ASSERT_EQUAL_UINT8(255, leds[5].r);
     TEST_ASSERT_EQUAL_UINT8(255, leds[5].g);
     TEST_ASSERT_EQUAL_UINT8(255, leds[5].b);
@@ -333,7 +361,7 @@ void test_render_glow_radius_2(void) {
     lightbar_init(&state, &config);
     state.position = 5;
     Led leds[10];
-    lightbar_render(&state, &config, leds);
+    render(&state, &config, leds);
     /* distance 0: 255 */
     TEST_ASSERT_EQUAL_UINT8(255, leds[5].r);
     /* distance 1: 255 * (1 - 1/3) = 170 */
@@ -356,7 +384,7 @@ void test_render_glow_at_left_edge(void) {
     lightbar_init(&state, &config);
     state.position = 0;
     Led leds[10];
-    lightbar_render(&state, &config, leds);
+    render(&state, &config, leds);
     TEST_ASSERT_EQUAL_UINT8(255, leds[0].r);
     TEST_ASSERT_EQUAL_UINT8(170, leds[1].r);
     TEST_ASSERT_EQUAL_UINT8(85, leds[2].r);
@@ -372,7 +400,7 @@ void test_render_glow_at_right_edge(void) {
     lightbar_init(&state, &config);
     state.position = 9;
     Led leds[10];
-    lightbar_render(&state, &config, leds);
+    render(&state, &config, leds);
     TEST_ASSERT_EQUAL_UINT8(255, leds[9].r);
     TEST_ASSERT_EQUAL_UINT8(170, leds[8].r);
     TEST_ASSERT_EQUAL_UINT8(85, leds[7].r);
@@ -388,7 +416,7 @@ void test_render_colored_dot(void) {
     lightbar_init(&state, &config);
     state.position = 5;
     Led leds[10];
-    lightbar_render(&state, &config, leds);
+    render(&state, &config, leds);
     TEST_ASSERT_EQUAL_UINT8(0, leds[5].r);
     TEST_ASSERT_EQUAL_UINT8(255, leds[5].g);
     TEST_ASSERT_EQUAL_UINT8(100, leds[5].b);
@@ -409,7 +437,7 @@ void test_stopping_continues_movement(void) {
     state.direction = 1;
     lightbar_stop(&state, &config);
     /* 10 LEDs/s => 100ms per step */
-    lightbar_update(&state, &config, 100.0f);
+    update(&state, &config, 100.0f);
     TEST_ASSERT_EQUAL_INT(16, state.position);
     TEST_ASSERT_EQUAL_INT(LIGHTBAR_STOPPING, state.phase);
 }
@@ -426,7 +454,7 @@ void test_stopping_decrements_edges_at_end(void) {
     lightbar_stop(&state, &config);
     TEST_ASSERT_EQUAL_UINT8(1, state.edges_remaining);
     /* 2 steps to left edge */
-    lightbar_update(&state, &config, 20.0f);
+    update(&state, &config, 20.0f);
     TEST_ASSERT_EQUAL_INT(0, state.position);
     TEST_ASSERT_EQUAL_UINT8(0, state.edges_remaining);
 }
@@ -442,15 +470,15 @@ void test_stopping_respects_end_pause(void) {
     state.direction = -1;
     lightbar_stop(&state, &config);
     /* 1 step to left edge */
-    lightbar_update(&state, &config, 10.0f);
+    update(&state, &config, 10.0f);
     TEST_ASSERT_EQUAL_INT(0, state.position);
     TEST_ASSERT_EQUAL_INT(LIGHTBAR_STOPPING, state.phase);
     /* Partial pause: direction not yet reversed */
-    lightbar_update(&state, &config, 25.0f);
+    update(&state, &config, 25.0f);
     TEST_ASSERT_EQUAL_INT(0, state.position);
     TEST_ASSERT_EQUAL_INT(-1, state.direction);
     /* Expire remaining pause: direction reverses */
-    lightbar_update(&state, &config, 25.0f);
+    update(&state, &config, 25.0f);
     TEST_ASSERT_EQUAL_INT(1, state.direction);
     TEST_ASSERT_EQUAL_INT(LIGHTBAR_STOPPING, state.phase);
 }
@@ -467,7 +495,7 @@ void test_stopping_finalizes_at_middle(void) {
     lightbar_stop(&state, &config);
     TEST_ASSERT_EQUAL_UINT8(0, state.edges_remaining);
     /* 2 steps: 3 -> 4 -> 5 (middle). Finalize. */
-    lightbar_update(&state, &config, 20.0f);
+    update(&state, &config, 20.0f);
     TEST_ASSERT_EQUAL_INT(5, state.position);
     TEST_ASSERT_EQUAL_INT(LIGHTBAR_STOPPED, state.phase);
     TEST_ASSERT_EQUAL_INT(1, state.direction);
@@ -499,7 +527,7 @@ void test_stopping_full_cycle(void) {
     TEST_ASSERT_EQUAL_INT(5, state.position);
 
     /* Move 2 steps right: 5 -> 7 */
-    lightbar_update(&state, &config, 20.0f);
+    update(&state, &config, 20.0f);
     TEST_ASSERT_EQUAL_INT(7, state.position);
 
     /* Stop: going right, pos >= middle => edges_remaining = 2 */
@@ -508,25 +536,25 @@ void test_stopping_full_cycle(void) {
     TEST_ASSERT_EQUAL_UINT8(2, state.edges_remaining);
 
     /* Move 2 steps to right edge (9), edges 2->1 */
-    lightbar_update(&state, &config, 20.0f);
+    update(&state, &config, 20.0f);
     TEST_ASSERT_EQUAL_INT(9, state.position);
     TEST_ASSERT_EQUAL_UINT8(1, state.edges_remaining);
 
     /* Expire end pause */
-    lightbar_update(&state, &config, 50.0f);
+    update(&state, &config, 50.0f);
     TEST_ASSERT_EQUAL_INT(-1, state.direction);
 
     /* Move 9 steps left to left edge (0), edges 1->0 */
-    lightbar_update(&state, &config, 90.0f);
+    update(&state, &config, 90.0f);
     TEST_ASSERT_EQUAL_INT(0, state.position);
     TEST_ASSERT_EQUAL_UINT8(0, state.edges_remaining);
 
     /* Expire end pause */
-    lightbar_update(&state, &config, 50.0f);
+    update(&state, &config, 50.0f);
     TEST_ASSERT_EQUAL_INT(1, state.direction);
 
     /* Move 5 steps right to middle (5) => finalize */
-    lightbar_update(&state, &config, 50.0f);
+    update(&state, &config, 50.0f);
     TEST_ASSERT_EQUAL_INT(5, state.position);
     TEST_ASSERT_EQUAL_INT(LIGHTBAR_STOPPED, state.phase);
     TEST_ASSERT_EQUAL_INT(1, state.direction);
@@ -545,26 +573,975 @@ void test_full_oscillation_cycle(void) {
     TEST_ASSERT_EQUAL_INT(5, state.position);
 
     /* 100 LEDs/s => 10ms per step. Move 4 steps to reach position 9 */
-    lightbar_update(&state, &config, 40.0f);
+    update(&state, &config, 40.0f);
     TEST_ASSERT_EQUAL_INT(9, state.position);
     TEST_ASSERT_EQUAL_INT(LIGHTBAR_PAUSED_END, state.phase);
 
     /* Expire end pause (50ms) */
-    lightbar_update(&state, &config, 50.0f);
+    update(&state, &config, 50.0f);
     TEST_ASSERT_EQUAL_INT(LIGHTBAR_MOVING, state.phase);
     TEST_ASSERT_EQUAL_INT(-1, state.direction);
 
     /* Move 9 steps left to reach position 0 (passes through middle) */
-    lightbar_update(&state, &config, 90.0f);
+    update(&state, &config, 90.0f);
     TEST_ASSERT_EQUAL_INT(0, state.position);
     TEST_ASSERT_EQUAL_INT(LIGHTBAR_PAUSED_END, state.phase);
 
     /* Expire end pause, direction reverses to +1 */
-    lightbar_update(&state, &config, 50.0f);
+    update(&state, &config, 50.0f);
     TEST_ASSERT_EQUAL_INT(LIGHTBAR_MOVING, state.phase);
     TEST_ASSERT_EQUAL_INT(1, state.direction);
 }
 
+void test_advance_large_dt_crosses_several_edges(void) {
+    LightbarConfig config = {
+        .num_leds = 10, .speed = 100.0f, .end_pause_ms = 50
+    };
+    LightbarState state;
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    /* 40ms to right edge, 50ms pause, 90ms to left edge, 50ms pause,
+     * then 30ms more => position 3 moving right. */
+    lightbar_advance(&state, &config, 260.0f);
+    TEST_ASSERT_EQUAL_INT(3, state.position);
+    TEST_ASSERT_EQUAL_INT(1, state.direction);
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_MOVING, state.phase);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, state.move_accum_ms);
+}
+
+void test_advance_carries_time_into_pause(void) {
+    LightbarConfig config = {
+        .num_leds = 10, .speed = 100.0f, .end_pause_ms = 50
+    };
+    LightbarState state;
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    /* 40ms reaches the right edge; the extra 15ms is spent pausing */
+    lightbar_advance(&state, &config, 55.0f);
+    TEST_ASSERT_EQUAL_INT(9, state.position);
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_PAUSED_END, state.phase);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 35.0f, state.pause_timer_ms);
+}
+
+void test_advance_skips_whole_periods(void) {
+    LightbarConfig config = {
+        .num_leds = 10, .speed = 100.0f, .end_pause_ms = 50
+    };
+    LightbarState state;
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    /* One period is 2 * (9 * 10ms + 50ms) = 280ms. */
+    lightbar_advance(&state, &config, 40.0f + 1000.0f * 280.0f + 25.0f);
+    TEST_ASSERT_EQUAL_INT(9, state.position);
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_PAUSED_END, state.phase);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 25.0f, state.pause_timer_ms);
+}
+
+void test_advance_completes_wind_down_in_one_call(void) {
+    LightbarConfig config = {
+        .num_leds = 10, .speed = 100.0f, .end_pause_ms = 50
+    };
+    LightbarState state;
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    state.position = 7;
+    lightbar_stop(&state, &config);
+    TEST_ASSERT_EQUAL_UINT8(2, state.edges_remaining);
+    lightbar_advance(&state, &config, 10000.0f);
+    TEST_ASSERT_EQUAL_INT(5, state.position);
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_STOPPED, state.phase);
+    TEST_ASSERT_EQUAL_INT(1, state.direction);
+    TEST_ASSERT_EQUAL_UINT8(0, state.edges_remaining);
+}
+
+/* The original once-per-LED-step update, kept as the reference for the
+ * closed-form one. */
+static void reference_update(LightbarState *state, const LightbarConfig *config, float dt_ms) {
+    int last = config->num_leds - 1;
+    int stopping = (state->phase == LIGHTBAR_STOPPING);
+    if (state->phase == LIGHTBAR_STOPPED) return;
+    if (state->phase == LIGHTBAR_PAUSED_END || (stopping && state->pause_timer_ms > 0.0f)) {
+        state->pause_timer_ms -= dt_ms;
+        if (state->pause_timer_ms <= 0.0f) {
+            state->direction = -state->direction;
+            if (!stopping) state->phase = LIGHTBAR_MOVING;
+            state->pause_timer_ms = 0.0f;
+            state->move_accum_ms = 0.0f;
+        }
+        return;
+    }
+    if (config->speed <= 0.0f) return;
+    float ms_per_step = 1000.0f / config->speed;
+    state->move_accum_ms += dt_ms;
+    while (state->move_accum_ms >= ms_per_step) {
+        state->move_accum_ms -= ms_per_step;
+        state->position += state->direction;
+        if (state->position <= 0 || state->position >= last) {
+            if (state->position <= 0) state->position = 0;
+            if (state->position >= last) state->position = last;
+            if (stopping && state->edges_remaining > 0) state->edges_remaining--;
+            if (config->end_pause_ms > 0) {
+                if (!stopping) state->phase = LIGHTBAR_PAUSED_END;
+                state->pause_timer_ms = (float)config->end_pause_ms;
+                state->move_accum_ms = 0.0f;
+                return;
+            }
+            state->direction = -state->direction;
+        }
+        if (stopping && state->position == config->num_leds / 2 &&
+            state->edges_remaining == 0) {
+            state->phase = LIGHTBAR_STOPPED;
+            state->direction = 1;
+            state->pause_timer_ms = 0.0f;
+            state->move_accum_ms = 0.0f;
+            return;
+        }
+    }
+}
+
+/* Every frame, from whatever state the last one left, lands where the step
+ * loop does: small and fractional frames, stalls many legs long, pauses and
+ * wind-downs, on strips down to a single LED. */
+void test_update_matches_step_loop(void) {
+    static const uint16_t sizes[] = { 1, 2, 3, 13, 144 };
+    static const float speeds[] = { 0.0f, 7.0f, 15.0f, 45.0f, 125.0f, 500.0f, 3000.0f };
+    static const float dts[] = { 0.25f, 1.0f, 3.7f, 16.667f, 33.0f, 100.0f, 999.5f,
+                                 5000.0f, 20000.0f };
+    for (size_t n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+        for (size_t v = 0; v < sizeof(speeds) / sizeof(speeds[0]); v++) {
+            for (int pause = 0; pause <= 30; pause += 30) {
+                LightbarConfig config = {
+                    .num_leds = sizes[n], .speed = speeds[v], .end_pause_ms = (uint16_t)pause
+                };
+                LightbarState closed, stepped;
+                lightbar_init(&closed, &config);
+                lightbar_start(&closed);
+                for (int frame = 0; frame < 400; frame++) {
+                    if (frame % 100 == 60) lightbar_stop(&closed, &config);
+                    if (closed.phase == LIGHTBAR_STOPPED) lightbar_start(&closed);
+                    stepped = closed;
+                    float dt = dts[(frame * 7 + n) % (sizeof(dts) / sizeof(dts[0]))];
+                    lightbar_update(&closed, &config, dt);
+                    reference_update(&stepped, &config, dt);
+                    /* Each of the loop's float subtractions can round by half
+                     * an ulp. Where that adds up to a sizeable part of a step,
+                     * or the frame ends that close to a step, the loop's own
+                     * count is off by one and there is nothing to compare. */
+                    float step = config.speed > 0.0f ? 1000.0f / config.speed : 0.0f;
+                    float drift = 0.0f;
+                    if (step > 0.0f) {
+                        drift = (dt / step + 1.0f) * (dt + step) * 6.0e-8f;
+                        if (drift * 4.0f > step) continue;
+                        if (stepped.move_accum_ms > step - drift ||
+                            closed.move_accum_ms > step - drift) {
+                            continue;
+                        }
+                    }
+                    TEST_ASSERT_EQUAL_INT(stepped.position, closed.position);
+                    TEST_ASSERT_EQUAL_INT(stepped.direction, closed.direction);
+                    TEST_ASSERT_EQUAL_INT(stepped.phase, closed.phase);
+                    TEST_ASSERT_EQUAL_UINT8(stepped.edges_remaining, closed.edges_remaining);
+                    TEST_ASSERT_FLOAT_WITHIN(0.01f, stepped.pause_timer_ms,
+                                             closed.pause_timer_ms);
+                    TEST_ASSERT_FLOAT_WITHIN(0.01f + drift, stepped.move_accum_ms,
+                                             closed.move_accum_ms);
+                }
+            }
+        }
+    }
+}
+
+void test_advance_matches_small_steps(void) {
+    /* 1ms frames land exactly on every step and pause boundary, so
+     * lightbar_update() never drops time and both paths must agree. */
+    LightbarConfig config = {
+        .num_leds = 13, .speed = 125.0f, .end_pause_ms = 30
+    };
+    LightbarState stepped, advanced;
+    lightbar_init(&stepped, &config);
+    lightbar_init(&advanced, &config);
+    lightbar_start(&stepped);
+    lightbar_start(&advanced);
+    const float chunks[] = { 1.0f, 7.0f, 23.0f, 64.0f, 3.0f, 211.0f, 40.0f };
+    for (int round = 0; round < 40; round++) {
+        int ms = (int)chunks[round % 7];
+        for (int i = 0; i < ms; i++) {
+            lightbar_update(&stepped, &config, 1.0f);
+        }
+        lightbar_advance(&advanced, &config, (float)ms);
+        if (round == 25) {
+            lightbar_stop(&stepped, &config);
+            lightbar_stop(&advanced, &config);
+        }
+        TEST_ASSERT_EQUAL_INT(stepped.position, advanced.position);
+        TEST_ASSERT_EQUAL_INT(stepped.direction, advanced.direction);
+        TEST_ASSERT_EQUAL_INT(stepped.phase, advanced.phase);
+        TEST_ASSERT_EQUAL_UINT8(stepped.edges_remaining, advanced.edges_remaining);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, stepped.pause_timer_ms, advanced.pause_timer_ms);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, stepped.move_accum_ms, advanced.move_accum_ms);
+    }
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_STOPPED, advanced.phase);
+}
+
+void test_advance_two_led_strip_keeps_oscillating_while_stopping(void) {
+    LightbarConfig config = {
+        .num_leds = 2, .speed = 100.0f, .end_pause_ms = 10
+    };
+    LightbarState state;
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    lightbar_stop(&state, &config);
+    lightbar_advance(&state, &config, 1.0e6f);
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_STOPPING, state.phase);
+    TEST_ASSERT_TRUE(state.position == 0 || state.position == 1);
+}
+
+void test_time_to_event_follows_edges_pauses_and_stop(void) {
+    LightbarConfig config = {
+        .num_leds = 10, .speed = 100.0f, .end_pause_ms = 50
+    };
+    LightbarState state;
+    lightbar_init(&state, &config);
+    TEST_ASSERT_TRUE(lightbar_time_to_event(&state, &config) < 0.0f);
+    lightbar_start(&state);
+    lightbar_advance(&state, &config, 15.0f);
+    /* 4 steps from 5 to the right edge, 5ms of the first already spent */
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 25.0f, lightbar_time_to_event(&state, &config));
+    lightbar_advance(&state, &config, 25.0f);
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_PAUSED_END, state.phase);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 50.0f, lightbar_time_to_event(&state, &config));
+    lightbar_advance(&state, &config, 50.0f);
+    lightbar_stop(&state, &config);
+    /* Heading left with one edge to visit before the middle */
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 90.0f, lightbar_time_to_event(&state, &config));
+    lightbar_advance(&state, &config, 120.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 20.0f, lightbar_time_to_event(&state, &config));
+    lightbar_advance(&state, &config, 20.0f);
+    /* Five steps back to the middle */
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 50.0f, lightbar_time_to_event(&state, &config));
+    config.speed = 0.0f;
+    TEST_ASSERT_TRUE(lightbar_time_to_event(&state, &config) < 0.0f);
+}
+
+/* Advancing by exactly the time to the event reaches it, whatever the
+ * float accumulator rounds to on the way */
+void test_advancing_by_time_to_event_reaches_it(void) {
+    LightbarEvent fired[8];
+    LightbarEventBuffer events = { fired, 8, 0, 0 };
+    srand(23);
+    for (int k = 0; k < 50; k++) {
+        LightbarConfig config = { .num_leds = (uint16_t)(3 + rand() % 300),
+                                  .speed = 0.5f + (float)(rand() % 100000) / 37.0f,
+                                  .end_pause_ms = (uint16_t)(rand() % 3) };
+        LightbarState state;
+        lightbar_init(&state, &config);
+        lightbar_start(&state);
+        for (int i = 0; i < 200; i++) {
+            lightbar_advance(&state, &config, (float)(rand() % 100000) / 977.0f);
+            float rest = lightbar_time_to_event(&state, &config);
+            TEST_ASSERT_TRUE(rest >= 0.0f);
+            lightbar_advance_events(&state, &config, rest, &events);
+            TEST_ASSERT_TRUE(events.count > 0);
+        }
+    }
+}
+
+static void expect_event(const LightbarEvent *e, LightbarEventType type, int position,
+                         int direction, float offset_ms) {
+    TEST_ASSERT_EQUAL_INT(type, e->type);
+    TEST_ASSERT_EQUAL_INT(position, e->position);
+    TEST_ASSERT_EQUAL_INT(direction, e->direction);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, offset_ms, e->offset_ms);
+}
+
+void test_advance_events_report_every_event_with_its_offset(void) {
+    LightbarConfig config = {
+        .num_leds = 10, .speed = 100.0f, .end_pause_ms = 50
+    };
+    LightbarState state;
+    LightbarEvent storage[8];
+    LightbarEventBuffer events = { storage, 8, 0, 0 };
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    lightbar_advance(&state, &config, 15.0f);
+    lightbar_advance_events(&state, &config, 260.0f, &events);
+    TEST_ASSERT_EQUAL_INT(5, events.count);
+    TEST_ASSERT_EQUAL_INT(0, events.overflow);
+    expect_event(&storage[0], LIGHTBAR_EVENT_EDGE_REACHED, 9, 1, 25.0f);
+    expect_event(&storage[1], LIGHTBAR_EVENT_PAUSE_END, 9, -1, 75.0f);
+    expect_event(&storage[2], LIGHTBAR_EVENT_MIDDLE_CROSSED, 5, -1, 115.0f);
+    expect_event(&storage[3], LIGHTBAR_EVENT_EDGE_REACHED, 0, -1, 165.0f);
+    expect_event(&storage[4], LIGHTBAR_EVENT_PAUSE_END, 0, 1, 215.0f);
+    TEST_ASSERT_EQUAL_INT(4, state.position);
+
+    /* 5 ms into the step to 4; the middle is one step further */
+    lightbar_advance_events(&state, &config, 15.0f, &events);
+    TEST_ASSERT_EQUAL_INT(1, events.count);
+    expect_event(&storage[0], LIGHTBAR_EVENT_MIDDLE_CROSSED, 5, 1, 5.0f);
+    lightbar_advance_events(&state, &config, 1.0f, &events);
+    TEST_ASSERT_EQUAL_INT(0, events.count);
+}
+
+void test_advance_events_report_wind_down(void) {
+    LightbarConfig config = {
+        .num_leds = 10, .speed = 100.0f, .end_pause_ms = 50
+    };
+    LightbarState state;
+    LightbarEvent storage[8];
+    LightbarEventBuffer events = { storage, 8, 0, 0 };
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    state.position = 7;
+    lightbar_stop(&state, &config);
+    lightbar_advance_events(&state, &config, 10000.0f, &events);
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_STOPPED, state.phase);
+    TEST_ASSERT_EQUAL_INT(7, events.count);
+    expect_event(&storage[0], LIGHTBAR_EVENT_EDGE_REACHED, 9, 1, 20.0f);
+    expect_event(&storage[1], LIGHTBAR_EVENT_PAUSE_END, 9, -1, 70.0f);
+    expect_event(&storage[2], LIGHTBAR_EVENT_MIDDLE_CROSSED, 5, -1, 110.0f);
+    expect_event(&storage[3], LIGHTBAR_EVENT_EDGE_REACHED, 0, -1, 160.0f);
+    expect_event(&storage[4], LIGHTBAR_EVENT_PAUSE_END, 0, 1, 210.0f);
+    expect_event(&storage[5], LIGHTBAR_EVENT_MIDDLE_CROSSED, 5, 1, 260.0f);
+    expect_event(&storage[6], LIGHTBAR_EVENT_STOPPED, 5, 1, 260.0f);
+}
+
+void test_advance_events_overflow_keeps_state_exact(void) {
+    LightbarConfig config = {
+        .num_leds = 10, .speed = 100.0f, .end_pause_ms = 50
+    };
+    LightbarState a, b;
+    LightbarEvent storage[3];
+    LightbarEventBuffer events = { storage, 3, 0, 0 };
+    lightbar_init(&a, &config);
+    lightbar_start(&a);
+    b = a;
+    lightbar_advance(&a, &config, 1.0e6f + 65.0f);
+    lightbar_advance_events(&b, &config, 1.0e6f + 65.0f, &events);
+    TEST_ASSERT_EQUAL_INT(3, events.count);
+    TEST_ASSERT_EQUAL_INT(1, events.overflow);
+    TEST_ASSERT_EQUAL_INT(a.position, b.position);
+    TEST_ASSERT_EQUAL_INT(a.direction, b.direction);
+    TEST_ASSERT_EQUAL_INT(a.phase, b.phase);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, a.pause_timer_ms, b.pause_timer_ms);
+}
+
+void test_advance_events_do_not_depend_on_frame_size(void) {
+    /* Event times on one timeline must agree whether the interval is
+     * handed over in one piece or as irregular frames. */
+    LightbarConfig config = {
+        .num_leds = 17, .speed = 33.0f, .end_pause_ms = 40
+    };
+    LightbarState whole, framed;
+    LightbarEvent big[64], small[8];
+    LightbarEventBuffer all = { big, 64, 0, 0 };
+    LightbarEventBuffer some = { small, 8, 0, 0 };
+    lightbar_init(&whole, &config);
+    lightbar_start(&whole);
+    framed = whole;
+    lightbar_advance_events(&whole, &config, 3000.0f, &all);
+    TEST_ASSERT_EQUAL_INT(0, all.overflow);
+
+    int seen = 0;
+    float clock = 0.0f;
+    srand(7);
+    while (clock < 3000.0f) {
+        float dt = (float)(1 + rand() % 40);
+        if (clock + dt > 3000.0f) dt = 3000.0f - clock;
+        lightbar_advance_events(&framed, &config, dt, &some);
+        for (int i = 0; i < some.count; i++, seen++) {
+            TEST_ASSERT_EQUAL_INT(big[seen].type, small[i].type);
+            TEST_ASSERT_EQUAL_INT(big[seen].position, small[i].position);
+            TEST_ASSERT_FLOAT_WITHIN(0.01f, big[seen].offset_ms, clock + small[i].offset_ms);
+        }
+        clock += dt;
+    }
+    TEST_ASSERT_EQUAL_INT(all.count, seen);
+}
+
+void test_render_delta_first_call_renders_whole_strip(void) {
+    LightbarConfig config = { .num_leds = 10, .glow_radius = 1, .color = { 255, 0, 0 } };
+    LightbarState state;
+    LightbarDelta delta;
+    Led leds[10];
+    int from, to;
+    lightbar_init(&state, &config);
+    lightbar_delta_reset(&delta);
+    memset(leds, 0xAA, sizeof(leds));
+    TEST_ASSERT_EQUAL_INT(1, lightbar_render_delta(&delta, &state, &config, leds, &from, &to));
+    TEST_ASSERT_EQUAL_INT(0, from);
+    TEST_ASSERT_EQUAL_INT(10, to);
+    TEST_ASSERT_EQUAL_UINT8(0, leds[0].r);
+    TEST_ASSERT_EQUAL_UINT8(255, leds[5].r);
+}
+
+void test_render_delta_reports_no_change(void) {
+    LightbarConfig config = { .num_leds = 10, .glow_radius = 1, .color = { 255, 0, 0 } };
+    LightbarState state;
+    LightbarDelta delta;
+    Led leds[10];
+    int from, to;
+    lightbar_init(&state, &config);
+    lightbar_delta_reset(&delta);
+    lightbar_render_delta(&delta, &state, &config, leds, &from, &to);
+    TEST_ASSERT_EQUAL_INT(0, lightbar_render_delta(&delta, &state, &config, leds, &from, &to));
+    TEST_ASSERT_EQUAL_INT(from, to);
+}
+
+void test_render_delta_one_step_dirties_old_and_new_window(void) {
+    LightbarConfig config = { .num_leds = 10, .glow_radius = 1, .color = { 255, 0, 0 } };
+    LightbarState state;
+    LightbarDelta delta;
+    Led leds[10];
+    int from, to;
+    lightbar_init(&state, &config);
+    lightbar_delta_reset(&delta);
+    lightbar_render_delta(&delta, &state, &config, leds, &from, &to);
+    state.position = 6;
+    TEST_ASSERT_EQUAL_INT(1, lightbar_render_delta(&delta, &state, &config, leds, &from, &to));
+    TEST_ASSERT_EQUAL_INT(4, from);
+    TEST_ASSERT_EQUAL_INT(8, to);
+    TEST_ASSERT_EQUAL_UINT8(0, leds[4].r);
+    TEST_ASSERT_EQUAL_UINT8(127, leds[5].r);
+    TEST_ASSERT_EQUAL_UINT8(255, leds[6].r);
+}
+
+void test_render_delta_color_change_dirties_window(void) {
+    LightbarConfig config = { .num_leds = 10, .glow_radius = 2, .color = { 255, 0, 0 } };
+    LightbarState state;
+    LightbarDelta delta;
+    Led leds[10];
+    int from, to;
+    lightbar_init(&state, &config);
+    lightbar_delta_reset(&delta);
+    lightbar_render_delta(&delta, &state, &config, leds, &from, &to);
+    config.color.g = 255;
+    TEST_ASSERT_EQUAL_INT(1, lightbar_render_delta(&delta, &state, &config, leds, &from, &to));
+    TEST_ASSERT_EQUAL_INT(3, from);
+    TEST_ASSERT_EQUAL_INT(8, to);
+    TEST_ASSERT_EQUAL_UINT8(255, leds[5].g);
+}
+
+void test_render_delta_matches_full_render(void) {
+    LightbarConfig config = { .num_leds = 40, .glow_radius = 3, .color = { 200, 100, 50 } };
+    LightbarState state;
+    LightbarDelta delta;
+    Led expected[40], actual[40];
+    int from, to;
+    lightbar_init(&state, &config);
+    lightbar_delta_reset(&delta);
+    srand(7);
+    for (int frame = 0; frame < 1000; frame++) {
+        state.position += rand() % 5 - 2;
+        if (state.position < -5) state.position = -5;
+        if (state.position > 45) state.position = 45;
+        if (rand() % 50 == 0) config.glow_radius = (uint8_t)(rand() % 6);
+        if (rand() % 50 == 0) config.color.b = (uint8_t)rand();
+        lightbar_render_delta(&delta, &state, &config, actual, &from, &to);
+        lightbar_render(&state, &config, expected);
+        TEST_ASSERT_EQUAL_MEMORY(expected, actual, sizeof(expected));
+    }
+}
+
+void test_init_large_strip(void) {
+    LightbarConfig config = { .num_leds = 10000 };
+    LightbarState state;
+    lightbar_init(&state, &config);
+    TEST_ASSERT_EQUAL_INT(5000, state.position);
+}
+
+void test_render_large_strip_lights_only_window(void) {
+    static Led leds[10000];
+    LightbarConfig config = {
+        .num_leds = 10000, .glow_radius = 300,
+        .color = { 255, 255, 255 }
+    };
+    LightbarState state;
+    lightbar_init(&state, &config);
+    state.position = 9000;
+    memset(leds, 0xAA, sizeof(leds));
+    lightbar_render(&state, &config, leds);
+    TEST_ASSERT_EQUAL_UINT8(0, leds[0].r);
+    TEST_ASSERT_EQUAL_UINT8(0, leds[8699].r);
+    TEST_ASSERT_EQUAL_UINT8(0, leds[8700].r);
+    TEST_ASSERT_EQUAL_UINT8(127, leds[8850].r);
+    TEST_ASSERT_EQUAL_UINT8(255, leds[9000].r);
+    TEST_ASSERT_EQUAL_UINT8(0, leds[9301].r);
+    TEST_ASSERT_EQUAL_UINT8(0, leds[9999].r);
+}
+
+void test_render_smooth_splits_dot_by_progress(void) {
+    LightbarConfig config = {
+        .num_leds = 10, .speed = 10.0f, .glow_radius = 0,
+        .color = { 255, 255, 255 }, .smooth = 1
+    };
+    LightbarState state;
+    Led leds[10];
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    /* 100ms per step: 75ms is three quarters of the way to LED 6 */
+    update(&state, &config, 75.0f);
+    render(&state, &config, leds);
+    TEST_ASSERT_EQUAL_UINT8(63, leds[5].r);
+    TEST_ASSERT_EQUAL_UINT8(191, leds[6].r);
+    TEST_ASSERT_EQUAL_UINT8(0, leds[4].r);
+    TEST_ASSERT_EQUAL_UINT8(0, leds[7].r);
+}
+
+void test_render_smooth_follows_direction(void) {
+    LightbarConfig config = {
+        .num_leds = 10, .speed = 10.0f, .glow_radius = 0,
+        .color = { 255, 255, 255 }, .smooth = 1
+    };
+    LightbarState state;
+    Led leds[10];
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    state.direction = -1;
+    state.move_accum_ms = 50.0f;
+    render(&state, &config, leds);
+    TEST_ASSERT_EQUAL_UINT8(127, leds[5].r);
+    TEST_ASSERT_EQUAL_UINT8(127, leds[4].r);
+    TEST_ASSERT_EQUAL_UINT8(0, leds[6].r);
+}
+
+void test_render_smooth_is_whole_led_when_not_travelling(void) {
+    LightbarConfig config = {
+        .num_leds = 10, .speed = 10.0f, .end_pause_ms = 200, .glow_radius = 2,
+        .color = { 255, 255, 255 }, .smooth = 1
+    };
+    LightbarConfig plain = config;
+    LightbarState state;
+    Led expected[10], actual[10];
+    plain.smooth = 0;
+    lightbar_init(&state, &config);
+    state.move_accum_ms = 50.0f;
+    /* Stopped */
+    render(&state, &config, actual);
+    lightbar_render(&state, &plain, expected);
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, sizeof(expected));
+    /* Paused at an end */
+    state.phase = LIGHTBAR_PAUSED_END;
+    state.position = 9;
+    state.pause_timer_ms = 100.0f;
+    render(&state, &config, actual);
+    lightbar_render(&state, &plain, expected);
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, sizeof(expected));
+}
+
+void test_render_delta_smooth_matches_full_render(void) {
+    LightbarConfig config = {
+        .num_leds = 30, .speed = 40.0f, .end_pause_ms = 60, .glow_radius = 2,
+        .color = { 200, 100, 50 }, .smooth = 1
+    };
+    LightbarState state;
+    LightbarDelta delta;
+    Led expected[30], actual[30];
+    int from, to;
+    lightbar_init(&state, &config);
+    lightbar_delta_reset(&delta);
+    lightbar_start(&state);
+    for (int frame = 0; frame < 500; frame++) {
+        lightbar_update(&state, &config, 7.3f);
+        lightbar_render_delta(&delta, &state, &config, actual, &from, &to);
+        lightbar_render(&state, &config, expected);
+        TEST_ASSERT_EQUAL_MEMORY(expected, actual, sizeof(expected));
+    }
+}
+
+/* The original per-LED formula, kept as the reference for the fast paths. */
+static void reference_render(const LightbarState *state, const LightbarConfig *config, Led *leds) {
+    for (int i = 0; i < config->num_leds; i++) {
+        int distance = abs(i - state->position);
+        if (distance == 0) {
+            leds[i] = config->color;
+        } else if (config->glow_radius > 0 && distance <= config->glow_radius) {
+            int divisor = config->glow_radius + 1;
+            int factor = divisor - distance;
+            leds[i].r = (uint8_t)(config->color.r * factor / divisor);
+            leds[i].g = (uint8_t)(config->color.g * factor / divisor);
+            leds[i].b = (uint8_t)(config->color.b * factor / divisor);
+        } else {
+            leds[i].r = 0;
+            leds[i].g = 0;
+            leds[i].b = 0;
+        }
+    }
+}
+
+void test_render_matches_reference_formula(void) {
+    Led expected[256], actual[256];
+    LightbarGlow glow;
+    srand(42);
+    for (int trial = 0; trial < 500; trial++) {
+        LightbarConfig config = {
+            .num_leds = (uint8_t)(1 + rand() % 255),
+            .glow_radius = (uint8_t)(rand() % 40),
+            .color = { (uint8_t)rand(), (uint8_t)rand(), (uint8_t)rand() }
+        };
+        LightbarState state;
+        lightbar_init(&state, &config);
+        state.position = rand() % (config.num_leds + 60) - 30;
+        reference_render(&state, &config, expected);
+
+        memset(actual, 0xAA, sizeof(actual));
+        lightbar_render(&state, &config, actual);
+        TEST_ASSERT_EQUAL_MEMORY(expected, actual, config.num_leds * sizeof(Led));
+        /* Nothing written past the strip */
+        TEST_ASSERT_EQUAL_HEX8(0xAA, actual[config.num_leds].r);
+
+        memset(actual, 0xAA, sizeof(actual));
+        lightbar_glow_init(&glow, &config);
+        lightbar_render_glow(&state, &config, &glow, actual);
+        TEST_ASSERT_EQUAL_MEMORY(expected, actual, config.num_leds * sizeof(Led));
+    }
+}
+
+void test_glow_sync_rebuilds_only_on_change(void) {
+    LightbarConfig config = { .num_leds = 10, .glow_radius = 2, .color = { 255, 255, 255 } };
+    LightbarGlow glow;
+    lightbar_glow_init(&glow, &config);
+    TEST_ASSERT_EQUAL_INT(0, lightbar_glow_sync(&glow, &config));
+    config.color.g = 0;
+    TEST_ASSERT_EQUAL_INT(1, lightbar_glow_sync(&glow, &config));
+    TEST_ASSERT_EQUAL_UINT8(0, glow.window[2].g);
+    config.glow_radius = 1;
+    TEST_ASSERT_EQUAL_INT(1, lightbar_glow_sync(&glow, &config));
+    TEST_ASSERT_EQUAL_UINT8(127, glow.window[0].r);
+    TEST_ASSERT_EQUAL_UINT8(255, glow.window[1].r);
+    TEST_ASSERT_EQUAL_INT(0, lightbar_glow_sync(&glow, &config));
+}
+
+void test_plan_sync_rebuilds_only_on_change(void) {
+    LightbarConfig config = { .num_leds = 10, .speed = 8.0f, .glow_radius = 2,
+                              .color = { 255, 255, 255 } };
+    LightbarPlan plan;
+    LightbarLut lut;
+    lightbar_plan_init(&plan, &config);
+    TEST_ASSERT_EQUAL_INT(0, lightbar_plan_sync(&plan, &config));
+    TEST_ASSERT_TRUE(plan.ms_per_step == 125.0f);
+    TEST_ASSERT_EQUAL_INT(5, plan.middle);
+    TEST_ASSERT_EQUAL_UINT8(170, plan.lit[1].r);
+
+    config.speed = 0.0f;
+    TEST_ASSERT_EQUAL_INT(1, lightbar_plan_sync(&plan, &config));
+    TEST_ASSERT_TRUE(plan.ms_per_step == 0.0f);
+    config.end_pause_ms = 100;
+    TEST_ASSERT_EQUAL_INT(1, lightbar_plan_sync(&plan, &config));
+    config.smooth = 1;
+    TEST_ASSERT_EQUAL_INT(1, lightbar_plan_sync(&plan, &config));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_plan_sync(&plan, &config));
+
+    lightbar_lut_init(&lut, 255, 0);
+    config.lut = &lut;
+    TEST_ASSERT_EQUAL_INT(1, lightbar_plan_sync(&plan, &config));
+    lightbar_lut_set_brightness(&lut, 100);
+    TEST_ASSERT_EQUAL_INT(1, lightbar_plan_sync(&plan, &config));
+    TEST_ASSERT_EQUAL_UINT8(100, plan.lit[0].r);
+    TEST_ASSERT_EQUAL_UINT8(100, plan.table[255]);
+    lightbar_lut_init(&lut, 100, 1);
+    TEST_ASSERT_EQUAL_INT(1, lightbar_plan_sync(&plan, &config));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_plan_sync(&plan, &config));
+}
+
+/* Updating and delta rendering through a plan track the config paths frame
+ * for frame, through speed, glow, color, smoothing and brightness changes. */
+void test_plan_matches_config_paths(void) {
+    static Led expected[300], actual[300];
+    LightbarProfile profile;
+    LightbarLut lut;
+    LightbarPlan plan;
+    LightbarDelta config_delta, plan_delta;
+    int from, to, plan_from, plan_to;
+    lightbar_profile_init(&profile, LIGHTBAR_PROFILE_EASE_IN_OUT);
+    lightbar_lut_init(&lut, 255, 1);
+    LightbarConfig config = {
+        .num_leds = 300, .speed = 45.0f, .end_pause_ms = 40, .glow_radius = 6,
+        .color = { 255, 80, 20 }, .lut = &lut
+    };
+    LightbarState by_config, by_plan;
+    lightbar_plan_init(&plan, &config);
+    lightbar_delta_reset(&config_delta);
+    lightbar_delta_reset(&plan_delta);
+    lightbar_init(&by_config, &config);
+    lightbar_start(&by_config);
+    by_plan = by_config;
+    srand(25);
+    for (int frame = 0; frame < 4000; frame++) {
+        if (frame % 400 == 200) {
+            config.speed = (float)(1 + rand() % 300);
+            config.glow_radius = (uint16_t)(rand() % 40);
+            config.color.g = (uint8_t)rand();
+            config.smooth = (uint8_t)(rand() & 1);
+            config.profile = (rand() & 1) ? &profile : NULL;
+            lightbar_lut_set_brightness(&lut, (uint8_t)rand());
+            TEST_ASSERT_EQUAL_INT(1, lightbar_plan_sync(&plan, &config));
+        }
+        if (frame % 1000 == 999) {
+            lightbar_stop(&by_config, &config);
+            lightbar_stop(&by_plan, &config);
+        }
+        float dt = (float)(rand() % 40);
+        lightbar_update(&by_config, &config, dt);
+        lightbar_update_plan(&by_plan, &plan, dt);
+        TEST_ASSERT_EQUAL_MEMORY(&by_config, &by_plan, sizeof(by_config));
+        if (by_config.phase == LIGHTBAR_STOPPED) {
+            lightbar_start(&by_config);
+            lightbar_start(&by_plan);
+        }
+
+        int changed = lightbar_render_delta(&config_delta, &by_config, &config, expected,
+                                            &from, &to);
+        TEST_ASSERT_EQUAL_INT(changed, lightbar_render_delta_plan(&plan_delta, &by_plan, &plan,
+                                                                   actual, &plan_from, &plan_to));
+        TEST_ASSERT_EQUAL_INT(from, plan_from);
+        TEST_ASSERT_EQUAL_INT(to, plan_to);
+        TEST_ASSERT_EQUAL_MEMORY(expected, actual, sizeof(expected));
+    }
+}
+
+void test_lut_linear_full_brightness_is_identity(void) {
+    LightbarLut lut;
+    lightbar_lut_init(&lut, 255, 0);
+    for (int v = 0; v < 256; v++) {
+        TEST_ASSERT_EQUAL_UINT8(v, lut.table[v]);
+    }
+}
+
+void test_lut_gamma_and_brightness(void) {
+    LightbarLut lut;
+    lightbar_lut_init(&lut, 255, 1);
+    TEST_ASSERT_EQUAL_UINT8(0, lut.table[0]);
+    TEST_ASSERT_EQUAL_UINT8(56, lut.table[128]);
+    TEST_ASSERT_EQUAL_UINT8(255, lut.table[255]);
+    TEST_ASSERT_EQUAL_INT(0, lightbar_lut_set_brightness(&lut, 255));
+    TEST_ASSERT_EQUAL_INT(1, lightbar_lut_set_brightness(&lut, 128));
+    TEST_ASSERT_EQUAL_UINT8(0, lut.table[0]);
+    TEST_ASSERT_EQUAL_UINT8(28, lut.table[128]);
+    TEST_ASSERT_EQUAL_UINT8(128, lut.table[255]);
+    lightbar_lut_set_brightness(&lut, 0);
+    TEST_ASSERT_EQUAL_UINT8(0, lut.table[255]);
+}
+
+/* Every render path gives the linear frame passed through the table. */
+void test_render_with_lut_matches_lookup(void) {
+    Led linear[64], expected[64], actual[64];
+    LightbarLut lut;
+    LightbarGlow glow;
+    LightbarDelta delta;
+    int from, to;
+    lightbar_lut_init(&lut, 200, 1);
+    srand(5);
+    for (int trial = 0; trial < 300; trial++) {
+        LightbarConfig config = {
+            .num_leds = (uint16_t)(1 + rand() % 64), .speed = 20.0f,
+            .glow_radius = (uint16_t)(rand() % 6),
+            .color = { (uint8_t)rand(), (uint8_t)rand(), (uint8_t)rand() },
+            .smooth = (uint8_t)(rand() & 1)
+        };
+        LightbarState state;
+        lightbar_init(&state, &config);
+        lightbar_start(&state);
+        state.position = rand() % config.num_leds;
+        state.move_accum_ms = (float)(rand() % 50);
+        lightbar_render(&state, &config, linear);
+        for (int i = 0; i < config.num_leds; i++) {
+            expected[i].r = lut.table[linear[i].r];
+            expected[i].g = lut.table[linear[i].g];
+            expected[i].b = lut.table[linear[i].b];
+        }
+
+        config.lut = &lut;
+        lightbar_render(&state, &config, actual);
+        TEST_ASSERT_EQUAL_MEMORY(expected, actual, config.num_leds * sizeof(Led));
+
+        memset(actual, 0xAA, sizeof(actual));
+        lightbar_glow_init(&glow, &config);
+        lightbar_render_glow(&state, &config, &glow, actual);
+        TEST_ASSERT_EQUAL_MEMORY(expected, actual, config.num_leds * sizeof(Led));
+
+        lightbar_delta_reset(&delta);
+        lightbar_render_delta(&delta, &state, &config, actual, &from, &to);
+        TEST_ASSERT_EQUAL_MEMORY(expected, actual, config.num_leds * sizeof(Led));
+    }
+}
+
+void test_brightness_change_invalidates_glow_and_delta(void) {
+    LightbarConfig config = { .num_leds = 10, .glow_radius = 1, .color = { 255, 255, 255 } };
+    LightbarState state;
+    LightbarGlow glow;
+    LightbarDelta delta;
+    LightbarLut lut;
+    Led leds[10];
+    int from, to;
+    lightbar_lut_init(&lut, 255, 0);
+    config.lut = &lut;
+    lightbar_init(&state, &config);
+    lightbar_glow_init(&glow, &config);
+    lightbar_delta_reset(&delta);
+    lightbar_render_delta(&delta, &state, &config, leds, &from, &to);
+    TEST_ASSERT_EQUAL_INT(0, lightbar_render_delta(&delta, &state, &config, leds, &from, &to));
+
+    lightbar_lut_set_brightness(&lut, 100);
+    TEST_ASSERT_EQUAL_INT(1, lightbar_glow_sync(&glow, &config));
+    TEST_ASSERT_EQUAL_UINT8(100, glow.window[1].r);
+    TEST_ASSERT_EQUAL_INT(1, lightbar_render_delta(&delta, &state, &config, leds, &from, &to));
+    TEST_ASSERT_EQUAL_INT(4, from);
+    TEST_ASSERT_EQUAL_INT(7, to);
+    TEST_ASSERT_EQUAL_UINT8(100, leds[5].r);
+    TEST_ASSERT_EQUAL_UINT8(50, leds[4].r);
+}
+
+static void run_render_tests(void) {
+    RUN_TEST(test_render_single_led_no_glow);
+    RUN_TEST(test_render_smooth_splits_dot_by_progress);
+    RUN_TEST(test_render_smooth_follows_direction);
+    RUN_TEST(test_render_smooth_is_whole_led_when_not_travelling);
+    RUN_TEST(test_render_glow_radius_2);
+    RUN_TEST(test_render_glow_at_left_edge);
+    RUN_TEST(test_render_glow_at_right_edge);
+    RUN_TEST(test_render_colored_dot);
+}
+
+static void run_update_tests(void) {
+    RUN_TEST(test_update_stopped_does_nothing);
+    RUN_TEST(test_update_advances_position);
+    RUN_TEST(test_update_accumulates_partial_steps);
+    RUN_TEST(test_update_multiple_steps_in_one_frame);
+    RUN_TEST(test_update_triggers_end_pause_at_right);
+    RUN_TEST(test_update_triggers_end_pause_at_left);
+    RUN_TEST(test_end_pause_expires_and_reverses);
+    RUN_TEST(test_end_pause_partial_timer);
+    RUN_TEST(test_zero_end_pause_skips_pause);
+    RUN_TEST(test_stopping_continues_movement);
+    RUN_TEST(test_stopping_decrements_edges_at_end);
+    RUN_TEST(test_stopping_respects_end_pause);
+    RUN_TEST(test_stopping_finalizes_at_middle);
+    RUN_TEST(test_stopping_full_cycle);
+    RUN_TEST(test_full_oscillation_cycle);
+}
+
+void test_profile_tables_run_from_end_to_end(void) {
+    LightbarProfile profile;
+    const LightbarProfileType types[] = {
+        LIGHTBAR_PROFILE_LINEAR, LIGHTBAR_PROFILE_SINE, LIGHTBAR_PROFILE_EASE_IN_OUT
+    };
+    for (int t = 0; t < 3; t++) {
+        lightbar_profile_init(&profile, types[t]);
+        TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, lightbar_profile_at(&profile, 0.0f));
+        TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.5f, lightbar_profile_at(&profile, 0.5f));
+        TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, lightbar_profile_at(&profile, 1.0f));
+        /* Monotonic, and symmetric about the middle of the leg */
+        for (float u = 0.0f; u < 1.0f; u += 0.01f) {
+            TEST_ASSERT_TRUE(lightbar_profile_at(&profile, u + 0.01f) >=
+                             lightbar_profile_at(&profile, u));
+            TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.0f - lightbar_profile_at(&profile, u),
+                                     lightbar_profile_at(&profile, 1.0f - u));
+        }
+    }
+    /* Sine slows into the ends; the table lerp stays close to the curve */
+    lightbar_profile_init(&profile, LIGHTBAR_PROFILE_SINE);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.5f - 0.5f * cosf(0.3f * 3.14159265f),
+                             lightbar_profile_at(&profile, 0.3f));
+    TEST_ASSERT_TRUE(lightbar_profile_at(&profile, 0.1f) < 0.1f);
+    lightbar_profile_init(&profile, LIGHTBAR_PROFILE_EASE_IN_OUT);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 4.0f * 0.2f * 0.2f * 0.2f, lightbar_profile_at(&profile, 0.2f));
+}
+
+void test_profile_custom_curve_through_points(void) {
+    LightbarProfile profile;
+    const float points[] = { 0.0f, 0.8f, 1.2f };
+    TEST_ASSERT_EQUAL_INT(-1, lightbar_profile_init_custom(&profile, points, 1));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_profile_init_custom(&profile, points, 3));
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_PROFILE_CUSTOM, profile.type);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.4f, lightbar_profile_at(&profile, 0.25f));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.8f, lightbar_profile_at(&profile, 0.5f));
+    /* Clamped to the strip */
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, lightbar_profile_at(&profile, 1.0f));
+}
+
+void test_profile_moves_the_drawn_dot_not_the_timing(void) {
+    LightbarProfile sine;
+    LightbarConfig linear = { .num_leds = 11, .speed = 10.0f, .end_pause_ms = 50,
+                              .color = { 255, 255, 255 } };
+    LightbarConfig curved = linear;
+    LightbarState a, b;
+    Led leds[11];
+    lightbar_profile_init(&sine, LIGHTBAR_PROFILE_SINE);
+    curved.profile = &sine;
+    lightbar_init(&a, &linear);
+    lightbar_init(&b, &curved);
+    lightbar_start(&a);
+    lightbar_start(&b);
+    for (int i = 0; i < 500; i++) {
+        lightbar_advance(&a, &linear, 7.0f);
+        lightbar_advance(&b, &curved, 7.0f);
+        TEST_ASSERT_EQUAL_INT(a.position, b.position);
+        TEST_ASSERT_EQUAL_INT(a.phase, b.phase);
+    }
+    /* One step (100 ms) out of the left edge, a tenth of the leg */
+    lightbar_init(&b, &curved);
+    lightbar_start(&b);
+    b.position = 1;
+    b.direction = 1;
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 10.0f * (0.5f - 0.5f * cosf(0.1f * 3.14159265f)),
+                             lightbar_dot_position(&b, &curved));
+    /* Drawn on the nearer LED: the sine has only covered 0.24 LED */
+    lightbar_render(&b, &curved, leds);
+    TEST_ASSERT_EQUAL_UINT8(255, leds[0].r);
+    TEST_ASSERT_EQUAL_UINT8(0, leds[1].r);
+    /* Coming back from the right edge mirrors it */
+    b.position = 9;
+    b.direction = -1;
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 10.0f - 10.0f * (0.5f - 0.5f * cosf(0.1f * 3.14159265f)),
+                             lightbar_dot_position(&b, &curved));
+}
+
+void test_profile_smooth_blends_around_the_curve(void) {
+    LightbarProfile ease;
+    LightbarConfig config = { .num_leds = 11, .speed = 10.0f, .color = { 255, 255, 255 },
+                              .smooth = 1 };
+    LightbarState state;
+    Led leds[11], via_span[11];
+    LightbarSpan span;
+    lightbar_profile_init(&ease, LIGHTBAR_PROFILE_EASE_IN_OUT);
+    config.profile = &ease;
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    state.position = 2;
+    state.move_accum_ms = 50.0f;
+    /* A quarter of the leg: 4 * 0.25^3 * 10 = 0.625 LED */
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.625f, lightbar_dot_position(&state, &config));
+    lightbar_render(&state, &config, leds);
+    TEST_ASSERT_EQUAL_UINT8(95, leds[0].r);
+    TEST_ASSERT_EQUAL_UINT8(159, leds[1].r);
+    TEST_ASSERT_EQUAL_UINT8(0, leds[2].r);
+    lightbar_span(&state, &config, &span);
+    for (int i = 0; i < 11; i++) via_span[i] = lightbar_span_led(&span, i);
+    TEST_ASSERT_EQUAL_MEMORY(leds, via_span, sizeof(leds));
+}
+
+void test_profile_wind_down_comes_to_rest_without_a_jump(void) {
+    LightbarProfile sine;
+    LightbarConfig config = { .num_leds = 21, .speed = 20.0f, .end_pause_ms = 100 };
+    LightbarState state;
+    lightbar_profile_init(&sine, LIGHTBAR_PROFILE_SINE);
+    config.profile = &sine;
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    lightbar_advance(&state, &config, 730.0f);
+    lightbar_stop(&state, &config);
+    float previous = lightbar_dot_position(&state, &config);
+    for (int i = 0; i < 2000 && state.phase != LIGHTBAR_STOPPED; i++) {
+        lightbar_advance(&state, &config, 2.0f);
+        float now = lightbar_dot_position(&state, &config);
+        /* Peak sine speed is pi/2 times linear: 20 LED/s, 2 ms frames */
+        TEST_ASSERT_FLOAT_WITHIN(0.065f, previous, now);
+        previous = now;
+    }
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_STOPPED, state.phase);
+    TEST_ASSERT_EQUAL_INT(10, state.position);
+}
+
 int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_init_sets_position_to_middle);
@@ -572,6 +1549,7 @@ int main(void) {
     RUN_TEST(test_init_sets_phase_stopped);
     RUN_TEST(test_init_clears_timers);
     RUN_TEST(test_init_odd_led_count);
+    RUN_TEST(test_init_large_strip);
     RUN_TEST(test_start_sets_phase_moving);
     RUN_TEST(test_stop_preserves_position);
     RUN_TEST(test_stop_preserves_accumulators);
@@ -583,26 +1561,49 @@ int main(void) {
     RUN_TEST(test_stop_edges_remaining_paused_left_edge);
     RUN_TEST(test_stop_while_already_stopped_is_noop);
     RUN_TEST(test_stop_while_already_stopping_is_noop);
-    RUN_TEST(test_update_stopped_does_nothing);
-    RUN_TEST(test_update_advances_position);
-    RUN_TEST(test_update_accumulates_partial_steps);
-    RUN_TEST(test_update_multiple_steps_in_one_frame);
-    RUN_TEST(test_update_triggers_end_pause_at_right);
-    RUN_TEST(test_update_triggers_end_pause_at_left);
-    RUN_TEST(test_end_pause_expires_and_reverses);
-    RUN_TEST(test_end_pause_partial_timer);
-    RUN_TEST(test_zero_end_pause_skips_pause);
-    RUN_TEST(test_render_single_led_no_glow);
-    RUN_TEST(test_render_glow_radius_2);
-    RUN_TEST(test_render_glow_at_left_edge);
-    RUN_TEST(test_render_glow_at_right_edge);
-    RUN_TEST(test_render_colored_dot);
-    RUN_TEST(test_stopping_continues_movement);
-    RUN_TEST(test_stopping_decrements_edges_at_end);
-    RUN_TEST(test_stopping_respects_end_pause);
-    RUN_TEST(test_stopping_finalizes_at_middle);
     RUN_TEST(test_start_cancels_stopping);
-    RUN_TEST(test_stopping_full_cycle);
-    RUN_TEST(test_full_oscillation_cycle);
+    run_render_tests();
+    render = render_with_glow;
+    run_render_tests();
+    render = render_with_plan;
+    run_render_tests();
+    RUN_TEST(test_render_matches_reference_formula);
+    RUN_TEST(test_glow_sync_rebuilds_only_on_change);
+    RUN_TEST(test_plan_sync_rebuilds_only_on_change);
+    RUN_TEST(test_plan_matches_config_paths);
+    RUN_TEST(test_lut_linear_full_brightness_is_identity);
+    RUN_TEST(test_lut_gamma_and_brightness);
+    RUN_TEST(test_render_with_lut_matches_lookup);
+    RUN_TEST(test_brightness_change_invalidates_glow_and_delta);
+    RUN_TEST(test_render_delta_first_call_renders_whole_strip);
+    RUN_TEST(test_render_delta_reports_no_change);
+    RUN_TEST(test_render_delta_one_step_dirties_old_and_new_window);
+    RUN_TEST(test_render_delta_color_change_dirties_window);
+    RUN_TEST(test_render_delta_matches_full_render);
+    RUN_TEST(test_render_delta_smooth_matches_full_render);
+    RUN_TEST(test_render_large_strip_lights_only_window);
+    run_update_tests();
+    update = update_with_plan;
+    run_update_tests();
+    update = lightbar_advance;
+    run_update_tests();
+    RUN_TEST(test_advance_large_dt_crosses_several_edges);
+    RUN_TEST(test_advance_carries_time_into_pause);
+    RUN_TEST(test_advance_skips_whole_periods);
+    RUN_TEST(test_advance_completes_wind_down_in_one_call);
+    RUN_TEST(test_update_matches_step_loop);
+    RUN_TEST(test_advance_matches_small_steps);
+    RUN_TEST(test_advance_two_led_strip_keeps_oscillating_while_stopping);
+    RUN_TEST(test_time_to_event_follows_edges_pauses_and_stop);
+    RUN_TEST(test_advancing_by_time_to_event_reaches_it);
+    RUN_TEST(test_advance_events_report_every_event_with_its_offset);
+    RUN_TEST(test_advance_events_report_wind_down);
+    RUN_TEST(test_advance_events_overflow_keeps_state_exact);
+    RUN_TEST(test_advance_events_do_not_depend_on_frame_size);
+    RUN_TEST(test_profile_tables_run_from_end_to_end);
+    RUN_TEST(test_profile_custom_curve_through_points);
+    RUN_TEST(test_profile_moves_the_drawn_dot_not_the_timing);
+    RUN_TEST(test_profile_smooth_blends_around_the_curve);
+    RUN_TEST(test_profile_wind_down_comes_to_rest_without_a_jump);
     return UNITY_END();
 }
@@ -0,0 +1,288 @@
+#define _GNU_SOURCE
+#include "unity.h"
+#include "lightbar_audio.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RATE 48000
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const LightbarAudioConfig audio_config = {
+    .sample_rate = RATE, .tone_hz = 440.0f, .volume = 0.5f, .click_ms = 0.0f
+};
+
+static void start(LightbarAudio *audio, LightbarState *state, const LightbarConfig *config,
+                  const LightbarAudioConfig *ac) {
+    lightbar_audio_init(audio, ac);
+    lightbar_init(state, config);
+    lightbar_start(state);
+}
+
+void test_tone_is_a_sine_at_the_requested_pitch(void) {
+    static float out[2 * 4800];
+    LightbarConfig config = { .num_leds = 11, .speed = 0.0f };
+    LightbarAudio audio;
+    LightbarState state;
+    start(&audio, &state, &config, &audio_config);
+    lightbar_audio_render_f32(&audio, &state, &config, out, 4800);
+    /* Centred dot: equal power on both sides, after the fade-in */
+    for (uint32_t i = 480; i < 4800; i++) {
+        float expected = 0.5f * (float)M_SQRT1_2 * (float)sin(2.0 * M_PI * 440.0 * i / RATE);
+        TEST_ASSERT_FLOAT_WITHIN(1e-4f, expected, out[2 * i]);
+        TEST_ASSERT_FLOAT_WITHIN(1e-4f, expected, out[2 * i + 1]);
+    }
+}
+
+void test_pan_follows_position(void) {
+    LightbarConfig config = { .num_leds = 11, .speed = 10.0f };
+    LightbarState state;
+    lightbar_init(&state, &config);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, lightbar_audio_pan(&state, &config));
+    state.position = 0;
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, -1.0f, lightbar_audio_pan(&state, &config));
+    state.position = 10;
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, lightbar_audio_pan(&state, &config));
+    /* Halfway through the step from 5 to 6 */
+    lightbar_start(&state);
+    state.position = 5;
+    state.move_accum_ms = 50.0f;
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.1f, lightbar_audio_pan(&state, &config));
+    /* A profile bends it the same way as the light */
+    LightbarProfile sine;
+    lightbar_profile_init(&sine, LIGHTBAR_PROFILE_SINE);
+    config.profile = &sine;
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 2.0f * lightbar_dot_position(&state, &config) / 10.0f - 1.0f,
+                             lightbar_audio_pan(&state, &config));
+    TEST_ASSERT_TRUE(lightbar_audio_pan(&state, &config) > 0.1f);
+}
+
+/* First frame where a render with edge clicks differs from one without,
+ * and on which side. */
+static uint32_t first_click_frame(uint32_t frames, uint32_t block, int *side) {
+    static float with[2 * 60000], without[2 * 60000];
+    LightbarConfig config = { .num_leds = 11, .speed = 10.0f, .end_pause_ms = 0 };
+    LightbarAudioConfig ac = audio_config;
+    LightbarAudio a, b;
+    LightbarState sa, sb;
+    /* Off the tone's zero crossings at whole half-seconds */
+    ac.tone_hz = 440.5f;
+    start(&b, &sb, &config, &ac);
+    ac.click_ms = 2.0f;
+    start(&a, &sa, &config, &ac);
+    for (uint32_t done = 0; done < frames; done += block) {
+        uint32_t n = frames - done < block ? frames - done : block;
+        lightbar_audio_render_f32(&a, &sa, &config, with + 2 * done, n);
+        lightbar_audio_render_f32(&b, &sb, &config, without + 2 * done, n);
+    }
+    for (uint32_t i = 0; i < frames; i++) {
+        for (int ch = 0; ch < 2; ch++) {
+            if (fabsf(with[2 * i + ch] - without[2 * i + ch]) > 1e-6f) {
+                *side = ch ? 1 : -1;
+                return i;
+            }
+        }
+    }
+    return UINT32_MAX;
+}
+
+void test_click_marks_each_edge_on_its_side(void) {
+    int side = 0;
+    /* 500 ms from the middle to the right edge */
+    TEST_ASSERT_EQUAL_UINT32(24000, first_click_frame(60000, 60000, &side));
+    TEST_ASSERT_EQUAL_INT(1, side);
+}
+
+void test_click_timing_does_not_depend_on_block_size(void) {
+    int side_a = 0, side_b = 0;
+    uint32_t a = first_click_frame(60000, 60000, &side_a);
+    uint32_t b = first_click_frame(60000, 7, &side_b);
+    TEST_ASSERT_EQUAL_UINT32(a, b);
+    TEST_ASSERT_EQUAL_INT(side_a, side_b);
+}
+
+void test_blocks_match_one_long_render(void) {
+    static float whole[2 * 96000], pieces[2 * 96000];
+    LightbarConfig config = { .num_leds = 24, .speed = 37.0f, .end_pause_ms = 130 };
+    LightbarAudioConfig ac = audio_config;
+    LightbarAudio a, b;
+    LightbarState sa, sb;
+    ac.click_ms = 3.0f;
+    start(&a, &sa, &config, &ac);
+    start(&b, &sb, &config, &ac);
+    lightbar_audio_render_f32(&a, &sa, &config, whole, 96000);
+    srand(3);
+    for (uint32_t done = 0; done < 96000;) {
+        uint32_t n = 1 + (uint32_t)(rand() % 700);
+        if (n > 96000 - done) n = 96000 - done;
+        lightbar_audio_render_f32(&b, &sb, &config, pieces + 2 * done, n);
+        done += n;
+    }
+    for (uint32_t i = 0; i < 2 * 96000; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(1e-3f, whole[i], pieces[i]);
+    }
+    TEST_ASSERT_EQUAL_INT(sa.position, sb.position);
+    TEST_ASSERT_EQUAL_INT(sa.phase, sb.phase);
+    TEST_ASSERT_EQUAL_UINT64(96000, b.frames);
+}
+
+void test_state_tracks_lightbar_advance(void) {
+    LightbarConfig config = { .num_leds = 30, .speed = 23.0f, .end_pause_ms = 70 };
+    LightbarAudio audio;
+    LightbarState state, reference;
+    static int16_t out[2 * 480];
+    start(&audio, &state, &config, &audio_config);
+    lightbar_init(&reference, &config);
+    lightbar_start(&reference);
+    /* Ten simulated minutes of 10 ms callbacks */
+    for (int i = 0; i < 60000; i++) {
+        lightbar_audio_render_s16(&audio, &state, &config, out, 480);
+        lightbar_advance(&reference, &config, 10.0f);
+        TEST_ASSERT_INT_WITHIN(1, reference.position, state.position);
+    }
+    TEST_ASSERT_EQUAL_INT(reference.direction, state.direction);
+}
+
+void test_stopped_bar_fades_to_silence(void) {
+    static int16_t out[2 * 48000];
+    LightbarConfig config = { .num_leds = 10, .speed = 100.0f, .end_pause_ms = 50 };
+    LightbarAudio audio;
+    LightbarState state;
+    start(&audio, &state, &config, &audio_config);
+    lightbar_audio_render_s16(&audio, &state, &config, out, 4800);
+    lightbar_stop(&state, &config);
+    lightbar_audio_render_s16(&audio, &state, &config, out, 48000);
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_STOPPED, state.phase);
+    for (int i = 2 * 47000; i < 2 * 48000; i++) {
+        TEST_ASSERT_EQUAL_INT16(0, out[i]);
+    }
+}
+
+void test_ring_wraps_and_reports_space(void) {
+    static float storage[2 * 8];
+    LightbarAudioRing ring;
+    float in[2 * 6], got[2 * 6];
+    TEST_ASSERT_EQUAL_INT(-1, lightbar_audio_ring_init(&ring, storage, 6));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_audio_ring_init(&ring, storage, 8));
+    for (int i = 0; i < 12; i++) in[i] = (float)i;
+    TEST_ASSERT_EQUAL_UINT32(6, lightbar_audio_ring_write(&ring, in, 6));
+    TEST_ASSERT_EQUAL_UINT32(4, lightbar_audio_ring_read(&ring, got, 4));
+    TEST_ASSERT_EQUAL_UINT32(2, lightbar_audio_ring_readable(&ring));
+    TEST_ASSERT_EQUAL_UINT32(6, lightbar_audio_ring_writable(&ring));
+    /* Wraps past the end of storage */
+    TEST_ASSERT_EQUAL_UINT32(6, lightbar_audio_ring_write(&ring, in, 6));
+    TEST_ASSERT_EQUAL_UINT32(0, lightbar_audio_ring_write(&ring, in, 1));
+    TEST_ASSERT_EQUAL_UINT32(2, lightbar_audio_ring_read(&ring, got, 2));
+    TEST_ASSERT_EQUAL_FLOAT(8.0f, got[0]);
+    TEST_ASSERT_EQUAL_UINT32(6, lightbar_audio_ring_read(&ring, got, 8));
+    for (int i = 0; i < 12; i++) TEST_ASSERT_EQUAL_FLOAT(in[i], got[i]);
+}
+
+typedef struct {
+    LightbarAudioRing *ring;
+    uint32_t frames;
+} Producer;
+
+static void *produce(void *arg) {
+    Producer *p = arg;
+    float frame[2];
+    for (uint32_t i = 0; i < p->frames;) {
+        frame[0] = (float)i;
+        frame[1] = -(float)i;
+        i += lightbar_audio_ring_write(p->ring, frame, 1);
+    }
+    return NULL;
+}
+
+void test_ring_passes_frames_between_threads_in_order(void) {
+    static float storage[2 * 64];
+    LightbarAudioRing ring;
+    Producer p = { &ring, 200000 };
+    pthread_t thread;
+    float frames[2 * 16];
+    uint32_t expected = 0;
+    lightbar_audio_ring_init(&ring, storage, 64);
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&thread, NULL, produce, &p));
+    while (expected < p.frames) {
+        uint32_t n = lightbar_audio_ring_read(&ring, frames, 16);
+        for (uint32_t i = 0; i < n; i++, expected++) {
+            if (frames[2 * i] != (float)expected || frames[2 * i + 1] != -(float)expected) {
+                TEST_FAIL_MESSAGE("frame out of order");
+            }
+        }
+    }
+    pthread_join(thread, NULL);
+}
+
+void test_fill_renders_into_the_free_space(void) {
+    static float storage[2 * 1024];
+    static float direct[2 * 3000], via_ring[2 * 3000];
+    LightbarConfig config = { .num_leds = 20, .speed = 30.0f, .end_pause_ms = 40 };
+    LightbarAudioRing ring;
+    LightbarAudio a, b;
+    LightbarState sa, sb;
+    start(&a, &sa, &config, &audio_config);
+    start(&b, &sb, &config, &audio_config);
+    lightbar_audio_render_f32(&a, &sa, &config, direct, 3000);
+    lightbar_audio_ring_init(&ring, storage, 1024);
+    uint32_t got = 0;
+    while (got < 3000) {
+        lightbar_audio_fill(&b, &sb, &config, &ring, 3000 - got);
+        uint32_t want = 3000 - got < 700 ? 3000 - got : 700;
+        got += lightbar_audio_ring_read(&ring, via_ring + 2 * got, want);
+    }
+    /* Same audio; the wrap only moves block boundaries */
+    for (uint32_t i = 0; i < 2 * 3000; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(1e-4f, direct[i], via_ring[i]);
+    }
+}
+
+void test_wav_header_and_samples(void) {
+    char path[64];
+    uint8_t bytes[44 + 8];
+    float frames[4] = { 0.5f, -0.5f, 1.5f, -1.0f };
+    LightbarWav wav;
+    snprintf(path, sizeof(path), "/tmp/test_lightbar_audio.%d.wav", (int)getpid());
+    TEST_ASSERT_EQUAL_INT(0, lightbar_wav_open(&wav, path, RATE, 0));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_wav_write(&wav, frames, 2));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_wav_close(&wav));
+
+    FILE *f = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_EQUAL_size_t(sizeof(bytes), fread(bytes, 1, sizeof(bytes) + 1, f));
+    fclose(f);
+    unlink(path);
+    TEST_ASSERT_EQUAL_MEMORY("RIFF", bytes, 4);
+    TEST_ASSERT_EQUAL_UINT8(44, bytes[4]);
+    TEST_ASSERT_EQUAL_MEMORY("WAVEfmt ", bytes + 8, 8);
+    TEST_ASSERT_EQUAL_UINT8(1, bytes[20]);
+    TEST_ASSERT_EQUAL_UINT8(2, bytes[22]);
+    TEST_ASSERT_EQUAL_UINT8(0x80, bytes[24]);
+    TEST_ASSERT_EQUAL_UINT8(0xBB, bytes[25]);
+    TEST_ASSERT_EQUAL_UINT8(16, bytes[34]);
+    TEST_ASSERT_EQUAL_MEMORY("data", bytes + 36, 4);
+    TEST_ASSERT_EQUAL_UINT8(8, bytes[40]);
+    /* 0.5 -> 16384, -0.5 -> -16384, clipped 1.5 -> 32767, -1.0 -> -32767 */
+    const uint8_t samples[8] = { 0x00, 0x40, 0x00, 0xC0, 0xFF, 0x7F, 0x01, 0x80 };
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(samples, bytes + 44, 8);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_tone_is_a_sine_at_the_requested_pitch);
+    RUN_TEST(test_pan_follows_position);
+    RUN_TEST(test_click_marks_each_edge_on_its_side);
+    RUN_TEST(test_click_timing_does_not_depend_on_block_size);
+    RUN_TEST(test_blocks_match_one_long_render);
+    RUN_TEST(test_state_tracks_lightbar_advance);
+    RUN_TEST(test_stopped_bar_fades_to_silence);
+    RUN_TEST(test_ring_wraps_and_reports_space);
+    RUN_TEST(test_ring_passes_frames_between_threads_in_order);
+    RUN_TEST(test_fill_renders_into_the_free_space);
+    RUN_TEST(test_wav_header_and_samples);
+    return UNITY_END();
+}
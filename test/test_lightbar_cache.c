@@ -0,0 +1,218 @@
+#include "unity.h"
+#include "lightbar_cache.h"
+#include <stdlib.h>
+#include <string.h>
+
+static LightbarCache cache;
+
+void setUp(void) {
+    lightbar_cache_init(&cache);
+}
+
+void tearDown(void) {
+    lightbar_cache_free(&cache);
+}
+
+static LightbarConfig make_config(uint16_t num_leds, float speed, uint16_t end_pause_ms) {
+    LightbarConfig config = {
+        .num_leds = num_leds, .speed = speed, .end_pause_ms = end_pause_ms,
+        .glow_radius = 2, .color = { 255, 128, 0 }
+    };
+    return config;
+}
+
+static void assert_same_state(const LightbarState *expected, const LightbarState *actual) {
+    TEST_ASSERT_EQUAL_INT(expected->position, actual->position);
+    TEST_ASSERT_EQUAL_INT(expected->direction, actual->direction);
+    TEST_ASSERT_EQUAL_INT(expected->phase, actual->phase);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, expected->move_accum_ms, actual->move_accum_ms);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, expected->pause_timer_ms, actual->pause_timer_ms);
+    TEST_ASSERT_EQUAL_UINT8(expected->edges_remaining, actual->edges_remaining);
+}
+
+/* Expands the cached frame for state into leds. */
+static void cached_frame(const LightbarState *state, Led *leds, int num_leds) {
+    int from, to;
+    const Led *window = lightbar_cache_window(&cache, state, &from, &to);
+    TEST_ASSERT_NOT_NULL(window);
+    memset(leds, 0, (size_t)num_leds * sizeof(Led));
+    memcpy(leds + from, window, (size_t)(to - from) * sizeof(Led));
+}
+
+void test_sync_builds_one_window(void) {
+    LightbarConfig config = make_config(24, 10.0f, 100);
+    TEST_ASSERT_EQUAL_INT(1, lightbar_cache_sync(&cache, &config));
+    TEST_ASSERT_EQUAL_UINT32(5, cache.window_len);
+    /* 23 steps each way plus a pause at each end */
+    TEST_ASSERT_EQUAL_UINT32(48, cache.num_keys);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 2.0 * (23 * 100.0 + 100.0), cache.period_ms);
+}
+
+void test_sync_without_pause_has_no_pause_keys(void) {
+    LightbarConfig config = make_config(10, 10.0f, 0);
+    TEST_ASSERT_EQUAL_INT(1, lightbar_cache_sync(&cache, &config));
+    TEST_ASSERT_EQUAL_UINT32(18, cache.num_keys);
+}
+
+/* Memory follows the glow and the strip length, not their product. */
+void test_window_is_clipped_at_the_ends(void) {
+    LightbarConfig config = make_config(30000, 10.0f, 100);
+    config.glow_radius = 40000;
+    TEST_ASSERT_EQUAL_INT(1, lightbar_cache_sync(&cache, &config));
+    TEST_ASSERT_EQUAL_UINT32(2 * 29999 + 1, cache.window_len);
+
+    LightbarState state;
+    int from, to;
+    lightbar_init(&state, &config);
+    state.position = 0;
+    lightbar_cache_window(&cache, &state, &from, &to);
+    TEST_ASSERT_EQUAL_INT(0, from);
+    TEST_ASSERT_EQUAL_INT(30000, to);
+    state.position = 29999;
+    const Led *window = lightbar_cache_window(&cache, &state, &from, &to);
+    TEST_ASSERT_EQUAL_INT(0, from);
+    TEST_ASSERT_EQUAL_INT(30000, to);
+    TEST_ASSERT_EQUAL_UINT8(255, window[29999].r);
+}
+
+void test_uncacheable_configs_run_live(void) {
+    LightbarConfig config = make_config(24, 10.0f, 100);
+    config.smooth = 1;
+    TEST_ASSERT_EQUAL_INT(0, lightbar_cache_sync(&cache, &config));
+    config = make_config(24, 0.0f, 100);
+    TEST_ASSERT_EQUAL_INT(0, lightbar_cache_sync(&cache, &config));
+    config = make_config(1, 10.0f, 100);
+    TEST_ASSERT_EQUAL_INT(0, lightbar_cache_sync(&cache, &config));
+    LightbarProfile profile;
+    lightbar_profile_init(&profile, LIGHTBAR_PROFILE_SINE);
+    config = make_config(24, 10.0f, 100);
+    config.profile = &profile;
+    TEST_ASSERT_EQUAL_INT(0, lightbar_cache_sync(&cache, &config));
+
+    LightbarState state;
+    lightbar_init(&state, &config);
+    int from, to;
+    TEST_ASSERT_NULL(lightbar_cache_window(&cache, &state, &from, &to));
+    Led leds[24];
+    TEST_ASSERT_EQUAL_INT(-1, lightbar_cache_render(&cache, &state, leds));
+}
+
+void test_frames_match_live_render(void) {
+    static const uint16_t radii[] = { 0, 2, 14, 40 };
+    for (size_t r = 0; r < sizeof(radii) / sizeof(radii[0]); r++) {
+        LightbarConfig config = make_config(30, 10.0f, 100);
+        config.glow_radius = radii[r];
+        LightbarState state;
+        Led expected[30], actual[30];
+        lightbar_init(&state, &config);
+        lightbar_cache_sync(&cache, &config);
+        for (int p = 0; p < 30; p++) {
+            state.position = p;
+            lightbar_render(&state, &config, expected);
+            cached_frame(&state, actual, 30);
+            TEST_ASSERT_EQUAL_MEMORY(expected, actual, sizeof(expected));
+            memset(actual, 0x55, sizeof(actual));
+            TEST_ASSERT_EQUAL_INT(0, lightbar_cache_render(&cache, &state, actual));
+            TEST_ASSERT_EQUAL_MEMORY(expected, actual, sizeof(expected));
+        }
+    }
+}
+
+/* Playback follows lightbar_update() frame by frame, dropping time at the
+ * start and end of a pause, including stop and restart, when step and
+ * frame times are exact in float. */
+void test_update_matches_live_update(void) {
+    static const float speeds[] = { 8.0f, 10.0f, 40.0f, 200.0f };
+    static const uint16_t pauses[] = { 0, 100, 250 };
+    srand(3);
+    for (size_t s = 0; s < sizeof(speeds) / sizeof(speeds[0]); s++) {
+        for (size_t p = 0; p < sizeof(pauses) / sizeof(pauses[0]); p++) {
+            LightbarConfig config = make_config(17, speeds[s], pauses[p]);
+            LightbarState live, cached;
+            lightbar_init(&live, &config);
+            lightbar_start(&live);
+            cached = live;
+            for (int frame = 0; frame < 20000; frame++) {
+                float dt = (float)(1 + rand() % 40);
+                if (frame % 2000 == 1000) dt = 12345.0f;
+                if (frame % 3000 == 2000) {
+                    lightbar_stop(&live, &config);
+                    lightbar_stop(&cached, &config);
+                } else if (frame % 3000 == 2500) {
+                    lightbar_start(&live);
+                    lightbar_start(&cached);
+                }
+                lightbar_update(&live, &config, dt);
+                lightbar_cache_update(&cache, &cached, &config, dt);
+                assert_same_state(&live, &cached);
+            }
+        }
+    }
+}
+
+void test_config_change_rebuilds(void) {
+    LightbarConfig config = make_config(20, 10.0f, 100);
+    LightbarState state;
+    lightbar_init(&state, &config);
+    Led leds[20];
+    lightbar_cache_sync(&cache, &config);
+    cached_frame(&state, leds, 20);
+    TEST_ASSERT_EQUAL_UINT8(255, leds[10].r);
+
+    config.color.r = 7;
+    TEST_ASSERT_EQUAL_INT(1, lightbar_cache_sync(&cache, &config));
+    cached_frame(&state, leds, 20);
+    TEST_ASSERT_EQUAL_UINT8(7, leds[10].r);
+
+    config.speed = 20.0f;
+    lightbar_cache_sync(&cache, &config);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 50.0, cache.ms_per_step);
+
+    config.smooth = 1;
+    TEST_ASSERT_EQUAL_INT(0, lightbar_cache_sync(&cache, &config));
+    int from, to;
+    TEST_ASSERT_NULL(lightbar_cache_window(&cache, &state, &from, &to));
+}
+
+void test_brightness_change_rebuilds(void) {
+    LightbarConfig config = make_config(20, 10.0f, 100);
+    LightbarState state;
+    LightbarLut lut;
+    lightbar_lut_init(&lut, 255, 0);
+    config.lut = &lut;
+    lightbar_init(&state, &config);
+    Led leds[20];
+    lightbar_cache_sync(&cache, &config);
+    cached_frame(&state, leds, 20);
+    TEST_ASSERT_EQUAL_UINT8(255, leds[10].r);
+    lightbar_lut_set_brightness(&lut, 51);
+    lightbar_cache_sync(&cache, &config);
+    cached_frame(&state, leds, 20);
+    TEST_ASSERT_EQUAL_UINT8(51, leds[10].r);
+}
+
+void test_invalidate_forces_rebuild(void) {
+    LightbarConfig config = make_config(20, 10.0f, 100);
+    lightbar_cache_sync(&cache, &config);
+    Led *window = cache.window;
+    TEST_ASSERT_EQUAL_INT(1, lightbar_cache_sync(&cache, &config));
+    TEST_ASSERT_TRUE(window == cache.window);
+    lightbar_cache_invalidate(&cache);
+    TEST_ASSERT_EQUAL_INT(0, cache.built);
+    TEST_ASSERT_EQUAL_INT(1, lightbar_cache_sync(&cache, &config));
+    TEST_ASSERT_EQUAL_INT(1, cache.built);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sync_builds_one_window);
+    RUN_TEST(test_sync_without_pause_has_no_pause_keys);
+    RUN_TEST(test_window_is_clipped_at_the_ends);
+    RUN_TEST(test_uncacheable_configs_run_live);
+    RUN_TEST(test_frames_match_live_render);
+    RUN_TEST(test_update_matches_live_update);
+    RUN_TEST(test_config_change_rebuilds);
+    RUN_TEST(test_brightness_change_rebuilds);
+    RUN_TEST(test_invalidate_forces_rebuild);
+    return UNITY_END();
+}
@@ -0,0 +1,242 @@
+#define _GNU_SOURCE
+#include "unity.h"
+#include "lightbar_command.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PRODUCERS 4
+#define PUSHES 20000
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static LightbarCommand speed(float value) {
+    LightbarCommand c = { .type = LIGHTBAR_CMD_SPEED };
+    c.value.speed = value;
+    return c;
+}
+
+static LightbarCommand simple(LightbarCommandType type) {
+    LightbarCommand c = { .type = type };
+    return c;
+}
+
+void test_init_needs_power_of_two(void) {
+    static LightbarCommandSlot slots[8];
+    LightbarCommandQueue queue;
+    TEST_ASSERT_EQUAL_INT(-1, lightbar_command_queue_init(&queue, slots, 0));
+    TEST_ASSERT_EQUAL_INT(-1, lightbar_command_queue_init(&queue, slots, 6));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_command_queue_init(&queue, slots, 8));
+}
+
+void test_fifo_and_full_queue_drops(void) {
+    static LightbarCommandSlot slots[4];
+    LightbarCommandQueue queue;
+    LightbarCommand c;
+    TEST_ASSERT_EQUAL_INT(0, lightbar_command_queue_init(&queue, slots, 4));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_command_pop(&queue, &c));
+    for (int lap = 0; lap < 3; lap++) {
+        for (int i = 0; i < 4; i++) {
+            c = speed((float)i);
+            TEST_ASSERT_EQUAL_INT(0, lightbar_command_push(&queue, &c));
+        }
+        TEST_ASSERT_EQUAL_INT(-1, lightbar_command_push(&queue, &c));
+        for (int i = 0; i < 4; i++) {
+            TEST_ASSERT_EQUAL_INT(1, lightbar_command_pop(&queue, &c));
+            TEST_ASSERT_EQUAL_FLOAT((float)i, c.value.speed);
+        }
+        TEST_ASSERT_EQUAL_INT(0, lightbar_command_pop(&queue, &c));
+    }
+    TEST_ASSERT_EQUAL_UINT64(3, queue.dropped);
+}
+
+void test_slider_burst_coalesces(void) {
+    static LightbarCommandSlot slots[64];
+    LightbarCommandQueue queue;
+    LightbarConfig config = { .num_leds = 20, .speed = 10.0f, .color = { 255, 0, 0 } };
+    LightbarState state;
+    lightbar_init(&state, &config);
+    lightbar_command_queue_init(&queue, slots, 64);
+    for (int i = 1; i <= 10; i++) {
+        LightbarCommand c = speed((float)i * 3.0f);
+        lightbar_command_push(&queue, &c);
+    }
+    int changed = lightbar_command_apply(&queue, &state, &config, 64, NULL, NULL);
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_COMMAND_CONFIG, changed);
+    TEST_ASSERT_EQUAL_FLOAT(30.0f, config.speed);
+    TEST_ASSERT_EQUAL_UINT64(10, queue.drained);
+    TEST_ASSERT_EQUAL_UINT64(9, queue.coalesced);
+    TEST_ASSERT_EQUAL_INT(0, lightbar_command_apply(&queue, &state, &config, 64, NULL, NULL));
+}
+
+void test_batch_limit_leaves_the_rest(void) {
+    static LightbarCommandSlot slots[16];
+    LightbarCommandQueue queue;
+    LightbarConfig config = { .num_leds = 20, .speed = 10.0f };
+    LightbarState state;
+    lightbar_init(&state, &config);
+    lightbar_command_queue_init(&queue, slots, 16);
+    for (int i = 1; i <= 5; i++) {
+        LightbarCommand c = speed((float)i);
+        lightbar_command_push(&queue, &c);
+    }
+    lightbar_command_apply(&queue, &state, &config, 3, NULL, NULL);
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, config.speed);
+    lightbar_command_apply(&queue, &state, &config, 3, NULL, NULL);
+    TEST_ASSERT_EQUAL_FLOAT(5.0f, config.speed);
+}
+
+static int hook_calls;
+
+static void count_hook(const LightbarCommand *command, const LightbarState *state,
+                       const LightbarConfig *config, void *ctx) {
+    (void)command;
+    (void)state;
+    (void)ctx;
+    TEST_ASSERT_EQUAL_UINT16(4, config->glow_radius);
+    hook_calls++;
+}
+
+/* Coalescing must never change the outcome: random command streams give
+ * the same state and config as calling the core for every command. */
+void test_matches_direct_calls(void) {
+    static LightbarCommandSlot slots[256];
+    LightbarCommandQueue queue;
+    srand(21);
+    for (int round = 0; round < 200; round++) {
+        LightbarConfig config = { .num_leds = 30, .speed = 20.0f, .end_pause_ms = 40 };
+        LightbarConfig direct_config = config;
+        LightbarState state, direct;
+        /* Compared bytewise below, padding included */
+        memset(&state, 0, sizeof(state));
+        memset(&direct, 0, sizeof(direct));
+        lightbar_init(&state, &config);
+        lightbar_init(&direct, &direct_config);
+        lightbar_command_queue_init(&queue, slots, 256);
+        for (int frame = 0; frame < 20; frame++) {
+            int count = rand() % 12;
+            for (int i = 0; i < count; i++) {
+                LightbarCommand c = simple((LightbarCommandType)(rand() % 7));
+                switch (c.type) {
+                case LIGHTBAR_CMD_START: lightbar_start(&direct); break;
+                case LIGHTBAR_CMD_STOP: lightbar_stop(&direct, &direct_config); break;
+                case LIGHTBAR_CMD_SPEED:
+                    c.value.speed = (float)(5 + rand() % 50);
+                    direct_config.speed = c.value.speed;
+                    break;
+                case LIGHTBAR_CMD_END_PAUSE:
+                    c.value.end_pause_ms = (uint16_t)(rand() % 100);
+                    direct_config.end_pause_ms = c.value.end_pause_ms;
+                    break;
+                case LIGHTBAR_CMD_GLOW:
+                    c.value.glow_radius = (uint16_t)(rand() % 5);
+                    direct_config.glow_radius = c.value.glow_radius;
+                    break;
+                case LIGHTBAR_CMD_COLOR:
+                    c.value.color.r = (uint8_t)rand();
+                    direct_config.color = c.value.color;
+                    break;
+                default:
+                    c.value.smooth = (uint8_t)(rand() & 1);
+                    direct_config.smooth = c.value.smooth;
+                    break;
+                }
+                TEST_ASSERT_EQUAL_INT(0, lightbar_command_push(&queue, &c));
+            }
+            lightbar_command_apply(&queue, &state, &config, 256, NULL, NULL);
+            float dt = (float)(1 + rand() % 30);
+            lightbar_update(&state, &config, dt);
+            lightbar_update(&direct, &direct_config, dt);
+            TEST_ASSERT_EQUAL_MEMORY(&direct_config, &config, sizeof(config));
+            TEST_ASSERT_EQUAL_MEMORY(&direct, &state, sizeof(state));
+        }
+    }
+}
+
+void test_stop_sees_config_sent_before_it(void) {
+    static LightbarCommandSlot slots[16];
+    LightbarCommandQueue queue;
+    LightbarConfig config = { .num_leds = 20, .speed = 10.0f };
+    LightbarState state;
+    LightbarCommand c;
+    lightbar_init(&state, &config);
+    lightbar_command_queue_init(&queue, slots, 16);
+    c = simple(LIGHTBAR_CMD_GLOW);
+    c.value.glow_radius = 4;
+    lightbar_command_push(&queue, &c);
+    c = simple(LIGHTBAR_CMD_START);
+    lightbar_command_push(&queue, &c);
+    lightbar_command_push(&queue, &c);
+    c = simple(LIGHTBAR_CMD_STOP);
+    lightbar_command_push(&queue, &c);
+    lightbar_command_push(&queue, &c);
+    c = simple(LIGHTBAR_CMD_GLOW);
+    c.value.glow_radius = 1;
+    lightbar_command_push(&queue, &c);
+
+    hook_calls = 0;
+    lightbar_command_apply(&queue, &state, &config, 5, count_hook, NULL);
+    TEST_ASSERT_EQUAL_INT(2, hook_calls);
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_STOPPING, state.phase);
+    TEST_ASSERT_EQUAL_UINT64(2, queue.coalesced);
+    lightbar_command_apply(&queue, &state, &config, 5, NULL, NULL);
+    TEST_ASSERT_EQUAL_UINT16(1, config.glow_radius);
+}
+
+typedef struct {
+    LightbarCommandQueue *queue;
+    int id;
+} Producer;
+
+static void *produce(void *arg) {
+    Producer *p = arg;
+    for (int i = 0; i < PUSHES; i++) {
+        LightbarCommand c = speed((float)(p->id * PUSHES + i));
+        while (lightbar_command_push(p->queue, &c) != 0) sched_yield();
+    }
+    return NULL;
+}
+
+/* Every command from every producer arrives exactly once, each producer's
+ * in the order it pushed them. */
+void test_concurrent_producers(void) {
+    static LightbarCommandSlot slots[1024];
+    static LightbarCommandQueue queue;
+    pthread_t threads[PRODUCERS];
+    Producer producers[PRODUCERS];
+    int next[PRODUCERS] = { 0 };
+    LightbarCommand c;
+    lightbar_command_queue_init(&queue, slots, 1024);
+    for (int i = 0; i < PRODUCERS; i++) {
+        producers[i].queue = &queue;
+        producers[i].id = i;
+        TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[i], NULL, produce, &producers[i]));
+    }
+    for (int received = 0; received < PRODUCERS * PUSHES;) {
+        if (!lightbar_command_pop(&queue, &c)) {
+            sched_yield();
+            continue;
+        }
+        int value = (int)c.value.speed;
+        int id = value / PUSHES;
+        TEST_ASSERT_EQUAL_INT(next[id], value % PUSHES);
+        next[id]++;
+        received++;
+    }
+    for (int i = 0; i < PRODUCERS; i++) pthread_join(threads[i], NULL);
+    TEST_ASSERT_EQUAL_INT(0, lightbar_command_pop(&queue, &c));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_init_needs_power_of_two);
+    RUN_TEST(test_fifo_and_full_queue_drops);
+    RUN_TEST(test_slider_burst_coalesces);
+    RUN_TEST(test_batch_limit_leaves_the_rest);
+    RUN_TEST(test_matches_direct_calls);
+    RUN_TEST(test_stop_sees_config_sent_before_it);
+    RUN_TEST(test_concurrent_producers);
+    return UNITY_END();
+}
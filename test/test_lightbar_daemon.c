@@ -0,0 +1,181 @@
+#define _GNU_SOURCE
+#include "unity.h"
+#include "lightbar_daemon.h"
+#include "lightbar_stats.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static LightbarDaemon *server;
+static char reply[4096];
+static char sink_path[64];
+
+void setUp(void) {
+    server = lightbar_daemon_create(2);
+    snprintf(sink_path, sizeof(sink_path), "/tmp/test_lightbar_daemon.%d", (int)getpid());
+    unlink(sink_path);
+}
+
+void tearDown(void) {
+    lightbar_daemon_destroy(server);
+    unlink(sink_path);
+}
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+static int command(const char *line) {
+    return lightbar_daemon_command(server, line, reply, sizeof(reply));
+}
+
+static unsigned long long field(const char *name) {
+    const char *p = strstr(reply, name);
+    return p ? strtoull(p + strlen(name), NULL, 10) : 0;
+}
+
+void test_commands_reply_ok_or_err(void) {
+    TEST_ASSERT_NOT_NULL(server);
+    TEST_ASSERT_EQUAL_INT(0, command("add room1 leds=24"));
+    TEST_ASSERT_EQUAL_STRING("ok\n", reply);
+    TEST_ASSERT_EQUAL_INT(-1, command("add room1"));
+    TEST_ASSERT_EQUAL_STRING("err exists\n", reply);
+    TEST_ASSERT_EQUAL_INT(-1, command("start room2"));
+    TEST_ASSERT_EQUAL_STRING("err no such session\n", reply);
+    TEST_ASSERT_EQUAL_INT(-1, command("jump room1"));
+    TEST_ASSERT_EQUAL_STRING("err syntax\n", reply);
+    TEST_ASSERT_EQUAL_INT(-1, command("add room2 sink=/nonexistent/dir/out"));
+    TEST_ASSERT_EQUAL_STRING("err cannot open sink\n", reply);
+}
+
+void test_list_shows_sessions(void) {
+    TEST_ASSERT_EQUAL_INT(0, command("add a leds=10 rate=30"));
+    TEST_ASSERT_EQUAL_INT(0, command("add b"));
+    TEST_ASSERT_EQUAL_INT(0, command("list"));
+    TEST_ASSERT_NOT_NULL(strstr(reply, "a stopped leds=10 rate=30 sink=null\n"));
+    TEST_ASSERT_NOT_NULL(strstr(reply, "b stopped leds=60 rate=60 sink=null\n"));
+    TEST_ASSERT_EQUAL_INT(0, command("remove a"));
+    TEST_ASSERT_EQUAL_INT(0, command("list"));
+    TEST_ASSERT_EQUAL_STRING("b stopped leds=60 rate=60 sink=null\nok\n", reply);
+}
+
+void test_running_session_writes_frames_to_sink(void) {
+    char line[128];
+    struct stat st;
+    snprintf(line, sizeof(line), "add room1 leds=20 rate=200 sink=%s", sink_path);
+    TEST_ASSERT_EQUAL_INT(0, command(line));
+    TEST_ASSERT_EQUAL_INT(0, command("start room1"));
+    sleep_ms(200);
+    TEST_ASSERT_EQUAL_INT(0, command("remove room1"));
+
+    TEST_ASSERT_EQUAL_INT(0, stat(sink_path, &st));
+    TEST_ASSERT_EQUAL_INT(0, st.st_size % (20 * 3));
+    /* About 40 frames; allow for a slow machine */
+    TEST_ASSERT_GREATER_THAN(10, st.st_size / (20 * 3));
+    TEST_ASSERT_LESS_OR_EQUAL(41, st.st_size / (20 * 3));
+}
+
+void test_stop_winds_down_and_ends_ticks(void) {
+    TEST_ASSERT_EQUAL_INT(0, command("add room1 leds=10 speed=200 pause=0 rate=500"));
+    TEST_ASSERT_EQUAL_INT(0, command("start room1"));
+    sleep_ms(50);
+    TEST_ASSERT_EQUAL_INT(0, command("stop room1"));
+    sleep_ms(200);
+    TEST_ASSERT_EQUAL_INT(0, command("list"));
+    TEST_ASSERT_NOT_NULL(strstr(reply, "room1 stopped"));
+    TEST_ASSERT_EQUAL_INT(0, command("stats room1"));
+    unsigned long long ticks = field("ticks=");
+    TEST_ASSERT_GREATER_THAN(0, ticks);
+    sleep_ms(50);
+    TEST_ASSERT_EQUAL_INT(0, command("stats room1"));
+    TEST_ASSERT_EQUAL_UINT64(ticks, field("ticks="));
+}
+
+void test_stats_counts_ticks_across_workers(void) {
+    TEST_ASSERT_EQUAL_INT(0, command("add a rate=100"));
+    TEST_ASSERT_EQUAL_INT(0, command("add b rate=100"));
+    TEST_ASSERT_EQUAL_INT(0, command("add c rate=100"));
+    TEST_ASSERT_EQUAL_INT(0, command("start a"));
+    TEST_ASSERT_EQUAL_INT(0, command("start b"));
+    TEST_ASSERT_EQUAL_INT(0, command("start c"));
+    sleep_ms(100);
+    TEST_ASSERT_EQUAL_INT(0, command("stats"));
+    TEST_ASSERT_EQUAL_UINT64(3, field("sessions="));
+    TEST_ASSERT_EQUAL_UINT64(2, field("workers="));
+    TEST_ASSERT_GREATER_THAN(3, field("ticks="));
+}
+
+void test_published_stats_follow_sessions(void) {
+    char name[64];
+    LightbarStats stats;
+    LightbarStatsSlot slot;
+    snprintf(name, sizeof(name), "/test_lightbar_daemon.%d", (int)getpid());
+    TEST_ASSERT_EQUAL_INT(0, command("add early leds=10"));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_daemon_publish_stats(server, name, 4));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_stats_open(&stats, name));
+    TEST_ASSERT_EQUAL_INT(0, command("add room1 leds=10 speed=200 pause=20 rate=500"));
+    TEST_ASSERT_EQUAL_INT(0, command("start room1"));
+    sleep_ms(150);
+    TEST_ASSERT_EQUAL_INT(0, command("stop room1"));
+    sleep_ms(150);
+
+    /* Slot 0 went to the session that existed before publishing */
+    TEST_ASSERT_EQUAL_INT(1, lightbar_stats_sample(&stats, 0, &slot));
+    TEST_ASSERT_EQUAL_STRING("early", slot.name);
+    TEST_ASSERT_EQUAL_UINT64(0, slot.frames);
+    TEST_ASSERT_EQUAL_INT(1, lightbar_stats_sample(&stats, 1, &slot));
+    TEST_ASSERT_EQUAL_STRING("room1", slot.name);
+    TEST_ASSERT_GREATER_THAN(10, slot.frames);
+    /* 200 LEDs/s for about 150 ms plus the wind-down */
+    TEST_ASSERT_GREATER_THAN(20, slot.steps);
+    TEST_ASSERT_TRUE(slot.max_steps >= 1 && slot.max_steps < 10);
+    TEST_ASSERT_GREATER_THAN(1, slot.edges);
+    TEST_ASSERT_EQUAL_UINT64(slot.edges, slot.pauses);
+    TEST_ASSERT_EQUAL_UINT64(1, slot.stops);
+    TEST_ASSERT_GREATER_THAN(0, slot.stop_ns_max);
+    TEST_ASSERT_TRUE(slot.render_ns_min <= slot.render_ns_max);
+
+    TEST_ASSERT_EQUAL_INT(0, command("remove room1"));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_stats_sample(&stats, 1, &slot));
+    lightbar_stats_close(&stats);
+}
+
+/* Thousands of edges per tick, far more events than one tick collects */
+void test_published_stats_count_busy_ticks_in_full(void) {
+    char name[64];
+    LightbarStats stats;
+    LightbarStatsSlot slot;
+    snprintf(name, sizeof(name), "/test_lightbar_daemon_busy.%d", (int)getpid());
+    TEST_ASSERT_EQUAL_INT(0, lightbar_daemon_publish_stats(server, name, 1));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_stats_open(&stats, name));
+    TEST_ASSERT_EQUAL_INT(0, command("add busy leds=3 speed=100000 pause=0 rate=10"));
+    TEST_ASSERT_EQUAL_INT(0, command("start busy"));
+    sleep_ms(350);
+    TEST_ASSERT_EQUAL_INT(1, lightbar_stats_sample(&stats, 0, &slot));
+    TEST_ASSERT_GREATER_THAN(1, slot.frames);
+    /* 100 ms at 100000 LEDs/s, turning every second step */
+    uint32_t frames = (uint32_t)slot.frames;
+    TEST_ASSERT_UINT32_WITHIN(1, 10000, (uint32_t)slot.max_steps);
+    TEST_ASSERT_UINT32_WITHIN(2 * frames, frames * 5000, (uint32_t)slot.edges);
+    TEST_ASSERT_UINT32_WITHIN(frames, frames * 10000, (uint32_t)slot.steps);
+    TEST_ASSERT_EQUAL_UINT64(0, slot.pauses);
+    lightbar_stats_close(&stats);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_commands_reply_ok_or_err);
+    RUN_TEST(test_list_shows_sessions);
+    RUN_TEST(test_running_session_writes_frames_to_sink);
+    RUN_TEST(test_stop_winds_down_and_ends_ticks);
+    RUN_TEST(test_stats_counts_ticks_across_workers);
+    RUN_TEST(test_published_stats_follow_sessions);
+    RUN_TEST(test_published_stats_count_busy_ticks_in_full);
+    return UNITY_END();
+}
@@ -0,0 +1,166 @@
+#include "unity.h"
+#include "lightbar_fleet.h"
+#include <stdlib.h>
+#include <string.h>
+
+static LightbarFleet fleet;
+
+void setUp(void) {
+    lightbar_fleet_init(&fleet, 64);
+}
+
+void tearDown(void) {
+    lightbar_fleet_free(&fleet);
+}
+
+static void assert_same_state(const LightbarState *expected, const LightbarState *actual) {
+    TEST_ASSERT_EQUAL_INT(expected->position, actual->position);
+    TEST_ASSERT_EQUAL_INT(expected->direction, actual->direction);
+    TEST_ASSERT_EQUAL_INT(expected->phase, actual->phase);
+    TEST_ASSERT_EQUAL_UINT8(expected->edges_remaining, actual->edges_remaining);
+    TEST_ASSERT_EQUAL_MEMORY(&expected->pause_timer_ms, &actual->pause_timer_ms, sizeof(float));
+    TEST_ASSERT_EQUAL_MEMORY(&expected->move_accum_ms, &actual->move_accum_ms, sizeof(float));
+}
+
+void test_add_initialises_like_lightbar_init(void) {
+    LightbarConfig config = { .num_leds = 24, .speed = 10.0f };
+    LightbarState expected, actual;
+    lightbar_init(&expected, &config);
+    TEST_ASSERT_EQUAL_INT(0, lightbar_fleet_add(&fleet, &config));
+    lightbar_fleet_get_state(&fleet, 0, &actual);
+    assert_same_state(&expected, &actual);
+}
+
+void test_add_assigns_led_offsets(void) {
+    LightbarConfig a = { .num_leds = 10 };
+    LightbarConfig b = { .num_leds = 7 };
+    lightbar_fleet_add(&fleet, &a);
+    lightbar_fleet_add(&fleet, &b);
+    lightbar_fleet_add(&fleet, &a);
+    TEST_ASSERT_EQUAL_UINT32(0, fleet.led_offset[0]);
+    TEST_ASSERT_EQUAL_UINT32(10, fleet.led_offset[1]);
+    TEST_ASSERT_EQUAL_UINT32(17, fleet.led_offset[2]);
+    TEST_ASSERT_EQUAL_UINT32(27, fleet.total_leds);
+}
+
+void test_add_fails_when_full(void) {
+    LightbarFleet small;
+    LightbarConfig config = { .num_leds = 10 };
+    lightbar_fleet_init(&small, 1);
+    TEST_ASSERT_EQUAL_INT(0, lightbar_fleet_add(&small, &config));
+    TEST_ASSERT_EQUAL_INT(-1, lightbar_fleet_add(&small, &config));
+    lightbar_fleet_free(&small);
+}
+
+void test_update_advances_moving_instance(void) {
+    LightbarConfig config = { .num_leds = 24, .speed = 10.0f };
+    LightbarState state;
+    lightbar_fleet_add(&fleet, &config);
+    lightbar_fleet_start(&fleet, 0);
+    lightbar_fleet_update(&fleet, 300.0f);
+    lightbar_fleet_get_state(&fleet, 0, &state);
+    TEST_ASSERT_EQUAL_INT(15, state.position);
+}
+
+void test_update_mixed_phases(void) {
+    LightbarConfig config = { .num_leds = 10, .speed = 100.0f, .end_pause_ms = 50 };
+    LightbarState s;
+    for (int i = 0; i < 4; i++) {
+        lightbar_fleet_add(&fleet, &config);
+    }
+    /* 0: stopped, 1: moving, 2: paused at right edge, 3: winding down */
+    lightbar_fleet_start(&fleet, 1);
+    lightbar_fleet_get_state(&fleet, 2, &s);
+    s.phase = LIGHTBAR_PAUSED_END;
+    s.position = 9;
+    s.pause_timer_ms = 20.0f;
+    lightbar_fleet_set_state(&fleet, 2, &s);
+    lightbar_fleet_start(&fleet, 3);
+    lightbar_fleet_get_state(&fleet, 3, &s);
+    s.position = 3;
+    lightbar_fleet_set_state(&fleet, 3, &s);
+    lightbar_fleet_stop(&fleet, 3);
+
+    lightbar_fleet_update(&fleet, 20.0f);
+
+    lightbar_fleet_get_state(&fleet, 0, &s);
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_STOPPED, s.phase);
+    TEST_ASSERT_EQUAL_INT(5, s.position);
+    lightbar_fleet_get_state(&fleet, 1, &s);
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_MOVING, s.phase);
+    TEST_ASSERT_EQUAL_INT(7, s.position);
+    lightbar_fleet_get_state(&fleet, 2, &s);
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_MOVING, s.phase);
+    TEST_ASSERT_EQUAL_INT(-1, s.direction);
+    lightbar_fleet_get_state(&fleet, 3, &s);
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_STOPPED, s.phase);
+    TEST_ASSERT_EQUAL_INT(5, s.position);
+}
+
+void test_update_matches_scalar_lightbar_update(void) {
+    enum { N = 64 };
+    LightbarConfig configs[N];
+    LightbarState states[N];
+    srand(1234);
+    for (int i = 0; i < N; i++) {
+        LightbarConfig c = {
+            .num_leds = (uint8_t)(1 + rand() % 40),
+            .speed = (float)(rand() % 80),
+            .end_pause_ms = (uint16_t)((rand() % 3) ? rand() % 300 : 0),
+            .glow_radius = (uint8_t)(rand() % 4),
+            .color = { 255, 128, 0 }
+        };
+        configs[i] = c;
+        lightbar_init(&states[i], &c);
+        lightbar_fleet_add(&fleet, &c);
+    }
+    for (int frame = 0; frame < 2000; frame++) {
+        float dt = (frame % 97 == 0) ? 1500.0f : (float)(rand() % 40) + 0.37f;
+        for (int i = 0; i < N; i++) {
+            int action = rand() % 200;
+            if (action == 0) {
+                lightbar_start(&states[i]);
+                lightbar_fleet_start(&fleet, (uint32_t)i);
+            } else if (action == 1) {
+                lightbar_stop(&states[i], &configs[i]);
+                lightbar_fleet_stop(&fleet, (uint32_t)i);
+            }
+            lightbar_update(&states[i], &configs[i], dt);
+        }
+        lightbar_fleet_update(&fleet, dt);
+        for (int i = 0; i < N; i++) {
+            LightbarState actual;
+            lightbar_fleet_get_state(&fleet, (uint32_t)i, &actual);
+            assert_same_state(&states[i], &actual);
+        }
+    }
+}
+
+void test_render_matches_scalar_lightbar_render(void) {
+    LightbarConfig a = { .num_leds = 10, .glow_radius = 2, .color = { 255, 255, 255 } };
+    LightbarConfig b = { .num_leds = 5, .glow_radius = 1, .color = { 0, 200, 100 } };
+    Led expected[15];
+    Led actual[15];
+    LightbarState s;
+    lightbar_fleet_add(&fleet, &a);
+    lightbar_fleet_add(&fleet, &b);
+    lightbar_fleet_get_state(&fleet, 0, &s);
+    lightbar_render(&s, &a, expected);
+    lightbar_fleet_get_state(&fleet, 1, &s);
+    lightbar_render(&s, &b, expected + 10);
+    memset(actual, 0xAA, sizeof(actual));
+    lightbar_fleet_render(&fleet, actual);
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, sizeof(expected));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_add_initialises_like_lightbar_init);
+    RUN_TEST(test_add_assigns_led_offsets);
+    RUN_TEST(test_add_fails_when_full);
+    RUN_TEST(test_update_advances_moving_instance);
+    RUN_TEST(test_update_mixed_phases);
+    RUN_TEST(test_update_matches_scalar_lightbar_update);
+    RUN_TEST(test_render_matches_scalar_lightbar_render);
+    return UNITY_END();
+}
@@ -0,0 +1,240 @@
+#include "unity.h"
+#include "lightbar_fx.h"
+#include <stdlib.h>
+#include <string.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void make_configs(LightbarConfig *config, LightbarFxConfig *fx,
+                         uint16_t num_leds, float speed, uint16_t end_pause_ms) {
+    LightbarConfig c = {
+        .num_leds = num_leds, .speed = speed, .end_pause_ms = end_pause_ms,
+        .glow_radius = 2, .color = { 255, 128, 64 }
+    };
+    *config = c;
+    memset(fx, 0, sizeof(*fx));
+    fx->num_leds = num_leds;
+    fx->end_pause_ms = end_pause_ms;
+    fx->glow_radius = c.glow_radius;
+    fx->color = c.color;
+    lightbar_fx_set_speed(fx, LIGHTBAR_FX_SPEED(speed));
+}
+
+void test_set_speed_derives_step_time(void) {
+    LightbarFxConfig config = { .num_leds = 24 };
+    lightbar_fx_set_speed(&config, LIGHTBAR_FX_SPEED(10.0));
+    TEST_ASSERT_EQUAL_UINT32(100000, config.us_per_step);
+    lightbar_fx_set_speed(&config, LIGHTBAR_FX_SPEED(15.0));
+    TEST_ASSERT_EQUAL_UINT32(66666, config.us_per_step);
+    lightbar_fx_set_speed(&config, 0);
+    TEST_ASSERT_EQUAL_UINT32(0, config.us_per_step);
+}
+
+void test_init_sets_middle_and_stopped(void) {
+    LightbarFxConfig config = { .num_leds = 21 };
+    LightbarFxState state;
+    lightbar_fx_init(&state, &config);
+    TEST_ASSERT_EQUAL_INT(10, state.position);
+    TEST_ASSERT_EQUAL_INT(1, state.direction);
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_STOPPED, state.phase);
+}
+
+void test_update_advances_position(void) {
+    LightbarConfig unused;
+    LightbarFxConfig config;
+    LightbarFxState state;
+    make_configs(&unused, &config, 24, 10.0f, 0);
+    lightbar_fx_init(&state, &config);
+    lightbar_fx_start(&state);
+    lightbar_fx_update(&state, &config, 50000);
+    TEST_ASSERT_EQUAL_INT(12, state.position);
+    lightbar_fx_update(&state, &config, 250000);
+    TEST_ASSERT_EQUAL_INT(15, state.position);
+}
+
+void test_update_pauses_at_end(void) {
+    LightbarConfig unused;
+    LightbarFxConfig config;
+    LightbarFxState state;
+    make_configs(&unused, &config, 10, 100.0f, 50);
+    lightbar_fx_init(&state, &config);
+    lightbar_fx_start(&state);
+    lightbar_fx_update(&state, &config, 40000);
+    TEST_ASSERT_EQUAL_INT(9, state.position);
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_PAUSED_END, state.phase);
+    TEST_ASSERT_EQUAL_INT32(50000, state.pause_timer_us);
+    lightbar_fx_update(&state, &config, 50000);
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_MOVING, state.phase);
+    TEST_ASSERT_EQUAL_INT(-1, state.direction);
+}
+
+void test_stop_winds_down_to_middle(void) {
+    LightbarConfig unused;
+    LightbarFxConfig config;
+    LightbarFxState state;
+    make_configs(&unused, &config, 10, 100.0f, 50);
+    lightbar_fx_init(&state, &config);
+    lightbar_fx_start(&state);
+    lightbar_fx_update(&state, &config, 20000);
+    lightbar_fx_stop(&state, &config);
+    TEST_ASSERT_EQUAL_UINT8(2, state.edges_remaining);
+    for (int i = 0; i < 100 && state.phase != LIGHTBAR_STOPPED; i++) {
+        lightbar_fx_update(&state, &config, 10000);
+    }
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_STOPPED, state.phase);
+    TEST_ASSERT_EQUAL_INT(5, state.position);
+    TEST_ASSERT_EQUAL_UINT8(0, state.edges_remaining);
+}
+
+/* With whole-millisecond step times and frames, both versions see exactly
+ * the same time and must agree frame by frame. */
+void test_matches_float_frame_by_frame(void) {
+    LightbarConfig config;
+    LightbarFxConfig fx;
+    LightbarState state;
+    LightbarFxState fx_state;
+    make_configs(&config, &fx, 37, 40.0f, 120);
+    lightbar_init(&state, &config);
+    lightbar_fx_init(&fx_state, &fx);
+    lightbar_start(&state);
+    lightbar_fx_start(&fx_state);
+    srand(99);
+    /* About 30 simulated minutes */
+    for (int frame = 0; frame < 100000; frame++) {
+        int dt_ms = 1 + rand() % 33;
+        if (frame % 5000 == 4000) {
+            lightbar_stop(&state, &config);
+            lightbar_fx_stop(&fx_state, &fx);
+        } else if (frame % 5000 == 4500) {
+            lightbar_start(&state);
+            lightbar_fx_start(&fx_state);
+        }
+        lightbar_update(&state, &config, (float)dt_ms);
+        lightbar_fx_update(&fx_state, &fx, (uint32_t)dt_ms * 1000);
+        TEST_ASSERT_EQUAL_INT(state.position, fx_state.position);
+        TEST_ASSERT_EQUAL_INT(state.direction, fx_state.direction);
+        TEST_ASSERT_EQUAL_INT(state.phase, fx_state.phase);
+        TEST_ASSERT_EQUAL_UINT8(state.edges_remaining, fx_state.edges_remaining);
+    }
+}
+
+/* With a step time that is not a whole number of microseconds the two
+ * versions may step a frame apart, but must visit the same positions in
+ * the same order. */
+void test_matches_float_step_sequence(void) {
+    enum { STEPS = 4000 };
+    static int float_steps[STEPS];
+    static int fx_steps[STEPS];
+    int n_float = 0;
+    int n_fx = 0;
+    LightbarConfig config;
+    LightbarFxConfig fx;
+    LightbarState state;
+    LightbarFxState fx_state;
+    make_configs(&config, &fx, 24, 15.0f, 200);
+    lightbar_init(&state, &config);
+    lightbar_fx_init(&fx_state, &fx);
+    lightbar_start(&state);
+    lightbar_fx_start(&fx_state);
+    int last_float = state.position;
+    int last_fx = fx_state.position;
+    while (n_float < STEPS || n_fx < STEPS) {
+        lightbar_update(&state, &config, 16.0f);
+        lightbar_fx_update(&fx_state, &fx, 16000);
+        if (state.position != last_float && n_float < STEPS) {
+            float_steps[n_float++] = state.position;
+            last_float = state.position;
+        }
+        if (fx_state.position != last_fx && n_fx < STEPS) {
+            fx_steps[n_fx++] = fx_state.position;
+            last_fx = fx_state.position;
+        }
+    }
+    TEST_ASSERT_EQUAL_INT_ARRAY(float_steps, fx_steps, STEPS);
+}
+
+/* Stalls past 2^31 us, from every phase, land where the float version does */
+void test_long_stalls_match_float(void) {
+    static const uint32_t stalls_us[] = { 2500000000u, 3000000000u, 4294967000u };
+    static const uint16_t pauses_ms[] = { 0, 120 };
+    for (int p = 0; p < 2; p++) {
+        LightbarConfig config;
+        LightbarFxConfig fx;
+        LightbarState state;
+        LightbarFxState fx_state;
+        make_configs(&config, &fx, 37, 40.0f, pauses_ms[p]);
+        lightbar_init(&state, &config);
+        lightbar_fx_init(&fx_state, &fx);
+        lightbar_start(&state);
+        lightbar_fx_start(&fx_state);
+        for (int frame = 0; frame < 3000; frame++) {
+            uint32_t dt_us = frame % 7 == 3 ? stalls_us[frame % 3] : 16000;
+            if (frame % 500 == 400) {
+                lightbar_stop(&state, &config);
+                lightbar_fx_stop(&fx_state, &fx);
+            } else if (frame % 500 == 450) {
+                lightbar_start(&state);
+                lightbar_fx_start(&fx_state);
+            }
+            lightbar_update(&state, &config, (float)(dt_us / 1000));
+            lightbar_fx_update(&fx_state, &fx, dt_us);
+            TEST_ASSERT_EQUAL_INT(state.position, fx_state.position);
+            TEST_ASSERT_EQUAL_INT(state.direction, fx_state.direction);
+            TEST_ASSERT_EQUAL_INT(state.phase, fx_state.phase);
+            TEST_ASSERT_EQUAL_UINT8(state.edges_remaining, fx_state.edges_remaining);
+            TEST_ASSERT_TRUE(fx_state.pause_timer_us >= 0);
+            TEST_ASSERT_TRUE(fx_state.move_accum_us < fx.us_per_step);
+        }
+    }
+}
+
+void test_render_matches_float(void) {
+    LightbarConfig config;
+    LightbarFxConfig fx;
+    LightbarState state;
+    LightbarFxState fx_state;
+    Led expected[30], actual[30];
+    make_configs(&config, &fx, 30, 25.0f, 0);
+    lightbar_init(&state, &config);
+    lightbar_fx_init(&fx_state, &fx);
+    for (int pos = 0; pos < 30; pos++) {
+        state.position = pos;
+        fx_state.position = pos;
+        lightbar_render(&state, &config, expected);
+        lightbar_fx_render(&fx_state, &fx, actual);
+        TEST_ASSERT_EQUAL_MEMORY(expected, actual, sizeof(expected));
+    }
+}
+
+void test_render_smooth_blends_by_progress(void) {
+    LightbarConfig unused;
+    LightbarFxConfig config;
+    LightbarFxState state;
+    Led leds[10];
+    make_configs(&unused, &config, 10, 10.0f, 0);
+    config.glow_radius = 0;
+    config.color.r = 255;
+    config.smooth = 1;
+    lightbar_fx_init(&state, &config);
+    lightbar_fx_start(&state);
+    lightbar_fx_update(&state, &config, 75000);
+    lightbar_fx_render(&state, &config, leds);
+    TEST_ASSERT_EQUAL_UINT8(63, leds[5].r);
+    TEST_ASSERT_EQUAL_UINT8(191, leds[6].r);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_set_speed_derives_step_time);
+    RUN_TEST(test_init_sets_middle_and_stopped);
+    RUN_TEST(test_update_advances_position);
+    RUN_TEST(test_update_pauses_at_end);
+    RUN_TEST(test_stop_winds_down_to_middle);
+    RUN_TEST(test_matches_float_frame_by_frame);
+    RUN_TEST(test_matches_float_step_sequence);
+    RUN_TEST(test_long_stalls_match_float);
+    RUN_TEST(test_render_matches_float);
+    RUN_TEST(test_render_smooth_blends_by_progress);
+    return UNITY_END();
+}
@@ -0,0 +1,120 @@
+#include "unity.h"
+#include "lightbar_handoff.h"
+#include <pthread.h>
+#include <string.h>
+
+#define WRITERS 3
+#define PUBLISHES 200000
+
+void setUp(void) {}
+void tearDown(void) {}
+
+/* Every field follows from v, so a torn copy shows up as a mismatch. */
+static LightbarConfig config_for(uint32_t v) {
+    LightbarConfig config;
+    memset(&config, 0, sizeof(config));
+    config.num_leds = (uint16_t)(1 + v % 1000);
+    config.speed = (float)(v % 100000);
+    config.end_pause_ms = (uint16_t)(v * 7);
+    config.glow_radius = (uint16_t)(v % 33);
+    config.color.r = (uint8_t)v;
+    config.color.g = (uint8_t)(v >> 8);
+    config.color.b = (uint8_t)(v >> 16);
+    config.smooth = (uint8_t)(v & 1);
+    return config;
+}
+
+static int consistent(const LightbarConfig *config, uint32_t *v) {
+    *v = (uint32_t)config->color.r | (uint32_t)config->color.g << 8 |
+         (uint32_t)config->color.b << 16;
+    LightbarConfig expected = config_for(*v);
+    return memcmp(&expected, config, sizeof(expected)) == 0;
+}
+
+void test_poll_takes_initial_then_only_changes(void) {
+    LightbarHandoff handoff;
+    LightbarConfig initial = config_for(5);
+    LightbarConfig config;
+    uint32_t seen = 0;
+    lightbar_handoff_init(&handoff, &initial);
+
+    TEST_ASSERT_EQUAL_INT(1, lightbar_handoff_poll(&handoff, &config, &seen));
+    TEST_ASSERT_EQUAL_MEMORY(&initial, &config, sizeof(config));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_handoff_poll(&handoff, &config, &seen));
+
+    LightbarConfig next = config_for(6);
+    lightbar_handoff_publish(&handoff, &next);
+    lightbar_handoff_publish(&handoff, &initial);
+    lightbar_handoff_publish(&handoff, &next);
+    TEST_ASSERT_EQUAL_INT(1, lightbar_handoff_poll(&handoff, &config, &seen));
+    TEST_ASSERT_EQUAL_MEMORY(&next, &config, sizeof(config));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_handoff_poll(&handoff, &config, &seen));
+}
+
+void test_pointers_pass_through(void) {
+    LightbarHandoff handoff;
+    LightbarLut lut;
+    LightbarConfig initial = config_for(1);
+    LightbarConfig config;
+    uint32_t seen = 0;
+    lightbar_lut_init(&lut, 100, 1);
+    lightbar_handoff_init(&handoff, &initial);
+    initial.lut = &lut;
+    lightbar_handoff_publish(&handoff, &initial);
+    TEST_ASSERT_EQUAL_INT(1, lightbar_handoff_poll(&handoff, &config, &seen));
+    TEST_ASSERT_TRUE(config.lut == &lut);
+}
+
+typedef struct {
+    LightbarHandoff *handoff;
+    uint32_t first;
+} Writer;
+
+static void *write_configs(void *arg) {
+    Writer *w = arg;
+    for (uint32_t i = 0; i < PUBLISHES; i++) {
+        LightbarConfig config = config_for(w->first + i * WRITERS);
+        lightbar_handoff_publish(w->handoff, &config);
+    }
+    return NULL;
+}
+
+/* Writers hammer the handoff while this thread polls it like a frame loop:
+ * every config taken must be whole, versions only move forward, and once
+ * the writers stop the last publish is what the poller ends up with. */
+void test_concurrent_publishers_never_tear(void) {
+    static LightbarHandoff handoff;
+    LightbarConfig initial = config_for(0);
+    LightbarConfig config;
+    pthread_t threads[WRITERS];
+    Writer writers[WRITERS];
+    const uint32_t last = 2 + 2u * WRITERS * PUBLISHES;
+    uint32_t seen = 0, v;
+    uint64_t taken = 0;
+    lightbar_handoff_init(&handoff, &initial);
+
+    for (int i = 0; i < WRITERS; i++) {
+        writers[i].handoff = &handoff;
+        writers[i].first = (uint32_t)i + 1;
+        TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[i], NULL, write_configs, &writers[i]));
+    }
+    while (seen != last) {
+        uint32_t before = seen;
+        if (!lightbar_handoff_poll(&handoff, &config, &seen)) continue;
+        TEST_ASSERT_TRUE(seen > before);
+        TEST_ASSERT_TRUE(consistent(&config, &v));
+        taken++;
+    }
+    for (int i = 0; i < WRITERS; i++) pthread_join(threads[i], NULL);
+
+    TEST_ASSERT_TRUE(consistent(&config, &v));
+    TEST_ASSERT_TRUE(taken > 1);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_poll_takes_initial_then_only_changes);
+    RUN_TEST(test_pointers_pass_through);
+    RUN_TEST(test_concurrent_publishers_never_tear);
+    return UNITY_END();
+}
@@ -0,0 +1,84 @@
+#include "unity.h"
+#include "lightbar_hist.h"
+#include <stdlib.h>
+#include <string.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_empty_histogram(void) {
+    LightbarHist hist;
+    lightbar_hist_init(&hist);
+    TEST_ASSERT_EQUAL_UINT64(0, hist.count);
+    TEST_ASSERT_EQUAL_UINT64(0, lightbar_hist_quantile(&hist, 0.5));
+}
+
+void test_small_values_are_exact(void) {
+    LightbarHist hist;
+    lightbar_hist_init(&hist);
+    for (uint64_t v = 0; v < 16; v++) lightbar_hist_record(&hist, v);
+    TEST_ASSERT_EQUAL_UINT64(0, hist.min);
+    TEST_ASSERT_EQUAL_UINT64(15, hist.max);
+    TEST_ASSERT_EQUAL_UINT64(7, lightbar_hist_quantile(&hist, 0.5));
+    TEST_ASSERT_EQUAL_UINT64(15, lightbar_hist_quantile(&hist, 1.0));
+}
+
+void test_quantiles_within_bucket_precision(void) {
+    static uint64_t values[10000];
+    LightbarHist hist;
+    lightbar_hist_init(&hist);
+    srand(7);
+    for (int i = 0; i < 10000; i++) {
+        values[i] = (uint64_t)rand() * 1000u;
+        lightbar_hist_record(&hist, values[i]);
+    }
+    /* Count the values at or below each reported quantile */
+    const double qs[] = { 0.5, 0.9, 0.99 };
+    for (int j = 0; j < 3; j++) {
+        uint64_t v = lightbar_hist_quantile(&hist, qs[j]);
+        int below = 0, below_bucket = 0;
+        for (int i = 0; i < 10000; i++) {
+            if (values[i] <= v) below++;
+            if (values[i] <= v - v / 16) below_bucket++;
+        }
+        TEST_ASSERT_TRUE(below >= (int)(qs[j] * 10000));
+        TEST_ASSERT_TRUE(below_bucket < (int)(qs[j] * 10000));
+    }
+}
+
+void test_huge_values_land_in_range(void) {
+    LightbarHist hist;
+    lightbar_hist_init(&hist);
+    lightbar_hist_record(&hist, UINT64_MAX);
+    lightbar_hist_record(&hist, 1ull << 63);
+    TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, lightbar_hist_quantile(&hist, 1.0));
+    TEST_ASSERT_EQUAL_UINT64(1ull << 63, hist.min);
+    /* Upper bound of the bucket holding 2^63, about 6% above it */
+    TEST_ASSERT_EQUAL_UINT64((17ull << 59) - 1, lightbar_hist_quantile(&hist, 0.5));
+}
+
+void test_print_scales_values(void) {
+    char line[256];
+    LightbarHist hist;
+    FILE *out = tmpfile();
+    TEST_ASSERT_NOT_NULL(out);
+    lightbar_hist_init(&hist);
+    lightbar_hist_record(&hist, 2000);
+    lightbar_hist_record(&hist, 4000);
+    lightbar_hist_print(&hist, "late", 1000.0, out);
+    rewind(out);
+    TEST_ASSERT_NOT_NULL(fgets(line, sizeof(line), out));
+    fclose(out);
+    TEST_ASSERT_NOT_NULL(strstr(line, "count=2 mean=3.0"));
+    TEST_ASSERT_NOT_NULL(strstr(line, "max=4.0"));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_histogram);
+    RUN_TEST(test_small_values_are_exact);
+    RUN_TEST(test_quantiles_within_bucket_precision);
+    RUN_TEST(test_huge_values_land_in_range);
+    RUN_TEST(test_print_scales_values);
+    return UNITY_END();
+}
@@ -0,0 +1,172 @@
+#include "unity.h"
+#include "lightbar_layout.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_CHANNELS 3
+#define MAX_PHYSICAL 400
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static Led channel_data[MAX_CHANNELS][MAX_PHYSICAL];
+static Led *channels[MAX_CHANNELS] = { channel_data[0], channel_data[1], channel_data[2] };
+
+/* Renders the logical frame and copies it out entry by entry, the way a
+ * driver would without a compiled map. */
+static void assert_matches_render(const LightbarLayout *layout, const LightbarState *state,
+                                  const LightbarConfig *config) {
+    static Led leds[MAX_PHYSICAL];
+    static Led expected[MAX_CHANNELS][MAX_PHYSICAL];
+    lightbar_render(state, config, leds);
+    memset(expected, 0, sizeof(expected));
+    for (size_t i = 0; i < layout->count; i++) {
+        const LightbarLayoutEntry *e = &layout->entries[i];
+        expected[e->pixel.channel][e->pixel.index] = leds[e->logical];
+    }
+    for (int c = 0; c < layout->num_channels; c++) {
+        TEST_ASSERT_EQUAL_MEMORY(expected[c], channels[c], layout->channel_leds[c] * sizeof(Led));
+    }
+}
+
+/* 60 logical LEDs: 0-29 forward on channel 0 after 5 unused LEDs, 30-39 a
+ * gap, 40-59 reversed on channel 1 and mirrored onto channel 2. */
+static void build_rig(LightbarLayout *layout) {
+    const uint32_t leds[MAX_CHANNELS] = { 40, 30, 20 };
+    TEST_ASSERT_EQUAL_INT(0, lightbar_layout_init(layout, 60, MAX_CHANNELS, leds));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_layout_segment(layout, 0, 30, 0, 5, 0));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_layout_segment(layout, 40, 20, 1, 10, 1));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_layout_segment(layout, 40, 20, 2, 0, 0));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_layout_compile(layout));
+}
+
+void test_single_segment_matches_render(void) {
+    const uint32_t leds = 60;
+    LightbarConfig config = { .num_leds = 60, .speed = 40.0f, .glow_radius = 3,
+                              .color = { 255, 128, 0 } };
+    LightbarState state;
+    LightbarLayout layout;
+    LightbarLayoutOutput out;
+    TEST_ASSERT_EQUAL_INT(0, lightbar_layout_init(&layout, 60, 1, &leds));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_layout_segment(&layout, 0, 60, 0, 0, 0));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_layout_compile(&layout));
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    lightbar_layout_output_init(&out, channels);
+    for (int frame = 0; frame < 200; frame++) {
+        static Led expected[60];
+        lightbar_update(&state, &config, 16.0f);
+        lightbar_layout_render(&out, &layout, &state, &config);
+        lightbar_render(&state, &config, expected);
+        TEST_ASSERT_EQUAL_MEMORY(expected, channels[0], sizeof(expected));
+    }
+    lightbar_layout_free(&layout);
+}
+
+void test_segments_reversal_gaps_and_channels(void) {
+    LightbarConfig config = { .num_leds = 60, .speed = 10.0f, .color = { 1, 2, 3 } };
+    LightbarState state;
+    LightbarLayout layout;
+    LightbarLayoutOutput out;
+    build_rig(&layout);
+    lightbar_init(&state, &config);
+    lightbar_layout_output_init(&out, channels);
+    memset(channel_data, 0xAB, sizeof(channel_data));
+
+    state.position = 2;
+    lightbar_layout_render(&out, &layout, &state, &config);
+    TEST_ASSERT_EQUAL_UINT8(3, channels[0][7].b);
+    TEST_ASSERT_EQUAL_UINT8(0, channels[0][0].b);
+    TEST_ASSERT_EQUAL_UINT8(0, channels[0][39].b);
+
+    state.position = 45;
+    lightbar_layout_render(&out, &layout, &state, &config);
+    TEST_ASSERT_EQUAL_UINT8(0, channels[0][7].b);
+    /* Logical 45 is the sixth LED of the reversed run ending at 29 */
+    TEST_ASSERT_EQUAL_UINT8(3, channels[1][24].b);
+    TEST_ASSERT_EQUAL_UINT8(3, channels[2][5].b);
+    assert_matches_render(&layout, &state, &config);
+
+    state.position = 35;
+    lightbar_layout_render(&out, &layout, &state, &config);
+    for (int c = 0; c < MAX_CHANNELS; c++) {
+        for (uint32_t i = 0; i < layout.channel_leds[c]; i++) {
+            TEST_ASSERT_EQUAL_UINT8(0, channels[c][i].r);
+        }
+    }
+    lightbar_layout_free(&layout);
+}
+
+void test_serpentine_lights_a_column(void) {
+    const uint32_t leds = 12;
+    LightbarConfig config = { .num_leds = 4, .speed = 10.0f, .color = { 9, 9, 9 } };
+    LightbarState state;
+    LightbarLayout layout;
+    LightbarLayoutOutput out;
+    TEST_ASSERT_EQUAL_INT(0, lightbar_layout_init(&layout, 4, 1, &leds));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_layout_serpentine(&layout, 0, 4, 3, 0, 0));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_layout_compile(&layout));
+    lightbar_init(&state, &config);
+    lightbar_layout_output_init(&out, channels);
+
+    state.position = 1;
+    lightbar_layout_render(&out, &layout, &state, &config);
+    for (uint32_t i = 0; i < leds; i++) {
+        int lit = i == 1 || i == 6 || i == 9;
+        TEST_ASSERT_EQUAL_UINT8(lit ? 9 : 0, channels[0][i].g);
+    }
+    lightbar_layout_free(&layout);
+}
+
+void test_rejects_out_of_range(void) {
+    const uint32_t leds[2] = { 10, 10 };
+    LightbarLayout layout;
+    TEST_ASSERT_EQUAL_INT(0, lightbar_layout_init(&layout, 20, 2, leds));
+    TEST_ASSERT_EQUAL_INT(-1, lightbar_layout_segment(&layout, 15, 10, 0, 0, 0));
+    TEST_ASSERT_EQUAL_INT(-1, lightbar_layout_segment(&layout, 0, 5, 2, 0, 0));
+    TEST_ASSERT_EQUAL_INT(-1, lightbar_layout_segment(&layout, 0, 5, 1, 6, 0));
+    TEST_ASSERT_EQUAL_INT(-1, lightbar_layout_segment(&layout, -1, 5, 0, 0, 0));
+    TEST_ASSERT_EQUAL_INT(-1, lightbar_layout_serpentine(&layout, 0, 4, 3, 0, 0));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_layout_serpentine(&layout, 0, 5, 2, 0, 0));
+    TEST_ASSERT_EQUAL_size_t(10, layout.count);
+    lightbar_layout_free(&layout);
+}
+
+/* The incremental scatter must match a full render copied through the
+ * layout across moves, pauses, smooth blends and config changes. */
+void test_matches_render_every_frame(void) {
+    LightbarConfig config = {
+        .num_leds = 60, .speed = 37.0f, .end_pause_ms = 100,
+        .glow_radius = 4, .color = { 200, 100, 50 }, .smooth = 1
+    };
+    LightbarState state;
+    LightbarLayout layout;
+    LightbarLayoutOutput out;
+    srand(11);
+    build_rig(&layout);
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    lightbar_layout_output_init(&out, channels);
+    memset(channel_data, 0xAB, sizeof(channel_data));
+    for (int frame = 0; frame < 2000; frame++) {
+        if (frame % 500 == 250) {
+            config.glow_radius = (uint16_t)(rand() % 8);
+            config.color.g = (uint8_t)rand();
+            config.smooth = (uint8_t)(rand() & 1);
+        }
+        lightbar_update(&state, &config, (float)(1 + rand() % 20));
+        lightbar_layout_render(&out, &layout, &state, &config);
+        assert_matches_render(&layout, &state, &config);
+    }
+    lightbar_layout_free(&layout);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_single_segment_matches_render);
+    RUN_TEST(test_segments_reversal_gaps_and_channels);
+    RUN_TEST(test_serpentine_lights_a_column);
+    RUN_TEST(test_rejects_out_of_range);
+    RUN_TEST(test_matches_render_every_frame);
+    return UNITY_END();
+}
@@ -0,0 +1,115 @@
+#include "unity.h"
+#include "lightbar_pacer.h"
+#include <math.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_init_rejects_rates_out_of_range(void) {
+    LightbarPacer pacer;
+    TEST_ASSERT_EQUAL_INT(-1, lightbar_pacer_init(&pacer, 59));
+    TEST_ASSERT_EQUAL_INT(-1, lightbar_pacer_init(&pacer, 2001));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_pacer_init(&pacer, 60));
+    TEST_ASSERT_EQUAL_UINT64(0, pacer.frame);
+}
+
+void test_deadlines_are_exact_from_the_epoch(void) {
+    LightbarPacer pacer;
+    lightbar_pacer_init(&pacer, 60);
+    TEST_ASSERT_EQUAL_UINT64(pacer.epoch_ns + 1000000000ull, lightbar_pacer_deadline(&pacer, 60));
+    TEST_ASSERT_EQUAL_UINT64(pacer.epoch_ns + 16666666ull, lightbar_pacer_deadline(&pacer, 1));
+    /* Ten hours in, still on the nanosecond */
+    TEST_ASSERT_EQUAL_UINT64(pacer.epoch_ns + 36000ull * 1000000000ull,
+                             lightbar_pacer_deadline(&pacer, 36000ull * 60));
+}
+
+void test_real_frames_cover_the_elapsed_time(void) {
+    LightbarConfig config = { .num_leds = 30, .speed = 40.0f, .end_pause_ms = 50 };
+    LightbarState state;
+    LightbarPacer pacer;
+    Led leds[30];
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    lightbar_pacer_init(&pacer, 1000);
+    double total = 0.0;
+    for (int i = 0; i < 200; i++) total += lightbar_pacer_wait(&pacer);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, (double)pacer.frame, total);
+    TEST_ASSERT_EQUAL_UINT64(200, pacer.late.count);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT64(200, pacer.frame);
+    TEST_ASSERT_EQUAL_UINT64(pacer.frame - 200, pacer.missed);
+    for (int i = 0; i < 20; i++) lightbar_pacer_frame(&pacer, &state, &config, leds);
+    TEST_ASSERT_EQUAL_UINT64(20, pacer.render.count);
+}
+
+/* Where the dot is, in LEDs, t ms after it left the left edge */
+static double triangle(double t, int num_leds, float speed) {
+    double step = (double)(1000.0f / speed);
+    double leg = (num_leds - 1) * step;
+    double u = fmod(t, 2.0 * leg);
+    return u < leg ? u / step : (num_leds - 1) - (u - leg) / step;
+}
+
+void test_position_stays_exact_over_a_long_session(void) {
+    LightbarConfig config = { .num_leds = 11, .speed = 7.0f, .end_pause_ms = 0 };
+    LightbarState state;
+    LightbarPacer pacer;
+    double step = (double)(1000.0f / config.speed);
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    lightbar_pacer_init(&pacer, 60);
+    pacer.epoch_ns = 0;
+    /* Ninety simulated minutes; the dot starts on the middle LED */
+    for (uint64_t k = 1; k <= 90ull * 60 * 60; k++) {
+        double dt = (double)(lightbar_pacer_deadline(&pacer, k) -
+                             lightbar_pacer_deadline(&pacer, k - 1)) / 1e6;
+        pacer.frame = k;
+        lightbar_pacer_update(&pacer, &state, &config, dt);
+        double t = 5.0 * step + (double)lightbar_pacer_deadline(&pacer, k) / 1e6;
+        double at = state.position + state.direction * state.move_accum_ms / step;
+        if (fabs(at - triangle(t, 11, config.speed)) > 1e-3) {
+            TEST_FAIL_MESSAGE("dot drifted from the session clock");
+        }
+    }
+    TEST_ASSERT_GREATER_THAN(5000, (int)pacer.drift.count);
+}
+
+void test_config_change_reanchors(void) {
+    LightbarConfig config = { .num_leds = 20, .speed = 25.0f, .end_pause_ms = 30 };
+    LightbarState state;
+    LightbarPacer pacer;
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    lightbar_pacer_init(&pacer, 100);
+    pacer.epoch_ns = 0;
+    for (uint64_t k = 1; k <= 1000; k++) {
+        pacer.frame = k;
+        lightbar_pacer_update(&pacer, &state, &config, 10.0);
+    }
+    TEST_ASSERT_TRUE(pacer.anchored);
+    uint64_t checks = pacer.drift.count;
+    /* The next check sees the new speed and starts over instead of
+     * snapping to the old period */
+    config.speed = 50.0f;
+    pacer.frame = 1001;
+    pacer.since_check = pacer.rate_hz - 1;
+    lightbar_pacer_update(&pacer, &state, &config, 10.0);
+    TEST_ASSERT_EQUAL_FLOAT(50.0f, pacer.anchor_config.speed);
+    TEST_ASSERT_EQUAL_UINT64(10010000000ull, pacer.anchor_ns);
+    TEST_ASSERT_EQUAL_UINT64(checks, pacer.drift.count);
+    /* A stopped bar drops its anchor */
+    lightbar_stop(&state, &config);
+    lightbar_pacer_update(&pacer, &state, &config, 100000.0);
+    pacer.since_check = pacer.rate_hz - 1;
+    lightbar_pacer_update(&pacer, &state, &config, 10.0);
+    TEST_ASSERT_FALSE(pacer.anchored);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_init_rejects_rates_out_of_range);
+    RUN_TEST(test_deadlines_are_exact_from_the_epoch);
+    RUN_TEST(test_real_frames_cover_the_elapsed_time);
+    RUN_TEST(test_position_stays_exact_over_a_long_session);
+    RUN_TEST(test_config_change_reanchors);
+    return UNITY_END();
+}
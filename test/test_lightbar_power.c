@@ -0,0 +1,145 @@
+#include "unity.h"
+#include "lightbar_power.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_LEDS 300
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const LightbarPowerModel ws2812 = { 20, 20, 20, 1, 0 };
+static Led leds[NUM_LEDS];
+static Led expected[NUM_LEDS];
+
+static LightbarConfig make_config(const LightbarLut *lut) {
+    LightbarConfig config = {
+        .num_leds = NUM_LEDS, .speed = 90.0f, .end_pause_ms = 30, .glow_radius = 12,
+        .color = { 255, 255, 255 }, .lut = lut
+    };
+    return config;
+}
+
+void test_frame_ma_sums_every_led(void) {
+    Led frame[3] = { { 255, 0, 0 }, { 0, 255, 255 }, { 0, 0, 0 } };
+    LightbarPowerModel model = { 20, 10, 5, 1, 0 };
+    TEST_ASSERT_EQUAL_UINT32(3 + 20 + 10 + 5, lightbar_power_frame_ma(&model, frame, 3));
+    frame[0].r = 1;
+    /* A sliver of a channel still rounds up to a whole mA */
+    TEST_ASSERT_EQUAL_UINT32(3 + 1 + 10 + 5, lightbar_power_frame_ma(&model, frame, 3));
+}
+
+/* The incremental estimate always equals summing the whole frame, through
+ * motion, smoothing, pauses, color and glow changes. */
+void test_incremental_matches_full_sum(void) {
+    LightbarLut lut;
+    LightbarState state;
+    LightbarPower power;
+    LightbarDelta delta;
+    LightbarPlan plan;
+    int from, to;
+    lightbar_lut_init(&lut, 200, 1);
+    LightbarConfig config = make_config(&lut);
+    lightbar_plan_init(&plan, &config);
+    lightbar_power_init(&power, &ws2812);
+    lightbar_delta_reset(&delta);
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    srand(24);
+    for (int frame = 0; frame < 3000; frame++) {
+        if (frame % 500 == 250) {
+            config.color.g = (uint8_t)rand();
+            config.glow_radius = (uint16_t)(rand() % 20);
+            config.smooth = (uint8_t)(rand() & 1);
+            lightbar_plan_sync(&plan, &config);
+        }
+        lightbar_update(&state, &config, (float)(rand() % 40));
+        lightbar_power_render_delta(&power, &delta, &state, &plan, leds, &from, &to);
+        TEST_ASSERT_EQUAL_UINT32(lightbar_power_frame_ma(&ws2812, leds, NUM_LEDS), power.ma);
+        lightbar_render(&state, &config, expected);
+        TEST_ASSERT_EQUAL_MEMORY(expected, leds, sizeof(leds));
+    }
+    TEST_ASSERT_EQUAL_UINT64(0, power.limited);
+}
+
+/* Every frame fits the budget, is exactly what rendering at the limited
+ * brightness gives, and uses most of the budget. */
+void test_limiter_keeps_frames_under_budget(void) {
+    LightbarLut lut, limited;
+    LightbarState state;
+    LightbarPower power;
+    LightbarDelta delta;
+    LightbarPowerModel model = ws2812;
+    LightbarPlan plan;
+    int from, to;
+    model.budget_ma = 600;
+    lightbar_lut_init(&lut, 255, 1);
+    LightbarConfig config = make_config(&lut);
+    lightbar_plan_init(&plan, &config);
+    LightbarConfig check = config;
+    lightbar_power_init(&power, &model);
+    lightbar_delta_reset(&delta);
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    check.lut = &limited;
+    for (int frame = 0; frame < 2000; frame++) {
+        lightbar_update(&state, &config, 16.0f);
+        lightbar_power_render_delta(&power, &delta, &state, &plan, leds, &from, &to);
+        uint32_t ma = lightbar_power_frame_ma(&model, leds, NUM_LEDS);
+        TEST_ASSERT_EQUAL_UINT32(ma, power.ma);
+        TEST_ASSERT_TRUE(ma <= model.budget_ma);
+        lightbar_lut_init(&limited, power.lut.brightness, 1);
+        lightbar_render(&state, &check, expected);
+        TEST_ASSERT_EQUAL_MEMORY(expected, leds, sizeof(leds));
+        /* Away from the ends the whole glow is on the strip */
+        if (state.position > 20 && state.position < NUM_LEDS - 20) {
+            TEST_ASSERT_TRUE(ma * 10 >= model.budget_ma * 9);
+        }
+    }
+    TEST_ASSERT_GREATER_THAN(1000, power.limited);
+}
+
+void test_brightness_recovers_up_to_the_configured_one(void) {
+    LightbarLut lut;
+    LightbarState state;
+    LightbarPower power;
+    LightbarDelta delta;
+    LightbarPowerModel model = ws2812;
+    LightbarPlan plan;
+    int from, to;
+    model.budget_ma = 800;
+    lightbar_lut_init(&lut, 180, 0);
+    LightbarConfig config = make_config(&lut);
+    lightbar_plan_init(&plan, &config);
+    lightbar_power_init(&power, &model);
+    lightbar_delta_reset(&delta);
+    lightbar_init(&state, &config);
+    lightbar_power_render_delta(&power, &delta, &state, &plan, leds, &from, &to);
+    int low = power.lut.brightness;
+    TEST_ASSERT_TRUE(low < 180);
+    TEST_ASSERT_TRUE(power.ma <= 800);
+
+    /* An unchanged frame redraws only if the brightness moves */
+    TEST_ASSERT_EQUAL_INT(0, lightbar_power_render_delta(&power, &delta, &state, &plan,
+                                                         leds, &from, &to));
+    power.model.budget_ma = 100000;
+    TEST_ASSERT_EQUAL_INT(1, lightbar_power_render_delta(&power, &delta, &state, &plan,
+                                                         leds, &from, &to));
+    TEST_ASSERT_EQUAL_UINT8(180, power.lut.brightness);
+    TEST_ASSERT_TRUE(from >= state.position - 12 && to <= state.position + 13);
+
+    /* Below the strip's idle draw nothing can be lit */
+    power.model.budget_ma = NUM_LEDS - 1;
+    lightbar_power_render_delta(&power, &delta, &state, &plan, leds, &from, &to);
+    TEST_ASSERT_EQUAL_UINT8(0, power.lut.brightness);
+    TEST_ASSERT_EQUAL_UINT32(NUM_LEDS, power.ma);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_frame_ma_sums_every_led);
+    RUN_TEST(test_incremental_matches_full_sum);
+    RUN_TEST(test_limiter_keeps_frames_under_budget);
+    RUN_TEST(test_brightness_recovers_up_to_the_configured_one);
+    return UNITY_END();
+}
@@ -0,0 +1,256 @@
+#define _GNU_SOURCE
+#include "unity.h"
+#include "lightbar_record.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static char path[64];
+
+void setUp(void) {
+    snprintf(path, sizeof(path), "/tmp/test_lightbar_record.%d.lbr", (int)getpid());
+}
+
+void tearDown(void) {
+    unlink(path);
+}
+
+static void assert_same_state(const LightbarState *expected, const LightbarState *actual) {
+    TEST_ASSERT_EQUAL_INT(expected->position, actual->position);
+    TEST_ASSERT_EQUAL_INT(expected->direction, actual->direction);
+    TEST_ASSERT_EQUAL_INT(expected->phase, actual->phase);
+    TEST_ASSERT_EQUAL_FLOAT(expected->pause_timer_ms, actual->pause_timer_ms);
+    TEST_ASSERT_EQUAL_FLOAT(expected->move_accum_ms, actual->move_accum_ms);
+}
+
+/* A session with jittery frame times, setter calls and start/stop,
+ * recorded as it runs. Returns the live state at the end. */
+static LightbarState record_session(int frames, double checkpoint_ms, double *time_ms) {
+    static LightbarLut lut;
+    LightbarConfig config = { .num_leds = 40, .speed = 12.0f, .end_pause_ms = 200,
+                              .glow_radius = 3, .color = { 0, 120, 255 } };
+    LightbarState state;
+    LightbarRecorder rec;
+    lightbar_lut_init(&lut, 255, 0);
+    config.lut = &lut;
+    lightbar_init(&state, &config);
+    TEST_ASSERT_EQUAL_INT(0, lightbar_record_open(&rec, path, checkpoint_ms, &state, &config));
+    lightbar_start(&state);
+    lightbar_record_start(&rec, &config);
+    srand(11);
+    *time_ms = 0.0;
+    for (int i = 0; i < frames; i++) {
+        float dt = rand() % 4 ? 16.0f : 15.0f + (float)(rand() % 300) / 100.0f;
+        if (i % 900 == 450) config.speed = 5.0f + (float)(rand() % 40);
+        if (i % 1300 == 700) config.end_pause_ms = (uint16_t)(rand() % 400);
+        if (i % 2000 == 1000) config.color.r = (uint8_t)rand();
+        if (i % 2500 == 1200) lightbar_lut_set_brightness(&lut, (uint8_t)rand());
+        if (i % 3000 == 2000) {
+            lightbar_stop(&state, &config);
+            lightbar_record_stop(&rec, &config);
+        }
+        if (i % 3000 == 2600) {
+            lightbar_start(&state);
+            lightbar_record_start(&rec, &config);
+        }
+        lightbar_update(&state, &config, dt);
+        lightbar_record_update(&rec, &state, &config, dt);
+        *time_ms += dt;
+    }
+    TEST_ASSERT_EQUAL_INT(0, lightbar_record_close(&rec));
+    return state;
+}
+
+void test_replay_reproduces_the_session(void) {
+    double time_ms;
+    LightbarState live = record_session(20000, 1000.0, &time_ms);
+    LightbarReplay replay;
+    TEST_ASSERT_EQUAL_INT(0, lightbar_replay_open(&replay, path));
+    int op;
+    while ((op = lightbar_replay_next(&replay)) > 0) {
+    }
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_REC_END, op);
+    assert_same_state(&live, &replay.state);
+    TEST_ASSERT_EQUAL_UINT64(20000, replay.frames);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, time_ms, replay.time_ms);
+    TEST_ASSERT_EQUAL_UINT64(0, replay.mismatches);
+    TEST_ASSERT_GREATER_THAN(300, (int)replay.index_count);
+    lightbar_replay_close(&replay);
+}
+
+/* Cached playback rounds differently from lightbar_update(), so the replay
+ * has to step the way the bar did for its checkpoints to agree. */
+void test_replay_follows_the_cache_and_profile(void) {
+    static const float points[] = { 0.0f, 0.1f, 0.7f, 1.0f };
+    LightbarConfig config = { .num_leds = 37, .speed = 13.0f, .end_pause_ms = 170,
+                              .glow_radius = 2, .color = { 255, 0, 0 } };
+    LightbarProfile sine, custom;
+    LightbarCache cache;
+    LightbarState state;
+    LightbarRecorder rec;
+    lightbar_profile_init(&sine, LIGHTBAR_PROFILE_SINE);
+    lightbar_profile_init_custom(&custom, points, 4);
+    lightbar_cache_init(&cache);
+    lightbar_init(&state, &config);
+    TEST_ASSERT_EQUAL_INT(0, lightbar_record_open(&rec, path, 250.0, &state, &config));
+    lightbar_start(&state);
+    lightbar_record_start(&rec, &config);
+    srand(5);
+    int cached = 1;
+    lightbar_record_cached(&rec, cached);
+    for (int i = 0; i < 6000; i++) {
+        float dt = 15.0f + (float)(rand() % 700) / 100.0f;
+        if (i % 1000 == 400) {
+            cached = !cached;
+            lightbar_record_cached(&rec, cached);
+        }
+        if (i % 1500 == 600) config.profile = &sine;
+        if (i % 1500 == 900) config.profile = &custom;
+        if (i % 1500 == 1200) config.profile = NULL;
+        if (cached) {
+            lightbar_cache_update(&cache, &state, &config, dt);
+        } else {
+            lightbar_update(&state, &config, dt);
+        }
+        lightbar_record_update(&rec, &state, &config, dt);
+    }
+    TEST_ASSERT_EQUAL_INT(0, lightbar_record_close(&rec));
+    lightbar_cache_free(&cache);
+
+    LightbarReplay replay;
+    TEST_ASSERT_EQUAL_INT(0, lightbar_replay_open(&replay, path));
+    while (lightbar_replay_next(&replay) > 0) {
+    }
+    TEST_ASSERT_EQUAL_INT(0, replay.error);
+    TEST_ASSERT_EQUAL_UINT64(0, replay.mismatches);
+    TEST_ASSERT_EQUAL_INT(1, replay.cached);
+    assert_same_state(&state, &replay.state);
+
+    TEST_ASSERT_EQUAL_INT(0, lightbar_replay_seek(&replay, 20000.0));
+    TEST_ASSERT_NOT_NULL(replay.config.profile);
+    TEST_ASSERT_EQUAL_INT(LIGHTBAR_PROFILE_CUSTOM, replay.config.profile->type);
+    TEST_ASSERT_EQUAL_MEMORY(custom.table, replay.config.profile->table, sizeof(custom.table));
+    TEST_ASSERT_EQUAL_INT(0, replay.cached);
+    lightbar_replay_close(&replay);
+}
+
+void test_steady_frames_compress_to_repeats(void) {
+    LightbarConfig config = { .num_leds = 60, .speed = 20.0f, .end_pause_ms = 100 };
+    LightbarState state;
+    LightbarRecorder rec;
+    lightbar_init(&state, &config);
+    lightbar_record_open(&rec, path, 60000.0, &state, &config);
+    lightbar_start(&state);
+    lightbar_record_start(&rec, &config);
+    /* An hour at a steady 60 Hz */
+    for (int i = 0; i < 216000; i++) {
+        lightbar_update(&state, &config, 16.666666f);
+        lightbar_record_update(&rec, &state, &config, 16.666666f);
+    }
+    TEST_ASSERT_EQUAL_INT(0, lightbar_record_close(&rec));
+    FILE *f = fopen(path, "rb");
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    /* Sixty checkpoints and a few bytes between each */
+    TEST_ASSERT_LESS_THAN(60 * 64, (int)size);
+}
+
+void test_seek_matches_replaying_from_the_start(void) {
+    double time_ms;
+    record_session(12000, 500.0, &time_ms);
+    LightbarReplay seq, seek;
+    lightbar_replay_open(&seq, path);
+    lightbar_replay_open(&seek, path);
+    const double targets[] = { 0.0, 7.5, 16000.0, 123456.7, 60000.0, 191000.0 };
+    for (int i = 0; i < 6; i++) {
+        double target = targets[i];
+        TEST_ASSERT_EQUAL_INT(0, lightbar_replay_seek(&seek, target));
+        if (target < seq.time_ms) lightbar_replay_seek(&seq, 0.0);
+        /* The same point by stepping: last update ending at or before target */
+        while (1) {
+            LightbarReplay probe = seq;
+            int op = lightbar_replay_next(&probe);
+            if (op <= 0 || probe.time_ms > target) break;
+            lightbar_replay_next(&seq);
+        }
+        TEST_ASSERT_TRUE(seek.time_ms <= target);
+        TEST_ASSERT_DOUBLE_WITHIN(1e-9, seq.time_ms, seek.time_ms);
+        TEST_ASSERT_EQUAL_UINT64(seq.frames, seek.frames);
+        assert_same_state(&seq.state, &seek.state);
+        TEST_ASSERT_EQUAL_FLOAT(seq.config.speed, seek.config.speed);
+    }
+    lightbar_replay_close(&seq);
+    lightbar_replay_close(&seek);
+}
+
+void test_truncated_recording_rebuilds_its_index(void) {
+    double time_ms;
+    record_session(6000, 1000.0, &time_ms);
+    FILE *f = fopen(path, "rb");
+    static uint8_t bytes[1 << 20];
+    size_t size = fread(bytes, 1, sizeof(bytes), f);
+    fclose(f);
+    /* Cut mid-record, as a crash would */
+    f = fopen(path, "wb");
+    fwrite(bytes, 1, size * 2 / 3 + 1, f);
+    fclose(f);
+
+    LightbarReplay replay;
+    TEST_ASSERT_EQUAL_INT(0, lightbar_replay_open(&replay, path));
+    TEST_ASSERT_GREATER_THAN(30, (int)replay.index_count);
+    TEST_ASSERT_EQUAL_INT(0, lightbar_replay_seek(&replay, 40000.0));
+    TEST_ASSERT_DOUBLE_WITHIN(20.0, 40000.0, replay.time_ms);
+    while (lightbar_replay_next(&replay) > 0) {
+    }
+    TEST_ASSERT_EQUAL_INT(0, replay.error);
+    TEST_ASSERT_EQUAL_UINT64(0, replay.mismatches);
+    lightbar_replay_close(&replay);
+}
+
+void test_replay_flags_where_the_run_departed(void) {
+    LightbarConfig config = { .num_leds = 30, .speed = 10.0f };
+    LightbarState state;
+    LightbarRecorder rec;
+    lightbar_init(&state, &config);
+    lightbar_record_open(&rec, path, 100.0, &state, &config);
+    lightbar_start(&state);
+    lightbar_record_start(&rec, &config);
+    for (int i = 0; i < 200; i++) {
+        /* A glitch in the live run at 1 s */
+        lightbar_update(&state, &config, i == 100 ? 30.0f : 10.0f);
+        lightbar_record_update(&rec, &state, &config, 10.0f);
+    }
+    lightbar_record_close(&rec);
+
+    LightbarReplay replay;
+    lightbar_replay_open(&replay, path);
+    while (lightbar_replay_next(&replay) > 0) {
+    }
+    /* Caught once; the checkpoint puts the replay back in step */
+    TEST_ASSERT_EQUAL_UINT64(1, replay.mismatches);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 1100.0, replay.first_mismatch_ms);
+    assert_same_state(&state, &replay.state);
+    lightbar_replay_close(&replay);
+}
+
+void test_open_rejects_other_files(void) {
+    LightbarReplay replay;
+    FILE *f = fopen(path, "wb");
+    fputs("not a recording at all", f);
+    fclose(f);
+    TEST_ASSERT_EQUAL_INT(-1, lightbar_replay_open(&replay, path));
+    TEST_ASSERT_EQUAL_INT(-1, lightbar_replay_open(&replay, "/nonexistent/session.lbr"));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_replay_reproduces_the_session);
+    RUN_TEST(test_replay_follows_the_cache_and_profile);
+    RUN_TEST(test_steady_frames_compress_to_repeats);
+    RUN_TEST(test_seek_matches_replaying_from_the_start);
+    RUN_TEST(test_truncated_recording_rebuilds_its_index);
+    RUN_TEST(test_replay_flags_where_the_run_departed);
+    RUN_TEST(test_open_rejects_other_files);
+    return UNITY_END();
+}
@@ -0,0 +1,122 @@
+#define _GNU_SOURCE
+#include "unity.h"
+#include "lightbar_stats.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static char name[64];
+static LightbarStats stats;
+
+void setUp(void) {
+    snprintf(name, sizeof(name), "/test_lightbar_stats.%d", (int)getpid());
+    TEST_ASSERT_EQUAL_INT(0, lightbar_stats_create(&stats, name, 3));
+}
+
+void tearDown(void) {
+    lightbar_stats_close(&stats);
+}
+
+void test_reader_sees_the_writer(void) {
+    LightbarStats reader;
+    LightbarStatsSlot sample;
+    LightbarStatsSlot *slot = lightbar_stats_claim(&stats, "room1");
+    TEST_ASSERT_NOT_NULL(slot);
+    TEST_ASSERT_EQUAL_INT(0, lightbar_stats_open(&reader, name));
+    TEST_ASSERT_EQUAL_UINT32(3, reader.header->slots);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)getpid(), reader.header->pid);
+
+    lightbar_stats_frame(slot, 3, 1, 1, 500);
+    lightbar_stats_frame(slot, 0, 0, 0, 200);
+    lightbar_stats_frame(slot, 5, 0, 0, 800);
+    lightbar_stats_stopped(slot, 7000);
+    TEST_ASSERT_EQUAL_INT(1, lightbar_stats_sample(&reader, 0, &sample));
+    TEST_ASSERT_EQUAL_STRING("room1", sample.name);
+    TEST_ASSERT_EQUAL_UINT64(3, sample.frames);
+    TEST_ASSERT_EQUAL_UINT64(8, sample.steps);
+    TEST_ASSERT_EQUAL_UINT64(5, sample.max_steps);
+    TEST_ASSERT_EQUAL_UINT64(1, sample.edges);
+    TEST_ASSERT_EQUAL_UINT64(1, sample.pauses);
+    TEST_ASSERT_EQUAL_UINT64(1, sample.stops);
+    TEST_ASSERT_EQUAL_UINT64(7000, sample.stop_ns_max);
+    TEST_ASSERT_EQUAL_UINT64(1500, sample.render_ns_sum);
+    TEST_ASSERT_EQUAL_UINT64(200, sample.render_ns_min);
+    TEST_ASSERT_EQUAL_UINT64(800, sample.render_ns_max);
+    TEST_ASSERT_EQUAL_INT(0, lightbar_stats_sample(&reader, 1, &sample));
+    lightbar_stats_close(&reader);
+}
+
+void test_released_slots_are_reused_fresh(void) {
+    LightbarStatsSlot sample;
+    LightbarStatsSlot *a = lightbar_stats_claim(&stats, "a");
+    LightbarStatsSlot *b = lightbar_stats_claim(&stats, "b");
+    LightbarStatsSlot *c = lightbar_stats_claim(&stats, "c");
+    TEST_ASSERT_NOT_NULL(c);
+    TEST_ASSERT_NULL(lightbar_stats_claim(&stats, "d"));
+    lightbar_stats_frame(b, 1, 0, 0, 100);
+    lightbar_stats_release(b);
+    TEST_ASSERT_EQUAL_INT(0, lightbar_stats_sample(&stats, 1, &sample));
+
+    LightbarStatsSlot *d = lightbar_stats_claim(&stats, "d");
+    TEST_ASSERT_TRUE(d == b);
+    TEST_ASSERT_EQUAL_INT(1, lightbar_stats_sample(&stats, 1, &sample));
+    TEST_ASSERT_EQUAL_STRING("d", sample.name);
+    TEST_ASSERT_EQUAL_UINT64(0, sample.frames);
+    TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, sample.render_ns_min);
+    TEST_ASSERT_EQUAL_UINT32(3, sample.generation);
+    (void)a;
+}
+
+void test_open_rejects_other_blocks(void) {
+    char other[80];
+    LightbarStats reader;
+    snprintf(other, sizeof(other), "%s.other", name);
+    TEST_ASSERT_EQUAL_INT(-1, lightbar_stats_open(&reader, other));
+    TEST_ASSERT_EQUAL_INT(ENOENT, errno);
+
+    int fd = shm_open(other, O_RDWR | O_CREAT, 0600);
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL_INT(0, ftruncate(fd, 4096));
+    close(fd);
+    TEST_ASSERT_EQUAL_INT(-1, lightbar_stats_open(&reader, other));
+    TEST_ASSERT_EQUAL_INT(EINVAL, errno);
+    shm_unlink(other);
+}
+
+void test_create_leaves_a_live_block_alone(void) {
+    LightbarStats other;
+    LightbarStats reader;
+    TEST_ASSERT_EQUAL_INT(-1, lightbar_stats_create(&other, name, 5));
+    TEST_ASSERT_EQUAL_INT(EEXIST, errno);
+    TEST_ASSERT_EQUAL_INT(0, lightbar_stats_open(&reader, name));
+    TEST_ASSERT_EQUAL_UINT32(3, reader.header->slots);
+    lightbar_stats_close(&reader);
+}
+
+void test_create_replaces_a_block_whose_owner_exited(void) {
+    LightbarStats other;
+    LightbarStats reader;
+    pid_t child = fork();
+    if (child == 0) _exit(0);
+    TEST_ASSERT_EQUAL_INT(child, waitpid(child, NULL, 0));
+    stats.header->pid = (uint32_t)child;
+    TEST_ASSERT_EQUAL_INT(0, lightbar_stats_create(&other, name, 5));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_stats_open(&reader, name));
+    TEST_ASSERT_EQUAL_UINT32(5, reader.header->slots);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)getpid(), reader.header->pid);
+    lightbar_stats_close(&reader);
+    lightbar_stats_close(&other);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_reader_sees_the_writer);
+    RUN_TEST(test_released_slots_are_reused_fresh);
+    RUN_TEST(test_open_rejects_other_blocks);
+    RUN_TEST(test_create_leaves_a_live_block_alone);
+    RUN_TEST(test_create_replaces_a_block_whose_owner_exited);
+    return UNITY_END();
+}
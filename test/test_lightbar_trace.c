@@ -0,0 +1,145 @@
+#include "unity.h"
+#include "lightbar.h"
+#include "lightbar_trace.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_PATH "build/test_lightbar_trace.trace"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+/* Records this thread appended since mark, oldest first. */
+static const LightbarTraceRecord *since(uint64_t mark, uint64_t *count) {
+    LightbarTraceRing *ring = lightbar_trace_ring;
+    *count = ring->head - mark;
+    return &ring->records[mark & (LIGHTBAR_TRACE_CAPACITY - 1)];
+}
+
+static uint64_t mark(void) {
+    LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_FRAME_BEGIN, 0, 0, 0);
+    return lightbar_trace_ring->head;
+}
+
+void test_update_records_steps_and_phase_change(void) {
+    LightbarConfig config = { .num_leds = 10, .speed = 100.0f, .end_pause_ms = 50 };
+    LightbarState state;
+    uint64_t count;
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    uint64_t at = mark();
+
+    /* From the middle at 100 LEDs/s, 45 ms is 4 steps to the right edge */
+    lightbar_update(&state, &config, 45.0f);
+    const LightbarTraceRecord *r = since(at, &count);
+    TEST_ASSERT_EQUAL_UINT64(3, count);
+    TEST_ASSERT_EQUAL_UINT8(LIGHTBAR_TRACE_UPDATE_BEGIN, r[0].event);
+    TEST_ASSERT_EQUAL_UINT8(LIGHTBAR_MOVING, r[0].phase);
+    TEST_ASSERT_EQUAL_INT32(5, r[0].position);
+    TEST_ASSERT_EQUAL_UINT8(LIGHTBAR_TRACE_UPDATE_END, r[1].event);
+    TEST_ASSERT_EQUAL_UINT16(4, r[1].arg);
+    TEST_ASSERT_EQUAL_INT32(9, r[1].position);
+    TEST_ASSERT_EQUAL_UINT8(LIGHTBAR_TRACE_PHASE, r[2].event);
+    TEST_ASSERT_EQUAL_UINT8(LIGHTBAR_PAUSED_END, r[2].phase);
+    TEST_ASSERT_TRUE(r[1].ticks >= r[0].ticks);
+}
+
+/* A long stall covers more steps than the record holds */
+void test_update_saturates_step_count(void) {
+    LightbarConfig config = { .num_leds = 60000, .speed = 1000.0f };
+    LightbarState state;
+    uint64_t count;
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    uint64_t at = mark();
+
+    lightbar_update(&state, &config, 100000.0f);
+    const LightbarTraceRecord *r = since(at, &count);
+    TEST_ASSERT_EQUAL_UINT8(LIGHTBAR_TRACE_UPDATE_END, r[1].event);
+    TEST_ASSERT_EQUAL_UINT16(0xFFFF, r[1].arg);
+}
+
+void test_render_and_advance_are_bracketed(void) {
+    static Led leds[30];
+    LightbarConfig config = { .num_leds = 30, .speed = 10.0f, .glow_radius = 2 };
+    LightbarState state;
+    uint64_t count;
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    uint64_t at = mark();
+
+    lightbar_render(&state, &config, leds);
+    lightbar_advance(&state, &config, 250.0f);
+    const LightbarTraceRecord *r = since(at, &count);
+    TEST_ASSERT_EQUAL_UINT64(4, count);
+    TEST_ASSERT_EQUAL_UINT8(LIGHTBAR_TRACE_RENDER_BEGIN, r[0].event);
+    TEST_ASSERT_EQUAL_UINT8(LIGHTBAR_TRACE_RENDER_END, r[1].event);
+    TEST_ASSERT_EQUAL_UINT16(30, r[1].arg);
+    TEST_ASSERT_EQUAL_UINT8(LIGHTBAR_TRACE_ADVANCE_BEGIN, r[2].event);
+    TEST_ASSERT_EQUAL_UINT8(LIGHTBAR_TRACE_ADVANCE_END, r[3].event);
+    TEST_ASSERT_EQUAL_INT32(17, r[3].position);
+}
+
+static void *emit_events(void *arg) {
+    int n = *(int *)arg;
+    for (int i = 0; i < n; i++) LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_PHASE, 1, i, i);
+    return NULL;
+}
+
+/* A thread that outruns its ring keeps its newest records; every thread's
+ * ring is in the dump. */
+void test_dump_holds_every_thread_newest_first(void) {
+    const int counts[2] = { 100, (int)LIGHTBAR_TRACE_CAPACITY + 10 };
+    pthread_t threads[2];
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[i], NULL, emit_events,
+                                                (void *)&counts[i]));
+        pthread_join(threads[i], NULL);
+    }
+    TEST_ASSERT_EQUAL_INT(0, lightbar_trace_dump(TRACE_PATH));
+
+    FILE *f = fopen(TRACE_PATH, "rb");
+    LightbarTraceHeader h;
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_EQUAL_size_t(1, fread(&h, sizeof(h), 1, f));
+    TEST_ASSERT_EQUAL_MEMORY(LIGHTBAR_TRACE_MAGIC, h.magic, 8);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(LightbarTraceRecord), h.record_size);
+    TEST_ASSERT_EQUAL_UINT32(3, h.rings);
+    TEST_ASSERT_TRUE(h.ns_per_tick > 0.0);
+
+    int found = 0;
+    for (uint32_t i = 0; i < h.rings; i++) {
+        LightbarTraceRingHeader rh;
+        LightbarTraceRecord *records;
+        TEST_ASSERT_EQUAL_size_t(1, fread(&rh, sizeof(rh), 1, f));
+        records = malloc((size_t)rh.count * sizeof(*records));
+        TEST_ASSERT_EQUAL_size_t(rh.count, fread(records, sizeof(*records), rh.count, f));
+        if (rh.count == 100) {
+            TEST_ASSERT_EQUAL_INT32(0, records[0].position);
+            TEST_ASSERT_EQUAL_INT32(99, records[99].position);
+            found |= 1;
+        } else if (rh.count == LIGHTBAR_TRACE_CAPACITY) {
+            TEST_ASSERT_EQUAL_INT32(10, records[0].position);
+            TEST_ASSERT_EQUAL_INT32(counts[1] - 1, records[rh.count - 1].position);
+            for (uint64_t k = 1; k < rh.count; k++) {
+                TEST_ASSERT_TRUE(records[k].ticks >= records[k - 1].ticks);
+            }
+            found |= 2;
+        }
+        free(records);
+    }
+    fclose(f);
+    remove(TRACE_PATH);
+    TEST_ASSERT_EQUAL_INT(3, found);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_update_records_steps_and_phase_change);
+    RUN_TEST(test_update_saturates_step_count);
+    RUN_TEST(test_render_and_advance_are_bracketed);
+    RUN_TEST(test_dump_holds_every_thread_newest_first);
+    return UNITY_END();
+}
@@ -0,0 +1,268 @@
+#include "unity.h"
+#include "lightbar_wire.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LEDS 300
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const LightbarWireFormat formats[] = {
+    LIGHTBAR_WIRE_GRB, LIGHTBAR_WIRE_GRBW, LIGHTBAR_WIRE_WS2812_SPI3,
+    LIGHTBAR_WIRE_WS2812_SPI4, LIGHTBAR_WIRE_APA102
+};
+
+/* Straightforward bit-by-bit WS2812 SPI encoding of one byte. */
+static void spi_byte(uint8_t v, int bits_per_bit, uint8_t *out, size_t *bit) {
+    for (int k = 7; k >= 0; k--) {
+        int one = (v >> k) & 1;
+        for (int j = 0; j < bits_per_bit; j++) {
+            int high = (j == 0) || (one && j < bits_per_bit - 1);
+            if (high) out[*bit / 8] |= (uint8_t)(0x80 >> (*bit % 8));
+            (*bit)++;
+        }
+    }
+}
+
+/* Encodes a rendered Led[] the slow way, as a driver would after render. */
+static size_t reference_encode(LightbarWireFormat format, const Led *leds, int n,
+                               uint8_t brightness, uint8_t *out) {
+    size_t size = lightbar_wire_size(format, (uint16_t)n);
+    size_t bit = 0;
+    uint8_t *p = out;
+    memset(out, 0, size);
+    if (format == LIGHTBAR_WIRE_APA102) p += 4;
+    for (int i = 0; i < n; i++) {
+        Led led = leds[i];
+        uint8_t grb[3] = { led.g, led.r, led.b };
+        switch (format) {
+        case LIGHTBAR_WIRE_GRB:
+            memcpy(p, grb, 3);
+            p += 3;
+            break;
+        case LIGHTBAR_WIRE_GRBW:
+            memcpy(p, grb, 3);
+            p[3] = 0;
+            p += 4;
+            break;
+        case LIGHTBAR_WIRE_WS2812_SPI3:
+        case LIGHTBAR_WIRE_WS2812_SPI4:
+            for (int c = 0; c < 3; c++) {
+                spi_byte(grb[c], format == LIGHTBAR_WIRE_WS2812_SPI3 ? 3 : 4, out, &bit);
+            }
+            break;
+        case LIGHTBAR_WIRE_APA102:
+            p[0] = (uint8_t)(0xE0 | brightness);
+            p[1] = led.b;
+            p[2] = led.g;
+            p[3] = led.r;
+            p += 4;
+            break;
+        }
+    }
+    if (format == LIGHTBAR_WIRE_APA102) {
+        memset(p, 0xFF, size - (size_t)(p - out));
+    }
+    return size;
+}
+
+static void assert_matches_render(const LightbarWire *wire, const LightbarState *state,
+                                  const LightbarConfig *config) {
+    static Led leds[MAX_LEDS];
+    static uint8_t expected[MAX_LEDS * 12 + 64];
+    lightbar_render(state, config, leds);
+    size_t size = reference_encode(wire->format, leds, config->num_leds,
+                                   wire->brightness, expected);
+    TEST_ASSERT_EQUAL_MEMORY(expected, wire->data, size);
+}
+
+void test_sizes(void) {
+    TEST_ASSERT_EQUAL_size_t(72, lightbar_wire_size(LIGHTBAR_WIRE_GRB, 24));
+    TEST_ASSERT_EQUAL_size_t(96, lightbar_wire_size(LIGHTBAR_WIRE_GRBW, 24));
+    TEST_ASSERT_EQUAL_size_t(216, lightbar_wire_size(LIGHTBAR_WIRE_WS2812_SPI3, 24));
+    TEST_ASSERT_EQUAL_size_t(288, lightbar_wire_size(LIGHTBAR_WIRE_WS2812_SPI4, 24));
+    TEST_ASSERT_EQUAL_size_t(4 + 96 + 4, lightbar_wire_size(LIGHTBAR_WIRE_APA102, 24));
+    TEST_ASSERT_EQUAL_size_t(4 + 1200 + 19, lightbar_wire_size(LIGHTBAR_WIRE_APA102, 300));
+}
+
+void test_spi3_encodes_known_bytes(void) {
+    uint8_t data[9];
+    LightbarWire wire;
+    LightbarConfig config = { .num_leds = 1, .speed = 10.0f, .color = { 0x00, 0xFF, 0xA5 } };
+    LightbarState state;
+    lightbar_init(&state, &config);
+    state.position = 0;
+    lightbar_wire_init(&wire, LIGHTBAR_WIRE_WS2812_SPI3, 1, 0, data);
+    lightbar_wire_render(&wire, &state, &config);
+    /* G = 0xFF, R = 0x00, B = 0xA5 */
+    const uint8_t expected[9] = { 0xDB, 0x6D, 0xB6, 0x92, 0x49, 0x24, 0xD3, 0x49, 0xA6 };
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, data, 9);
+}
+
+void test_spi4_encodes_known_bytes(void) {
+    uint8_t data[12];
+    LightbarWire wire;
+    LightbarConfig config = { .num_leds = 1, .speed = 10.0f, .color = { 0x00, 0xFF, 0xA5 } };
+    LightbarState state;
+    lightbar_init(&state, &config);
+    state.position = 0;
+    lightbar_wire_init(&wire, LIGHTBAR_WIRE_WS2812_SPI4, 1, 0, data);
+    lightbar_wire_render(&wire, &state, &config);
+    const uint8_t expected[12] = { 0xEE, 0xEE, 0xEE, 0xEE, 0x88, 0x88, 0x88, 0x88,
+                                   0xE8, 0xE8, 0x8E, 0x8E };
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, data, 12);
+}
+
+void test_apa102_frames_and_brightness(void) {
+    uint8_t data[4 + 40 + 4];
+    LightbarWire wire;
+    LightbarConfig config = { .num_leds = 10, .speed = 10.0f, .color = { 1, 2, 3 } };
+    LightbarState state;
+    lightbar_init(&state, &config);
+    lightbar_wire_init(&wire, LIGHTBAR_WIRE_APA102, 10, 7, data);
+    lightbar_wire_render(&wire, &state, &config);
+    const uint8_t start[4] = { 0, 0, 0, 0 };
+    const uint8_t lit[4] = { 0xE7, 3, 2, 1 };
+    const uint8_t dark[4] = { 0xE7, 0, 0, 0 };
+    const uint8_t end[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(start, data, 4);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(dark, data + 4, 4);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(lit, data + 4 + 5 * 4, 4);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(end, data + 44, 4);
+
+    lightbar_wire_set_brightness(&wire, 31);
+    lightbar_wire_render(&wire, &state, &config);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, data[4]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, data[4 + 9 * 4]);
+    assert_matches_render(&wire, &state, &config);
+}
+
+/* Incremental encoding must give the same bytes as a full render + encode
+ * for every format across moves, pauses, smooth blends and config changes. */
+void test_matches_render_every_frame(void) {
+    static uint8_t data[MAX_LEDS * 12 + 64];
+    srand(7);
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+        LightbarConfig config = {
+            .num_leds = 60, .speed = 37.0f, .end_pause_ms = 100,
+            .glow_radius = 4, .color = { 200, 100, 50 }, .smooth = 1
+        };
+        LightbarState state;
+        LightbarWire wire;
+        memset(data, 0xAB, sizeof(data));
+        lightbar_init(&state, &config);
+        lightbar_start(&state);
+        lightbar_wire_init(&wire, formats[f], config.num_leds, 5, data);
+        for (int frame = 0; frame < 2000; frame++) {
+            if (frame % 500 == 250) {
+                config.glow_radius = (uint16_t)(rand() % 8);
+                config.color.g = (uint8_t)rand();
+                config.smooth = (uint8_t)(rand() & 1);
+            }
+            lightbar_update(&state, &config, (float)(1 + rand() % 20));
+            lightbar_wire_render(&wire, &state, &config);
+            assert_matches_render(&wire, &state, &config);
+        }
+    }
+}
+
+void test_large_strip_all_formats(void) {
+    static uint8_t data[MAX_LEDS * 12 + 64];
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+        LightbarConfig config = {
+            .num_leds = MAX_LEDS, .speed = 500.0f, .glow_radius = 20,
+            .color = { 255, 255, 255 }
+        };
+        LightbarState state;
+        LightbarWire wire;
+        lightbar_init(&state, &config);
+        lightbar_start(&state);
+        lightbar_wire_init(&wire, formats[f], config.num_leds, 31, data);
+        for (int frame = 0; frame < 200; frame++) {
+            lightbar_update(&state, &config, 16.0f);
+            lightbar_wire_render(&wire, &state, &config);
+        }
+        assert_matches_render(&wire, &state, &config);
+    }
+}
+
+void test_pair_alternates_buffers(void) {
+    static uint8_t a[72], b[72];
+    LightbarConfig config = {
+        .num_leds = 24, .speed = 50.0f, .glow_radius = 2, .color = { 255, 0, 0 }
+    };
+    LightbarState state;
+    LightbarWirePair pair;
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    lightbar_wire_pair_init(&pair, LIGHTBAR_WIRE_GRB, 24, 0, a, b);
+
+    const uint8_t *first = lightbar_wire_pair_render(&pair, &state, &config);
+    lightbar_update(&state, &config, 20.0f);
+    const uint8_t *second = lightbar_wire_pair_render(&pair, &state, &config);
+    lightbar_update(&state, &config, 20.0f);
+    const uint8_t *third = lightbar_wire_pair_render(&pair, &state, &config);
+
+    TEST_ASSERT_TRUE(first != second);
+    TEST_ASSERT_TRUE(first == third);
+    /* The buffer handed out two frames ago is brought fully up to date */
+    for (int frame = 0; frame < 300; frame++) {
+        lightbar_update(&state, &config, 7.0f);
+        const uint8_t *front = lightbar_wire_pair_render(&pair, &state, &config);
+        TEST_ASSERT_TRUE(front == pair.buffers[pair.front].data);
+        assert_matches_render(&pair.buffers[pair.front], &state, &config);
+    }
+}
+
+/* Two channels of different formats behind one layout: each buffer must
+ * hold the reference encoding of its physical LEDs. */
+void test_layout_matches_render(void) {
+    static uint8_t data[2][MAX_LEDS * 12 + 64];
+    static uint8_t expected[MAX_LEDS * 12 + 64];
+    static Led leds[MAX_LEDS];
+    static Led physical[2][MAX_LEDS];
+    const uint32_t channel_leds[2] = { 50, 40 };
+    LightbarConfig config = {
+        .num_leds = 60, .speed = 45.0f, .end_pause_ms = 50,
+        .glow_radius = 3, .color = { 10, 200, 90 }, .smooth = 1
+    };
+    LightbarState state;
+    LightbarLayout layout;
+    LightbarWire wires[2];
+    TEST_ASSERT_EQUAL_INT(0, lightbar_layout_init(&layout, 60, 2, channel_leds));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_layout_segment(&layout, 0, 35, 0, 10, 0));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_layout_segment(&layout, 40, 20, 1, 5, 1));
+    TEST_ASSERT_EQUAL_INT(0, lightbar_layout_compile(&layout));
+    lightbar_init(&state, &config);
+    lightbar_start(&state);
+    lightbar_wire_init(&wires[0], LIGHTBAR_WIRE_WS2812_SPI3, 50, 0, data[0]);
+    lightbar_wire_init(&wires[1], LIGHTBAR_WIRE_APA102, 40, 9, data[1]);
+    for (int frame = 0; frame < 1000; frame++) {
+        lightbar_update(&state, &config, 13.0f);
+        lightbar_wire_render_layout(wires, &layout, &state, &config);
+        lightbar_render(&state, &config, leds);
+        memset(physical, 0, sizeof(physical));
+        for (int i = 0; i < 35; i++) physical[0][10 + i] = leds[i];
+        for (int i = 0; i < 20; i++) physical[1][24 - i] = leds[40 + i];
+        for (int c = 0; c < 2; c++) {
+            size_t size = reference_encode(wires[c].format, physical[c], (int)channel_leds[c],
+                                           wires[c].brightness, expected);
+            TEST_ASSERT_EQUAL_MEMORY(expected, data[c], size);
+        }
+    }
+    lightbar_layout_free(&layout);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sizes);
+    RUN_TEST(test_spi3_encodes_known_bytes);
+    RUN_TEST(test_spi4_encodes_known_bytes);
+    RUN_TEST(test_apa102_frames_and_brightness);
+    RUN_TEST(test_matches_render_every_frame);
+    RUN_TEST(test_large_strip_all_formats);
+    RUN_TEST(test_pair_alternates_buffers);
+    RUN_TEST(test_layout_matches_render);
+    return UNITY_END();
+}
@@ -5,12 +5,49 @@
 void setUp(void) {}
 void tearDown(void) {}
 
-void test_hello_message_returns_greeting(void) {
-    TEST_ASSERT_EQUAL_STRING("Hello, World!", hello_message());
+void test_parse_options_defaults(void) {
+    char *argv[] = { "lightbar" };
+    Options options;
+    TEST_ASSERT_EQUAL_INT(0, parse_options(1, argv, &options));
+    TEST_ASSERT_EQUAL_STRING(MAIN_DEFAULT_SOCKET, options.socket_path);
+    TEST_ASSERT_EQUAL_INT(MAIN_DEFAULT_WORKERS, options.workers);
+    TEST_ASSERT_NULL(options.stats_name);
+}
+
+void test_parse_options_socket_and_workers(void) {
+    char *argv[] = { "lightbar", "-w", "8", "-s", "/run/lightbar.sock" };
+    Options options;
+    TEST_ASSERT_EQUAL_INT(0, parse_options(5, argv, &options));
+    TEST_ASSERT_EQUAL_STRING("/run/lightbar.sock", options.socket_path);
+    TEST_ASSERT_EQUAL_INT(8, options.workers);
+}
+
+void test_parse_options_stats_name(void) {
+    char *argv[] = { "lightbar", "-m", "/lightbar" };
+    char *relative[] = { "lightbar", "-m", "lightbar" };
+    Options options;
+    TEST_ASSERT_EQUAL_INT(0, parse_options(3, argv, &options));
+    TEST_ASSERT_EQUAL_STRING("/lightbar", options.stats_name);
+    TEST_ASSERT_EQUAL_INT(-1, parse_options(3, relative, &options));
+}
+
+void test_parse_options_rejects_bad_command_line(void) {
+    char *missing[] = { "lightbar", "-s" };
+    char *zero[] = { "lightbar", "-w", "0" };
+    char *words[] = { "lightbar", "-w", "four" };
+    char *unknown[] = { "lightbar", "-x", "1" };
+    Options options;
+    TEST_ASSERT_EQUAL_INT(-1, parse_options(2, missing, &options));
+    TEST_ASSERT_EQUAL_INT(-1, parse_options(3, zero, &options));
+    TEST_ASSERT_EQUAL_INT(-1, parse_options(3, words, &options));
+    TEST_ASSERT_EQUAL_INT(-1, parse_options(3, unknown, &options));
 }
 
 int main(void) {
     UNITY_BEGIN();
-    RUN_TEST(test_hello_message_returns_greeting);
+    RUN_TEST(test_parse_options_defaults);
+    RUN_TEST(test_parse_options_socket_and_workers);
+    RUN_TEST(test_parse_options_stats_name);
+    RUN_TEST(test_parse_options_rejects_bad_command_line);
     return UNITY_END();
 }
@@ -0,0 +1,130 @@
+#include "unity.h"
+#include "timer_wheel.h"
+#include <stdlib.h>
+
+#define N_TIMERS 2000
+
+typedef struct {
+    TimerEntry entry;
+    uint64_t fired_at;
+    int fired;
+} Timer;
+
+static TimerWheel wheel;
+static Timer timers[N_TIMERS];
+
+void setUp(void) {
+    timer_wheel_init(&wheel, 0);
+    for (int i = 0; i < N_TIMERS; i++) {
+        timers[i].fired = 0;
+        timers[i].entry.next = NULL;
+    }
+}
+
+void tearDown(void) {}
+
+static void record(TimerEntry *entry, void *ctx) {
+    (void)ctx;
+    Timer *timer = (Timer *)entry;
+    timer->fired++;
+    timer->fired_at = wheel.now;
+}
+
+void test_timer_fires_at_its_tick(void) {
+    timer_wheel_add(&wheel, &timers[0].entry, 10);
+    timer_wheel_advance(&wheel, 9, record, NULL);
+    TEST_ASSERT_EQUAL_INT(0, timers[0].fired);
+    timer_wheel_advance(&wheel, 10, record, NULL);
+    TEST_ASSERT_EQUAL_INT(1, timers[0].fired);
+    TEST_ASSERT_EQUAL_UINT64(10, timers[0].fired_at);
+    TEST_ASSERT_EQUAL_UINT32(0, wheel.count);
+}
+
+void test_past_expiry_fires_on_next_tick(void) {
+    timer_wheel_advance(&wheel, 100, record, NULL);
+    timer_wheel_add(&wheel, &timers[0].entry, 50);
+    timer_wheel_advance(&wheel, 101, record, NULL);
+    TEST_ASSERT_EQUAL_INT(1, timers[0].fired);
+    TEST_ASSERT_EQUAL_UINT64(101, timers[0].fired_at);
+}
+
+/* Timers spread over every level fire exactly on their tick, however the
+ * wheel is advanced. */
+void test_random_timers_fire_exactly_once_on_time(void) {
+    srand(11);
+    for (int i = 0; i < N_TIMERS; i++) {
+        uint64_t expires = 1 + (uint64_t)(rand() % 5) * (uint64_t)rand() % 20000000u;
+        timer_wheel_add(&wheel, &timers[i].entry, expires);
+    }
+    uint64_t now = 0;
+    while (wheel.count > 0) {
+        now += 1 + (uint64_t)(rand() % 3000);
+        timer_wheel_advance(&wheel, now, record, NULL);
+    }
+    for (int i = 0; i < N_TIMERS; i++) {
+        TEST_ASSERT_EQUAL_INT(1, timers[i].fired);
+        TEST_ASSERT_EQUAL_UINT64(timers[i].entry.expires, timers[i].fired_at);
+    }
+}
+
+void test_cascade_boundaries(void) {
+    static const uint64_t ticks[] = { 255, 256, 257, 511, 512, 65535, 65536, 65537, 16777216 };
+    for (int i = 0; i < 9; i++) {
+        timer_wheel_add(&wheel, &timers[i].entry, ticks[i]);
+    }
+    timer_wheel_advance(&wheel, 16777216, record, NULL);
+    for (int i = 0; i < 9; i++) {
+        TEST_ASSERT_EQUAL_UINT64(ticks[i], timers[i].fired_at);
+    }
+}
+
+void test_remove_cancels_timer(void) {
+    timer_wheel_add(&wheel, &timers[0].entry, 1000);
+    timer_wheel_add(&wheel, &timers[1].entry, 1000);
+    TEST_ASSERT_TRUE(timer_wheel_pending(&timers[0].entry));
+    timer_wheel_remove(&wheel, &timers[0].entry);
+    TEST_ASSERT_FALSE(timer_wheel_pending(&timers[0].entry));
+    timer_wheel_remove(&wheel, &timers[0].entry);
+    TEST_ASSERT_EQUAL_UINT32(1, wheel.count);
+    timer_wheel_advance(&wheel, 2000, record, NULL);
+    TEST_ASSERT_EQUAL_INT(0, timers[0].fired);
+    TEST_ASSERT_EQUAL_INT(1, timers[1].fired);
+}
+
+static void rearm(TimerEntry *entry, void *ctx) {
+    Timer *timer = (Timer *)entry;
+    timer->fired++;
+    if (timer->fired < 100) {
+        timer_wheel_add(&wheel, entry, entry->expires + *(uint64_t *)ctx);
+    }
+}
+
+void test_periodic_rearm_from_callback(void) {
+    uint64_t period = 167;
+    timer_wheel_add(&wheel, &timers[0].entry, period);
+    timer_wheel_advance(&wheel, 1000000, rearm, &period);
+    TEST_ASSERT_EQUAL_INT(100, timers[0].fired);
+    TEST_ASSERT_EQUAL_UINT64(100 * period, timers[0].entry.expires);
+}
+
+void test_next_reports_nearest_expiry_or_cascade(void) {
+    TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, timer_wheel_next(&wheel));
+    timer_wheel_add(&wheel, &timers[0].entry, 40);
+    TEST_ASSERT_EQUAL_UINT64(40, timer_wheel_next(&wheel));
+    timer_wheel_advance(&wheel, 40, record, NULL);
+    timer_wheel_add(&wheel, &timers[1].entry, 100000);
+    /* Must wake at the level-0 wrap to cascade */
+    TEST_ASSERT_EQUAL_UINT64(256 - 40, timer_wheel_next(&wheel));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_timer_fires_at_its_tick);
+    RUN_TEST(test_past_expiry_fires_on_next_tick);
+    RUN_TEST(test_random_timers_fire_exactly_once_on_time);
+    RUN_TEST(test_cascade_boundaries);
+    RUN_TEST(test_remove_cancels_timer);
+    RUN_TEST(test_periodic_rearm_from_callback);
+    RUN_TEST(test_next_reports_nearest_expiry_or_cascade);
+    return UNITY_END();
+}
@@ -0,0 +1,88 @@
+#define _GNU_SOURCE
+#include "lightbar_record.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Replays a recorded session through the core, from any point in it.
+ *
+ *   lightbar_replay [-f from_ms] [-t to_ms] [-v] file
+ *
+ * -v prints every start, stop, config change and checkpoint on the way,
+ * with the session time it happened at. */
+
+static const char *op_names[] = {
+    "end", "init", "start", "stop", "update", "repeat", "checkpoint",
+    "num_leds", "speed", "end_pause", "glow", "color", "smooth", "lut",
+    "profile", "cached"
+};
+
+static const char *phase_names[] = { "stopped", "moving", "paused", "stopping" };
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static void print_state(const LightbarReplay *replay) {
+    const LightbarState *s = &replay->state;
+    printf("%12.3f ms  frame %llu  position %d  direction %d  %s  pause %.3f  accum %.3f\n",
+           replay->time_ms, (unsigned long long)replay->frames, s->position, s->direction,
+           (unsigned)s->phase < 4 ? phase_names[s->phase] : "?", s->pause_timer_ms,
+           s->move_accum_ms);
+}
+
+int main(int argc, char **argv) {
+    double from = 0.0, to = -1.0;
+    int verbose = 0, opt;
+    while ((opt = getopt(argc, argv, "f:t:v")) != -1) {
+        switch (opt) {
+        case 'f': from = atof(optarg); break;
+        case 't': to = atof(optarg); break;
+        case 'v': verbose = 1; break;
+        default: optind = argc + 1; break;
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "usage: %s [-f from_ms] [-t to_ms] [-v] file\n", argv[0]);
+        return 2;
+    }
+
+    LightbarReplay replay;
+    if (lightbar_replay_open(&replay, argv[optind]) != 0) {
+        fprintf(stderr, "%s: not a readable recording\n", argv[optind]);
+        return 1;
+    }
+    printf("%zu checkpoints, last at %.3f ms\n", replay.index_count,
+           replay.index_count ? replay.index[replay.index_count - 1].time_ms : 0.0);
+
+    double start = now_ms();
+    if (lightbar_replay_seek(&replay, from) != 0) {
+        fprintf(stderr, "corrupt record before %.3f ms\n", from);
+        return 1;
+    }
+    print_state(&replay);
+
+    double begin = replay.time_ms;
+    uint64_t mismatches = replay.mismatches;
+    int op;
+    while ((to < 0.0 || replay.time_ms < to) && (op = lightbar_replay_next(&replay)) > 0) {
+        if (replay.mismatches != mismatches) {
+            mismatches = replay.mismatches;
+            printf("%12.3f ms  replayed state differs from the recording\n", replay.time_ms);
+        }
+        if (verbose && op != LIGHTBAR_REC_UPDATE) {
+            printf("%12.3f ms  %s\n", replay.time_ms, op_names[op]);
+        }
+    }
+    double wall = now_ms() - start;
+    print_state(&replay);
+    if (replay.error) printf("recording is corrupt after %.3f ms\n", replay.time_ms);
+    printf("%.3f s of session in %.3f ms (%.0fx real time), %llu mismatches\n",
+           (replay.time_ms - begin) / 1e3, wall, wall > 0.0 ? (replay.time_ms - begin) / wall : 0.0,
+           (unsigned long long)replay.mismatches);
+    lightbar_replay_close(&replay);
+    return replay.error || replay.mismatches ? 1 : 0;
+}
@@ -0,0 +1,94 @@
+#define _GNU_SOURCE
+#include "lightbar_stats.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Prints the live counters a daemon started with -m publishes.
+ *
+ *   lightbar_stats [-i interval_ms [-n count]] name
+ *
+ * The block is mapped read-only, so sampling never writes to memory the
+ * daemon touches. With -i the table repeats every interval, with frame
+ * rates over the last one. */
+
+#define MAX_SLOTS 4096
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+static double avg(uint64_t sum, uint64_t count) {
+    return count ? (double)sum / (double)count : 0.0;
+}
+
+static void print_table(const LightbarStats *stats, LightbarStatsSlot *last, long interval_ms) {
+    uint32_t count = stats->header->slots < MAX_SLOTS ? stats->header->slots : MAX_SLOTS;
+    printf("%-16s %10s %7s %10s %5s %8s %8s %6s %9s %9s %8s %8s %8s\n", "session", "frames",
+           "fps", "steps", "max", "edges", "pauses", "stops", "stop_avg", "stop_max",
+           "rend_min", "rend_avg", "rend_max");
+    for (uint32_t i = 0; i < count; i++) {
+        LightbarStatsSlot s;
+        if (!lightbar_stats_sample(stats, i, &s)) {
+            last[i].generation = 0;
+            continue;
+        }
+        double fps = 0.0;
+        if (interval_ms > 0 && last[i].generation == s.generation) {
+            fps = (double)(s.frames - last[i].frames) * 1000.0 / (double)interval_ms;
+        }
+        printf("%-16s %10llu %7.1f %10llu %5llu %8llu %8llu %6llu %7.1fms %7.1fms "
+               "%6.1fus %6.1fus %6.1fus\n",
+               s.name, (unsigned long long)s.frames, fps, (unsigned long long)s.steps,
+               (unsigned long long)s.max_steps, (unsigned long long)s.edges,
+               (unsigned long long)s.pauses, (unsigned long long)s.stops,
+               avg(s.stop_ns_sum, s.stops) / 1e6, (double)s.stop_ns_max / 1e6,
+               s.frames ? (double)s.render_ns_min / 1e3 : 0.0,
+               avg(s.render_ns_sum, s.frames) / 1e3, (double)s.render_ns_max / 1e3);
+        last[i] = s;
+    }
+}
+
+int main(int argc, char **argv) {
+    long interval_ms = 0, rounds = -1;
+    int opt;
+    while ((opt = getopt(argc, argv, "i:n:")) != -1) {
+        switch (opt) {
+        case 'i': interval_ms = strtol(optarg, NULL, 10); break;
+        case 'n': rounds = strtol(optarg, NULL, 10); break;
+        default: optind = argc + 1; break;
+        }
+    }
+    if (optind != argc - 1 || interval_ms < 0) {
+        fprintf(stderr, "usage: %s [-i interval_ms [-n count]] name\n", argv[0]);
+        return 2;
+    }
+
+    LightbarStats stats;
+    if (lightbar_stats_open(&stats, argv[optind]) != 0) {
+        fprintf(stderr, "%s: %s\n", argv[optind],
+                errno == EINVAL ? "not a lightbar stats block" : strerror(errno));
+        return 1;
+    }
+    static LightbarStatsSlot last[MAX_SLOTS];
+    if (interval_ms == 0) rounds = 1;
+    for (long n = 0; rounds < 0 || n < rounds; n++) {
+        if (n > 0) {
+            sleep_ms(interval_ms);
+            putchar('\n');
+        }
+        if (kill((pid_t)stats.header->pid, 0) != 0 && errno == ESRCH) {
+            printf("daemon %u has exited; counters are final\n", stats.header->pid);
+        }
+        print_table(&stats, last, interval_ms);
+        fflush(stdout);
+    }
+    lightbar_stats_close(&stats);
+    return 0;
+}
@@ -0,0 +1,128 @@
+#define _GNU_SOURCE
+#include "lightbar_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Converts a lightbar_trace_dump() file to Chrome trace JSON, for
+ * chrome://tracing or ui.perfetto.dev.
+ *
+ *   lightbar_trace_json [-o out.json] file
+ *
+ * Update, advance, render and frame become nested slices on their thread's
+ * track, phase changes instant events, and the dot position a counter. */
+
+#define MAX_DEPTH 64
+
+static const char *slice_names[] = { "update", "advance", "render", "frame" };
+static const char *phase_names[] = { "stopped", "moving", "paused", "stopping" };
+static const char *end_args[] = { "steps", "steps", "leds", "leds" };
+
+static const char *phase_name(unsigned phase) {
+    return phase < 4 ? phase_names[phase] : "?";
+}
+
+static int first = 1;
+
+static void separator(FILE *out) {
+    fputs(first ? "\n" : ",\n", out);
+    first = 0;
+}
+
+static void write_record(FILE *out, const LightbarTraceHeader *h, uint32_t tid,
+                         const LightbarTraceRecord *r, int *depth) {
+    double ts_us = (double)(int64_t)(r->ticks - h->base_ticks) * h->ns_per_tick / 1000.0;
+    if (r->event == LIGHTBAR_TRACE_PHASE) {
+        separator(out);
+        fprintf(out, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,"
+                "\"tid\":%u,\"args\":{\"position\":%d}}", phase_name(r->phase), ts_us, tid,
+                (int)r->position);
+        return;
+    }
+    if (r->event >= LIGHTBAR_TRACE_PHASE) return;
+
+    int slice = r->event / 2;
+    int begin = (r->event & 1) == 0;
+    if (begin) {
+        if (*depth == MAX_DEPTH) return;
+        ++*depth;
+        separator(out);
+        fprintf(out, "{\"name\":\"%s\",\"ph\":\"B\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,"
+                "\"args\":{\"phase\":\"%s\",\"position\":%d}}", slice_names[slice], ts_us, tid,
+                phase_name(r->phase), (int)r->position);
+        return;
+    }
+    /* The ring may have wrapped past the begin of the oldest slices */
+    if (*depth == 0) return;
+    --*depth;
+    separator(out);
+    fprintf(out, "{\"name\":\"%s\",\"ph\":\"E\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,"
+            "\"args\":{\"phase\":\"%s\",\"position\":%d,\"%s\":%u}}", slice_names[slice], ts_us,
+            tid, phase_name(r->phase), (int)r->position, end_args[slice], (unsigned)r->arg);
+    if (r->event == LIGHTBAR_TRACE_UPDATE_END || r->event == LIGHTBAR_TRACE_ADVANCE_END) {
+        separator(out);
+        fprintf(out, "{\"name\":\"position %u\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,"
+                "\"args\":{\"position\":%d}}", tid, ts_us, (int)r->position);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *out_path = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "o:")) != -1) {
+        switch (opt) {
+        case 'o': out_path = optarg; break;
+        default: optind = argc + 1; break;
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "usage: %s [-o out.json] file\n", argv[0]);
+        return 2;
+    }
+
+    FILE *in = fopen(argv[optind], "rb");
+    LightbarTraceHeader h;
+    if (!in || fread(&h, sizeof(h), 1, in) != 1 ||
+        memcmp(h.magic, LIGHTBAR_TRACE_MAGIC, sizeof(h.magic)) != 0 ||
+        h.record_size != sizeof(LightbarTraceRecord)) {
+        fprintf(stderr, "%s: not a lightbar trace\n", argv[optind]);
+        return 1;
+    }
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        perror(out_path);
+        return 1;
+    }
+
+    uint64_t total = 0;
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", out);
+    for (uint32_t i = 0; i < h.rings; i++) {
+        LightbarTraceRingHeader rh;
+        LightbarTraceRecord r;
+        int depth = 0;
+        if (fread(&rh, sizeof(rh), 1, in) != 1) {
+            fprintf(stderr, "%s: truncated\n", argv[optind]);
+            return 1;
+        }
+        separator(out);
+        fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                "\"args\":{\"name\":\"lightbar %u\"}}", rh.tid, rh.tid);
+        for (uint64_t k = 0; k < rh.count; k++) {
+            if (fread(&r, sizeof(r), 1, in) != 1) {
+                fprintf(stderr, "%s: truncated\n", argv[optind]);
+                return 1;
+            }
+            write_record(out, &h, rh.tid, &r, &depth);
+        }
+        total += rh.count;
+    }
+    fputs("\n]}\n", out);
+    fclose(in);
+    if (out != stdout && fclose(out) != 0) {
+        perror(out_path);
+        return 1;
+    }
+    fprintf(stderr, "%u threads, %llu records\n", h.rings, (unsigned long long)total);
+    return 0;
+}
@@ -0,0 +1,120 @@
+/* Shared by the page and web/lightbar_worker.js, so the lightbar runs the
+ * same way on or off the main thread. */
+
+/* Control messages are batched lists of ops: ['start'], ['speed', 15],
+ * ['color', r, g, b], ... applied in order. */
+function lightbarApply(M, ops) {
+    for (var i = 0; i < ops.length; i++) {
+        var op = ops[i];
+        switch (op[0]) {
+        case 'start': M._wasm_start(); break;
+        case 'stop': M._wasm_stop(); break;
+        case 'speed': M._wasm_set_speed(op[1]); break;
+        case 'pause': M._wasm_set_end_pause(op[1]); break;
+        case 'color': M._wasm_set_color(op[1], op[2], op[3]); break;
+        case 'brightness': M._wasm_set_brightness(op[1]); break;
+        case 'power': M._wasm_set_power_budget(op[1]); break;
+        case 'smooth': M._wasm_set_smooth(op[1]); break;
+        case 'profile': lightbarSetProfile(M, op[1], op[2]); break;
+        case 'record': op[1] ? M._wasm_record_start() : M._wasm_record_stop(); break;
+        }
+    }
+}
+
+var lightbarProfiles = { linear: 0, sine: 1, 'ease-in-out': 2, custom: 3 };
+
+/* name is a key of lightbarProfiles; a custom profile takes points, an
+ * array of leg fractions from one end (0) to the other (1). */
+function lightbarSetProfile(M, name, points) {
+    var type = lightbarProfiles[name];
+    if (type === undefined) return;
+    var count = 0;
+    if (points) {
+        var buffer = new Float32Array(M.HEAPU8.buffer, M._wasm_get_profile_points_ptr(), 257);
+        count = Math.min(points.length, buffer.length);
+        buffer.set(points.slice(0, count));
+    }
+    M._wasm_set_profile(type, count);
+}
+
+/* The last finished recording (['record', 0] ends one) for
+ * build/lightbar_replay, or null if there is none. */
+function lightbarRecording(M) {
+    try {
+        return M.FS.readFile('/session.lbr');
+    } catch (e) {
+        return null;
+    }
+}
+
+/* Whether the browser accepts a module using a v128 instruction */
+function lightbarSimdSupported() {
+    return typeof WebAssembly === 'object' && WebAssembly.validate(new Uint8Array([
+        0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0,
+        10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11
+    ]));
+}
+
+/* Builds worth trying, best first */
+function lightbarScripts() {
+    return lightbarSimdSupported() ? ['main_simd.js', 'main.js'] : ['main.js'];
+}
+
+/* Starts the first build from lightbarScripts() that loads and calls
+ * ready(M) with its module. load(src, M, failed) must run src with M as its
+ * Module and call failed() if the script cannot be fetched; a build that
+ * aborts while starting up (say its .wasm is missing) also moves on to the
+ * next one. */
+function lightbarLoad(load, ready) {
+    var scripts = lightbarScripts();
+    var next = 0;
+
+    function attempt() {
+        var settled = false;
+        function failed() {
+            if (settled) return;
+            settled = true;
+            if (next < scripts.length) attempt();
+        }
+        var M = {
+            onRuntimeInitialized: function() {
+                if (settled) return;
+                settled = true;
+                ready(M);
+            },
+            onAbort: failed
+        };
+        load(scripts[next++], M, failed);
+    }
+
+    attempt();
+}
+
+/* Initialises the core and runs the frame loop, drawing to canvas (an
+ * HTMLCanvasElement or OffscreenCanvas) with one putImageData per changed
+ * frame. raf schedules the next frame with a timestamp in ms. */
+function lightbarRun(M, canvas, init, raf) {
+    M._wasm_init(init.numLeds, init.speed, init.pause, init.glow, init.r, init.g, init.b);
+    canvas.width = init.numLeds;
+    canvas.height = 1;
+    var ctx = canvas.getContext('2d');
+    /* ImageData over the bridge's RGBA buffer: no copies, no per-LED JS */
+    var pixels = new Uint8ClampedArray(M.HEAPU8.buffer, M._wasm_get_rgba_ptr(), init.numLeds * 4);
+    var image = new ImageData(pixels, init.numLeds, 1);
+    var lastTime = 0;
+
+    function tick(dt) {
+        if (M._wasm_tick(dt)) ctx.putImageData(image, 0, 0);
+    }
+
+    function frame(time) {
+        var dt = lastTime > 0 ? time - lastTime : 0;
+        lastTime = time;
+        tick(dt);
+        raf(frame);
+    }
+
+    /* Render initial stopped state */
+    tick(0);
+    raf(frame);
+}
@@ -0,0 +1,44 @@
+/* Runs the lightbar core off the main thread, drawing to an OffscreenCanvas,
+ * so UI work and GC pauses on the page do not disturb the motion. */
+importScripts('lightbar_ops.js');
+
+var pending = [];
+var running = false;
+var M = null;
+
+function raf(callback) {
+    if (self.requestAnimationFrame) {
+        self.requestAnimationFrame(callback);
+    } else {
+        setTimeout(function() { callback(performance.now()); }, 1000 / 60);
+    }
+}
+
+self.onmessage = function(e) {
+    var msg = e.data;
+    if (msg.type === 'init') {
+        lightbarLoad(function(src, module, failed) {
+            self.Module = module;
+            try {
+                importScripts(src);
+            } catch (err) {
+                failed();
+            }
+        }, function(module) {
+            M = module;
+            lightbarRun(M, msg.canvas, msg.init, raf);
+            lightbarApply(M, pending);
+            pending = [];
+            running = true;
+        });
+    } else if (msg.type === 'control') {
+        if (running) {
+            lightbarApply(M, msg.ops);
+        } else {
+            pending = pending.concat(msg.ops);
+        }
+    } else if (msg.type === 'recording') {
+        var bytes = running ? lightbarRecording(M) : null;
+        self.postMessage({ type: 'recording', bytes: bytes }, bytes ? [bytes.buffer] : []);
+    }
+};
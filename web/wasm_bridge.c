@@ -1,44 +1,254 @@
 #include "lightbar.h"
+#include "lightbar_cache.h"
+#include "lightbar_command.h"
+#include "lightbar_handoff.h"
+#include "lightbar_power.h"
+#include "lightbar_record.h"
+#include "lightbar_trace.h"
 #include <emscripten.h>
+#include <stddef.h>
 
-#define MAX_LEDS 64
+#define MAX_LEDS 10000
 
+/* The setters edit control and publish it whole, only when a field
+ * actually changes; the frame loop takes the latest published version into
+ * config at the start of each update, so a setter running on another thread
+ * never changes config mid-frame. The LUT and profile are tables rather
+ * than fields, so they travel separately (see Tables) and control never
+ * points at either. */
 static LightbarConfig config;
+static LightbarConfig control;
+static LightbarHandoff handoff;
+static uint32_t config_seen;
+/* config compiled for the frame loop, rebuilt at the frame boundary only
+ * when config changed */
+static LightbarPlan plan;
+static int plan_dirty;
+/* Starts and stops, applied in order at the start of the next update */
+#define COMMAND_SLOTS 64
+static LightbarCommandSlot command_slots[COMMAND_SLOTS];
+static LightbarCommandQueue commands;
 static LightbarState state;
 static Led leds[MAX_LEDS];
+/* The strip as one row of canvas ImageData pixels */
+static uint8_t rgba[MAX_LEDS * 4];
+static LightbarDelta delta;
+static LightbarCache cache;
+/* Supply draw of the delta-rendered frame, and the budget the page set
+ * (0 for none), picked up at the next frame */
+static LightbarPower power;
+static uint32_t power_budget_ma;
+/* LUT and profile as a triple buffer: the setters fill back and swap it
+ * into middle, the frame loop swaps middle out into front when it holds
+ * something newer (FRESH). Each side only ever writes the buffer it owns,
+ * so a setter never touches tables the frame loop is drawing with. */
+typedef struct {
+    LightbarLut lut;
+    LightbarProfile profile;
+    int has_profile;
+} Tables;
+#define FRESH 4
+static Tables tables[3];
+static int back;
+static int middle;
+static int front;
+/* What the setters last asked for. Brightness only: the page shows sRGB
+ * colors, which are already gamma encoded, so the LED gamma curve would
+ * darken the preview twice. */
+static uint8_t brightness;
+static LightbarProfile profile;
+static int has_profile;
+/* Custom curve points, written by the page before wasm_set_profile() */
+static float profile_points[LIGHTBAR_PROFILE_SIZE + 1];
+static int cache_on;
+static int dirty_from;
+static int dirty_to;
+/* Session recording into the in-memory filesystem; the page reads the
+ * file back with FS.readFile(RECORD_PATH) once it is stopped. */
+#define RECORD_PATH "/session.lbr"
+static LightbarRecorder recorder;
+static int recording;
+
+/* Setter side: fills back with the requested tables and hands it over. */
+static void publish_tables(void) {
+    Tables *t = &tables[back];
+    lightbar_lut_init(&t->lut, brightness, 0);
+    t->has_profile = has_profile;
+    if (has_profile) t->profile = profile;
+    back = __atomic_exchange_n(&middle, back | FRESH, __ATOMIC_ACQ_REL) & ~FRESH;
+}
+
+/* Frame loop side: makes the newest tables front. Returns 1 if they
+ * changed. */
+static int take_tables(void) {
+    if (!(__atomic_load_n(&middle, __ATOMIC_ACQUIRE) & FRESH)) return 0;
+    front = __atomic_exchange_n(&middle, front, __ATOMIC_ACQ_REL) & ~FRESH;
+    return 1;
+}
+
+static void use_front_tables(void) {
+    config.lut = &tables[front].lut;
+    config.profile = tables[front].has_profile ? &tables[front].profile : NULL;
+}
+
+static void compile_plan(void) {
+    if (!plan_dirty) return;
+    lightbar_plan_init(&plan, &config);
+    plan_dirty = 0;
+}
 
 EMSCRIPTEN_KEEPALIVE
 void wasm_init(int num_leds, float speed, int end_pause,
                int glow_radius, int r, int g, int b) {
     if (num_leds > MAX_LEDS) num_leds = MAX_LEDS;
-    config.num_leds = (uint8_t)num_leds;
-    config.speed = speed;
-    config.end_pause_ms = (uint16_t)end_pause;
-    config.glow_radius = (uint8_t)glow_radius;
-    config.color.r = (uint8_t)r;
-    config.color.g = (uint8_t)g;
-    config.color.b = (uint8_t)b;
+    control.num_leds = (uint16_t)num_leds;
+    control.speed = speed;
+    control.end_pause_ms = (uint16_t)end_pause;
+    control.glow_radius = (uint16_t)glow_radius;
+    control.color.r = (uint8_t)r;
+    control.color.g = (uint8_t)g;
+    control.color.b = (uint8_t)b;
+    brightness = 255;
+    has_profile = 0;
+    back = 0;
+    middle = 1;
+    front = 2;
+    publish_tables();
+    lightbar_handoff_init(&handoff, &control);
+    config_seen = 0;
+    lightbar_handoff_poll(&handoff, &config, &config_seen);
+    take_tables();
+    use_front_tables();
+    plan_dirty = 1;
+    compile_plan();
+    lightbar_command_queue_init(&commands, command_slots, COMMAND_SLOTS);
     lightbar_init(&state, &config);
+    if (recording) lightbar_record_init(&recorder, &state, &config);
+    lightbar_delta_reset(&delta);
+    LightbarPowerModel ws2812 = { 20, 20, 20, 1, 0 };
+    lightbar_power_init(&power, &ws2812);
+    lightbar_cache_free(&cache);
+    for (int i = 0; i < num_leds; i++) {
+        rgba[i * 4 + 3] = 255;
+    }
 }
 
 EMSCRIPTEN_KEEPALIVE
 void wasm_start(void) {
-    lightbar_start(&state);
+    LightbarCommand command = { .type = LIGHTBAR_CMD_START };
+    lightbar_command_push(&commands, &command);
 }
 
 EMSCRIPTEN_KEEPALIVE
 void wasm_stop(void) {
-    lightbar_stop(&state, &config);
+    LightbarCommand command = { .type = LIGHTBAR_CMD_STOP };
+    lightbar_command_push(&commands, &command);
+}
+
+static void publish(void) {
+    lightbar_handoff_publish(&handoff, &control);
+}
+
+/* Frame boundary: picks up whatever the setters published since the last
+ * frame. */
+static void take_config(void) {
+    int changed = lightbar_handoff_poll(&handoff, &config, &config_seen);
+    changed |= take_tables();
+    if (changed) {
+        use_front_tables();
+        lightbar_cache_invalidate(&cache);
+        plan_dirty = 1;
+    }
+}
+
+static void record_command(const LightbarCommand *command, const LightbarState *now,
+                           const LightbarConfig *applied, void *ctx) {
+    (void)now;
+    (void)ctx;
+    if (!recording) return;
+    if (command->type == LIGHTBAR_CMD_START) {
+        lightbar_record_start(&recorder, applied);
+    } else {
+        lightbar_record_stop(&recorder, applied);
+    }
 }
 
 EMSCRIPTEN_KEEPALIVE
 void wasm_update(float dt_ms) {
-    lightbar_update(&state, &config, dt_ms);
+    take_config();
+    if (lightbar_command_apply(&commands, &state, &config, COMMAND_SLOTS, record_command,
+                               NULL) & LIGHTBAR_COMMAND_CONFIG) {
+        plan_dirty = 1;
+    }
+    compile_plan();
+    if (cache_on) {
+        lightbar_cache_update(&cache, &state, &config, dt_ms);
+    } else {
+        lightbar_update_plan(&state, &plan, dt_ms);
+    }
+    if (recording) lightbar_record_update(&recorder, &state, &config, dt_ms);
 }
 
 EMSCRIPTEN_KEEPALIVE
 void wasm_render(void) {
-    lightbar_render(&state, &config, leds);
+    lightbar_render_plan(&state, &plan, leds);
+}
+
+/* Renders the current frame into the LED buffer and returns it, copying
+ * the lit window from the cache when it holds the config. */
+EMSCRIPTEN_KEEPALIVE
+const uint8_t *wasm_render_frame(void) {
+    if (!cache_on || lightbar_cache_render(&cache, &state, leds) != 0) {
+        lightbar_render_plan(&state, &plan, leds);
+    }
+    return (const uint8_t *)leds;
+}
+
+static int render_delta(void) {
+    power.model.budget_ma = __atomic_load_n(&power_budget_ma, __ATOMIC_RELAXED);
+    return lightbar_power_render_delta(&power, &delta, &state, &plan, leds,
+                                       &dirty_from, &dirty_to);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_render_delta(void) {
+    return render_delta();
+}
+
+/* Update and render in one call. Only LEDs that changed are copied into the
+ * RGBA buffer; returns 1 if any did, 0 if the frame is unchanged. The delta
+ * path already rewrites just the old and new lit windows from the plan's
+ * glow table, and the power limiter may redraw them dimmer, so with the
+ * cache on only the timing comes from it. */
+EMSCRIPTEN_KEEPALIVE
+int wasm_tick(float dt_ms) {
+    int changed;
+    LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_FRAME_BEGIN, state.phase, 0, state.position);
+    wasm_update(dt_ms);
+    changed = render_delta();
+    for (int i = dirty_from; i < dirty_to; i++) {
+        rgba[i * 4] = leds[i].r;
+        rgba[i * 4 + 1] = leds[i].g;
+        rgba[i * 4 + 2] = leds[i].b;
+    }
+    LIGHTBAR_TRACE_EVENT(LIGHTBAR_TRACE_FRAME_END, state.phase, dirty_to - dirty_from,
+                         state.position);
+    return changed;
+}
+
+EMSCRIPTEN_KEEPALIVE
+uint8_t *wasm_get_rgba_ptr(void) {
+    return rgba;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_get_dirty_from(void) {
+    return dirty_from;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_get_dirty_to(void) {
+    return dirty_to;
 }
 
 EMSCRIPTEN_KEEPALIVE
@@ -53,20 +263,126 @@ int wasm_get_num_leds(void) {
 
 EMSCRIPTEN_KEEPALIVE
 void wasm_set_speed(float speed) {
-    config.speed = speed;
+    if (control.speed == speed) return;
+    control.speed = speed;
+    publish();
 }
 
 EMSCRIPTEN_KEEPALIVE
 void wasm_set_end_pause(int ms) {
-    config.end_pause_ms = (uint16_t)ms;
+    if (control.end_pause_ms == (uint16_t)ms) return;
+    control.end_pause_ms = (uint16_t)ms;
+    publish();
 }
 
 EMSCRIPTEN_KEEPALIVE
 void wasm_set_color(int r, int g, int b) {
-    config.color.r = (uint8_t)r;
-    config.color.g = (uint8_t)g;
-    config.color.b = (uint8_t)b;
+    if (control.color.r == (uint8_t)r && control.color.g == (uint8_t)g &&
+        control.color.b == (uint8_t)b) {
+        return;
+    }
+    control.color.r = (uint8_t)r;
+    control.color.g = (uint8_t)g;
+    control.color.b = (uint8_t)b;
+    publish();
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_set_brightness(int level) {
+    if (level < 0) level = 0;
+    if (level > 255) level = 255;
+    if (brightness == (uint8_t)level) return;
+    brightness = (uint8_t)level;
+    publish_tables();
+}
+
+/* Caps the estimated supply draw of delta-rendered frames in mA, dimming
+ * below the set brightness as needed; 0 removes the cap. */
+EMSCRIPTEN_KEEPALIVE
+void wasm_set_power_budget(int budget_ma) {
+    __atomic_store_n(&power_budget_ma, budget_ma > 0 ? (uint32_t)budget_ma : 0u,
+                     __ATOMIC_RELAXED);
+}
+
+/* Estimated draw of the last delta-rendered frame in mA */
+EMSCRIPTEN_KEEPALIVE
+int wasm_get_power_ma(void) {
+    return (int)power.ma;
+}
+
+/* Brightness the last delta-rendered frame was drawn at */
+EMSCRIPTEN_KEEPALIVE
+int wasm_get_drawn_brightness(void) {
+    return power.lut.brightness;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void wasm_set_smooth(int on) {
+    if (control.smooth == (uint8_t)(on != 0)) return;
+    control.smooth = (uint8_t)(on != 0);
+    publish();
+}
+
+EMSCRIPTEN_KEEPALIVE
+float *wasm_get_profile_points_ptr(void) {
+    return profile_points;
+}
+
+/* type is a LightbarProfileType; for LIGHTBAR_PROFILE_CUSTOM the curve is
+ * the first count entries of the points buffer. */
+EMSCRIPTEN_KEEPALIVE
+void wasm_set_profile(int type, int count) {
+    if (type == LIGHTBAR_PROFILE_CUSTOM) {
+        if (count > LIGHTBAR_PROFILE_SIZE + 1) count = LIGHTBAR_PROFILE_SIZE + 1;
+        if (lightbar_profile_init_custom(&profile, profile_points, count) != 0) return;
+    } else if (type >= LIGHTBAR_PROFILE_LINEAR && type < LIGHTBAR_PROFILE_CUSTOM) {
+        lightbar_profile_init(&profile, (LightbarProfileType)type);
+    } else {
+        return;
+    }
+    has_profile = (type != LIGHTBAR_PROFILE_LINEAR);
+    publish_tables();
+}
+
+/* Plays steady oscillation back from one precomputed period, with the same
+ * timing as the live update. */
+EMSCRIPTEN_KEEPALIVE
+void wasm_set_cache(int on) {
+    cache_on = (on != 0);
+    if (recording) lightbar_record_cached(&recorder, cache_on);
+    take_config();
+    compile_plan();
+    if (cache_on) {
+        lightbar_cache_sync(&cache, &config);
+    } else {
+        lightbar_cache_free(&cache);
+    }
+}
+
+/* Starts recording from the current state. Returns 0, or -1 if the file
+ * cannot be created. */
+EMSCRIPTEN_KEEPALIVE
+int wasm_record_start(void) {
+    if (recording) lightbar_record_close(&recorder);
+    recording = lightbar_record_open(&recorder, RECORD_PATH, 1000.0, &state, &config) == 0;
+    if (recording) lightbar_record_cached(&recorder, cache_on);
+    return recording ? 0 : -1;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int wasm_record_stop(void) {
+    if (!recording) return -1;
+    recording = 0;
+    return lightbar_record_close(&recorder);
+}
+
+#ifdef LIGHTBAR_TRACE
+/* Writes the trace rings to path in the in-memory filesystem. */
+EMSCRIPTEN_KEEPALIVE
+int wasm_trace_dump(const char *path) {
+    return lightbar_trace_dump(path);
 }
+#endif
 
 int main(void) {
     return 0;